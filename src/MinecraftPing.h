@@ -22,6 +22,33 @@
 * Procedures:
 * class Ping    -The Ping object that contains all the necessary properties of
 *       a Minecraft ServerList Ping Connection
+* class TargetList      -Memory-mapped, deduplicated list of host:port targets
+* class ResultSink      -Interface for streaming completed probes to storage
+* class NDJSONSink      -Buffered newline delimited JSON result writer
+* class BinaryLogSink   -Append-only binary result log writer
+* class BinaryLogReader -Memory-mapped binary result log reader
+* class SnapshotWriter  -Writes resolver, target and scan state to disk
+* class SnapshotReader  -Memory-mapped state snapshot reader
+* class SeriesStore     -Fixed size ring buffers of per-target latency and
+*       player count samples with range and downsampling queries
+* class ResponseHasher  -Streaming JSON response hasher with field masking
+* class FaviconStore    -Content addressed store of deduplicated favicons
+* class FaviconSplitter -Streams the favicon out of a response into a store
+* class PollScheduler   -Adaptive per-target poll scheduler
+* class RateLimiter     -Global, per-IP and per-subnet probe rate limiting
+* class SocketHandle    -Owns a socket descriptor and closes it on every path
+* class SourcePool      -Round robin pool of local addresses probes bind to
+* class HedgeBudget     -Hedged probe policy and the budget of extra attempts
+* class ShardRing       -Consistent hash ring that assigns targets to shards
+* class ScanCoordinator -Splits a scan into shards run by local or remote
+*       worker processes and merges their result logs
+* class ProbeEngine     -Probes a target list with one pinned event loop per
+*       core, each owning a hash partition of the targets
+* class DatagramClient  -Batch, resend and receive loop the UDP clients share
+* class QueryClient     -Batched UDP GameSpy4 query client sharing one socket
+* class BedrockClient   -Batched RakNet unconnected ping client for Bedrock
+* class StatusCache     -Shared per server status cache that coalesces
+*       concurrent requests and refreshes stale entries in the background
 ***************************************************************************/
 
 #ifndef MINECRAFTPING_H_INCLUDED
@@ -41,8 +68,13 @@
 
 #ifdef __cplusplus
 #include <cstring>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
 #include <stdint.h>
@@ -56,6 +88,15 @@
 #define BUFFER_SIZE 1024
 #define HANDSHAKE_MAX_SIZE 264
 #define DOMAIN_MAX_SIZE 253
+#define DEFAULT_PORT 25565
+#define PREPARED_PACKET_SIZE 272
+/*largest handshake plus request packet, a 253 byte host and 5 byte varints*/
+#define DNS_CACHE_TIME 300000
+/*milliseconds a resolved domain is reused by default*/
+#define HEDGE_HISTORY 16
+/*recent first response latencies kept per target for hedging*/
+#define CACHE_REFRESH_WORKERS 2
+/*threads of a status cache that refresh stale entries*/
 
 #ifndef nullptr
 #define nullptr NULL
@@ -63,7 +104,8 @@
 #endif // nullptr
 
 
-    enum pingError {SOCKET_INITIALIZATION_FAILURE = -11,
+    enum pingError {BUFFER_TRUNCATED = -12,
+                    SOCKET_INITIALIZATION_FAILURE = -11,
                     SOCKET_OPEN_FAILURE = -10,
                     RECEIVE_FAILURE = -9,
                     MALFORMED_VARINT_PACKET = -8,
@@ -78,9 +120,35 @@
                     CONNECT_FAILURE = 0,
                     OK = 1,
                     REDIRECTED = 2,
+                    UNCHANGED = 3,
                     };
             /*ping attempt error codes*/
 
+enum bedrockField{BEDROCK_EDITION, BEDROCK_MOTD, BEDROCK_PROTOCOL,
+                BEDROCK_VERSION, BEDROCK_ONLINE, BEDROCK_MAX, BEDROCK_SERVER_ID,
+                BEDROCK_SUBMOTD, BEDROCK_GAMEMODE, BEDROCK_GAMEMODE_ID,
+                BEDROCK_PORT_V4, BEDROCK_PORT_V6, BEDROCK_FIELD_COUNT
+};
+            /*semicolon separated fields of a Bedrock status, in order*/
+
+enum hashMask{HASH_MASK_NONE = 0x00, HASH_MASK_SAMPLE = 0x01,
+                HASH_MASK_FAVICON = 0x02, HASH_MASK_ONLINE = 0x04,
+                HASH_MASK_DESCRIPTION = 0x08
+};
+            /*JSON fields left out of the response hash. SAMPLE is the player
+            *sample list, FAVICON the base64 icon, ONLINE the online player
+            *count and DESCRIPTION the MOTD
+            */
+
+enum probeMode{PROBE_FULL = 0, PROBE_CONNECT_ONLY = 1, PROBE_STATUS_ONLY = 2,
+                PROBE_LATENCY_ONLY = 3
+};
+/*how much of the Server List Ping exchange a probe performs. FULL does the
+*status request and the ping/pong, CONNECT_ONLY stops after the TCP handshake,
+*STATUS_ONLY closes after the JSON response and LATENCY_ONLY discards the JSON
+*without buffering it and only keeps the ping/pong latency
+*/
+
 /**
                     DNS HEADER
 ID: 16 bits | QR: 1 bit | OPCODE: 4 bit | AUTHORITIVE ANSWER: 1 bit |
@@ -126,9 +194,500 @@ struct DNS_Response{
 
 };
 
+#define SRV_MAX_RECORDS 16
+/*records kept from one SRV answer*/
+
+struct SRV_Record{
+        char target[DOMAIN_MAX_SIZE + 1];
+        /*host the record points to*/
+        uint32_t ttl;
+        /*seconds the record may be cached*/
+        uint16_t priority;
+        /*lower priorities are tried first*/
+        uint16_t weight;
+        /*relative share among records of the same priority*/
+        uint16_t port;
+        /*port of the server behind the record*/
+
+};
+
+struct SRV_Answer{
+        struct SRV_Record records[SRV_MAX_RECORDS];
+        uint16_t count;
+        /*number of records*/
+        enum DNS_ERROR dns_error;
+        /*DNS error response code*/
+
+};
+
+enum srvPreference{SRV_PREFER_WEIGHT = 0, SRV_PREFER_LATENCY = 1};
+/*how the SRV record a probe goes through is chosen, by RFC 2782 priority
+*and weight or by the lowest latency measured through each record
+*/
+
+struct MC_Target{
+        uint32_t hostOffset;
+        /*offset of the null terminated host string inside the list's
+        *string pool
+        */
+        uint16_t hostLength;
+        /*length of the host string, without the null terminator*/
+        uint16_t port;
+        /*port of the target*/
+        uint32_t ipv4;
+        /*IPv4 address in network byte order if the host is an IP literal,
+        *0 if the host is a domain that still needs to be resolved
+        */
+        uint32_t hash;
+        /*hash of the endpoint, used for deduplication and sharding*/
+
+};
+
+struct PingResult{
+        const char* host;
+        /*the address the probe was created with*/
+        const char* response;
+        /*JSON response of the server, nullptr if there was none*/
+        size_t responseLength;
+        /*length of the response, without the null terminator*/
+        uint64_t timestamp;
+        /*time the probe completed, in milliseconds since the epoch*/
+        uint32_t ipv4;
+        /*IPv4 address that was probed in network byte order, 0 if the
+        *host never resolved
+        */
+        uint16_t port;
+        /*port of the server*/
+        enum pingError error;
+        /*ping error code of the probe*/
+        enum DNS_ERROR dnsError;
+        /*DNS error code of the probe*/
+        long milliseconds;
+        /*latency of the probe, -1 if it failed*/
+        long kernelRtt;
+        /*smoothed round trip time the kernel measured for the connection in
+        *microseconds, -1 if it is not available
+        */
+        long stampedPing;
+        /*ping/pong round trip in microseconds, ended by the kernel's receive
+        *timestamp of the pong instead of our own clock, -1 if it is not
+        *available
+        */
+        int fastOpen;
+        /*1 if the request went out in the SYN with TCP Fast Open and the
+        *server accepted it, 0 otherwise
+        */
+
+};
+
+struct EngineStats{
+        uint64_t probes;
+        /*targets the reactor probed, stolen ones included*/
+        uint64_t answered;
+        /*probes that got an answer: OK, REDIRECTED or UNCHANGED*/
+        uint64_t stolen;
+        /*targets taken from another reactor's partition*/
+        uint64_t milliseconds;
+        /*time the reactor spent in the last run*/
+        int cpu;
+        /*CPU the reactor was pinned to, -1 if it was not pinned*/
+};
+
+typedef int (*mc_chunkCallback)(void* user, const char* data, size_t length,
+                                                size_t total, int final);
+/*receives a status response body chunk by chunk. total is the body length
+*the server announced, final is set on the last chunk. Returning non-zero
+*stops the probe with RECEIVE_FAILURE. The data is only valid during the call
+*/
+
+struct MC_LogRecord{
+        uint64_t timestamp;
+        /*time the probe completed, in milliseconds since the epoch*/
+        uint64_t blobOffset;
+        /*offset of the host string in the blob file, the response directly
+        *follows the host's null terminator
+        */
+        uint32_t responseLength;
+        /*length of the response, 0 if there was none*/
+        uint32_t ipv4;
+        /*IPv4 address that was probed in network byte order*/
+        int32_t milliseconds;
+        /*latency of the probe*/
+        uint16_t port;
+        /*port of the server*/
+        int16_t error;
+        /*ping error code*/
+        uint8_t dnsError;
+        /*DNS error code*/
+        uint8_t hostLength;
+        /*length of the host string*/
+        uint8_t flags;
+        /*LOG_HAS_RESPONSE if the probe produced a response, LOG_FAST_OPEN if
+        *its request went out in the SYN
+        */
+        uint8_t reserved[5];
+
+};
+            /*fixed size record of the binary result log, 40 bytes*/
+
+struct MC_TargetState{
+        uint64_t key;
+        /*mc_hash64 of the target's host, seeded with its port*/
+        uint64_t expires;
+        /*wall clock time the resolved address goes stale, in milliseconds
+        *since the epoch
+        */
+        uint64_t completedAt;
+        /*time the last probe completed, 0 if it was never probed*/
+        uint64_t lastHash;
+        /*hash of the last response, for change detection*/
+        uint32_t ipv4;
+        uint32_t alternate;
+        /*resolved address and the second one for hedging, network order*/
+        uint32_t interval;
+        uint32_t failures;
+        /*poll interval and consecutive failures of the scheduler*/
+        uint32_t nameOffset;
+        /*offset of the SRV target the handshake names in the name pool*/
+        int32_t milliseconds;
+        /*latency of the last probe*/
+        uint16_t port;
+        /*resolved port, the SRV port for redirected targets*/
+        int16_t error;
+        /*ping error code of the last probe*/
+        uint8_t status;
+        /*OK, or REDIRECTED if an SRV record was followed*/
+        uint8_t dnsError;
+        /*DNS error code of the last resolution*/
+        uint8_t nameLength;
+        /*length of the SRV target, 0 if the handshake names the host*/
+        uint8_t flags;
+        /*STATE_RESOLVED and STATE_SCHEDULED*/
+
+};
+            /*fixed size record of a state snapshot, 64 bytes*/
+
+struct MC_ScanCheckpoint{
+        uint64_t id;
+        /*identifies the scan partition the checkpoint belongs to*/
+        uint64_t position;
+        /*every target of the partition before this one was probed*/
+        uint64_t total;
+        /*size of the partition, a checkpoint only applies to the same one*/
+};
+
+struct MC_SeriesSample{
+        uint64_t timestamp;
+        /*time of the sample in milliseconds since the epoch, stored with
+        *second resolution
+        */
+        long milliseconds;
+        /*latency of the probe, -1 if it failed*/
+        long online;
+        /*players.online the server reported, -1 if it reported none*/
+};
+
+struct MC_SeriesBucket{
+        uint64_t start;
+        /*start of the bucket in milliseconds since the epoch*/
+        uint32_t samples;
+        /*samples that fell into the bucket*/
+        uint32_t failures;
+        /*samples of failed probes*/
+        long latencyMin;
+        long latencyMax;
+        long latencyP95;
+        double latencyAvg;
+        /*latency of the successful probes, -1 if there were none*/
+        long onlineMin;
+        long onlineMax;
+        long onlineP95;
+        double onlineAvg;
+        /*reported player counts, -1 if there were none*/
+};
+
+struct SchedulerPolicy{
+        uint32_t baseInterval;
+        /*milliseconds between polls of a newly added or recovered target*/
+        uint32_t minInterval;
+        /*shortest interval a target that keeps changing is polled at*/
+        uint32_t maxInterval;
+        /*longest interval a live target that never changes backs off to*/
+        uint32_t deadInterval;
+        /*first retry interval of a target that stopped answering*/
+        uint32_t deadMaxInterval;
+        /*longest interval a dead target backs off to*/
+        uint32_t jitterPercent;
+        /*every interval is randomly moved by up to this percentage*/
+        uint32_t tierDeadline[4];
+        /*how many milliseconds a poll of each priority tier may be late
+        *before it is served ahead of every other tier
+        */
+
+};
+
+#define SCHEDULER_TIERS 4
+
+struct HedgePolicy{
+        uint32_t quantile;
+        /*percentile of the target's recent latency after which a second
+        *attempt is started, 95 by default
+        */
+        uint32_t minDelay;
+        /*a probe is never hedged sooner than this many milliseconds*/
+        uint32_t defaultDelay;
+        /*hedge delay of targets without enough latency history*/
+        uint32_t budgetPercent;
+        /*extra attempts allowed per 100 probes*/
+        uint32_t budgetBurst;
+        /*extra attempts that can be saved up while nothing needs hedging*/
+
+};
+
+enum cacheState{CACHE_FRESH = 0, CACHE_STALE = 1, CACHE_MISS = 2,
+                CACHE_COALESCED = 3
+};
+/*where a StatusCache answer came from. FRESH and STALE were served from the
+*cache, STALE while a background refresh runs. MISS means the caller probed
+*the server itself, COALESCED that it waited for the probe another caller
+*had in flight
+*/
+
+struct CachePolicy{
+        uint32_t freshMillis;
+        /*how long a status is served without probing the server again*/
+        uint32_t staleMillis;
+        /*how long after it stopped being fresh a status is still served
+        *while a background refresh runs, 0 never serves stale statuses
+        */
+        uint32_t errorMillis;
+        /*how long a failed probe is served, so a dead server is not probed
+        *by every request
+        */
+        uint32_t maxEntries;
+        /*servers kept at once, the least recently used idle server is
+        *dropped to make room for a new one
+        */
+
+};
+
+struct CacheStats{
+        uint64_t requests;
+        /*calls to get()*/
+        uint64_t hits;
+        /*requests served a fresh status*/
+        uint64_t stale;
+        /*requests served a stale status*/
+        uint64_t coalesced;
+        /*requests that waited for another caller's probe*/
+        uint64_t probes;
+        /*probes sent on behalf of a request*/
+        uint64_t refreshes;
+        /*probes sent by a background refresh*/
+        uint64_t evictions;
+        /*servers dropped to make room for others*/
+};
+
+struct Ping;
+typedef void (*mc_cacheConfigure)(void* user, struct Ping* p);
+/*called once for every Ping a StatusCache creates, before its first probe,
+*to set its timeout, probe mode, sink and the like
+*/
+
+struct RateLimitPolicy{
+        double globalRate;
+        /*new connections per second across all destinations, 0 is unlimited*/
+        uint32_t globalBurst;
+        /*connections that can be opened at once after the limiter was idle*/
+        double ipRate;
+        /*new connections per second to a single IP, 0 is unlimited*/
+        uint32_t ipBurst;
+        double subnetRate;
+        /*new connections per second to a single subnet, 0 is unlimited*/
+        uint32_t subnetBurst;
+        uint32_t subnetPrefix;
+        /*prefix length that groups IPs into a subnet, 24 by default*/
+        uint32_t maxPerIP;
+        /*probes that may be in flight to a single IP at once, 0 is
+        *unlimited
+        */
+
+};
+
+#define LOG_MAGIC "MCPLOG1"
+#define LOG_HEADER_SIZE 16
+#define LOG_HAS_RESPONSE 0x01
+#define LOG_FAST_OPEN 0x02
+#define SINK_BUFFER_SIZE (1 << 20)
+#define SNAPSHOT_MAGIC "MCPSNP1"
+#define SNAPSHOT_HEADER_SIZE 32
+#define STATE_RESOLVED 0x01
+#define STATE_SCHEDULED 0x02
+#define SERIES_MAGIC "MCPSER1"
+#define SERIES_HEADER_SIZE 32
+#define SERIES_BLOCK_SIZE 64
+/*bytes of one block of delta encoded samples, a series is a ring of them*/
+
+#define DATAGRAM_BATCH 64
+/*datagrams sent or received per system call*/
+#define QUERY_MAX_TARGETS 65536
+/*targets one QueryClient can hold, the session ID encodes the index*/
+#define QUERY_PACKET_SIZE 8192
+/*largest full stat answer accepted*/
+#define BEDROCK_DEFAULT_PORT 19132
+#define BEDROCK_MAX_TARGETS (1 << 24)
+/*targets one BedrockClient can hold, the ping's time field encodes the index*/
+#define BEDROCK_PACKET_SIZE 2048
+/*largest unconnected pong accepted, RakNet keeps datagrams under the MTU*/
+
+#define SHARD_VIRTUAL_NODES 64
+/*points every shard gets on the consistent hash ring*/
+#define SHARD_TOKEN_MAX 64
+/*longest shared token remote workers authenticate with*/
+
+#define MC_PROBE_CONTEXT_SIZE 4096
+/*bytes a C caller reserves for a Ping object it keeps on its own stack*/
+
+#define FAVICON_REFERENCE "mc-favicon:"
+#define FAVICON_REFERENCE_SIZE 32
+/*a stored favicon is replaced by its reference followed by the 16 hex digit
+*hash, the size leaves room for both and the closing quote
+*/
+
 
 #ifdef __cplusplus
 
+class ResultSink;
+class SnapshotWriter;
+class SnapshotReader;
+class RateLimiter;
+class SourcePool;
+class HedgeBudget;
+class SocketHandle;
+
+/***************************************************************************
+* class ResponseHasher
+* Author: agent
+* Date: 10/19/2026
+* Description: Incrementally hashes a JSON status response as it is
+*       received. Values of masked fields are skipped, so responses that only
+*       differ in those fields hash the same
+*
+**************************************************************************/
+class ResponseHasher{
+
+
+private:
+        uint64_t hash;
+        unsigned mask;
+        int state;
+        bool escape;
+        bool keyMasked;
+        unsigned depth;
+        char key[16];
+        unsigned keyLength;
+        //variables
+
+        bool isMaskedKey();
+        //private functions
+
+public:
+        ResponseHasher(unsigned mask = HASH_MASK_NONE);
+        void reset(unsigned mask);
+        void update(const char* data, size_t length);
+        uint64_t digest();
+        static uint64_t hashResponse(const char* data, size_t length,
+                                        unsigned mask);
+
+};
+
+/***************************************************************************
+* class FaviconStore
+* Author: agent
+* Date: 10/19/2026
+* Description: Content addressed store that keeps every distinct favicon
+*       once, keyed by the hash of its stored bytes. Favicons are kept as the
+*       base64 text of the response or decoded to the raw PNG bytes. Entries
+*       live as long as the store, so the data returned by get() stays valid
+*
+**************************************************************************/
+class FaviconStore{
+
+
+private:
+        struct Entry{
+                uint64_t hash;
+                uint8_t* data;
+                size_t length;
+        };
+        Entry* table;
+        size_t capacity;
+        size_t count;
+        size_t bytes;
+        bool decode;
+        std::mutex lock;
+        //variables
+
+        bool grow();
+        //private functions
+
+public:
+        FaviconStore(bool decode = false);
+        ~FaviconStore();
+        uint64_t put(char* value, size_t length);
+        bool get(uint64_t hash, const uint8_t** data, size_t* length);
+        size_t size();
+        size_t storedBytes();
+        bool isDecoding();
+
+private:
+        FaviconStore(const FaviconStore &obj);
+        FaviconStore& operator=(const FaviconStore &obj);
+
+};
+
+/***************************************************************************
+* class FaviconSplitter
+* Author: agent
+* Date: 10/19/2026
+* Description: Copies a JSON status response as it is received, except for
+*       the value of its "favicon" key, which is collected, put into a
+*       FaviconStore and replaced by a reference to the stored hash
+*
+**************************************************************************/
+class FaviconSplitter{
+
+
+private:
+        FaviconStore* store;
+        char* value;
+        size_t valueLength;
+        size_t valueCapacity;
+        uint64_t hash;
+        int state;
+        bool escape;
+        bool keyMatched;
+        unsigned depth;
+        char key[8];
+        unsigned keyLength;
+        //variables
+
+        bool append(char c);
+        //private functions
+
+public:
+        FaviconSplitter();
+        ~FaviconSplitter();
+        void reset(FaviconStore* s);
+        size_t feed(const char* data, size_t length, char* out);
+        uint64_t getHash();
+
+private:
+        FaviconSplitter(const FaviconSplitter &obj);
+        FaviconSplitter& operator=(const FaviconSplitter &obj);
+
+};
+
 /***************************************************************************
 * class Ping
 * Author: SkibbleBip
@@ -141,11 +700,32 @@ class Ping{
 
 
 private:
-        const uint8_t request[2] = {0x1, 0x0};
-        const uint8_t version[5] = {0xff,0xff,0xff,0xff, 0x0f};// -1 in varInt
-        //constant packet values
+        struct PreparedTarget{
+                struct sockaddr_in address;
+                /*resolved endpoint, SRV port included*/
+                struct sockaddr_in alternate;
+                /*second resolved address for hedged probes, or address*/
+                uint8_t packet[PREPARED_PACKET_SIZE];
+                size_t packetLength;
+                /*handshake and request packets, sent in one write*/
+                uint64_t expires;
+                /*wall clock time the DNS results go stale*/
+                int status;
+                /*OK, or REDIRECTED if an SRV record was followed*/
+                DNS_ERROR dnsError;
+                bool valid;
+        } prepared;
+        int protocolVersion;
+        uint32_t dnsCacheTime;
+        //resolved target reused between probes
+
+        HedgeBudget* hedger;
+        uint32_t latencyHistory[HEDGE_HISTORY];
+        uint8_t latencyCount;
+        uint8_t latencyNext;
+        uint32_t heldAddress;
+        //hedging state and the address the rate limiter slot is held for
 
-        int sock;
         struct sockaddr_in server;
         struct timeval timeout;
         char* pingResponse;
@@ -153,11 +733,62 @@ private:
     /*const*/ char actualAddress[DOMAIN_MAX_SIZE + 1]; //last char is a null
         uint16_t port;
         long milliseconds;
+        long kernelRtt;
+        long stampedPing;
         pingError error;
         DNS_ERROR dnsError;
+        size_t responseLength;
+        uint64_t completedAt;
+        ResultSink* sink;
+        RateLimiter* limiter;
+        bool limiterHeld;
+        SourcePool* sources;
+        bool abortiveClose;
+        bool fastOpen;
+        bool sentInSyn;
+        ResponseHasher hasher;
+        FaviconStore* favicons;
+        FaviconSplitter splitter;
+        srvPreference srvPrefer;
+        struct SRVStats{
+                uint64_t key;
+                uint32_t latency;
+                uint8_t failures;
+        } srvStats[SRV_MAX_RECORDS];
+        uint8_t srvStatsNext;
+        int srvChosen;
+        //latency of the SRV backends and the one being probed
+
+        char* userBuffer;
+        size_t userCapacity;
+        size_t neededLength;
+        bool truncated;
+        //caller-provided response buffer
+
+        mc_chunkCallback chunkCallback;
+        void* chunkUser;
+        bool bodyRead;
+        //streamed response body
+        bool detectChanges;
+        unsigned hashMask;
+        uint64_t responseHash;
+        uint64_t lastHash;
+        probeMode mode;
         //variables
 
-        size_t buildHandshake(uint8_t* buffer, char* host);
+        int probe();
+        bool prepare();
+        void releaseResponse();
+        int findSRVStats(const char* target, uint16_t port);
+        void recordSRVResult(bool healthy);
+        int selectFastestSRV(const SRV_Answer* answer);
+        bool openDirect(SocketHandle* sock, uint64_t* connectStart,
+                                                uint64_t* requestStart);
+        bool openHedged(SocketHandle* sock, uint64_t* connectStart,
+                                                uint64_t* requestStart);
+        void recordLatency(uint64_t ms);
+        size_t buildHandshake(uint8_t* buffer, const char* host,
+                                                        uint16_t hostPort);
         int readVarInt(int s);
         bool checkIfIP(const char* in);
         //private functions
@@ -171,52 +802,1410 @@ public:
         pingError getError();
         char* getResponse();
         long getPing();
+        long getKernelRTT();
+        long getStampedPing();
+        void setFaviconStore(FaviconStore* store);
+        uint64_t getFaviconHash();
+        void setResponseBuffer(char* buffer, size_t capacity);
+        size_t getResponseLength();
         static void SRV_Lookup(const char* domain, DNS_Response* dnsr);
+        static void SRV_LookupAll(const char* domain, SRV_Answer* answer);
+        static size_t encodeHandshake(uint8_t* buffer, const char* host,
+                                        uint16_t hostPort, int32_t protocol);
+        static size_t buildSRVQuestion(const char* domain, uint16_t id,
+                                                        uint8_t* packet);
+        static void parseSRVAnswer(const uint8_t* packet, int length,
+                                                        SRV_Answer* answer);
+        static size_t buildAQuestion(const char* domain, uint16_t id,
+                                                        uint8_t* packet);
+        static int parseAAnswer(const uint8_t* packet, int length,
+                        uint32_t* addresses, int max, uint32_t* ttl);
+        static int selectSRV(const SRV_Answer* answer, uint64_t random);
+        void setSRVPreference(srvPreference preference);
+        void setChunkCallback(mc_chunkCallback callback, void* user);
+        static bool parseIPv4(const char* in, size_t length, uint32_t* out);
+        static pingError resolveIPv4(const char* host, uint32_t* out);
+        static bool lookupIPv4(const char* host, uint32_t* first,
+                                                        uint32_t* second);
         DNS_ERROR getDNSerror();
         void ping_free();
+        const char* getAddress();
+        uint16_t getPort();
+        void getResult(PingResult* out);
+        void setSink(ResultSink* s);
+        void setRateLimiter(RateLimiter* l);
+        void setSourcePool(SourcePool* pool);
+        void setAbortiveClose(bool enable);
+        void setFastOpen(bool enable);
+        bool usedFastOpen();
+        void setProtocolVersion(int version);
+        void setDNSCacheTime(uint32_t ms);
+        void resetPrepared();
+        void setHedging(HedgeBudget* budget);
+        void setChangeDetection(bool enable, unsigned mask = HASH_MASK_NONE);
+        uint64_t getResponseHash();
+        void setProbeMode(probeMode m);
+        probeMode getProbeMode();
+        uint64_t getStateKey();
+        const char* exportState(MC_TargetState* out);
+        bool importState(const MC_TargetState* state, const char* backend);
+
+
+
+
+};
+
+/***************************************************************************
+* class TargetList
+* Author: agent
+* Date: 10/19/2026
+* Description: A flat list of unique host:port targets, loaded from a
+*       memory-mapped text file of "host[:port]" lines. Hosts are kept in a
+*       single string pool instead of one Ping object per line, and Ping
+*       objects are only created on demand
+*
+**************************************************************************/
+class TargetList{
+
+
+private:
+        MC_Target* targets;
+        size_t count;
+        size_t capacity;
+        //target array
+
+        char* pool;
+        size_t poolSize;
+        size_t poolCapacity;
+        //string pool holding every host, null terminated
+
+        uint64_t* table;
+        size_t tableMask;
+        /*open addressing deduplication index, each slot holds the endpoint
+        *hash in the upper half and the target index + 1 in the lower half
+        */
+
+        size_t duplicates;
+        size_t rejected;
+        //load statistics
+
+        struct Pending;
+        bool reserve(size_t targetCount, size_t poolBytes);
+        bool rehash(size_t slots);
+        int parseLine(const char* line, size_t length, uint16_t defaultPort,
+                                Pending* out);
+        int insert(const Pending* p);
+        //private functions
+
+public:
+        TargetList();
+        ~TargetList();
+        int load(const char* path, uint16_t defaultPort = DEFAULT_PORT);
+        int loadBuffer(const char* data, size_t length,
+                                uint16_t defaultPort = DEFAULT_PORT);
+        int add(const char* host, uint16_t port);
+        size_t size();
+        size_t getDuplicates();
+        size_t getRejected();
+        const MC_Target* getTarget(size_t index);
+        const char* getHost(size_t index);
+        uint16_t getPort(size_t index);
+        Ping* createPing(size_t index);
+        void clear();
+
+private:
+        TargetList(const TargetList &obj);
+        TargetList& operator=(const TargetList &obj);
+        //the list owns its buffers, it is not copyable
+
+};
+
+/***************************************************************************
+* class PollScheduler
+* Author: agent
+* Date: 10/19/2026
+* Description: Decides when each target is polled next. Targets that keep
+*       changing are polled more often, targets that never change and dead
+*       targets back off exponentially, and every interval is jittered so
+*       polls do not line up into bursts. Targets are split into priority
+*       tiers, lower tiers are served first unless a higher tier poll has
+*       gone past its deadline. Not thread safe, one thread drives it
+*
+**************************************************************************/
+class PollScheduler{
+
 
+private:
+        struct Entry;
+        Entry* entries;
+        size_t count;
+        size_t capacity;
+        uint32_t freeHead;
+        //scheduled targets, removed entries are chained into a free list
+
+        uint32_t* heaps[SCHEDULER_TIERS];
+        size_t heapSize[SCHEDULER_TIERS];
+        size_t heapCapacity[SCHEDULER_TIERS];
+        //one min-heap of entry indices per tier, ordered by due time
+
+        SchedulerPolicy policy;
+        uint64_t random;
+        //variables
 
+        bool push(uint32_t index);
+        void pop(unsigned tier, size_t position);
+        void siftUp(unsigned tier, size_t position);
+        void siftDown(unsigned tier, size_t position);
+        uint32_t jitter(uint32_t interval);
+        //private functions
 
+public:
+        PollScheduler();
+        ~PollScheduler();
+        void setPolicy(const SchedulerPolicy* p);
+        void getPolicy(SchedulerPolicy* p);
+        int add(Ping* p, unsigned tier, uint64_t now);
+        bool remove(int handle);
+        size_t next(uint64_t now, int* handles, size_t max);
+        void report(int handle, int result, uint64_t now);
+        size_t run(uint64_t now, size_t budget);
+        uint64_t nextDue();
+        Ping* getPing(int handle);
+        uint32_t getInterval(int handle);
+        bool getState(int handle, MC_TargetState* out);
+        bool restore(int handle, const MC_TargetState* state, uint64_t now);
+        static uint64_t now();
 
+private:
+        PollScheduler(const PollScheduler &obj);
+        PollScheduler& operator=(const PollScheduler &obj);
 
 };
 
+/***************************************************************************
+* class RateLimiter
+* Author: agent
+* Date: 10/19/2026
+* Description: Token bucket limiter for outbound probes. A probe must take a
+*       token from the global bucket, the bucket of its IP and the bucket of
+*       its subnet before it connects, and the number of probes in flight to
+*       one IP can be capped. Buckets of idle destinations are dropped when
+*       the tables grow. Safe to share between threads
+*
+**************************************************************************/
+class RateLimiter{
+
 
+private:
+        struct Bucket;
+        struct BucketTable{
+                Bucket* slots;
+                size_t mask;
+                size_t count;
+        };
+        //open addressed table of buckets keyed by IP or subnet
 
+        RateLimitPolicy policy;
+        uint32_t subnetMask;
+        double globalTokens;
+        uint64_t globalLast;
+        BucketTable ips;
+        BucketTable subnets;
+        std::mutex lock;
+        std::condition_variable released;
+        //variables
 
-#endif // __cplusplus
+        Bucket* find(BucketTable* table, uint32_t key, double burst,
+                                                uint64_t now);
+        bool grow(BucketTable* table, double burst, double rate, uint64_t now);
+        bool tryAcquireLocked(uint32_t ipv4, uint64_t now, uint64_t* wait);
+        //private functions
 
-#ifdef __cplusplus
-extern "C" {
-#endif // __cplusplus
+public:
+        RateLimiter(const RateLimitPolicy* p);
+        ~RateLimiter();
+        void setPolicy(const RateLimitPolicy* p);
+        bool tryAcquire(uint32_t ipv4, uint64_t* wait);
+        void acquire(uint32_t ipv4);
+        void release(uint32_t ipv4);
+        static uint64_t now();
 
-/*Function definitions for C-type methods. These are used in C programs that
-*have been linked to this C++ library
+private:
+        RateLimiter(const RateLimiter &obj);
+        RateLimiter& operator=(const RateLimiter &obj);
+
+};
+
+/***************************************************************************
+* class SocketHandle
+* Author: agent
+* Date: 10/19/2026
+* Description: Owns a socket descriptor and closes it when it goes out of
+*       scope, so no return path can leak it. An abortive close resets the
+*       connection instead of leaving it in TIME_WAIT
+*
+**************************************************************************/
+class SocketHandle{
+
+
+private:
+        int fd;
+        bool abortive;
+        //variables
+
+public:
+        SocketHandle(int fd = -1);
+        ~SocketHandle();
+        int get();
+        bool valid();
+        void reset(int newFd = -1);
+        int release();
+        void setAbortive(bool enable);
+        bool setTimeout(const struct timeval* tv);
+
+private:
+        SocketHandle(const SocketHandle &obj);
+        SocketHandle& operator=(const SocketHandle &obj);
+
+};
+
+/***************************************************************************
+* class SourcePool
+* Author: agent
+* Date: 10/19/2026
+* Description: A list of local IPv4 addresses outgoing probes are spread
+*       over round robin. On Linux the source port is left for connect() to
+*       pick with IP_BIND_ADDRESS_NO_PORT, so every local address gets the
+*       whole ephemeral port range per destination. Safe to share between
+*       threads once filled
+*
+**************************************************************************/
+class SourcePool{
+
+
+private:
+        uint32_t* addresses;
+        size_t count;
+        size_t capacity;
+        std::atomic<uint32_t> nextAddress;
+        //variables
+
+public:
+        SourcePool();
+        ~SourcePool();
+        bool add(const char* address);
+        size_t size();
+        bool bindSocket(int fd);
+
+private:
+        SourcePool(const SourcePool &obj);
+        SourcePool& operator=(const SourcePool &obj);
+
+};
+
+struct Datagram{
+        uint8_t* data;
+        size_t length;
+        struct sockaddr_in address;
+};
+/*one UDP datagram of a batch. Going into receiveDatagrams() length is the size
+*of the buffer, coming out it is the size received
 */
 
-        typedef struct Ping Ping;
+size_t sendDatagrams(int fd, const struct Datagram* datagrams, size_t count);
+size_t receiveDatagrams(int fd, struct Datagram* datagrams, size_t count);
 
-        Ping* newPing(void);
+uint64_t mc_currentMillis(void);
+bool mc_setBlocking(int fd, bool blocking);
+long mc_readKernelRTT(int fd);
+int mc_decodeVarInt(const uint8_t* in, size_t length, int32_t* value);
+/*socket and protocol helpers Ping, the hedged probes and the probe engine
+*share
+*/
 
-        Ping* createPing(const char* address, uint16_t p);
+/***************************************************************************
+* class HedgeBudget
+* Author: agent
+* Date: 10/19/2026
+* Description: Hedging policy shared by many Ping objects. Every probe earns
+*       budgetPercent/100 of an extra attempt and every hedge spends one, so
+*       hedging can never add more than that share of load, even when a whole
+*       network is slow. Safe to share between threads
+*
+**************************************************************************/
+class HedgeBudget{
 
-        Ping* copyPing(const Ping *obj);
 
-        void destroyPing(Ping* p);
+private:
+        HedgePolicy policy;
+        double tokens;
+        uint64_t probes;
+        uint64_t hedges;
+        uint64_t wins;
+        std::mutex lock;
+        //variables
 
-        int ping_connectMC(Ping* p);
+public:
+        HedgeBudget(const HedgePolicy* p);
+        void setPolicy(const HedgePolicy* p);
+        void getPolicy(HedgePolicy* p);
+        void recordProbe();
+        bool tryHedge();
+        void recordWin();
+        uint32_t hedgeDelay(const uint32_t* history, size_t count);
+        uint64_t getProbes();
+        uint64_t getHedges();
+        uint64_t getWins();
 
-        enum pingError ping_getError(Ping* p);
+private:
+        HedgeBudget(const HedgeBudget &obj);
+        HedgeBudget& operator=(const HedgeBudget &obj);
 
-        char* ping_getResponse(Ping* p);
+};
 
-        long ping_getPing(Ping* p);
+/***************************************************************************
+* class StatusCache
+* Author: agent
+* Date: 10/19/2026
+* Description: Status cache keyed by host and port for callers that get many
+*       requests for the same servers, like a web dashboard. A status is
+*       served from the cache while it is fresh. Concurrent requests for a
+*       server nobody has a status of collapse into one probe whose result
+*       every waiting caller gets, and a stale status is served while a
+*       small pool of background threads probes the server again. The number
+*       of probes depends on the number of servers, not on the number of
+*       requests. Safe to share between threads
+*
+**************************************************************************/
+class StatusCache{
 
-        void ping_SRV_Lookup(const char* domain, struct DNS_Response* dnsr);
 
-        enum DNS_ERROR ping_getDNSerror(Ping* p);
+private:
+        struct Entry;
+        CachePolicy policy;
+        Entry** buckets;
+        size_t mask;
+        size_t count;
+        CacheStats stats;
+        mc_cacheConfigure configure;
+        void* configureUser;
+        Entry* pending;
+        Entry* pendingTail;
+        std::thread workers[CACHE_REFRESH_WORKERS];
+        bool started;
+        bool stopping;
+        std::mutex lock;
+        std::condition_variable loaded;
+        std::condition_variable wake;
+        //variables
 
-        void ping_ping_free(Ping* p);
+        Entry* find(uint64_t hash, const char* host, uint16_t port);
+        Entry* insert(uint64_t hash, const char* host, uint16_t port);
+        bool grow();
+        void evict();
+        void unlink(Entry* e);
+        bool load(Entry* e, PingResult* result, char** response);
+        void store(Entry* e, const PingResult* result, char* response,
+                                                        bool background);
+        int copyOut(Entry* e, const char* host, PingResult* out,
+                                        char* buffer, size_t capacity);
+        void refresh(Entry* e);
+        void work();
+        //private functions
+
+public:
+        StatusCache(const CachePolicy* p);
+        ~StatusCache();
+        void setPolicy(const CachePolicy* p);
+        void getPolicy(CachePolicy* p);
+        void setConfigure(mc_cacheConfigure callback, void* user);
+        int get(const char* host, uint16_t port, PingResult* out,
+                char* buffer, size_t capacity, cacheState* state = nullptr);
+        void getStats(CacheStats* out);
+        size_t size();
+        static StatusCache* shared();
+
+private:
+        StatusCache(const StatusCache &obj);
+        StatusCache& operator=(const StatusCache &obj);
+
+};
+
+/***************************************************************************
+* class ShardRing
+* Author: agent
+* Date: 10/19/2026
+* Description: Consistent hash ring mapping target hashes to shards. Every
+*       shard owns several points on the ring, so going from N to N+1 shards
+*       only moves about 1/(N+1) of the targets
+*
+**************************************************************************/
+class ShardRing{
+
+
+private:
+        uint64_t* points;
+        size_t count;
+        unsigned shards;
+        //ring points, (position << 32) | shard, sorted by position
+
+public:
+        ShardRing();
+        ~ShardRing();
+        bool build(unsigned shards, unsigned virtualNodes = SHARD_VIRTUAL_NODES);
+        unsigned shardOf(uint32_t hash);
+        unsigned getShards();
+
+private:
+        ShardRing(const ShardRing &obj);
+        ShardRing& operator=(const ShardRing &obj);
+
+};
+
+/***************************************************************************
+* class ResultSink
+* Author: agent
+* Date: 10/19/2026
+* Description: Interface for anything completed probes are streamed into.
+*       A Ping with a sink set writes its result to it as soon as
+*       connectMC() finishes. Implementations must be safe to call from
+*       several threads at once
+*
+**************************************************************************/
+class ResultSink{
+
+public:
+        virtual ~ResultSink() {}
+        virtual int write(const PingResult* result) = 0;
+        virtual int flush() = 0;
+
+};
+
+/***************************************************************************
+* class NDJSONSink
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes one JSON object per completed probe, one per line,
+*       through a large write buffer
+*
+**************************************************************************/
+class NDJSONSink : public ResultSink{
+
+
+private:
+        FILE* file;
+        char* buffer;
+        std::mutex lock;
+        //variables
+
+public:
+        NDJSONSink();
+        ~NDJSONSink();
+        int open(const char* path, bool append = true);
+        int write(const PingResult* result);
+        int flush();
+        void close();
+
+private:
+        NDJSONSink(const NDJSONSink &obj);
+        NDJSONSink& operator=(const NDJSONSink &obj);
+
+};
+
+/***************************************************************************
+* class BinaryLogSink
+* Author: agent
+* Date: 10/19/2026
+* Description: Append-only binary result log. Every probe is a fixed size
+*       MC_LogRecord in the log file, and the variable length host and
+*       response strings go into a "<path>.blob" file next to it
+*
+**************************************************************************/
+class BinaryLogSink : public ResultSink{
+
+
+private:
+        FILE* records;
+        FILE* blobs;
+        char* recordBuffer;
+        char* blobBuffer;
+        uint64_t blobSize;
+        std::mutex lock;
+        //variables
+
+        int writeLocked(const PingResult* result);
+        //private functions
+
+public:
+        BinaryLogSink();
+        ~BinaryLogSink();
+        int open(const char* path, bool append = true);
+        int write(const PingResult* result);
+        int flush();
+        void close();
+
+private:
+        BinaryLogSink(const BinaryLogSink &obj);
+        BinaryLogSink& operator=(const BinaryLogSink &obj);
+
+};
+
+/***************************************************************************
+* class BinaryLogReader
+* Author: agent
+* Date: 10/19/2026
+* Description: Memory-maps a binary result log and its blob file for
+*       reading. Strings returned in a PingResult point into the mapping and
+*       stay valid until the reader is closed
+*
+**************************************************************************/
+class BinaryLogReader{
+
+
+private:
+        const uint8_t* recordMap;
+        size_t recordMapSize;
+        const char* blobMap;
+        size_t blobMapSize;
+        size_t count;
+        //variables
+
+public:
+        BinaryLogReader();
+        ~BinaryLogReader();
+        int open(const char* path);
+        size_t size();
+        const MC_LogRecord* getRecord(size_t index);
+        bool get(size_t index, PingResult* out);
+        void close();
+
+private:
+        BinaryLogReader(const BinaryLogReader &obj);
+        BinaryLogReader& operator=(const BinaryLogReader &obj);
+
+};
+
+const void* mc_mapFile(const char* path, size_t* size);
+void mc_unmapFile(const void* data, size_t size);
+
+/***************************************************************************
+* class SnapshotWriter
+* Author: agent
+* Date: 10/19/2026
+* Description: Collects the state a poller needs to restart warm, the
+*       resolved addresses of its targets with their expiry, their last
+*       results and poll intervals, and scan checkpoints, then writes it as
+*       one snapshot file. The file is replaced atomically, so a crash while
+*       writing leaves the previous snapshot in place
+*
+*       File layout: a SNAPSHOT_HEADER_SIZE header (magic, record size,
+*       checkpoint count, record count, name pool size), the checkpoints,
+*       the MC_TargetState records sorted by key, then the name pool
+*
+**************************************************************************/
+class SnapshotWriter{
+
+
+private:
+        MC_TargetState* records;
+        size_t count;
+        size_t capacity;
+        char* names;
+        size_t namesSize;
+        size_t namesCapacity;
+        MC_ScanCheckpoint* checkpoints;
+        size_t checkpointCount;
+        size_t checkpointCapacity;
+        //variables
+
+public:
+        SnapshotWriter();
+        ~SnapshotWriter();
+        bool add(Ping* p, PollScheduler* scheduler = nullptr, int handle = -1);
+        bool addCheckpoint(uint64_t id, uint64_t position, uint64_t total);
+        int write(const char* path);
+        size_t size();
+        void clear();
+
+private:
+        SnapshotWriter(const SnapshotWriter &obj);
+        SnapshotWriter& operator=(const SnapshotWriter &obj);
+
+};
+
+/***************************************************************************
+* class SnapshotReader
+* Author: agent
+* Date: 10/19/2026
+* Description: Memory-maps a snapshot written by SnapshotWriter. Nothing is
+*       parsed up front, targets are looked up by binary search as they are
+*       restored, so loading a snapshot of millions of targets is immediate
+*
+**************************************************************************/
+class SnapshotReader{
+
+
+private:
+        const uint8_t* map;
+        size_t mapSize;
+        const MC_ScanCheckpoint* checkpoints;
+        size_t checkpointCount;
+        const MC_TargetState* records;
+        size_t count;
+        const char* names;
+        size_t namesSize;
+        //variables
+
+public:
+        SnapshotReader();
+        ~SnapshotReader();
+        int open(const char* path);
+        size_t size();
+        const MC_TargetState* find(uint64_t key);
+        const char* getBackend(const MC_TargetState* state, char* buffer);
+        bool restore(Ping* p, PollScheduler* scheduler = nullptr, int handle = -1);
+        bool getCheckpoint(uint64_t id, MC_ScanCheckpoint* out);
+        void close();
+
+private:
+        SnapshotReader(const SnapshotReader &obj);
+        SnapshotReader& operator=(const SnapshotReader &obj);
+
+};
+
+/***************************************************************************
+* class SeriesStore
+* Author: agent
+* Date: 10/19/2026
+* Description: In process time series of the latency and players.online of
+*       every target, indexed like the TargetList or the scheduler handles.
+*       Every series is a ring of SERIES_BLOCK_SIZE byte blocks, each holding
+*       a full first sample followed by varint deltas, so a regular poll
+*       costs 3 to 4 bytes a sample and the newest samples overwrite the
+*       oldest block once the ring is full. The memory used is fixed when the
+*       store is created: 16 bytes plus blocks * SERIES_BLOCK_SIZE per
+*       series. The store lives in memory or in a file mapping that keeps the
+*       history across restarts. Safe to share between threads
+*
+*       File layout: a SERIES_HEADER_SIZE header (magic, blocks per series,
+*       series count, epoch), the per-series ring states, then the blocks
+*
+**************************************************************************/
+class SeriesStore{
+
+
+private:
+        struct Series;
+        uint8_t* map;
+        size_t mapSize;
+        bool mapped;
+        Series* series;
+        uint8_t* blocks;
+        size_t count;
+        uint32_t blocksPerSeries;
+        uint64_t epoch;
+        std::mutex lock;
+        //variables
+
+        int attach(uint8_t* data, size_t size, bool fresh, size_t n,
+                                                        uint32_t b);
+        size_t collect(size_t index, uint64_t from, uint64_t to,
+                                MC_SeriesSample* out, size_t max);
+        //private functions
+
+public:
+        SeriesStore();
+        ~SeriesStore();
+        int create(size_t n, uint32_t b);
+        int open(const char* path, size_t n, uint32_t b);
+        bool record(size_t index, uint64_t timestamp, long milliseconds,
+                                                                long online);
+        bool record(size_t index, const PingResult* result);
+        bool record(size_t index, Ping* p);
+        size_t range(size_t index, uint64_t from, uint64_t to,
+                                MC_SeriesSample* out, size_t max);
+        size_t downsample(size_t index, uint64_t from, uint64_t to,
+                uint64_t bucket, MC_SeriesBucket* out, size_t max);
+        size_t size();
+        size_t capacity();
+        int flush();
+        void close();
+        static long parseOnline(const char* response, size_t length);
+
+private:
+        SeriesStore(const SeriesStore &obj);
+        SeriesStore& operator=(const SeriesStore &obj);
+
+};
+
+/***************************************************************************
+* class ScanCoordinator
+* Author: agent
+* Date: 10/19/2026
+* Description: Splits a target list into shards with a ShardRing and has
+*       every shard scanned into its own binary result log, either by forked
+*       local worker processes or by remote workers that connect over TCP.
+*       The shard logs are merged into one log when the scan is done.
+*       serve() listens on the loopback address unless another address is
+*       set, and on any other address it requires a shared token. Every
+*       shard log a worker sends back is limited in size and checked record
+*       by record before it is accepted
+*
+*       Worker protocol, one text line per message:
+*               worker:         HELLO [<token>]
+*               coordinator:    SHARD <index> <probeMode> <bytes>
+*                               followed by <bytes> of "host:port" lines,
+*                               or DONE when no shard is left
+*               worker:         RESULT <index> <logBytes> <blobBytes>
+*                               followed by the shard log and its blob file,
+*                               then the coordinator sends the next SHARD
+*
+**************************************************************************/
+class ScanCoordinator{
+
+
+private:
+        TargetList* targets;
+        ShardRing ring;
+        probeMode mode;
+        uint8_t* shardState;
+        unsigned shardsDone;
+        uint32_t deadline;
+        uint32_t bindAddress;
+        char token[SHARD_TOKEN_MAX + 1];
+        uint64_t uploadLimit;
+        std::mutex lock;
+        //variables
+
+        int takeShard();
+        void finishShard(unsigned shard, bool done);
+        char* buildShard(unsigned shard, size_t* length, size_t* count);
+        int scanShard(unsigned shard, const char* path);
+        int mergeShards(const char* output);
+        int serveWorker(int fd, const char* output);
+        //private functions
+
+public:
+        ScanCoordinator(TargetList* targets, unsigned shards);
+        ~ScanCoordinator();
+        void setProbeMode(probeMode m);
+        void setDeadline(uint32_t seconds);
+        int setBindAddress(const char* address);
+        int setToken(const char* token);
+        void setUploadLimit(uint64_t bytes);
+        int runLocal(const char* output);
+        int serve(uint16_t port, const char* output);
+        static int runWorker(const char* host, uint16_t port,
+                                const char* workPath, const char* token = nullptr);
+        static int scanList(TargetList* list, const char* path, probeMode m);
+        static int merge(const char* output, const char* const* inputs,
+                                                                size_t count);
+
+private:
+        ScanCoordinator(const ScanCoordinator &obj);
+        ScanCoordinator& operator=(const ScanCoordinator &obj);
+
+};
+
+/***************************************************************************
+* class ProbeEngine
+* Author: agent
+* Date: 10/19/2026
+* Description: Probes a target list with one reactor thread per core, each
+*       pinned to its CPU. A reactor is an event loop: it keeps a window of
+*       probes in flight on non-blocking sockets and its own DNS socket, and
+*       sleeps in poll() until one of them is ready. The targets are split
+*       over the reactors with a ShardRing, every reactor owns the sockets,
+*       DNS queries and statistics of the probes it runs, so the reactors
+*       share nothing while they run. A reactor that runs out of work takes
+*       targets from the others through their atomic cursors, the only state
+*       ever touched by two reactors.
+*       The reactors speak the status protocol and DNS themselves instead of
+*       driving Ping objects, so only the engine's own settings apply: the
+*       sink, probe mode, window and affinity. Rate limiters, source pools,
+*       hedging, TCP Fast Open, favicon stores, change detection and
+*       response buffers are Ping settings the engine does not have. Its
+*       results keep the favicon in the response and report fastOpen 0 and
+*       stampedPing -1
+*
+**************************************************************************/
+class ProbeEngine{
+
+
+private:
+        struct Reactor;
+        struct Endpoint;
+        struct Probe;
+        TargetList* targets;
+        ShardRing ring;
+        Reactor* reactors;
+        unsigned reactorCount;
+        uint32_t* order;
+        Endpoint* endpoints;
+        ResultSink* sink;
+        probeMode mode;
+        unsigned window;
+        bool pin;
+        //variables
+
+        std::atomic<uint64_t>* done;
+        //bit per position of the order array, set once it was probed
+
+        bool partition();
+        bool claim(unsigned reactor, size_t* position);
+        void runReactor(unsigned reactor);
+        void start(Reactor* r, Probe* p, size_t position);
+        bool ask(Reactor* r, Probe* p, const char* name, int step);
+        void dial(Reactor* r, Probe* p);
+        void answer(Reactor* r, const uint8_t* packet, int length);
+        void advance(Reactor* r, Probe* p);
+        bool consume(Probe* p, const uint8_t* data, size_t length);
+        void finish(Reactor* r, Probe* p, pingError error);
+        uint64_t checkpointId(unsigned reactor);
+        //private functions
+
+public:
+        ProbeEngine(TargetList* targets, unsigned reactors = 0);
+        ~ProbeEngine();
+        void setSink(ResultSink* s);
+        void setProbeMode(probeMode m);
+        void setAffinity(bool enable);
+        void setWindow(unsigned probes);
+        int run();
+        unsigned getReactors();
+        bool getStats(unsigned reactor, EngineStats* out);
+        void getTotals(EngineStats* out);
+        void saveProgress(SnapshotWriter* w);
+        unsigned resumeProgress(SnapshotReader* r);
+        static unsigned availableCores();
+
+private:
+        ProbeEngine(const ProbeEngine &obj);
+        ProbeEngine& operator=(const ProbeEngine &obj);
+
+};
+
+
+
+
+/***************************************************************************
+* class DatagramClient
+* Author: agent
+* Date: 10/19/2026
+* Description: Base of the UDP clients. exchange() owns the one socket of a
+*       run and its loop: send what is queued, wait for answers, drain them,
+*       and halfway through the timeout queue the silent targets once more.
+*       The clients fill in what goes out and what comes back
+*
+**************************************************************************/
+class DatagramClient{
+
+
+protected:
+        size_t pending;
+        //targets still waiting for their answer
+
+        int exchange(uint32_t timeoutMs, int receiveBuffer);
+        virtual void requeue() = 0;
+        virtual size_t sendPending(int fd) = 0;
+        virtual void drain(int fd) = 0;
+        //the client's part of the loop
+
+public:
+        DatagramClient() {pending = 0;}
+        virtual ~DatagramClient() {}
+
+private:
+        DatagramClient(const DatagramClient &obj);
+        DatagramClient& operator=(const DatagramClient &obj);
+
+};
+
+/***************************************************************************
+* class QueryClient
+* Author: agent
+* Date: 10/19/2026
+* Description: Polls servers with enable-query on through the UDP GameSpy4
+*       query protocol: a handshake for the challenge token, then the full
+*       stat with every key and the whole player list. Every target shares
+*       one socket and datagrams are sent and received in batches, so a poll
+*       costs two small round trips and no connection. Results use the
+*       library's pingError codes
+*
+**************************************************************************/
+class QueryClient : public DatagramClient{
+
+
+private:
+        struct Target{
+                struct sockaddr_in address;
+                uint64_t sentAt;
+                int32_t token;
+                int state;
+                pingError error;
+                long milliseconds;
+                char* payload;
+                size_t payloadLength;
+                size_t valuesOffset;
+                uint32_t* players;
+                uint32_t playerCount;
+        };
+        Target* targets;
+        size_t count;
+        size_t capacity;
+        uint8_t* packets;
+        uint32_t* queue;
+        size_t queued;
+        //variables
+
+        void clearResult(Target* t);
+        bool parseStat(Target* t, const uint8_t* data, size_t length);
+        bool handle(const uint8_t* data, size_t length,
+                        const struct sockaddr_in* from, uint64_t now);
+        void requeue();
+        size_t sendPending(int fd);
+        void drain(int fd);
+        //private functions
+
+public:
+        QueryClient();
+        ~QueryClient();
+        int add(const char* host, uint16_t port);
+        int run(uint32_t timeoutMs);
+        size_t size();
+        pingError getError(int handle);
+        long getPing(int handle);
+        const char* getValue(int handle, const char* key);
+        size_t getPlayerCount(int handle);
+        const char* getPlayer(int handle, size_t index);
+
+private:
+        QueryClient(const QueryClient &obj);
+        QueryClient& operator=(const QueryClient &obj);
+
+};
+
+/***************************************************************************
+* class BedrockClient
+* Author: agent
+* Date: 10/19/2026
+* Description: Pings Bedrock Edition servers with RakNet unconnected pings.
+*       Every target shares one socket and datagrams are sent and received in
+*       batches. The ping's time field carries the target index, the send it
+*       belongs to and a per run nonce, so every pong is matched to its
+*       request without a lookup.
+*       Results use the library's pingError codes and the status fields the
+*       server advertises
+*
+**************************************************************************/
+class BedrockClient : public DatagramClient{
+
+
+private:
+        struct Target{
+                struct sockaddr_in address;
+                uint64_t sentAt;
+                uint64_t resentAt;
+                int state;
+                pingError error;
+                long milliseconds;
+                uint64_t serverGuid;
+                char* status;
+                uint32_t fields[BEDROCK_FIELD_COUNT];
+                uint32_t fieldCount;
+        };
+        Target* targets;
+        size_t count;
+        size_t capacity;
+        uint8_t* packets;
+        uint32_t* queue;
+        size_t queued;
+        uint64_t guid;
+        uint32_t nonce;
+        //variables
+
+        void clearResult(Target* t);
+        bool parsePong(Target* t, const uint8_t* data, size_t length);
+        void handle(const uint8_t* data, size_t length,
+                        const struct sockaddr_in* from, uint64_t now);
+        void requeue();
+        size_t sendPending(int fd);
+        void drain(int fd);
+        //private functions
+
+public:
+        BedrockClient();
+        ~BedrockClient();
+        int add(const char* host, uint16_t port = BEDROCK_DEFAULT_PORT);
+        int run(uint32_t timeoutMs);
+        size_t size();
+        pingError getError(int handle);
+        long getPing(int handle);
+        const char* getResponse(int handle);
+        const char* getField(int handle, bedrockField field);
+        uint64_t getServerGUID(int handle);
+
+private:
+        BedrockClient(const BedrockClient &obj);
+        BedrockClient& operator=(const BedrockClient &obj);
+
+};
+
+#endif // __cplusplus
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+/*Function definitions for C-type methods. These are used in C programs that
+*have been linked to this C++ library
+*/
+
+        typedef struct Ping Ping;
+
+        struct MC_ProbeContext{
+                uint64_t storage[MC_PROBE_CONTEXT_SIZE / sizeof(uint64_t)];
+        };
+        /*storage for a Ping object in memory the caller owns, such as the
+        *stack, so a probe needs no heap allocation
+        */
+
+        Ping* newPing(void);
+
+        Ping* createPing(const char* address, uint16_t p);
+
+        Ping* copyPing(const Ping *obj);
+
+        void destroyPing(Ping* p);
+
+        int ping_connectMC(Ping* p);
+
+        enum pingError ping_getError(Ping* p);
+
+        char* ping_getResponse(Ping* p);
+
+        long ping_getPing(Ping* p);
+
+        void ping_SRV_Lookup(const char* domain, struct DNS_Response* dnsr);
+
+        void ping_SRV_LookupAll(const char* domain, struct SRV_Answer* answer);
+
+        int mc_selectSRV(const struct SRV_Answer* answer, uint64_t random);
+
+        void ping_setSRVPreference(Ping* p, enum srvPreference preference);
+
+        void ping_setChunkCallback(Ping* p, mc_chunkCallback callback,
+                                                                void* user);
+
+        typedef struct QueryClient QueryClient;
+
+        typedef struct BedrockClient BedrockClient;
+
+        QueryClient* newQueryClient(void);
+
+        void destroyQueryClient(QueryClient* q);
+
+        int queryClient_add(QueryClient* q, const char* host, uint16_t port);
+
+        int queryClient_run(QueryClient* q, uint32_t timeoutMs);
+
+        enum pingError queryClient_getError(QueryClient* q, int handle);
+
+        long queryClient_getPing(QueryClient* q, int handle);
+
+        const char* queryClient_getValue(QueryClient* q, int handle,
+                                                        const char* key);
+
+        size_t queryClient_getPlayerCount(QueryClient* q, int handle);
+
+        const char* queryClient_getPlayer(QueryClient* q, int handle,
+                                                        size_t index);
+
+        BedrockClient* newBedrockClient(void);
+
+        void destroyBedrockClient(BedrockClient* b);
+
+        int bedrockClient_add(BedrockClient* b, const char* host, uint16_t port);
+
+        int bedrockClient_run(BedrockClient* b, uint32_t timeoutMs);
+
+        enum pingError bedrockClient_getError(BedrockClient* b, int handle);
+
+        long bedrockClient_getPing(BedrockClient* b, int handle);
+
+        const char* bedrockClient_getResponse(BedrockClient* b, int handle);
+
+        const char* bedrockClient_getField(BedrockClient* b, int handle,
+                                                enum bedrockField field);
+
+        uint64_t bedrockClient_getServerGUID(BedrockClient* b, int handle);
+
+        enum DNS_ERROR ping_getDNSerror(Ping* p);
+
+        void ping_ping_free(Ping* p);
+
+        uint64_t mc_hash64(const void* data, size_t length, uint64_t seed);
+
+        typedef struct TargetList TargetList;
+
+        TargetList* newTargetList(void);
+
+        void destroyTargetList(TargetList* t);
+
+        int targetList_load(TargetList* t, const char* path,
+                                                uint16_t defaultPort);
+
+        int targetList_add(TargetList* t, const char* host, uint16_t port);
+
+        size_t targetList_size(TargetList* t);
+
+        const char* targetList_getHost(TargetList* t, size_t index);
+
+        uint16_t targetList_getPort(TargetList* t, size_t index);
+
+        Ping* targetList_createPing(TargetList* t, size_t index);
+
+        typedef struct ResultSink ResultSink;
+
+        typedef struct BinaryLogReader BinaryLogReader;
+
+        ResultSink* newNDJSONSink(const char* path);
+
+        ResultSink* newBinaryLogSink(const char* path);
+
+        int sink_flush(ResultSink* s);
+
+        void destroySink(ResultSink* s);
+
+        void ping_setSink(Ping* p, ResultSink* s);
+
+        typedef struct RateLimiter RateLimiter;
+
+        RateLimiter* newRateLimiter(const struct RateLimitPolicy* p);
+
+        void destroyRateLimiter(RateLimiter* l);
+
+        void rateLimiter_setPolicy(RateLimiter* l,
+                                        const struct RateLimitPolicy* p);
+
+        void ping_setRateLimiter(Ping* p, RateLimiter* l);
+
+        typedef struct SourcePool SourcePool;
+
+        SourcePool* newSourcePool(void);
+
+        void destroySourcePool(SourcePool* pool);
+
+        int sourcePool_add(SourcePool* pool, const char* address);
+
+        void ping_setSourcePool(Ping* p, SourcePool* pool);
+
+        void ping_setAbortiveClose(Ping* p, int enable);
+
+        void ping_setFastOpen(Ping* p, int enable);
+
+        int ping_usedFastOpen(Ping* p);
+
+        void ping_setProtocolVersion(Ping* p, int version);
+
+        void ping_setDNSCacheTime(Ping* p, uint32_t ms);
+
+        typedef struct HedgeBudget HedgeBudget;
+
+        HedgeBudget* newHedgeBudget(const struct HedgePolicy* p);
+
+        void destroyHedgeBudget(HedgeBudget* b);
+
+        void ping_setHedging(Ping* p, HedgeBudget* b);
+
+        void ping_getResult(Ping* p, struct PingResult* out);
+
+        void ping_setChangeDetection(Ping* p, int enable, unsigned mask);
+
+        uint64_t ping_getResponseHash(Ping* p);
+
+        void ping_setProbeMode(Ping* p, enum probeMode mode);
+
+        long ping_getKernelRTT(Ping* p);
+
+        long ping_getStampedPing(Ping* p);
+
+        typedef struct FaviconStore FaviconStore;
+
+        FaviconStore* newFaviconStore(int decode);
+
+        void destroyFaviconStore(FaviconStore* s);
+
+        uint64_t faviconStore_put(FaviconStore* s, char* value, size_t length);
+
+        int faviconStore_get(FaviconStore* s, uint64_t hash,
+                                const uint8_t** data, size_t* length);
+
+        size_t faviconStore_size(FaviconStore* s);
+
+        void ping_setFaviconStore(Ping* p, FaviconStore* s);
+
+        uint64_t ping_getFaviconHash(Ping* p);
+
+        Ping* mc_initProbeContext(struct MC_ProbeContext* ctx,
+                                        const char* address, uint16_t port);
+
+        void mc_releaseProbeContext(struct MC_ProbeContext* ctx);
+
+        int mc_probeInto(Ping* p, char* buffer, size_t capacity,
+                                                        size_t* length);
+
+        uint64_t mc_hashResponse(const char* data, size_t length, unsigned mask);
+
+        typedef struct PollScheduler PollScheduler;
+
+        PollScheduler* newPollScheduler(void);
+
+        void destroyPollScheduler(PollScheduler* s);
+
+        void scheduler_setPolicy(PollScheduler* s,
+                                        const struct SchedulerPolicy* p);
+
+        int scheduler_add(PollScheduler* s, Ping* p, unsigned tier);
+
+        int scheduler_remove(PollScheduler* s, int handle);
+
+        size_t scheduler_next(PollScheduler* s, int* handles, size_t max);
+
+        void scheduler_report(PollScheduler* s, int handle, int result);
+
+        size_t scheduler_run(PollScheduler* s, size_t budget);
+
+        uint64_t scheduler_nextDue(PollScheduler* s);
+
+        Ping* scheduler_getPing(PollScheduler* s, int handle);
+
+        BinaryLogReader* newBinaryLogReader(const char* path);
+
+        size_t binaryLogReader_size(BinaryLogReader* r);
+
+        int binaryLogReader_get(BinaryLogReader* r, size_t index,
+                                                struct PingResult* out);
+
+        void destroyBinaryLogReader(BinaryLogReader* r);
+
+        typedef struct ScanCoordinator ScanCoordinator;
+
+        ScanCoordinator* newScanCoordinator(TargetList* targets, unsigned shards);
+
+        void destroyScanCoordinator(ScanCoordinator* c);
+
+        void scanCoordinator_setProbeMode(ScanCoordinator* c,
+                                                enum probeMode mode);
+
+        void scanCoordinator_setDeadline(ScanCoordinator* c, uint32_t seconds);
+
+        int scanCoordinator_setBindAddress(ScanCoordinator* c,
+                                                        const char* address);
+
+        int scanCoordinator_setToken(ScanCoordinator* c, const char* token);
+
+        void scanCoordinator_setUploadLimit(ScanCoordinator* c, uint64_t bytes);
+
+        int scanCoordinator_runLocal(ScanCoordinator* c, const char* output);
+
+        int scanCoordinator_serve(ScanCoordinator* c, uint16_t port,
+                                                        const char* output);
+
+        int mc_runScanWorker(const char* host, uint16_t port,
+                                const char* workPath, const char* token);
+
+        int mc_mergeLogs(const char* output, const char* const* inputs,
+                                                                size_t count);
+
+        typedef struct ProbeEngine ProbeEngine;
+
+        typedef struct SnapshotWriter SnapshotWriter;
+
+        typedef struct SnapshotReader SnapshotReader;
+
+        ProbeEngine* newProbeEngine(TargetList* targets, unsigned reactors);
+
+        void destroyProbeEngine(ProbeEngine* e);
+
+        void probeEngine_setSink(ProbeEngine* e, ResultSink* s);
+
+        void probeEngine_setProbeMode(ProbeEngine* e, enum probeMode mode);
+
+        void probeEngine_setAffinity(ProbeEngine* e, int enable);
+
+        void probeEngine_setWindow(ProbeEngine* e, unsigned probes);
+
+        int probeEngine_run(ProbeEngine* e);
+
+        unsigned probeEngine_getReactors(ProbeEngine* e);
+
+        int probeEngine_getStats(ProbeEngine* e, unsigned reactor,
+                                                struct EngineStats* out);
+
+        void probeEngine_getTotals(ProbeEngine* e, struct EngineStats* out);
+
+        void probeEngine_saveProgress(ProbeEngine* e, SnapshotWriter* w);
+
+        unsigned probeEngine_resumeProgress(ProbeEngine* e, SnapshotReader* r);
+
+        SnapshotWriter* newSnapshotWriter(void);
+
+        void destroySnapshotWriter(SnapshotWriter* w);
+
+        int snapshotWriter_add(SnapshotWriter* w, Ping* p, PollScheduler* s,
+                                                                int handle);
+
+        int snapshotWriter_write(SnapshotWriter* w, const char* path);
+
+        void snapshotWriter_clear(SnapshotWriter* w);
+
+        SnapshotReader* newSnapshotReader(const char* path);
+
+        void destroySnapshotReader(SnapshotReader* r);
+
+        int snapshotReader_restore(SnapshotReader* r, Ping* p, PollScheduler* s,
+                                                                int handle);
+
+        typedef struct SeriesStore SeriesStore;
+
+        SeriesStore* newSeriesStore(const char* path, size_t series,
+                                                        uint32_t blocks);
+
+        void destroySeriesStore(SeriesStore* s);
+
+        int seriesStore_record(SeriesStore* s, size_t index, uint64_t timestamp,
+                                                long milliseconds, long online);
+
+        int seriesStore_recordPing(SeriesStore* s, size_t index, Ping* p);
+
+        size_t seriesStore_range(SeriesStore* s, size_t index, uint64_t from,
+                uint64_t to, struct MC_SeriesSample* out, size_t max);
+
+        size_t seriesStore_downsample(SeriesStore* s, size_t index,
+                        uint64_t from, uint64_t to, uint64_t bucket,
+                        struct MC_SeriesBucket* out, size_t max);
+
+        int seriesStore_flush(SeriesStore* s);
+
+        typedef struct StatusCache StatusCache;
+
+        StatusCache* newStatusCache(const struct CachePolicy* p);
+
+        void destroyStatusCache(StatusCache* c);
+
+        StatusCache* statusCache_shared(void);
+
+        void statusCache_setPolicy(StatusCache* c, const struct CachePolicy* p);
+
+        void statusCache_setConfigure(StatusCache* c,
+                                mc_cacheConfigure callback, void* user);
+
+        int statusCache_get(StatusCache* c, const char* host, uint16_t port,
+                        struct PingResult* out, char* buffer, size_t capacity,
+                        enum cacheState* state);
+
+        void statusCache_getStats(StatusCache* c, struct CacheStats* out);
 
 
 
@@ -0,0 +1,590 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  bedrock.cpp
+* Author:  agent
+* Procedures:
+* BedrockClient(X)      -Constructor
+* ~BedrockClient        -Destructor
+* readBE64      -Reads a big endian 64 bit integer
+* writeBE64     -Writes a big endian 64 bit integer
+* clearResult   -Frees the result of a target
+* add           -Adds a target to ping
+* parsePong     -Parses an unconnected pong
+* handle        -Processes an answer datagram
+* drain         -Processes every datagram waiting on the socket
+* sendPending   -Sends the queued pings in batches
+* requeue       -Queues the unanswered pings once more
+* run           -Pings every target and waits for the answers
+* size          -Returns the number of targets
+* getError      -Returns the error code of a target
+* getPing       -Returns the round trip of a target
+* getResponse   -Returns the status string of a target
+* getField      -Returns one field of a target's status
+* getServerGUID -Returns the GUID a target's server reported
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+
+#define RAKNET_UNCONNECTED_PING 0x01
+#define RAKNET_UNCONNECTED_PONG 0x1C
+#define RAKNET_PING_SIZE 33
+/*ID, time, magic and client GUID*/
+#define RAKNET_PONG_HEADER_SIZE 35
+/*ID, time, server GUID, magic and the status length*/
+#define BEDROCK_SOCKET_BUFFER (8 << 20)
+/*receive buffer asked for, tens of thousands of pongs can arrive at once*/
+#define BEDROCK_INITIAL_TARGETS 64
+
+static const uint8_t raknetMagic[16] = {
+        0x00, 0xFF, 0xFF, 0x00, 0xFE, 0xFE, 0xFE, 0xFE,
+        0xFD, 0xFD, 0xFD, 0xFD, 0x12, 0x34, 0x56, 0x78
+};
+            /*offline message ID every unconnected RakNet packet carries*/
+
+enum bedrockState{BEDROCK_SKIP, BEDROCK_SEND, BEDROCK_WAIT, BEDROCK_DONE};
+            /*SKIP targets did not resolve. SEND targets are queued to be sent
+            *with the next batch, WAIT targets have their ping in flight
+            */
+
+
+/***************************************************************************
+* BedrockClient::BedrockClient(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+**************************************************************************/
+BedrockClient::BedrockClient(void)
+{
+        targets  = nullptr;
+        count    = 0;
+        capacity = 0;
+        packets  = nullptr;
+        queue    = nullptr;
+        queued   = 0;
+        nonce    = 0;
+
+        uint64_t now = PollScheduler::now();
+        guid = mc_hash64(&now, sizeof(now), (uint64_t)(uintptr_t)this);
+        /*the client GUID only has to differ between clients*/
+}
+
+/***************************************************************************
+* BedrockClient::~BedrockClient(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+BedrockClient::~BedrockClient(void)
+{
+        for(size_t i = 0; i < count; i++)
+                clearResult(&targets[i]);
+        free(targets);
+        free(packets);
+        free(queue);
+}
+
+/***************************************************************************
+* static uint64_t readBE64(const uint8_t* data)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads a big endian 64 bit integer
+*
+* Parameters:
+*        data   I/P     const uint8_t*  the 8 bytes to read
+*        readBE64       O/P     uint64_t        the integer
+**************************************************************************/
+static uint64_t readBE64(const uint8_t* data)
+{
+        uint64_t value = 0;
+        for(int i = 0; i < 8; i++)
+                value = value << 8 | data[i];
+
+        return value;
+}
+
+/***************************************************************************
+* static void writeBE64(uint8_t* data, uint64_t value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes a big endian 64 bit integer
+*
+* Parameters:
+*        data   O/P     uint8_t*        the 8 bytes to write
+*        value  I/P     uint64_t        the integer
+**************************************************************************/
+static void writeBE64(uint8_t* data, uint64_t value)
+{
+        for(int i = 7; i >= 0; i--){
+                data[i] = value & 0xFF;
+                value >>= 8;
+        }
+}
+
+/***************************************************************************
+* void BedrockClient::clearResult(Target* t)
+* Author: agent
+* Date: 10/19/2026
+* Description: Frees the result of a target
+*
+* Parameters:
+*        t      I/O     Target* target to clear
+**************************************************************************/
+void BedrockClient::clearResult(Target* t)
+{
+        free(t->status);
+        t->status     = nullptr;
+        t->fieldCount = 0;
+        t->serverGuid = 0;
+}
+
+/***************************************************************************
+* int BedrockClient::add(const char* host, uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds a target to ping. The host is resolved right away, a
+*       host that does not resolve keeps its error and is skipped by run()
+*
+* Parameters:
+*        host   I/P     const char*     IP or domain of the server
+*        port   I/P     uint16_t        port of the server
+*        add    O/P     int     handle of the target, INITIALIZATION_FAILURE
+*                               if the client is full or out of memory
+**************************************************************************/
+int BedrockClient::add(const char* host, uint16_t port)
+{
+        if(count >= BEDROCK_MAX_TARGETS)
+                return INITIALIZATION_FAILURE;
+
+        if(count == capacity){
+                size_t grown = capacity ? capacity * 2 : BEDROCK_INITIAL_TARGETS;
+                Target* t = (Target*)realloc(targets, grown * sizeof(Target));
+                if(t == nullptr)
+                        return INITIALIZATION_FAILURE;
+                targets  = t;
+                capacity = grown;
+        }
+
+        Target* t = &targets[count];
+        memset(t, 0, sizeof(Target));
+        t->milliseconds = -1;
+
+        uint32_t ip;
+        t->error = Ping::resolveIPv4(host, &ip);
+        t->state = t->error == OK ? BEDROCK_SEND : BEDROCK_SKIP;
+        if(t->error == OK)
+                t->error = CONNECT_FAILURE;
+        /*not pinged yet*/
+
+        t->address.sin_family      = AF_INET;
+        t->address.sin_port        = htons(port);
+        t->address.sin_addr.s_addr = ip;
+
+        return count++;
+}
+
+/***************************************************************************
+* bool BedrockClient::parsePong(Target* t, const uint8_t* data, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Keeps the status string of an unconnected pong and indexes its
+*       semicolon separated fields
+*
+* Parameters:
+*        t      I/O     Target* target the pong belongs to
+*        data   I/P     const uint8_t*  the pong
+*        length I/P     size_t  length of the pong
+*        parsePong      O/P     bool    false if the pong is malformed
+**************************************************************************/
+bool BedrockClient::parsePong(Target* t, const uint8_t* data, size_t length)
+{
+        clearResult(t);
+
+        if(length < RAKNET_PONG_HEADER_SIZE
+                                || memcmp(data + 17, raknetMagic, 16))
+                return false;
+
+        size_t statusLength = (size_t)data[33] << 8 | data[34];
+        if(statusLength > length - RAKNET_PONG_HEADER_SIZE)
+                return false;
+
+        t->status = (char*)malloc(2 * (statusLength + 1));
+        if(t->status == nullptr)
+                return false;
+        /*the status as received, followed by a copy split into its fields*/
+
+        const char* status = (const char*)data + RAKNET_PONG_HEADER_SIZE;
+        char* split = t->status + statusLength + 1;
+        memcpy(t->status, status, statusLength);
+        memcpy(split, status, statusLength);
+        t->status[statusLength] = '\0';
+        split[statusLength]     = '\0';
+        t->serverGuid = readBE64(data + 9);
+
+        size_t start = 0;
+        for(size_t i = 0; i <= statusLength
+                                && t->fieldCount < BEDROCK_FIELD_COUNT; i++){
+                if(i < statusLength && split[i] != ';')
+                        continue;
+                if(i == statusLength && start == statusLength)
+                        break;
+                /*the status ends with a separator, nothing follows it*/
+
+                split[i] = '\0';
+                t->fields[t->fieldCount++] = statusLength + 1 + start;
+                start = i + 1;
+        }
+
+        return t->fieldCount > BEDROCK_MOTD;
+        /*anything without an edition and a MOTD is not a Bedrock status*/
+}
+
+/***************************************************************************
+* void BedrockClient::handle(const uint8_t* data, size_t length,
+*                               const struct sockaddr_in* from, uint64_t now)
+* Author: agent
+* Date: 10/19/2026
+* Description: Processes an answer datagram. The echoed time field must carry
+*       this run's nonce and the index of a target that sits at the sender's
+*       address, anything else is ignored
+*
+* Parameters:
+*        data   I/P     const uint8_t*  datagram
+*        length I/P     size_t  length of the datagram
+*        from   I/P     const struct sockaddr_in*       sender of the datagram
+*        now    I/P     uint64_t        current time in milliseconds
+**************************************************************************/
+void BedrockClient::handle(const uint8_t* data, size_t length,
+                                const struct sockaddr_in* from, uint64_t now)
+{
+        if(length < 9 || data[0] != RAKNET_UNCONNECTED_PONG)
+                return;
+
+        uint64_t time = readBE64(data + 1);
+        size_t index  = time & (BEDROCK_MAX_TARGETS - 1);
+        bool resend   = (time >> 24 & 0xFF) != 0;
+        if((uint32_t)(time >> 32) != nonce || index >= count)
+                return;
+
+        Target* t = &targets[index];
+        if(t->state != BEDROCK_WAIT
+                        || from->sin_addr.s_addr != t->address.sin_addr.s_addr
+                        || from->sin_port != t->address.sin_port)
+                return;
+        /*a target already answered or still queued for its resend takes the
+        *first pong only
+        */
+
+        t->milliseconds = now - (resend ? t->resentAt : t->sentAt);
+        t->error = parsePong(t, data, length) ? OK : BAD_RESPONSE;
+        t->state = BEDROCK_DONE;
+        pending--;
+}
+
+/***************************************************************************
+* void BedrockClient::drain(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Processes every datagram waiting on the socket without
+*       blocking
+*
+* Parameters:
+*        fd     I/P     int     the client's UDP socket
+**************************************************************************/
+void BedrockClient::drain(int fd)
+{
+        uint64_t now = PollScheduler::now();
+        size_t received;
+
+        do{
+                struct Datagram datagrams[DATAGRAM_BATCH];
+                for(int i = 0; i < DATAGRAM_BATCH; i++){
+                        datagrams[i].data   = packets + i * BEDROCK_PACKET_SIZE;
+                        datagrams[i].length = BEDROCK_PACKET_SIZE;
+                }
+                received = receiveDatagrams(fd, datagrams, DATAGRAM_BATCH);
+
+                for(size_t i = 0; i < received; i++)
+                        handle(datagrams[i].data, datagrams[i].length,
+                                                &datagrams[i].address, now);
+        }while(received == DATAGRAM_BATCH);
+}
+
+/***************************************************************************
+* size_t BedrockClient::sendPending(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sends the queued pings, up to DATAGRAM_BATCH datagrams per
+*       system call where the platform allows it. Pongs are drained between
+*       batches, so a large sweep cannot overflow the receive buffer before
+*       the client starts reading it
+*
+* Parameters:
+*        fd     I/P     int     the client's UDP socket
+*        sendPending    O/P     size_t  number of targets that failed to send
+**************************************************************************/
+size_t BedrockClient::sendPending(int fd)
+{
+        size_t failed = 0;
+        size_t done   = 0;
+
+        while(done < queued){
+                uint8_t requests[DATAGRAM_BATCH][RAKNET_PING_SIZE];
+                struct Datagram datagrams[DATAGRAM_BATCH];
+                size_t batch = 0;
+                uint64_t now = PollScheduler::now();
+
+                for(; batch < DATAGRAM_BATCH && done + batch < queued; batch++){
+                        uint32_t index = queue[done + batch];
+                        Target* t  = &targets[index];
+                        uint8_t* r = requests[batch];
+
+                        bool resend = t->sentAt != 0;
+                        r[0] = RAKNET_UNCONNECTED_PING;
+                        writeBE64(r + 1, (uint64_t)nonce << 32
+                                        | (uint64_t)resend << 24 | index);
+                        memcpy(r + 9, raknetMagic, 16);
+                        writeBE64(r + 25, guid);
+                        /*servers echo the time field, so it names the target
+                        *and the send instead of holding a time
+                        */
+
+                        datagrams[batch].data    = r;
+                        datagrams[batch].length  = RAKNET_PING_SIZE;
+                        datagrams[batch].address = t->address;
+
+                        t->state = BEDROCK_WAIT;
+                        if(resend)
+                                t->resentAt = now;
+                        else
+                                t->sentAt = now;
+                        /*a pong reports the round trip of the send it
+                        *answers
+                        */
+                }
+
+                failed += sendDatagrams(fd, datagrams, batch);
+                /*a datagram that could not go out gets another chance in the
+                *resend pass
+                */
+                done += batch;
+
+                drain(fd);
+        }
+
+        queued = 0;
+        return failed;
+}
+
+/***************************************************************************
+* void BedrockClient::requeue(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Queues the ping of every target still waiting for its pong
+*       once more
+*
+* Parameters:
+**************************************************************************/
+void BedrockClient::requeue(void)
+{
+        for(size_t i = 0; i < count; i++){
+                if(targets[i].state != BEDROCK_WAIT)
+                        continue;
+                targets[i].state = BEDROCK_SEND;
+                queue[queued++] = i;
+        }
+}
+
+/***************************************************************************
+* int BedrockClient::run(uint32_t timeoutMs)
+* Author: agent
+* Date: 10/19/2026
+* Description: Pings every target through one UDP socket and waits for the
+*       pongs. Targets still silent halfway through the timeout are pinged
+*       once more. Previous results are replaced
+*
+* Parameters:
+*        timeoutMs      I/P     uint32_t        time to wait for all answers
+*        run    O/P     int     number of targets that answered, or a negative
+*                               pingError if the socket could not be set up
+**************************************************************************/
+int BedrockClient::run(uint32_t timeoutMs)
+{
+        if(packets == nullptr)
+                packets = (uint8_t*)malloc(DATAGRAM_BATCH * BEDROCK_PACKET_SIZE);
+        free(queue);
+        queue = (uint32_t*)malloc((count ? count : 1) * sizeof(uint32_t));
+        if(packets == nullptr || queue == nullptr)
+                return INITIALIZATION_FAILURE;
+        queued  = 0;
+        pending = 0;
+        nonce++;
+        /*pongs to an earlier run carry the old nonce and are dropped*/
+
+        for(size_t i = 0; i < count; i++){
+                Target* t = &targets[i];
+                if(t->state == BEDROCK_SKIP)
+                        continue;
+
+                clearResult(t);
+                t->state        = BEDROCK_SEND;
+                t->error        = CONNECT_FAILURE;
+                t->milliseconds = -1;
+                t->sentAt       = 0;
+                queue[queued++] = i;
+                pending++;
+        }
+
+        int ret = exchange(timeoutMs, BEDROCK_SOCKET_BUFFER);
+
+        int answered = 0;
+        for(size_t i = 0; i < count; i++){
+                if(targets[i].error == OK)
+                        answered++;
+                if(targets[i].state != BEDROCK_SKIP)
+                        targets[i].state = BEDROCK_DONE;
+        }
+
+        return ret == OK ? answered : ret;
+}
+
+/***************************************************************************
+* size_t BedrockClient::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of targets
+*
+* Parameters:
+*        size   O/P     size_t  number of targets
+**************************************************************************/
+size_t BedrockClient::size(void)
+{
+        return count;
+}
+
+/***************************************************************************
+* pingError BedrockClient::getError(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the error code of a target's last ping. OK if a pong
+*       arrived, CONNECT_FAILURE if the server never answered, BAD_RESPONSE
+*       for a malformed pong and the resolver's error for hosts that did not
+*       resolve
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        getError       O/P     pingError       error code
+**************************************************************************/
+pingError BedrockClient::getError(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count)
+                return INITIALIZATION_FAILURE;
+
+        return targets[handle].error;
+}
+
+/***************************************************************************
+* long BedrockClient::getPing(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the round trip of the target's ping
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        getPing        O/P     long    latency in milliseconds, -1 if the
+*                                       ping was not answered
+**************************************************************************/
+long BedrockClient::getPing(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count)
+                return -1;
+
+        return targets[handle].milliseconds;
+}
+
+/***************************************************************************
+* const char* BedrockClient::getResponse(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the status string of the target's pong as sent, such
+*       as "MCPE;Dedicated Server;686;1.21.2;0;10;...". Valid until the next
+*       run() or until the client is destroyed
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        getResponse    O/P     const char*     the status, nullptr if the
+*                                               target did not answer
+**************************************************************************/
+const char* BedrockClient::getResponse(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count)
+                return nullptr;
+
+        return targets[handle].status;
+}
+
+/***************************************************************************
+* const char* BedrockClient::getField(int handle, bedrockField field)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns one field of the target's status. Older servers send
+*       fewer fields. Valid until the next run() or until the client is
+*       destroyed
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        field  I/P     bedrockField    field to return
+*        getField       O/P     const char*     the field, nullptr if the
+*                                               server did not send it
+**************************************************************************/
+const char* BedrockClient::getField(int handle, bedrockField field)
+{
+        if(handle < 0 || (size_t)handle >= count || field < 0
+                                || (uint32_t)field >= targets[handle].fieldCount)
+                return nullptr;
+
+        return targets[handle].status + targets[handle].fields[field];
+}
+
+/***************************************************************************
+* uint64_t BedrockClient::getServerGUID(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the GUID the target's server sent in its pong, which
+*       stays the same across restarts of most servers
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        getServerGUID  O/P     uint64_t        the GUID, 0 if the target did
+*                                               not answer
+**************************************************************************/
+uint64_t BedrockClient::getServerGUID(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count)
+                return 0;
+
+        return targets[handle].serverGuid;
+}
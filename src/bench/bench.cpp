@@ -0,0 +1,307 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  bench.cpp
+* Author:  agent
+* Procedures:
+* writeVarInt   -Encodes a protocol varint
+* readFrame     -Reads one length prefixed packet from a socket
+* serveClient   -Answers the status and ping requests of one connection
+* runServer     -Local stand-in Minecraft server the workload probes
+* cpuMicros     -Returns the CPU time of the probing thread in microseconds
+* main          -Runs the probe workload and prints its cost
+***************************************************************************/
+
+/**Representative probe workload, used to train the profile guided build and
+*to compare it against the plain one. It starts a stand-in server on the
+*loopback interface and probes it with the modes and options a scanner uses.
+*Wall time is dominated by the loopback round trips, so the CPU time per
+*probe is the figure to compare
+**/
+
+
+#include <thread>
+#include <atomic>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "MinecraftPing.h"
+
+
+#define BENCH_PROBES 2000
+#define BENCH_SAMPLE_PLAYERS 12
+#define BENCH_FAVICON_SIZE 8192
+
+static char statusJSON[BENCH_FAVICON_SIZE + 2048];
+static size_t statusLength;
+static std::atomic<bool> stopping(false);
+
+
+/***************************************************************************
+* static size_t writeVarInt(uint8_t* buffer, uint32_t value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes a protocol varint
+*
+* Parameters:
+*        buffer I/O     uint8_t*        receives at most 5 bytes
+*        value  I/P     uint32_t        value to encode
+*        writeVarInt    O/P     size_t  number of bytes written
+**************************************************************************/
+static size_t writeVarInt(uint8_t* buffer, uint32_t value)
+{
+        size_t n = 0;
+        do{
+                uint8_t b = value & 0x7f;
+                value >>= 7;
+                buffer[n++] = value ? b | 0x80 : b;
+        }while(value);
+
+        return n;
+}
+
+/***************************************************************************
+* static bool readFrame(int fd, uint8_t* buffer, size_t size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads one length prefixed packet from a socket
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        buffer I/O     uint8_t*        receives the packet body
+*        size   I/P     size_t  size of the buffer
+*        readFrame      O/P     bool    false on EOF, errors or oversized
+*                                       packets
+**************************************************************************/
+static bool readFrame(int fd, uint8_t* buffer, size_t size)
+{
+        uint32_t length = 0;
+        for(int shift = 0; shift < 35; shift += 7){
+                uint8_t b;
+                if(recv(fd, &b, 1, 0) != 1)
+                        return false;
+                length |= (uint32_t)(b & 0x7f) << shift;
+                if(!(b & 0x80))
+                        break;
+        }
+        if(length > size)
+                return false;
+
+        size_t got = 0;
+        while(got < length){
+                ssize_t r = recv(fd, buffer + got, length - got, 0);
+                if(r <= 0)
+                        return false;
+                got += r;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static void serveClient(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Answers the handshake, status request and ping of one
+*       connection like a vanilla server does
+*
+* Parameters:
+*        fd     I/P     int     accepted connection, closed when done
+**************************************************************************/
+static void serveClient(int fd)
+{
+        uint8_t packet[512];
+        static uint8_t reply[sizeof(statusJSON) + 16];
+
+        if(readFrame(fd, packet, sizeof(packet))
+                                && readFrame(fd, packet, sizeof(packet))){
+                size_t n = writeVarInt(reply, statusLength + 1
+                                + writeVarInt(packet, statusLength));
+                reply[n++] = 0x00;
+                n += writeVarInt(reply + n, statusLength);
+                memcpy(reply + n, statusJSON, statusLength);
+                n += statusLength;
+                send(fd, reply, n, 0);
+                /*status response, the server runs one connection at a time so
+                *the static buffer is safe
+                */
+
+                if(readFrame(fd, packet, sizeof(packet))){
+                        uint8_t pong[10];
+                        pong[0] = 9;
+                        memcpy(pong + 1, packet, 9);
+                        send(fd, pong, sizeof(pong), 0);
+                }
+        }
+
+        close(fd);
+}
+
+/***************************************************************************
+* static void runServer(int listener)
+* Author: agent
+* Date: 10/19/2026
+* Description: Local stand-in Minecraft server the workload probes
+*
+* Parameters:
+*        listener       I/P     int     listening socket
+**************************************************************************/
+static void runServer(int listener)
+{
+        while(!stopping){
+                int fd = accept(listener, NULL, NULL);
+                if(fd < 0)
+                        continue;
+                serveClient(fd);
+        }
+}
+
+/***************************************************************************
+* static uint64_t cpuMicros(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the user and system CPU time of the calling thread,
+*       so the stand-in server's share is left out where the platform allows
+*
+* Parameters:
+*        cpuMicros      O/P     uint64_t        CPU time in microseconds
+**************************************************************************/
+static uint64_t cpuMicros(void)
+{
+        struct rusage usage;
+#ifdef RUSAGE_THREAD
+        getrusage(RUSAGE_THREAD, &usage);
+#else
+        getrusage(RUSAGE_SELF, &usage);
+#endif // RUSAGE_THREAD
+
+        return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+                        + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/***************************************************************************
+* int main(int argc, char* argv[])
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs the probe workload and prints its cost. The first
+*       argument overrides the number of probes
+*
+* Parameters:
+*        argc   I/P     int     number of arguments
+*        argv   I/P     char*[] arguments
+*        main   O/P     int     0 on success
+**************************************************************************/
+int main(int argc, char* argv[])
+{
+        long probes = argc > 1 ? atol(argv[1]) : BENCH_PROBES;
+        if(probes <= 0)
+                probes = BENCH_PROBES;
+
+        size_t n = snprintf(statusJSON, sizeof(statusJSON),
+                        "{\"version\":{\"name\":\"1.20.4\",\"protocol\":765},"
+                        "\"players\":{\"max\":100,\"online\":%d,\"sample\":[",
+                        BENCH_SAMPLE_PLAYERS);
+        for(int i = 0; i < BENCH_SAMPLE_PLAYERS; i++)
+                n += snprintf(statusJSON + n, sizeof(statusJSON) - n,
+                        "%s{\"name\":\"player%02d\",\"id\":"
+                        "\"4566e69f-c907-48ee-8d71-d7ba5aa00d%02d\"}",
+                        i ? "," : "", i, i);
+        n += snprintf(statusJSON + n, sizeof(statusJSON) - n,
+                        "]},\"description\":{\"text\":\"A Minecraft Server\"},"
+                        "\"favicon\":\"data:image\\/png;base64,");
+        for(int i = 0; i < BENCH_FAVICON_SIZE; i++)
+                statusJSON[n++] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdef"[(i * 7) & 31];
+        n += snprintf(statusJSON + n, sizeof(statusJSON) - n, "\"}");
+        statusLength = n;
+        /*a typical modern status response with a sample and a favicon*/
+
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        int on = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if(bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0
+                        || listen(listener, 128) < 0
+                        || getsockname(listener, (struct sockaddr*)&address,
+                                                                &length) < 0){
+                perror("bench: listen");
+                return 1;
+        }
+        std::thread server(runServer, listener);
+
+        FaviconStore favicons;
+        Ping ping("127.0.0.1", ntohs(address.sin_port));
+        ping.setChangeDetection(true, HASH_MASK_ONLINE);
+        ping.setAbortiveClose(true);
+
+        long failures = 0;
+        uint64_t hashes = 0;
+        struct timeval wallStart, wallStop;
+        gettimeofday(&wallStart, NULL);
+        uint64_t cpuStart = cpuMicros();
+
+        for(long i = 0; i < probes; i++){
+                switch(i & 3){
+                case 0:
+                        ping.setProbeMode(PROBE_FULL);
+                        ping.setFaviconStore(nullptr);
+                        break;
+                case 1:
+                        ping.setFaviconStore(&favicons);
+                        break;
+                case 2:
+                        ping.setProbeMode(PROBE_STATUS_ONLY);
+                        break;
+                case 3:
+                        ping.setProbeMode(PROBE_LATENCY_ONLY);
+                        ping.setFaviconStore(nullptr);
+                        break;
+                }
+                /*cycle through the probe paths a scanner takes*/
+
+                int ret = ping.connectMC();
+                if(ret != OK && ret != UNCHANGED)
+                        failures++;
+                if(ping.getResponse() != nullptr)
+                        hashes += ResponseHasher::hashResponse(ping.getResponse(),
+                                        strlen(ping.getResponse()),
+                                        HASH_MASK_SAMPLE | HASH_MASK_FAVICON);
+        }
+
+        uint64_t cpu = cpuMicros() - cpuStart;
+        gettimeofday(&wallStop, NULL);
+        uint64_t wall = (wallStop.tv_sec - wallStart.tv_sec) * 1000000
+                        + wallStop.tv_usec - wallStart.tv_usec;
+
+        stopping = true;
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+        server.join();
+
+        printf("probes %ld failures %ld wall_us %llu cpu_us %llu "
+                        "cpu_us_per_probe %.2f probes_per_s %.0f (check %llx)\n",
+                        probes, failures, (unsigned long long)wall,
+                        (unsigned long long)cpu, (double)cpu / probes,
+                        probes * 1e6 / wall, (unsigned long long)hashes);
+
+        return failures ? 1 : 0;
+}
@@ -0,0 +1,625 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+
+/***************************************************************************
+* File:  microbench.cpp
+* Author:  agent
+* Procedures:
+* malloc        -Counts allocations, then calls the C library's malloc
+* calloc        -Counts allocations, then calls the C library's calloc
+* realloc       -Counts allocations, then calls the C library's realloc
+* free          -Calls the C library's free
+* nowNanos      -Returns a monotonic time in nanoseconds
+* makeHost      -Builds a deterministic host name of a given length
+* makeResponse  -Builds a deterministic status response of a given size
+* makeSRVAnswer -Builds a DNS response with a number of SRV records
+* benchParseIPv4        -Times Ping::parseIPv4
+* benchEncodeHandshake  -Times Ping::encodeHandshake
+* benchDecodeVarInt     -Times mc_decodeVarInt
+* benchSRVQuestion      -Times Ping::buildSRVQuestion
+* benchSRVAnswer        -Times Ping::parseSRVAnswer
+* benchHashResponse     -Times ResponseHasher::hashResponse
+* benchParseOnline      -Times SeriesStore::parseOnline
+* benchHash64   -Times mc_hash64
+* run           -Runs one benchmark long enough to time it and prints it
+* main          -Runs every benchmark, or those matching a filter
+***************************************************************************/
+
+/**Microbenchmarks of the per-probe hot paths, run on fixed in-memory inputs
+*so no network is involved and two runs of the same build compare. Each
+*benchmark reports ns/op, bytes/op and allocs/op, the latter two counted by
+*wrapping the C library's allocator, which is only possible with glibc
+**/
+
+
+#include <time.h>
+#include "MinecraftPing.h"
+
+
+#define BENCH_MILLIS 200
+/*default time each benchmark is run for*/
+#define RESPONSE_SIZE (100 * 1024)
+
+static uint64_t allocations;
+static uint64_t allocated;
+static bool counting;
+/*allocations made while a benchmark was timed*/
+
+#ifdef __GLIBC__
+#define COUNTS_ALLOCATIONS 1
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* data, size_t size);
+extern "C" void __libc_free(void* data);
+
+/***************************************************************************
+* void* malloc(size_t size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Counts allocations, then calls the C library's malloc
+*
+* Parameters:
+*        size   I/P     size_t  bytes to allocate
+*        malloc O/P     void*   the allocation
+**************************************************************************/
+extern "C" void* malloc(size_t size)
+{
+        if(counting){
+                allocations++;
+                allocated += size;
+        }
+
+        return __libc_malloc(size);
+}
+
+/***************************************************************************
+* void* calloc(size_t count, size_t size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Counts allocations, then calls the C library's calloc
+*
+* Parameters:
+*        count  I/P     size_t  number of elements
+*        size   I/P     size_t  size of an element
+*        calloc O/P     void*   the zeroed allocation
+**************************************************************************/
+extern "C" void* calloc(size_t count, size_t size)
+{
+        if(counting){
+                allocations++;
+                allocated += count * size;
+        }
+
+        return __libc_calloc(count, size);
+}
+
+/***************************************************************************
+* void* realloc(void* data, size_t size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Counts allocations, then calls the C library's realloc
+*
+* Parameters:
+*        data   I/P     void*   allocation to resize, or NULL
+*        size   I/P     size_t  new size
+*        realloc        O/P     void*   the resized allocation
+**************************************************************************/
+extern "C" void* realloc(void* data, size_t size)
+{
+        if(counting){
+                allocations++;
+                allocated += size;
+        }
+
+        return __libc_realloc(data, size);
+}
+
+/***************************************************************************
+* void free(void* data)
+* Author: agent
+* Date: 10/19/2026
+* Description: Calls the C library's free
+*
+* Parameters:
+*        data   I/P     void*   allocation to release
+**************************************************************************/
+extern "C" void free(void* data)
+{
+        __libc_free(data);
+}
+#else
+#define COUNTS_ALLOCATIONS 0
+#endif // __GLIBC__
+
+static volatile uint64_t sink;
+/*results are folded into it so the compiler keeps the work*/
+
+
+/***************************************************************************
+* static uint64_t nowNanos(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns a monotonic time in nanoseconds
+*
+* Parameters:
+*        nowNanos       O/P     uint64_t        nanoseconds
+**************************************************************************/
+static uint64_t nowNanos(void)
+{
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/***************************************************************************
+* static void makeHost(char* out, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Builds a deterministic host name of a given length out of
+*       labels of up to 60 characters
+*
+* Parameters:
+*        out    I/O     char*   receives the name, length + 1 bytes
+*        length I/P     size_t  length of the name
+**************************************************************************/
+static void makeHost(char* out, size_t length)
+{
+        for(size_t i = 0; i < length; i++)
+                out[i] = i % 61 == 60 && i + 1 < length ? '.'
+                                        : "abcdefghijklmnopqrstuvwxyz"[i % 26];
+        out[length] = '\0';
+}
+
+/***************************************************************************
+* static size_t makeResponse(char* out, size_t size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Builds a deterministic status response of about the given
+*       size: a player sample, a chat component description and a favicon
+*       that fills the rest
+*
+* Parameters:
+*        out    I/O     char*   receives the response, size + 1 bytes
+*        size   I/P     size_t  size to aim for
+*        makeResponse   O/P     size_t  length of the response
+**************************************************************************/
+static size_t makeResponse(char* out, size_t size)
+{
+        size_t n = snprintf(out, size, "{\"version\":{\"name\":\"1.20.4\","
+                        "\"protocol\":765},\"players\":{\"max\":200,"
+                        "\"online\":137,\"sample\":[");
+        for(int i = 0; i < 12; i++)
+                n += snprintf(out + n, size - n, "%s{\"name\":\"player%02d\","
+                        "\"id\":\"4566e69f-c907-48ee-8d71-d7ba5aa00d%02d\"}",
+                        i ? "," : "", i, i);
+        n += snprintf(out + n, size - n, "]},\"description\":{\"text\":"
+                        "\"A \\\"quoted\\\" Minecraft Server\",\"extra\":[{\"text\":"
+                        "\"\\u00a7aonline\",\"color\":\"green\"}]},\"favicon\":"
+                        "\"data:image/png;base64,");
+        while(n + 2 < size){
+                out[n] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdef"[(n * 7) & 31];
+                n++;
+        }
+        out[n++] = '"';
+        out[n++] = '}';
+        out[n]   = '\0';
+
+        return n;
+}
+
+/***************************************************************************
+* static int makeSRVAnswer(uint8_t* out, unsigned records)
+* Author: agent
+* Date: 10/19/2026
+* Description: Builds a DNS response to the SRV query of a fixed domain, a
+*       CNAME followed by a number of SRV records whose names point back at
+*       the question, like resolvers compress them
+*
+* Parameters:
+*        out    I/O     uint8_t*        receives the response, 512 bytes
+*        records        I/P     unsigned        number of SRV records
+*        makeSRVAnswer  O/P     int     length of the response
+**************************************************************************/
+static int makeSRVAnswer(uint8_t* out, unsigned records)
+{
+        int n = Ping::buildSRVQuestion("play.example.net", 0x1234, out);
+        out[2] = 0x81;
+        out[3] = 0x80;
+        out[7] = records + 1;
+        /*a response without error, the CNAME and the records*/
+
+        static const uint8_t cname[] = {0xc0, 0x0c, 0x00, 0x05, 0x00, 0x01,
+                        0x00, 0x00, 0x01, 0x2c, 0x00, 0x02, 0xc0, 0x0c};
+        memcpy(out + n, cname, sizeof(cname));
+        n += sizeof(cname);
+
+        for(unsigned i = 0; i < records; i++){
+                char target[32];
+                int length = snprintf(target, sizeof(target), "node%02u", i);
+                uint8_t* r = out + n;
+
+                static const uint8_t head[] = {0xc0, 0x0c, 0x00, 0x21, 0x00,
+                                        0x01, 0x00, 0x00, 0x0e, 0x10};
+                memcpy(r, head, sizeof(head));
+                r[10] = 0;
+                r[11] = 6 + 1 + length + 2;
+                r[12] = 0;
+                r[13] = i % 3;
+                r[14] = 0;
+                r[15] = 10 + i;
+                r[16] = 0x63;
+                r[17] = 0xdd;
+                r[18] = length;
+                memcpy(r + 19, target, length);
+                r[19 + length] = 0xc0;
+                r[20 + length] = 0x21;
+                /*priority, weight and port, then nodeNN followed by a
+                *pointer to example.net in the question
+                */
+                n += 21 + length;
+        }
+
+        return n;
+}
+
+/***************************************************************************
+* static uint64_t benchParseIPv4(long ops, const void* input)
+* Author: agent
+* Date: 10/19/2026
+* Description: Times Ping::parseIPv4, which Ping::checkIfIP runs on every
+*       target
+*
+* Parameters:
+*        ops    I/P     long    number of calls
+*        input  I/P     const void*     host to check
+*        benchParseIPv4 O/P     uint64_t        nanoseconds taken
+**************************************************************************/
+static uint64_t benchParseIPv4(long ops, const void* input)
+{
+        const char* host = (const char*)input;
+        size_t length = strlen(host);
+        uint32_t address;
+        uint64_t found = 0;
+
+        uint64_t start = nowNanos();
+        for(long i = 0; i < ops; i++)
+                found += Ping::parseIPv4(host, length, &address);
+        uint64_t elapsed = nowNanos() - start;
+
+        sink = found;
+        return elapsed;
+}
+
+/***************************************************************************
+* static uint64_t benchEncodeHandshake(long ops, const void* input)
+* Author: agent
+* Date: 10/19/2026
+* Description: Times Ping::encodeHandshake, which Ping::buildHandshake and
+*       the probe engine encode every handshake with
+*
+* Parameters:
+*        ops    I/P     long    number of calls
+*        input  I/P     const void*     host the handshake names
+*        benchEncodeHandshake   O/P     uint64_t        nanoseconds taken
+**************************************************************************/
+static uint64_t benchEncodeHandshake(long ops, const void* input)
+{
+        const char* host = (const char*)input;
+        uint8_t packet[PREPARED_PACKET_SIZE];
+        uint64_t bytes = 0;
+
+        uint64_t start = nowNanos();
+        for(long i = 0; i < ops; i++)
+                bytes += Ping::encodeHandshake(packet, host, 25565 + (i & 7),
+                                                                VERSION);
+        uint64_t elapsed = nowNanos() - start;
+
+        sink = bytes + packet[bytes % 8];
+        return elapsed;
+}
+
+/***************************************************************************
+* static uint64_t benchDecodeVarInt(long ops, const void* input)
+* Author: agent
+* Date: 10/19/2026
+* Description: Times mc_decodeVarInt, which Ping::readVarInt and the probe
+*       engine decode every varint with
+*
+* Parameters:
+*        ops    I/P     long    number of calls
+*        input  I/P     const void*     the uint32_t value to encode
+*        benchDecodeVarInt      O/P     uint64_t        nanoseconds taken
+**************************************************************************/
+static uint64_t benchDecodeVarInt(long ops, const void* input)
+{
+        uint32_t value = *(const uint32_t*)input;
+        uint8_t encoded[5];
+        size_t length = 0;
+        do{
+                encoded[length++] = (value & 0x7f) | (value > 0x7f ? 0x80 : 0);
+                value >>= 7;
+        }while(value);
+
+        int32_t decoded;
+        uint64_t total = 0;
+
+        uint64_t start = nowNanos();
+        for(long i = 0; i < ops; i++){
+                total += mc_decodeVarInt(encoded, length, &decoded);
+                total += decoded;
+        }
+        uint64_t elapsed = nowNanos() - start;
+
+        sink = total;
+        return elapsed;
+}
+
+/***************************************************************************
+* static uint64_t benchSRVQuestion(long ops, const void* input)
+* Author: agent
+* Date: 10/19/2026
+* Description: Times Ping::buildSRVQuestion
+*
+* Parameters:
+*        ops    I/P     long    number of calls
+*        input  I/P     const void*     domain to encode
+*        benchSRVQuestion       O/P     uint64_t        nanoseconds taken
+**************************************************************************/
+static uint64_t benchSRVQuestion(long ops, const void* input)
+{
+        const char* domain = (const char*)input;
+        uint8_t packet[512];
+        uint64_t bytes = 0;
+
+        uint64_t start = nowNanos();
+        for(long i = 0; i < ops; i++)
+                bytes += Ping::buildSRVQuestion(domain, (uint16_t)i, packet);
+        uint64_t elapsed = nowNanos() - start;
+
+        sink = bytes + packet[bytes % 12];
+        return elapsed;
+}
+
+/***************************************************************************
+* static uint64_t benchSRVAnswer(long ops, const void* input)
+* Author: agent
+* Date: 10/19/2026
+* Description: Times Ping::parseSRVAnswer
+*
+* Parameters:
+*        ops    I/P     long    number of calls
+*        input  I/P     const void*     the unsigned number of SRV records
+*        benchSRVAnswer O/P     uint64_t        nanoseconds taken
+**************************************************************************/
+static uint64_t benchSRVAnswer(long ops, const void* input)
+{
+        uint8_t packet[512];
+        int length = makeSRVAnswer(packet, *(const unsigned*)input);
+        SRV_Answer answer;
+        uint64_t found = 0;
+
+        uint64_t start = nowNanos();
+        for(long i = 0; i < ops; i++){
+                Ping::parseSRVAnswer(packet, length, &answer);
+                found += answer.count;
+        }
+        uint64_t elapsed = nowNanos() - start;
+
+        sink = found;
+        return elapsed;
+}
+
+/***************************************************************************
+* static uint64_t benchHashResponse(long ops, const void* input)
+* Author: agent
+* Date: 10/19/2026
+* Description: Times ResponseHasher::hashResponse over a 100 KB response
+*
+* Parameters:
+*        ops    I/P     long    number of calls
+*        input  I/P     const void*     the unsigned hash mask
+*        benchHashResponse      O/P     uint64_t        nanoseconds taken
+**************************************************************************/
+static uint64_t benchHashResponse(long ops, const void* input)
+{
+        static char response[RESPONSE_SIZE + 1];
+        size_t length = makeResponse(response, RESPONSE_SIZE);
+        unsigned mask = *(const unsigned*)input;
+        uint64_t hash = 0;
+
+        uint64_t start = nowNanos();
+        for(long i = 0; i < ops; i++)
+                hash ^= ResponseHasher::hashResponse(response, length, mask);
+        uint64_t elapsed = nowNanos() - start;
+
+        sink = hash;
+        return elapsed;
+}
+
+/***************************************************************************
+* static uint64_t benchParseOnline(long ops, const void* input)
+* Author: agent
+* Date: 10/19/2026
+* Description: Times SeriesStore::parseOnline over a 100 KB response
+*
+* Parameters:
+*        ops    I/P     long    number of calls
+*        input  I/P     const void*     unused
+*        benchParseOnline       O/P     uint64_t        nanoseconds taken
+**************************************************************************/
+static uint64_t benchParseOnline(long ops, const void* input)
+{
+        static char response[RESPONSE_SIZE + 1];
+        size_t length = makeResponse(response, RESPONSE_SIZE);
+        long online = 0;
+        (void)input;
+
+        uint64_t start = nowNanos();
+        for(long i = 0; i < ops; i++)
+                online += SeriesStore::parseOnline(response, length);
+        uint64_t elapsed = nowNanos() - start;
+
+        sink = online;
+        return elapsed;
+}
+
+/***************************************************************************
+* static uint64_t benchHash64(long ops, const void* input)
+* Author: agent
+* Date: 10/19/2026
+* Description: Times mc_hash64 over a host name, the way targets are keyed
+*
+* Parameters:
+*        ops    I/P     long    number of calls
+*        input  I/P     const void*     host to hash
+*        benchHash64    O/P     uint64_t        nanoseconds taken
+**************************************************************************/
+static uint64_t benchHash64(long ops, const void* input)
+{
+        const char* host = (const char*)input;
+        size_t length = strlen(host);
+        uint64_t hash = 0;
+
+        uint64_t start = nowNanos();
+        for(long i = 0; i < ops; i++)
+                hash += mc_hash64(host, length, i);
+        uint64_t elapsed = nowNanos() - start;
+
+        sink = hash;
+        return elapsed;
+}
+
+/***************************************************************************
+* static void run(const char* name, uint64_t (*bench)(long, const void*),
+*                       const void* input, uint64_t millis, const char* filter)
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs one benchmark with a growing number of operations until
+*       a run takes the requested time, then prints the cost of one
+*       operation of that run
+*
+* Parameters:
+*        name   I/P     const char*     name of the benchmark
+*        bench  I/P     uint64_t (*)(long, const void*) benchmark function,
+*                                                       returns nanoseconds
+*        input  I/P     const void*     input passed to the function
+*        millis I/P     uint64_t        time to run for
+*        filter I/P     const char*     only run names containing it, or
+*                                       nullptr
+**************************************************************************/
+static void run(const char* name, uint64_t (*bench)(long, const void*),
+                const void* input, uint64_t millis, const char* filter)
+{
+        if(filter != nullptr && strstr(name, filter) == nullptr)
+                return;
+
+        long ops = 1;
+        uint64_t elapsed;
+        while(true){
+                allocations = 0;
+                allocated   = 0;
+                counting    = true;
+                elapsed     = bench(ops, input);
+                counting    = false;
+
+                if(elapsed >= millis * 1000000 || ops >= (1L << 40))
+                        break;
+
+                uint64_t target = elapsed ? ops * (millis * 1200000 / elapsed)
+                                                                : ops * 100;
+                ops = target > (uint64_t)ops * 100 ? ops * 100
+                        : target <= (uint64_t)ops ? ops * 2 : (long)target;
+        }
+        /*scale the next run from the last one, aiming a little over the
+        *requested time so the loop ends on the next run
+        */
+
+        if(COUNTS_ALLOCATIONS)
+                printf("%-28s %12ld %12.1f ns/op %10.1f B/op %8.2f allocs/op\n",
+                                name, ops, (double)elapsed / ops,
+                                (double)allocated / ops,
+                                (double)allocations / ops);
+        else
+                printf("%-28s %12ld %12.1f ns/op %10s B/op %8s allocs/op\n",
+                                name, ops, (double)elapsed / ops, "n/a", "n/a");
+        fflush(stdout);
+}
+
+/***************************************************************************
+* int main(int argc, char* argv[])
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs every benchmark. The first argument overrides the
+*       milliseconds each one runs for, the second only runs the benchmarks
+*       whose name contains it
+*
+* Parameters:
+*        argc   I/P     int     number of arguments
+*        argv   I/P     char*[] arguments
+*        main   O/P     int     0 on success
+**************************************************************************/
+int main(int argc, char* argv[])
+{
+        long millis = argc > 1 ? atol(argv[1]) : BENCH_MILLIS;
+        if(millis <= 0)
+                millis = BENCH_MILLIS;
+        const char* filter = argc > 2 ? argv[2] : nullptr;
+
+        static char shortHost[] = "mc.example.net";
+        static char ip[] = "203.0.113.77";
+        static char longHost[DOMAIN_MAX_SIZE + 1];
+        static char longestSRV[DOMAIN_MAX_SIZE + 1];
+        makeHost(longHost, DOMAIN_MAX_SIZE);
+        makeHost(longestSRV, 237);
+        /*with the _minecraft._tcp. prefix 237 characters is the longest
+        *name DNS allows, a 253 character host is rejected
+        */
+
+        uint32_t oneByte = 0x00;
+        uint32_t fiveBytes = 0xfffffff;
+        unsigned oneRecord = 1;
+        unsigned manyRecords = SRV_MAX_RECORDS;
+        unsigned noMask = HASH_MASK_NONE;
+        unsigned mask = HASH_MASK_SAMPLE | HASH_MASK_FAVICON;
+
+        run("parseIPv4/ip", benchParseIPv4, ip, millis, filter);
+        run("parseIPv4/short", benchParseIPv4, shortHost, millis, filter);
+        run("parseIPv4/253", benchParseIPv4, longHost, millis, filter);
+        run("encodeHandshake/short", benchEncodeHandshake, shortHost, millis,
+                                                                        filter);
+        run("encodeHandshake/253", benchEncodeHandshake, longHost, millis,
+                                                                        filter);
+        run("decodeVarInt/1", benchDecodeVarInt, &oneByte, millis, filter);
+        run("decodeVarInt/4", benchDecodeVarInt, &fiveBytes, millis, filter);
+        run("srvQuestion/short", benchSRVQuestion, shortHost, millis, filter);
+        run("srvQuestion/237", benchSRVQuestion, longestSRV, millis, filter);
+        run("srvQuestion/253", benchSRVQuestion, longHost, millis, filter);
+        run("srvAnswer/1", benchSRVAnswer, &oneRecord, millis, filter);
+        run("srvAnswer/16", benchSRVAnswer, &manyRecords, millis, filter);
+        run("hashResponse/100K", benchHashResponse, &noMask, millis, filter);
+        run("hashResponse/100K-masked", benchHashResponse, &mask, millis,
+                                                                        filter);
+        run("parseOnline/100K", benchParseOnline, nullptr, millis, filter);
+        run("hash64/253", benchHash64, longHost, millis, filter);
+
+        return 0;
+}
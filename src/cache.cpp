@@ -0,0 +1,774 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+
+/***************************************************************************
+* File:  cache.cpp
+* Author:  agent
+* Procedures:
+* hashKey       -Hashes a lowercase host and port
+* StatusCache(X)        -Constructor
+* ~StatusCache()        -Destructor
+* setPolicy     -Sets how long statuses are served
+* getPolicy     -Returns the current policy
+* setConfigure  -Sets the callback that configures new Ping objects
+* find          -Finds the entry of a server
+* grow          -Doubles the number of hash buckets
+* insert        -Adds the entry of a server
+* unlink        -Removes an entry from its bucket and frees it
+* evict         -Drops the least recently used idle entry
+* load          -Probes the server of an entry and copies the result
+* store         -Replaces the status of an entry with a new probe result
+* copyOut       -Hands the status of an entry to a caller
+* refresh       -Background refresh of a stale entry
+* work          -Body of a refresh worker
+* get           -Returns the status of a server, probing it when needed
+* getStats      -Returns the request and probe counters
+* size          -Returns the number of servers in the cache
+* shared        -Returns the process wide cache
+***************************************************************************/
+
+
+#include <thread>
+/*the standard headers come first, MinecraftPing.h defines nullptr*/
+
+#include "MinecraftPing.h"
+
+
+#define CACHE_BUCKETS 64
+/*initial number of hash buckets*/
+
+static const CachePolicy defaultPolicy = {
+        5000,   /*freshMillis*/
+        30000,  /*staleMillis*/
+        5000,   /*errorMillis*/
+        4096    /*maxEntries*/
+};
+
+struct StatusCache::Entry{
+        Entry* next;
+        uint64_t hash;
+        Ping* ping;
+        bool configured;
+        /*the configure callback ran on the Ping*/
+        PingResult result;
+        char* response;
+        /*copy of the last response, result.response is not used*/
+        uint64_t fetched;
+        /*when the status was probed, 0 if it never was*/
+        uint64_t used;
+        bool loading;
+        /*a caller or a refresh worker is probing the server*/
+        Entry* queued;
+        /*next entry waiting for a refresh worker*/
+        unsigned waiters;
+        /*callers waiting for that probe, the entry cannot be evicted while
+        *there are any
+        */
+};
+
+
+/***************************************************************************
+* static uint64_t hashKey(const char* host, size_t length, uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Hashes a lowercase host and port
+*
+* Parameters:
+*        host   I/P     const char*     lowercase host
+*        length I/P     size_t  length of the host
+*        port   I/P     uint16_t        port of the server
+*        hashKey        O/P     uint64_t        hash of the server
+**************************************************************************/
+static uint64_t hashKey(const char* host, size_t length, uint16_t port)
+{
+        uint64_t h = mc_hash64(host, length, 0);
+
+        return mc_hash64(&port, sizeof(port), h);
+}
+
+/***************************************************************************
+* StatusCache::StatusCache(const CachePolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+*        p      I/P     const CachePolicy*      policy, nullptr for the
+*                                               defaults
+**************************************************************************/
+StatusCache::StatusCache(const CachePolicy* p)
+{
+        buckets       = nullptr;
+        mask          = 0;
+        count         = 0;
+        configure     = nullptr;
+        configureUser = nullptr;
+        pending       = nullptr;
+        pendingTail   = nullptr;
+        started       = false;
+        stopping      = false;
+        memset(&stats, 0, sizeof(stats));
+
+        setPolicy(p);
+}
+
+/***************************************************************************
+* StatusCache::~StatusCache()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor. Stops the refresh workers, after the probes they
+*       are running, before the entries are freed. Queued refreshes are
+*       dropped
+*
+* Parameters:
+**************************************************************************/
+StatusCache::~StatusCache()
+{
+        std::unique_lock<std::mutex> guard(lock);
+        stopping = true;
+        wake.notify_all();
+        guard.unlock();
+
+        for(int i = 0; i < CACHE_REFRESH_WORKERS; i++){
+                if(workers[i].joinable())
+                        workers[i].join();
+        }
+
+        guard.lock();
+
+        for(size_t i = 0; buckets != nullptr && i <= mask; i++){
+                while(buckets[i] != nullptr)
+                        unlink(buckets[i]);
+        }
+
+        free(buckets);
+}
+
+/***************************************************************************
+* void StatusCache::setPolicy(const CachePolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets how long statuses are served. Statuses already in the
+*       cache are judged by the new policy
+*
+* Parameters:
+*        p      I/P     const CachePolicy*      policy, nullptr for the
+*                                               defaults
+**************************************************************************/
+void StatusCache::setPolicy(const CachePolicy* p)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        policy = p ? *p : defaultPolicy;
+        if(policy.maxEntries == 0)
+                policy.maxEntries = 1;
+}
+
+/***************************************************************************
+* void StatusCache::getPolicy(CachePolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the current policy
+*
+* Parameters:
+*        p      I/O     CachePolicy*    policy to fill
+**************************************************************************/
+void StatusCache::getPolicy(CachePolicy* p)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        *p = policy;
+}
+
+/***************************************************************************
+* void StatusCache::setConfigure(mc_cacheConfigure callback, void* user)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the callback that configures every Ping the cache
+*       creates. It runs outside of the cache lock, before the first probe of
+*       a server, so Ping objects created earlier keep their configuration
+*
+* Parameters:
+*        callback       I/P     mc_cacheConfigure       callback, or nullptr
+*        user   I/P     void*   value passed to the callback
+**************************************************************************/
+void StatusCache::setConfigure(mc_cacheConfigure callback, void* user)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        this->configure     = callback;
+        this->configureUser = user;
+}
+
+/***************************************************************************
+* StatusCache::Entry* StatusCache::find(uint64_t hash, const char* host,
+*                                                       uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Finds the entry of a server. The lock must be held
+*
+* Parameters:
+*        hash   I/P     uint64_t        hash of the server
+*        host   I/P     const char*     lowercase host
+*        port   I/P     uint16_t        port of the server
+*        find   O/P     Entry*  entry of the server, nullptr if there is none
+**************************************************************************/
+StatusCache::Entry* StatusCache::find(uint64_t hash, const char* host,
+                                                        uint16_t port)
+{
+        if(buckets == nullptr)
+                return nullptr;
+
+        for(Entry* e = buckets[hash & mask]; e != nullptr; e = e->next){
+                if(e->hash == hash && e->ping->getPort() == port
+                                && strcmp(e->ping->getAddress(), host) == 0)
+                        return e;
+        }
+
+        return nullptr;
+}
+
+/***************************************************************************
+* bool StatusCache::grow(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Doubles the number of hash buckets and moves the entries over.
+*       The lock must be held
+*
+* Parameters:
+*        grow   O/P     bool    false if out of memory
+**************************************************************************/
+bool StatusCache::grow(void)
+{
+        size_t slots = buckets == nullptr ? CACHE_BUCKETS : (mask + 1) * 2;
+
+        Entry** tmp = (Entry**)calloc(slots, sizeof(Entry*));
+        if(tmp == nullptr)
+                return false;
+
+        for(size_t i = 0; buckets != nullptr && i <= mask; i++){
+                Entry* e = buckets[i];
+                while(e != nullptr){
+                        Entry* next = e->next;
+                        e->next = tmp[e->hash & (slots - 1)];
+                        tmp[e->hash & (slots - 1)] = e;
+                        e = next;
+                }
+        }
+
+        free(buckets);
+        buckets = tmp;
+        mask    = slots - 1;
+
+        return true;
+}
+
+/***************************************************************************
+* StatusCache::Entry* StatusCache::insert(uint64_t hash, const char* host,
+*                                                       uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds an entry without a status for a server, dropping the
+*       least recently used idle entry first when the cache is full. The
+*       lock must be held
+*
+* Parameters:
+*        hash   I/P     uint64_t        hash of the server
+*        host   I/P     const char*     lowercase host
+*        port   I/P     uint16_t        port of the server
+*        insert O/P     Entry*  new entry, nullptr if out of memory
+**************************************************************************/
+StatusCache::Entry* StatusCache::insert(uint64_t hash, const char* host,
+                                                        uint16_t port)
+{
+        if(count >= policy.maxEntries)
+                evict();
+
+        if((buckets == nullptr || count > mask) && !grow())
+                return nullptr;
+
+        Entry* e = (Entry*)calloc(1, sizeof(Entry));
+        if(e == nullptr)
+                return nullptr;
+
+        e->ping = new(std::nothrow) Ping(host, port);
+        if(e->ping == nullptr){
+                free(e);
+                return nullptr;
+        }
+
+        e->hash = hash;
+        e->next = buckets[hash & mask];
+        buckets[hash & mask] = e;
+        count++;
+
+        return e;
+}
+
+/***************************************************************************
+* void StatusCache::unlink(Entry* e)
+* Author: agent
+* Date: 10/19/2026
+* Description: Removes an entry from its bucket and frees it. The lock must
+*       be held and nobody may be probing through the entry
+*
+* Parameters:
+*        e      I/O     Entry*  entry to remove
+**************************************************************************/
+void StatusCache::unlink(Entry* e)
+{
+        Entry** link = &buckets[e->hash & mask];
+        while(*link != e)
+                link = &(*link)->next;
+
+        *link = e->next;
+        count--;
+
+        delete e->ping;
+        free(e->response);
+        free(e);
+}
+
+/***************************************************************************
+* void StatusCache::evict(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Drops the least recently used entry that nobody is probing or
+*       waiting for. The lock must be held. This walks every entry, which is
+*       only done when a new server is added to a full cache
+*
+* Parameters:
+**************************************************************************/
+void StatusCache::evict(void)
+{
+        Entry* oldest = nullptr;
+
+        for(size_t i = 0; buckets != nullptr && i <= mask; i++){
+                for(Entry* e = buckets[i]; e != nullptr; e = e->next){
+                        if(e->loading || e->waiters > 0)
+                                continue;
+                        if(oldest == nullptr || e->used < oldest->used)
+                                oldest = e;
+                }
+        }
+
+        if(oldest == nullptr)
+                return;
+        /*every entry is busy, the cache goes over its size for now*/
+
+        unlink(oldest);
+        stats.evictions++;
+}
+
+/***************************************************************************
+* bool StatusCache::load(Entry* e, PingResult* result, char** response)
+* Author: agent
+* Date: 10/19/2026
+* Description: Probes the server of an entry and copies the result and the
+*       response out of its Ping. Runs without the lock, the loading flag of
+*       the entry gives the caller the Ping to itself
+*
+* Parameters:
+*        e      I/O     Entry*  entry to probe
+*        result I/O     PingResult*     result of the probe
+*        response       I/O     char**  malloc'd copy of the response, nullptr
+*                                       if there was none
+*        load   O/P     bool    true if the server answered
+**************************************************************************/
+bool StatusCache::load(Entry* e, PingResult* result, char** response)
+{
+        if(!e->configured){
+                mc_cacheConfigure callback;
+                void* user;
+                {
+                        std::lock_guard<std::mutex> guard(lock);
+                        callback = this->configure;
+                        user     = this->configureUser;
+                }
+                if(callback != nullptr)
+                        callback(user, e->ping);
+                e->configured = true;
+        }
+
+        e->ping->connectMC();
+        e->ping->getResult(result);
+
+        *response = nullptr;
+        if(result->response != nullptr){
+                *response = (char*)malloc(result->responseLength + 1);
+                if(*response != nullptr){
+                        memcpy(*response, result->response,
+                                                result->responseLength);
+                        (*response)[result->responseLength] = '\000';
+                }
+                else
+                        result->error = INITIALIZATION_FAILURE;
+        }
+        result->response = nullptr;
+
+        return result->error == OK || result->error == REDIRECTED
+                || result->error == UNCHANGED;
+}
+
+/***************************************************************************
+* void StatusCache::store(Entry* e, const PingResult* result, char* response,
+*                                                       bool background)
+* Author: agent
+* Date: 10/19/2026
+* Description: Replaces the status of an entry with a new probe result and
+*       wakes the callers waiting for it. A failed background refresh keeps
+*       the old status, which is served until it is too stale. An UNCHANGED
+*       probe only renews the old response. The lock must be held
+*
+* Parameters:
+*        e      I/O     Entry*  entry of the server
+*        result I/P     const PingResult*       result of the probe
+*        response       I/P     char*   malloc'd response, owned by the entry
+*                                       afterwards
+*        background     I/P     bool    the probe was a background refresh
+**************************************************************************/
+void StatusCache::store(Entry* e, const PingResult* result, char* response,
+                                                        bool background)
+{
+        bool answered = result->error == OK || result->error == REDIRECTED
+                        || result->error == UNCHANGED;
+
+        if(background && !answered && e->fetched != 0)
+                free(response);
+        else if(result->error == UNCHANGED && e->response != nullptr){
+                free(response);
+                pingError previous = e->result.error;
+                size_t length      = e->result.responseLength;
+
+                e->result                = *result;
+                e->result.error          = previous;
+                e->result.responseLength = length;
+                e->fetched               = PollScheduler::now();
+        }
+        else{
+                free(e->response);
+                e->response = response;
+                e->result   = *result;
+                e->fetched  = PollScheduler::now();
+        }
+
+        e->loading = false;
+        loaded.notify_all();
+}
+
+/***************************************************************************
+* int StatusCache::copyOut(Entry* e, const char* host, PingResult* out,
+*                                       char* buffer, size_t capacity)
+* Author: agent
+* Date: 10/19/2026
+* Description: Hands the status of an entry to a caller. The response is
+*       copied into the caller's buffer, cut off if it does not fit. The lock
+*       must be held
+*
+* Parameters:
+*        e      I/P     Entry*  entry of the server
+*        host   I/P     const char*     host the caller asked for
+*        out    I/O     PingResult*     result to fill, or nullptr
+*        buffer I/O     char*   buffer for the response, or nullptr
+*        capacity       I/P     size_t  size of the buffer, terminator included
+*        copyOut        O/P     int     error of the cached probe, or
+*                                       BUFFER_TRUNCATED
+**************************************************************************/
+int StatusCache::copyOut(Entry* e, const char* host, PingResult* out,
+                                        char* buffer, size_t capacity)
+{
+        int ret = e->result.error;
+
+        if(out != nullptr){
+                *out          = e->result;
+                out->host     = host;
+                out->response = nullptr;
+        }
+
+        if(buffer == nullptr || capacity == 0 || e->response == nullptr)
+                return ret;
+
+        size_t length = e->result.responseLength;
+        if(length >= capacity){
+                length = capacity - 1;
+                ret    = BUFFER_TRUNCATED;
+        }
+
+        memcpy(buffer, e->response, length);
+        buffer[length] = '\000';
+
+        if(out != nullptr)
+                out->response = buffer;
+
+        return ret;
+}
+
+/***************************************************************************
+* void StatusCache::refresh(Entry* e)
+* Author: agent
+* Date: 10/19/2026
+* Description: Probes the server of a stale entry again. Runs on a refresh
+*       worker without the lock
+*
+* Parameters:
+*        e      I/O     Entry*  stale entry, marked as loading
+**************************************************************************/
+void StatusCache::refresh(Entry* e)
+{
+        PingResult result;
+        char* response;
+        load(e, &result, &response);
+
+        std::lock_guard<std::mutex> guard(lock);
+        store(e, &result, response, true);
+}
+
+/***************************************************************************
+* void StatusCache::work(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Body of a refresh worker. Takes stale entries off the queue
+*       in the order they went stale until the cache is destroyed
+*
+* Parameters:
+**************************************************************************/
+void StatusCache::work(void)
+{
+        std::unique_lock<std::mutex> guard(lock);
+
+        while(!stopping){
+                if(pending == nullptr){
+                        wake.wait(guard);
+                        continue;
+                }
+
+                Entry* e = pending;
+                pending  = e->queued;
+                if(pending == nullptr)
+                        pendingTail = nullptr;
+                e->queued = nullptr;
+
+                guard.unlock();
+                refresh(e);
+                guard.lock();
+        }
+}
+
+/***************************************************************************
+* int StatusCache::get(const char* host, uint16_t port, PingResult* out,
+*               char* buffer, size_t capacity, cacheState* state)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the status of a server. A fresh status is returned
+*       right away and a stale one queues a background refresh first. With
+*       no usable status the caller probes the server itself, unless another
+*       caller already does, in which case it waits for that probe. Failed
+*       probes are served for errorMillis
+*
+* Parameters:
+*        host   I/P     const char*     domain of the minecraft server
+*        port   I/P     uint16_t        port of the minecraft server
+*        out    I/O     PingResult*     result of the probe the status came
+*                                       from, or nullptr. Its response points
+*                                       to the buffer, its host to host
+*        buffer I/O     char*   buffer to copy the null terminated response
+*                               to, or nullptr
+*        capacity       I/P     size_t  size of the buffer, terminator included
+*        state  I/O     cacheState*     where the status came from, or nullptr
+*        get    O/P     int     ping error code of the probe, BUFFER_TRUNCATED
+*                               if the response did not fit the buffer
+**************************************************************************/
+int StatusCache::get(const char* host, uint16_t port, PingResult* out,
+                char* buffer, size_t capacity, cacheState* state)
+{
+        char key[DOMAIN_MAX_SIZE + 1];
+        size_t length = 0;
+
+        if(host == nullptr || host[0] == '\000')
+                return NO_DOMAIN;
+
+        for(; host[length] != '\000'; length++){
+                if(length == DOMAIN_MAX_SIZE)
+                        return BAD_DOMAIN;
+                key[length] = (char)tolower((unsigned char)host[length]);
+        }
+        key[length] = '\000';
+        /*host names are case insensitive, so is the cache*/
+
+        uint64_t hash = hashKey(key, length, port);
+        cacheState how = CACHE_MISS;
+
+        std::unique_lock<std::mutex> guard(lock);
+        stats.requests++;
+
+        Entry* e = find(hash, key, port);
+        if(e == nullptr)
+                e = insert(hash, key, port);
+        if(e == nullptr)
+                return INITIALIZATION_FAILURE;
+
+        uint64_t now = PollScheduler::now();
+        e->used = now;
+
+        if(e->fetched != 0){
+                bool answered = e->result.error == OK
+                                || e->result.error == REDIRECTED;
+                uint64_t age = now - e->fetched;
+                uint64_t ttl = answered ? policy.freshMillis
+                                        : policy.errorMillis;
+
+                if(age <= ttl){
+                        stats.hits++;
+                        if(state != nullptr)
+                                *state = CACHE_FRESH;
+                        return copyOut(e, host, out, buffer, capacity);
+                }
+
+                if(answered && age <= ttl + policy.staleMillis){
+                        if(!e->loading && !stopping){
+                                e->loading = true;
+                                stats.refreshes++;
+
+                                if(pendingTail != nullptr)
+                                        pendingTail->queued = e;
+                                else
+                                        pending = e;
+                                pendingTail = e;
+
+                                for(int i = 0; !started
+                                        && i < CACHE_REFRESH_WORKERS; i++){
+                                        workers[i] = std::thread(
+                                                &StatusCache::work, this);
+                                }
+                                started = true;
+                                /*the workers start with the first refresh,
+                                *a cache that never serves stale statuses
+                                *runs no threads
+                                */
+                                wake.notify_one();
+                        }
+                        /*the loading flag keeps a queued entry from being
+                        *queued twice or evicted, so the queue never holds
+                        *more than the cache
+                        */
+
+                        stats.stale++;
+                        if(state != nullptr)
+                                *state = CACHE_STALE;
+                        return copyOut(e, host, out, buffer, capacity);
+                }
+        }
+
+        if(e->loading){
+                e->waiters++;
+                stats.coalesced++;
+                while(e->loading)
+                        loaded.wait(guard);
+                e->waiters--;
+
+                how = CACHE_COALESCED;
+        }
+        /*somebody is already probing the server, share its result*/
+
+        if(how == CACHE_COALESCED && e->fetched != 0){
+                bool answered = e->result.error == OK
+                                || e->result.error == REDIRECTED;
+                uint64_t age = PollScheduler::now() - e->fetched;
+                uint64_t ttl = answered ? (uint64_t)policy.freshMillis
+                                        + policy.staleMillis
+                                        : policy.errorMillis;
+
+                if(age > ttl)
+                        how = CACHE_MISS;
+        }
+        /*a failed background refresh keeps the old status, which can be
+        *past the stale window by now. The first waiter probes again and the
+        *others wait for that probe, the loading flag is set before the lock
+        *is dropped
+        */
+
+        if(how == CACHE_MISS || e->fetched == 0){
+                PingResult result;
+                char* response;
+
+                e->loading = true;
+                stats.probes++;
+                guard.unlock();
+
+                load(e, &result, &response);
+
+                guard.lock();
+                store(e, &result, response, false);
+                how = CACHE_MISS;
+        }
+        /*the status is too old to serve, or the probe that was waited for
+        *left none behind
+        */
+
+        if(state != nullptr)
+                *state = how;
+
+        return copyOut(e, host, out, buffer, capacity);
+}
+
+/***************************************************************************
+* void StatusCache::getStats(CacheStats* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the request and probe counters
+*
+* Parameters:
+*        out    I/O     CacheStats*     counters to fill
+**************************************************************************/
+void StatusCache::getStats(CacheStats* out)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        *out = stats;
+}
+
+/***************************************************************************
+* size_t StatusCache::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of servers in the cache
+*
+* Parameters:
+*        size   O/P     size_t  number of servers
+**************************************************************************/
+size_t StatusCache::size(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        return count;
+}
+
+/***************************************************************************
+* StatusCache* StatusCache::shared(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the process wide cache, created with the default
+*       policy on first use
+*
+* Parameters:
+*        shared O/P     StatusCache*    process wide cache
+**************************************************************************/
+StatusCache* StatusCache::shared(void)
+{
+        static StatusCache cache(nullptr);
+        return &cache;
+}
@@ -0,0 +1,1409 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  engine.cpp
+* Author:  agent
+* Procedures:
+* ProbeEngine(X, Y)     -Constructor
+* ~ProbeEngine()        -Destructor
+* availableCores        -Returns the number of CPUs the process may run on
+* pinToCore     -Pins the calling thread to one of the allowed CPUs
+* partition     -Splits the targets over the reactors
+* setSink       -Sets the sink every reactor writes results to
+* setProbeMode  -Sets the probe mode of the engine
+* setAffinity   -Turns pinning reactors to CPUs on or off
+* setWindow     -Sets how many probes a reactor keeps in flight
+* claim         -Claims the next target for a reactor
+* readHeader    -Decodes the header of a status response
+* openResolver  -Opens the DNS socket of a reactor
+* start         -Starts probing a claimed target
+* ask           -Sends a DNS query for a probe
+* dial          -Starts connecting a probe to its resolved address
+* answer        -Hands a DNS response to the probe waiting for it
+* advance       -Moves a probe along when its socket is ready
+* consume       -Adds received status response bytes to a probe
+* finish        -Writes out the result of a probe and frees its slot
+* runReactor    -Event loop probing targets until none is left
+* run           -Probes every target once
+* getReactors   -Returns the number of reactors
+* getStats      -Returns the statistics of one reactor
+* getTotals     -Returns the statistics of all reactors summed
+* checkpointId  -Returns the snapshot checkpoint ID of a partition
+* saveProgress  -Adds the progress of every partition to a snapshot
+* resumeProgress        -Resumes the partitions from a snapshot
+***************************************************************************/
+
+
+#include <thread>
+#include <vector>
+/*the standard headers come first, MinecraftPing.h defines nullptr*/
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#define poll WSAPoll
+#define IN_PROGRESS() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define SEND_CAST (const char*)
+#define RECV_CAST (char*)
+#define OPT_CAST (char*)
+#define SEND_FLAGS 0
+typedef int socklen_t;
+#else
+#include <poll.h>
+#include <errno.h>
+#define IN_PROGRESS() (errno == EINPROGRESS)
+#define WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
+#define SEND_CAST
+#define RECV_CAST
+#define OPT_CAST
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif // MSG_NOSIGNAL
+/*a server resetting the connection must not kill the scan with SIGPIPE*/
+#endif // _WIN32
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif // __linux__
+
+
+#define CACHE_LINE 64
+#define ENGINE_WINDOW 256
+/*probes a reactor keeps in flight by default*/
+#define ENGINE_MAX_WINDOW 65536
+/*every probe of a reactor waiting on DNS needs its own query ID*/
+#define ENGINE_MAX_WAIT 1000
+/*longest a reactor sleeps in poll(), in milliseconds*/
+#define ENGINE_CHUNK (BUFFER_SIZE * 16)
+/*bytes of a status response received at once*/
+#define ENGINE_HEAD 16
+/*bytes kept until the status packet header is decoded, a packet length,
+*the packet ID and a string length fit in 11
+*/
+
+#define STEP_IDLE 0
+#define STEP_SRV 1
+#define STEP_A 2
+#define STEP_CONNECTING 3
+#define STEP_SENDING 4
+#define STEP_READING 5
+#define STEP_PONG 6
+/*steps of a probe, the slot is free while it is idle*/
+
+static const pingError stepFailure[] = {OK, SRV_FAILURE, NO_DOMAIN,
+                CONNECT_FAILURE, SEND_FAILURE, RECEIVE_FAILURE, RECEIVE_FAILURE};
+/*what a probe fails with when its step times out, by step*/
+
+struct ProbeEngine::Reactor{
+        alignas(CACHE_LINE) std::atomic<size_t> next;
+        /*next position of the partition to probe, the only field other
+        *reactors touch, on its own cache line
+        */
+        alignas(CACHE_LINE) size_t begin;
+        size_t end;
+        /*the partition, positions in the engine's order array*/
+        size_t resume;
+        /*targets of the partition the next run skips, from a snapshot*/
+        EngineStats stats;
+        /*written by the reactor alone while it runs*/
+        Probe* probes;
+        /*the window of probes in flight*/
+        SocketHandle dns;
+        struct sockaddr_in nameserver;
+        uint64_t querySecret;
+        uint64_t queries;
+        /*DNS client of the reactor: its own UDP socket, connected to the
+        *server it asks, and the secret and count its query IDs are hashed
+        *from
+        */
+};
+
+struct ProbeEngine::Endpoint{
+        uint64_t expires;
+        /*time the resolution runs out, monotonic milliseconds. 0 if the
+        *target was never resolved
+        */
+        char* backend;
+        /*SRV target the handshake names, nullptr for the target's own host*/
+        uint32_t ipv4;
+        /*resolved address in network order*/
+        uint16_t port;
+        /*port to connect to, the SRV port if there was a record*/
+        bool redirected;
+        /*the target went through an SRV record*/
+};
+
+struct ProbeEngine::Probe{
+        SocketHandle sock;
+        int step;
+        /*connection of the probe and what it is waiting for*/
+        size_t position;
+        uint32_t index;
+        /*position in the order array and index of the target*/
+        uint16_t query;
+        /*ID of the DNS query the probe waits for*/
+        uint32_t ttl;
+        /*lowest TTL of the records the resolution went through*/
+        uint64_t deadline;
+        /*time the current step gives up, monotonic milliseconds*/
+        uint64_t started;
+        /*time the measured round trip started, monotonic milliseconds*/
+        struct sockaddr_in address;
+        /*endpoint probed, the address is 0 until it resolved*/
+        pingError status;
+        DNS_ERROR dnsError;
+        long milliseconds;
+        /*outcome of the probe so far*/
+        char backend[DOMAIN_MAX_SIZE + 1];
+        /*SRV target the probe resolves and names in its handshake, empty
+        *for the target's own host
+        */
+        uint8_t packet[PREPARED_PACKET_SIZE];
+        size_t packetLength;
+        size_t sent;
+        /*handshake and status request, and how much of it went out*/
+        uint8_t head[ENGINE_HEAD];
+        size_t headLength;
+        int32_t remaining;
+        /*start of the status packet until its header is decoded, then the
+        *body bytes still to come. -1 while the header is incomplete
+        */
+        char* response;
+        size_t responseLength;
+        size_t capacity;
+        /*body of the status response, nullptr for latency-only probes*/
+        uint8_t ping[10];
+        uint8_t pong[10];
+        size_t pongLength;
+        /*ping packet sent and the pong received so far*/
+};
+
+
+/***************************************************************************
+* ProbeEngine::ProbeEngine(TargetList* targets, unsigned reactors)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor. The list must not change while the engine uses
+*       it
+*
+* Parameters:
+*        targets        I/P     TargetList*     targets to probe, not owned
+*        reactors       I/P     unsigned        number of reactors, 0 for one
+*                                               per available CPU
+**************************************************************************/
+ProbeEngine::ProbeEngine(TargetList* targets, unsigned reactors)
+{
+        this->targets = targets;
+        reactorCount  = reactors ? reactors : availableCores();
+        this->reactors = nullptr;
+        order     = nullptr;
+        endpoints = nullptr;
+        done      = nullptr;
+        sink      = nullptr;
+        mode      = PROBE_FULL;
+        window    = ENGINE_WINDOW;
+        pin       = true;
+
+        if(!partition()){
+                delete[] this->reactors;
+                delete[] done;
+                free(order);
+                free(endpoints);
+                this->reactors = nullptr;
+                order     = nullptr;
+                endpoints = nullptr;
+                done      = nullptr;
+        }
+        /*run() reports the failure*/
+}
+
+/***************************************************************************
+* ProbeEngine::~ProbeEngine()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+ProbeEngine::~ProbeEngine()
+{
+        if(endpoints != nullptr){
+                for(size_t i = 0; i < targets->size(); i++)
+                        free(endpoints[i].backend);
+        }
+
+        delete[] reactors;
+        delete[] done;
+        free(order);
+        free(endpoints);
+}
+
+/***************************************************************************
+* unsigned ProbeEngine::availableCores(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of CPUs the process may run on, which is
+*       less than the machine has under taskset or a cpuset cgroup
+*
+* Parameters:
+*        availableCores O/P     unsigned        number of CPUs, at least 1
+**************************************************************************/
+unsigned ProbeEngine::availableCores(void)
+{
+#ifdef __linux__
+        cpu_set_t set;
+        if(sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+                return CPU_COUNT(&set);
+#endif // __linux__
+
+        unsigned cores = std::thread::hardware_concurrency();
+        return cores ? cores : 1;
+}
+
+/***************************************************************************
+* static int pinToCore(unsigned reactor)
+* Author: agent
+* Date: 10/19/2026
+* Description: Pins the calling thread to one of the CPUs the process may
+*       run on, reactor N gets the Nth allowed CPU, wrapping around when
+*       there are more reactors than CPUs
+*
+* Parameters:
+*        reactor        I/P     unsigned        index of the reactor
+*        pinToCore      O/P     int     the CPU, -1 if the thread was not
+*                                       pinned
+**************************************************************************/
+static int pinToCore(unsigned reactor)
+{
+#ifdef __linux__
+        cpu_set_t allowed;
+        if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0
+                                                || CPU_COUNT(&allowed) == 0)
+                return -1;
+
+        unsigned skip = reactor % CPU_COUNT(&allowed);
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+                if(!CPU_ISSET(cpu, &allowed) || skip-- > 0)
+                        continue;
+
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+                        return -1;
+                return cpu;
+        }
+#else
+        (void)reactor;
+#endif // __linux__
+
+        return -1;
+}
+
+/***************************************************************************
+* bool ProbeEngine::partition(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Splits the targets over the reactors by their hash with a
+*       ShardRing. The order array holds the target indexes grouped by
+*       reactor, every reactor owns one contiguous range of it
+*
+* Parameters:
+*        partition      O/P     bool    false if out of memory
+**************************************************************************/
+bool ProbeEngine::partition(void)
+{
+        size_t total = targets->size();
+
+        reactors = new(std::nothrow) Reactor[reactorCount];
+        order = (uint32_t*)malloc((total ? total : 1) * sizeof(uint32_t));
+        endpoints = (Endpoint*)calloc(total ? total : 1, sizeof(Endpoint));
+        done  = new(std::nothrow) std::atomic<uint64_t>[total / 64 + 1];
+        if(reactors == nullptr || order == nullptr || endpoints == nullptr
+                                || done == nullptr || !ring.build(reactorCount))
+                return false;
+
+        for(unsigned r = 0; r < reactorCount; r++){
+                reactors[r].begin  = 0;
+                reactors[r].end    = 0;
+                reactors[r].resume = 0;
+        }
+
+        for(size_t i = 0; i < total; i++)
+                reactors[ring.shardOf(targets->getTarget(i)->hash)].end++;
+
+        size_t position = 0;
+        for(unsigned r = 0; r < reactorCount; r++){
+                reactors[r].begin = position;
+                position += reactors[r].end;
+                reactors[r].end = reactors[r].begin;
+        }
+        /*turn the counts into ranges, end is the fill position for now*/
+
+        for(size_t i = 0; i < total; i++){
+                Reactor* r = &reactors[ring.shardOf(targets->getTarget(i)->hash)];
+                order[r->end++] = i;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* void ProbeEngine::setSink(ResultSink* s)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the sink every reactor writes its results to. Sinks are
+*       safe to share between threads
+*
+* Parameters:
+*        s      I/P     ResultSink*     the sink, nullptr for none
+**************************************************************************/
+void ProbeEngine::setSink(ResultSink* s)
+{
+        sink = s;
+}
+
+/***************************************************************************
+* void ProbeEngine::setProbeMode(probeMode m)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the probe mode every target is probed with
+*
+* Parameters:
+*        m      I/P     probeMode       probe mode
+**************************************************************************/
+void ProbeEngine::setProbeMode(probeMode m)
+{
+        mode = m;
+}
+
+/***************************************************************************
+* void ProbeEngine::setAffinity(bool enable)
+* Author: agent
+* Date: 10/19/2026
+* Description: Turns pinning every reactor to its own CPU on or off, on by
+*       default. Only Linux pins threads
+*
+* Parameters:
+*        enable I/P     bool    true to pin the reactors
+**************************************************************************/
+void ProbeEngine::setAffinity(bool enable)
+{
+        pin = enable;
+}
+
+/***************************************************************************
+* void ProbeEngine::setWindow(unsigned probes)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets how many probes every reactor keeps in flight at once,
+*       ENGINE_WINDOW by default. Each one holds a socket while it runs, so
+*       reactors times window has to stay below the descriptor limit
+*
+* Parameters:
+*        probes I/P     unsigned        probes per reactor, at least 1
+**************************************************************************/
+void ProbeEngine::setWindow(unsigned probes)
+{
+        if(probes == 0)
+                probes = 1;
+        if(probes > ENGINE_MAX_WINDOW)
+                probes = ENGINE_MAX_WINDOW;
+
+        window = probes;
+}
+
+/***************************************************************************
+* bool ProbeEngine::claim(unsigned reactor, size_t* position)
+* Author: agent
+* Date: 10/19/2026
+* Description: Claims the next target for a reactor, from its own partition
+*       while there is one left, then from the other reactors' partitions.
+*       Owner and thief both claim with a fetch_add on the partition's
+*       cursor, so no target is probed twice and nobody ever waits
+*
+* Parameters:
+*        reactor        I/P     unsigned        index of the reactor
+*        position       O/P     size_t* claimed position in the order array
+*        claim  O/P     bool    false if every partition is used up
+**************************************************************************/
+bool ProbeEngine::claim(unsigned reactor, size_t* position)
+{
+        Reactor* own = &reactors[reactor];
+
+        size_t p = own->next.fetch_add(1, std::memory_order_relaxed);
+        if(p < own->end){
+                *position = p;
+                return true;
+        }
+
+        for(unsigned i = 1; i < reactorCount; i++){
+                Reactor* victim = &reactors[(reactor + i) % reactorCount];
+                if(victim->next.load(std::memory_order_relaxed) >= victim->end)
+                        continue;
+                /*look before writing, so used up partitions stay in the
+                *cache of their owner
+                */
+
+                p = victim->next.fetch_add(1, std::memory_order_relaxed);
+                if(p < victim->end){
+                        own->stats.stolen++;
+                        *position = p;
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/***************************************************************************
+* static int readHeader(const uint8_t* head, size_t length, int32_t* body)
+* Author: agent
+* Date: 10/19/2026
+* Description: Decodes the header of a status response: the packet length,
+*       the packet ID and the length of the JSON string
+*
+* Parameters:
+*        head   I/P     const uint8_t*  first bytes of the response
+*        length I/P     size_t  number of bytes received
+*        body   O/P     int32_t*        length of the JSON string
+*        readHeader     O/P     int     bytes the header takes, 0 if it is
+*                                       not complete yet, or a negative
+*                                       pingError
+**************************************************************************/
+static int readHeader(const uint8_t* head, size_t length, int32_t* body)
+{
+        int32_t packetLength;
+        int used = mc_decodeVarInt(head, length, &packetLength);
+        if(used <= 0)
+                return used < 0 ? MALFORMED_VARINT_PACKET : 0;
+        /*the packet length, the string length inside it is what counts*/
+
+        if((size_t)used >= length)
+                return 0;
+        if(head[used] != 0x00)
+                return BAD_RESPONSE;
+        /*if the ID is not 0, then it is not a regular reply, could be a
+        *reject packet or trash
+        */
+
+        int more = mc_decodeVarInt(head + used + 1, length - used - 1, body);
+        if(more <= 0)
+                return more < 0 ? MALFORMED_VARINT_PACKET : 0;
+        if(*body < 0)
+                return BAD_RESPONSE;
+
+        return used + 1 + more;
+}
+
+/***************************************************************************
+* static bool openResolver(SocketHandle* dns, struct sockaddr_in* nameserver)
+* Author: agent
+* Date: 10/19/2026
+* Description: Opens the non-blocking UDP socket a reactor sends its DNS
+*       queries from, and finds the server SRV_Lookup asks too. The socket
+*       is connected to that server, so the system drops datagrams from any
+*       other address before they reach answer()
+*
+* Parameters:
+*        dns    I/O     SocketHandle*   receives the socket
+*        nameserver     I/O     struct sockaddr_in*     receives the DNS
+*                                                       server
+*        openResolver   O/P     bool    false if the socket could not be
+*                                       opened
+**************************************************************************/
+static bool openResolver(SocketHandle* dns, struct sockaddr_in* nameserver)
+{
+        memset(nameserver, 0, sizeof(*nameserver));
+        nameserver->sin_family = AF_INET;
+        nameserver->sin_port   = htons(53);
+#ifdef _WIN32
+        FIXED_INFO pfi;
+        unsigned long ulOutBufLen = sizeof(FIXED_INFO);
+        GetNetworkParams(&pfi, &ulOutBufLen);
+        nameserver->sin_addr.s_addr = inet_addr(pfi.DnsServerList.IpAddress.String);
+#endif // _WIN32
+#ifdef __linux__
+        res_init();
+        *nameserver = _res.nsaddr_list[0];
+#endif // __linux__
+        /*the system's resolver, usually the router. _res belongs to the
+        *calling thread
+        */
+
+        dns->reset(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+        if(!dns->valid() || !mc_setBlocking(dns->get(), false)
+                        || connect(dns->get(), (struct sockaddr*)nameserver,
+                                                sizeof(*nameserver)) < 0){
+                dns->reset();
+                return false;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* void ProbeEngine::start(Reactor* r, Probe* p, size_t position)
+* Author: agent
+* Date: 10/19/2026
+* Description: Starts probing a claimed target in a free slot. IP literals
+*       and targets whose last resolution is still good connect right away,
+*       the others start with the SRV lookup Ping::prepare() does
+*
+* Parameters:
+*        r      I/O     Reactor*        reactor running the probe
+*        p      I/O     Probe*  free slot of the reactor
+*        position       I/P     size_t  claimed position in the order array
+**************************************************************************/
+void ProbeEngine::start(Reactor* r, Probe* p, size_t position)
+{
+        p->position       = position;
+        p->index          = order[position];
+        p->status         = OK;
+        p->dnsError       = NOERROR_STATUS;
+        p->milliseconds   = -1;
+        p->ttl            = UINT32_MAX;
+        p->backend[0]     = '\0';
+        p->sent           = 0;
+        p->headLength     = 0;
+        p->remaining      = -1;
+        p->response       = nullptr;
+        p->responseLength = 0;
+        p->capacity       = 0;
+        p->pongLength     = 0;
+
+        const MC_Target* t = targets->getTarget(p->index);
+        const Endpoint* e  = &endpoints[p->index];
+        memset(&p->address, 0, sizeof(p->address));
+        p->address.sin_family = AF_INET;
+        p->address.sin_port   = htons(t->port);
+
+        if(t->ipv4 != 0){
+                p->address.sin_addr.s_addr = t->ipv4;
+                dial(r, p);
+                return;
+        }
+        /*IP literals are connected to as they are*/
+
+        if(e->expires != 0 && PollScheduler::now() < e->expires){
+                p->address.sin_addr.s_addr = e->ipv4;
+                p->address.sin_port        = htons(e->port);
+                p->status = e->redirected ? REDIRECTED : OK;
+                if(e->backend != nullptr)
+                        strcpy(p->backend, e->backend);
+                dial(r, p);
+                return;
+        }
+        /*reuse the last resolution of the target until it runs out*/
+
+        if(!ask(r, p, targets->getHost(p->index), STEP_SRV))
+                finish(r, p, SRV_FAILURE);
+}
+
+/***************************************************************************
+* bool ProbeEngine::ask(Reactor* r, Probe* p, const char* name, int step)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sends the SRV or A query of a probe from the reactor's DNS
+*       socket, the probe then waits for the answer with the query's ID. The
+*       ID is hashed from a secret of the reactor, so a host that cannot see
+*       the queries cannot guess it, and no two waiting probes share one
+*
+* Parameters:
+*        r      I/O     Reactor*        reactor running the probe
+*        p      I/O     Probe*  the probe
+*        name   I/P     const char*     domain to look up
+*        step   I/P     int     STEP_SRV or STEP_A
+*        ask    O/P     bool    false if the query could not be sent, the
+*                               probe's DNS error holds the reason
+**************************************************************************/
+bool ProbeEngine::ask(Reactor* r, Probe* p, const char* name, int step)
+{
+        uint8_t packet[512];
+        /*max size of a DNS packet is 512 bytes*/
+        uint16_t id;
+        bool taken;
+
+        do{
+                r->queries++;
+                id = (uint16_t)mc_hash64(&r->queries, sizeof(r->queries),
+                                                        r->querySecret);
+                taken = false;
+                for(unsigned i = 0; i < window && !taken; i++){
+                        Probe* q = &r->probes[i];
+                        taken = q != p && q->query == id
+                                && (q->step == STEP_SRV || q->step == STEP_A);
+                }
+        }while(taken);
+        /*the window holds at most ENGINE_MAX_WINDOW - 1 other probes, a
+        *free ID is always left
+        */
+
+        size_t length = step == STEP_SRV ?
+                                Ping::buildSRVQuestion(name, id, packet) :
+                                Ping::buildAQuestion(name, id, packet);
+        if(length == 0){
+                p->dnsError = INVALID_DOMAIN;
+                return false;
+        }
+
+        if(!r->dns.valid() || send(r->dns.get(), SEND_CAST packet, length,
+                                                                0) < 0){
+                p->dnsError = SEND_REQUEST_FAILURE;
+                return false;
+        }
+
+        p->query    = id;
+        p->step     = step;
+        p->deadline = PollScheduler::now() + TIMEOUT * 1000;
+        return true;
+}
+
+/***************************************************************************
+* void ProbeEngine::dial(Reactor* r, Probe* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes the handshake of a resolved probe and starts a
+*       non-blocking connection to it
+*
+* Parameters:
+*        r      I/O     Reactor*        reactor running the probe
+*        p      I/O     Probe*  probe with its address set
+**************************************************************************/
+void ProbeEngine::dial(Reactor* r, Probe* p)
+{
+        const char* host = p->backend[0] != '\0' ? p->backend :
+                                                targets->getHost(p->index);
+        p->packetLength = Ping::encodeHandshake(p->packet, host,
+                                        ntohs(p->address.sin_port), VERSION);
+        if(p->packetLength == 0){
+                finish(r, p, BAD_DOMAIN);
+                return;
+        }
+        /*the handshake names the SRV target when there was a record*/
+
+        p->sock.reset(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+        if(!p->sock.valid() || !mc_setBlocking(p->sock.get(), false)){
+                finish(r, p, SOCKET_OPEN_FAILURE);
+                return;
+        }
+
+        p->started = PollScheduler::now();
+        if(connect(p->sock.get(), (struct sockaddr*)&p->address,
+                                sizeof(p->address)) < 0 && !IN_PROGRESS()){
+                finish(r, p, CONNECT_FAILURE);
+                return;
+        }
+        /*the connection completes in the background, poll() reports it as
+        *writable
+        */
+
+        p->step     = STEP_CONNECTING;
+        p->deadline = p->started + TIMEOUT * 1000;
+}
+
+/***************************************************************************
+* void ProbeEngine::answer(Reactor* r, const uint8_t* packet, int length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Hands a DNS response to the probe waiting for its ID. An SRV
+*       answer is followed by the A query of the record's target, or of the
+*       domain itself when it has no record. An A answer is cached for the
+*       target and the probe connects
+*
+* Parameters:
+*        r      I/O     Reactor*        reactor the response arrived on
+*        packet I/P     const uint8_t*  DNS response
+*        length I/P     int     length of the response
+**************************************************************************/
+void ProbeEngine::answer(Reactor* r, const uint8_t* packet, int length)
+{
+        if(length < 12)
+                return;
+
+        uint16_t id;
+        memcpy(&id, packet, sizeof(id));
+
+        Probe* p = nullptr;
+        for(unsigned i = 0; i < window && p == nullptr; i++){
+                Probe* q = &r->probes[i];
+                if((q->step == STEP_SRV || q->step == STEP_A) && q->query == id)
+                        p = q;
+        }
+        if(p == nullptr)
+                return;
+        /*a late answer to a query that already timed out*/
+
+        if(p->step == STEP_SRV){
+                SRV_Answer srv;
+                Ping::parseSRVAnswer(packet, length, &srv);
+                p->dnsError = srv.dns_error;
+
+                int chosen = -1;
+                if(p->dnsError == NOERROR_STATUS){
+                        uint64_t now = PollScheduler::now();
+                        chosen = Ping::selectSRV(&srv, mc_hash64(&now,
+                                                sizeof(now), (uintptr_t)p));
+                        if(chosen < 0)
+                                p->dnsError = NXDOMAIN_STATUS;
+                }
+                /*a domain without any SRV record answers NOERROR with no
+                *records, it is handled like one that does not exist
+                */
+
+                const char* name = targets->getHost(p->index);
+                if(p->dnsError == NOERROR_STATUS){
+                        const SRV_Record* record = &srv.records[chosen];
+                        strcpy(p->backend, record->target);
+                        p->address.sin_port = htons(record->port);
+                        p->ttl    = record->ttl;
+                        p->status = REDIRECTED;
+                        name      = p->backend;
+                }
+                else if(p->dnsError != NXDOMAIN_STATUS){
+                        finish(r, p, SRV_FAILURE);
+                        return;
+                }
+
+                if(!ask(r, p, name, STEP_A))
+                        finish(r, p, NO_DOMAIN);
+                return;
+        }
+
+        uint32_t ttl;
+        if(Ping::parseAAnswer(packet, length, &p->address.sin_addr.s_addr,
+                                                        1, &ttl) <= 0){
+                finish(r, p, NO_DOMAIN);
+                return;
+        }
+        p->dnsError = NOERROR_STATUS;
+        if(ttl < p->ttl)
+                p->ttl = ttl;
+
+        Endpoint* e = &endpoints[p->index];
+        free(e->backend);
+        e->backend    = p->backend[0] != '\0' ? strdup(p->backend) : nullptr;
+        e->ipv4       = p->address.sin_addr.s_addr;
+        e->port       = ntohs(p->address.sin_port);
+        e->redirected = p->status == REDIRECTED;
+        e->expires    = PollScheduler::now() + DNS_CACHE_TIME;
+        if(p->ttl < DNS_CACHE_TIME / 1000)
+                e->expires = PollScheduler::now() + (uint64_t)p->ttl * 1000;
+        if(p->backend[0] != '\0' && e->backend == nullptr)
+                e->expires = 0;
+        /*the next runs reuse the resolution, no longer than the TTL of its
+        *records. Only the reactor probing the target writes its entry
+        */
+
+        dial(r, p);
+}
+
+/***************************************************************************
+* bool ProbeEngine::consume(Probe* p, const uint8_t* data, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds received bytes of the status response body to a probe,
+*       growing its buffer as they arrive so a server announcing a huge
+*       response costs nothing until it sends it. Latency-only probes drain
+*       the body without keeping it
+*
+* Parameters:
+*        p      I/O     Probe*  the probe
+*        data   I/P     const uint8_t*  received bytes
+*        length I/P     size_t  number of bytes, anything past the body is
+*                               ignored
+*        consume        O/P     bool    false if out of memory
+**************************************************************************/
+bool ProbeEngine::consume(Probe* p, const uint8_t* data, size_t length)
+{
+        if(length > (size_t)p->remaining)
+                length = p->remaining;
+        p->remaining -= length;
+
+        if(mode == PROBE_LATENCY_ONLY)
+                return true;
+
+        size_t needed = p->responseLength + length + 1;
+        if(needed > p->capacity){
+                size_t capacity = p->capacity ? p->capacity : BUFFER_SIZE;
+                while(capacity < needed)
+                        capacity *= 2;
+                char* grown = (char*)realloc(p->response, capacity);
+                if(grown == nullptr)
+                        return false;
+                p->response = grown;
+                p->capacity = capacity;
+        }
+
+        memcpy(p->response + p->responseLength, data, length);
+        p->responseLength += length;
+        p->response[p->responseLength] = '\0';
+
+        return true;
+}
+
+/***************************************************************************
+* void ProbeEngine::advance(Reactor* r, Probe* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Moves a probe along when poll() reports its socket: finishes
+*       the connection, sends the request, receives the status response and
+*       then does the ping/pong round trip. The probe mode decides where the
+*       exchange stops and what the latency measures, like Ping::probe()
+*
+* Parameters:
+*        r      I/O     Reactor*        reactor running the probe
+*        p      I/O     Probe*  probe whose socket is ready
+**************************************************************************/
+void ProbeEngine::advance(Reactor* r, Probe* p)
+{
+        int fd = p->sock.get();
+
+        if(p->step == STEP_CONNECTING){
+                int failure = 0;
+                socklen_t length = sizeof(failure);
+                if(getsockopt(fd, SOL_SOCKET, SO_ERROR, OPT_CAST &failure,
+                                                        &length) < 0
+                                                        || failure != 0){
+                        finish(r, p, CONNECT_FAILURE);
+                        return;
+                }
+                /*SO_ERROR tells whether the connection attempt worked*/
+
+                if(mode == PROBE_CONNECT_ONLY){
+                        p->milliseconds = PollScheduler::now() - p->started;
+                        finish(r, p, p->status);
+                        return;
+                }
+                /*the port is open, that is all a connect-only probe wants to
+                *know
+                */
+
+                p->step     = STEP_SENDING;
+                p->started  = PollScheduler::now();
+                p->deadline = p->started + TIMEOUT * 1000;
+        }
+
+        if(p->step == STEP_SENDING){
+                int n = send(fd, SEND_CAST p->packet + p->sent,
+                                p->packetLength - p->sent, SEND_FLAGS);
+                if(n < 0){
+                        if(!WOULD_BLOCK())
+                                finish(r, p, SEND_FAILURE);
+                        return;
+                }
+
+                p->sent += n;
+                if(p->sent == p->packetLength){
+                        p->step     = STEP_READING;
+                        p->deadline = PollScheduler::now() + TIMEOUT * 1000;
+                }
+                return;
+        }
+        /*the rest of a partly sent request goes when the socket has room*/
+
+        if(p->step == STEP_READING){
+                uint8_t buffer[ENGINE_CHUNK];
+                int n;
+                if(p->remaining < 0)
+                        n = recv(fd, RECV_CAST p->head + p->headLength,
+                                        ENGINE_HEAD - p->headLength, 0);
+                else
+                        n = recv(fd, RECV_CAST buffer, p->remaining < ENGINE_CHUNK ?
+                                        p->remaining : ENGINE_CHUNK, 0);
+                if(n < 0 && WOULD_BLOCK())
+                        return;
+                if(n <= 0){
+                        finish(r, p, RECEIVE_FAILURE);
+                        return;
+                }
+                /*0 means the server hung up before the whole response
+                *arrived
+                */
+
+                if(p->remaining < 0){
+                        if(p->headLength == 0 && mode == PROBE_STATUS_ONLY)
+                                p->milliseconds = PollScheduler::now() - p->started;
+                        /*the status packet arriving closes the request round
+                        *trip
+                        */
+                        p->headLength += n;
+
+                        int header = readHeader(p->head, p->headLength,
+                                                        &p->remaining);
+                        if(header == 0 && p->headLength < ENGINE_HEAD)
+                                return;
+                        if(header <= 0){
+                                finish(r, p, header ? (pingError)header :
+                                                        BAD_RESPONSE);
+                                return;
+                        }
+                        if(!consume(p, p->head + header, p->headLength - header)){
+                                finish(r, p, INITIALIZATION_FAILURE);
+                                return;
+                        }
+                        /*whatever came after the header is the start of the
+                        *body
+                        */
+                }
+                else if(!consume(p, buffer, n)){
+                        finish(r, p, INITIALIZATION_FAILURE);
+                        return;
+                }
+
+                if(p->remaining > 0)
+                        return;
+
+                if(mode == PROBE_STATUS_ONLY){
+                        finish(r, p, p->status);
+                        return;
+                }
+                /*a status-only probe skips the ping/pong round trip*/
+
+                p->started = PollScheduler::now();
+                p->ping[0] = 9;
+                p->ping[1] = 0x1;
+                memcpy(p->ping + 2, &p->started, 8);
+                /*packet length, ping ID and the payload the pong echoes*/
+
+                if(send(fd, SEND_CAST p->ping, sizeof(p->ping), SEND_FLAGS)
+                                                        != sizeof(p->ping)){
+                        finish(r, p, SEND_FAILURE);
+                        return;
+                }
+
+                p->step     = STEP_PONG;
+                p->deadline = p->started + TIMEOUT * 1000;
+                return;
+        }
+
+        int n = recv(fd, RECV_CAST p->pong + p->pongLength,
+                                        sizeof(p->pong) - p->pongLength, 0);
+        if(n < 0 && WOULD_BLOCK())
+                return;
+        if(n <= 0){
+                finish(r, p, RECEIVE_FAILURE);
+                return;
+        }
+
+        p->pongLength += n;
+        if(p->pongLength < sizeof(p->pong))
+                return;
+        /*certain servers transmit packets in chunks*/
+
+        if(memcmp(p->ping, p->pong, sizeof(p->ping))){
+                finish(r, p, PING_FAILURE);
+                return;
+        }
+
+        p->milliseconds = PollScheduler::now() - p->started;
+        finish(r, p, p->status);
+}
+
+/***************************************************************************
+* void ProbeEngine::finish(Reactor* r, Probe* p, pingError error)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes the result of a probe to the sink, counts it, marks
+*       its position done for the checkpoint and frees the slot
+*
+* Parameters:
+*        r      I/O     Reactor*        reactor running the probe
+*        p      I/O     Probe*  the probe
+*        error  I/P     pingError       outcome of the probe
+**************************************************************************/
+void ProbeEngine::finish(Reactor* r, Probe* p, pingError error)
+{
+        bool answered = error == OK || error == REDIRECTED;
+        if(!answered)
+                p->milliseconds = -1;
+        /*a failed step leaves the response received so far, but no latency*/
+
+        if(sink != nullptr){
+                PingResult result;
+                memset(&result, 0, sizeof(result));
+                result.host           = targets->getHost(p->index);
+                result.response       = p->response;
+                result.responseLength = p->response ? p->responseLength : 0;
+                result.timestamp      = mc_currentMillis();
+                result.ipv4           = p->address.sin_addr.s_addr;
+                result.port           = targets->getPort(p->index);
+                result.error          = error;
+                result.dnsError       = p->dnsError;
+                result.milliseconds   = p->milliseconds;
+                result.kernelRtt      = p->sock.valid() ?
+                                        mc_readKernelRTT(p->sock.get()) : -1;
+                result.stampedPing    = -1;
+                result.fastOpen       = 0;
+                sink->write(&result);
+        }
+        /*stream the completed probe to the sink, if there is one*/
+
+        p->sock.reset();
+        free(p->response);
+        p->response = nullptr;
+        p->step     = STEP_IDLE;
+
+        r->stats.probes++;
+        if(answered)
+                r->stats.answered++;
+
+        done[p->position / 64].fetch_or(1ULL << (p->position % 64),
+                                                std::memory_order_release);
+        /*the checkpoint may now move past this target*/
+}
+
+/***************************************************************************
+* void ProbeEngine::runReactor(unsigned reactor)
+* Author: agent
+* Date: 10/19/2026
+* Description: Body of a reactor thread. Pins itself, then runs an event
+*       loop over a window of probes until no target is left. The reactor
+*       owns the sockets of its probes and a DNS socket of its own, and
+*       sleeps in poll() until one of them is ready or a step times out, so
+*       one core keeps a whole window of targets in flight
+*
+* Parameters:
+*        reactor        I/P     unsigned        index of the reactor
+**************************************************************************/
+void ProbeEngine::runReactor(unsigned reactor)
+{
+        Reactor* r = &reactors[reactor];
+        r->stats.cpu = pin ? pinToCore(reactor) : -1;
+
+        uint64_t began = PollScheduler::now();
+
+        r->probes = new(std::nothrow) Probe[window];
+        struct pollfd* fds = (struct pollfd*)malloc((window + 1)
+                                                * sizeof(struct pollfd));
+        Probe** owners = (Probe**)malloc((window + 1) * sizeof(Probe*));
+        if(r->probes == nullptr || fds == nullptr || owners == nullptr){
+                delete[] r->probes;
+                r->probes = nullptr;
+                free(fds);
+                free(owners);
+                r->stats.milliseconds = PollScheduler::now() - began;
+                return;
+        }
+        /*out of memory, the other reactors take over the partition*/
+
+        for(unsigned i = 0; i < window; i++){
+                r->probes[i].step     = STEP_IDLE;
+                r->probes[i].response = nullptr;
+        }
+
+        openResolver(&r->dns, &r->nameserver);
+        uint64_t seed[4] = {mc_currentMillis(), began, (uintptr_t)r,
+                                                (uintptr_t)&seed};
+        r->querySecret = mc_hash64(seed, sizeof(seed), reactor);
+        r->queries     = 0;
+        /*the clocks and the addresses the system randomized*/
+        /*without a DNS socket the domains of this reactor fail with
+        *SRV_FAILURE, IP literals are still probed
+        */
+
+        bool claiming = true;
+        while(true){
+                for(unsigned i = 0; i < window && claiming; i++){
+                        size_t position;
+                        while(r->probes[i].step == STEP_IDLE){
+                                if(!claim(reactor, &position)){
+                                        claiming = false;
+                                        break;
+                                }
+                                start(r, &r->probes[i], position);
+                        }
+                }
+                /*keep every slot busy while targets are left, a probe that
+                *fails right away frees its slot for the next one
+                */
+
+                uint64_t now  = PollScheduler::now();
+                uint64_t wake = now + ENGINE_MAX_WAIT;
+                unsigned count = 0;
+                bool busy = false;
+
+                if(r->dns.valid()){
+                        fds[count].fd      = r->dns.get();
+                        fds[count].events  = POLLIN;
+                        fds[count].revents = 0;
+                        owners[count++]    = nullptr;
+                }
+                for(unsigned i = 0; i < window; i++){
+                        Probe* p = &r->probes[i];
+                        if(p->step == STEP_IDLE)
+                                continue;
+
+                        busy = true;
+                        if(p->deadline < wake)
+                                wake = p->deadline;
+                        if(p->step < STEP_CONNECTING)
+                                continue;
+
+                        fds[count].fd      = p->sock.get();
+                        fds[count].events  = p->step <= STEP_SENDING ?
+                                                        POLLOUT : POLLIN;
+                        fds[count].revents = 0;
+                        owners[count++]    = p;
+                }
+                if(!busy)
+                        break;
+                /*nothing in flight and nothing left to claim*/
+
+                poll(fds, count, wake > now ? (int)(wake - now) : 0);
+
+                for(unsigned i = 0; i < count; i++){
+                        if(fds[i].revents == 0)
+                                continue;
+
+                        if(owners[i] == nullptr){
+                                uint8_t packet[512];
+                                int length;
+                                while((length = recv(r->dns.get(),
+                                                RECV_CAST packet,
+                                                sizeof(packet), 0)) > 0)
+                                        answer(r, packet, length);
+                        }
+                        /*every DNS answer that arrived, in one go*/
+                        else if(owners[i]->step >= STEP_CONNECTING){
+                                advance(r, owners[i]);
+                        }
+                }
+
+                now = PollScheduler::now();
+                for(unsigned i = 0; i < window; i++){
+                        Probe* p = &r->probes[i];
+                        if(p->step == STEP_IDLE || now < p->deadline)
+                                continue;
+
+                        if(p->step == STEP_SRV)
+                                p->dnsError = RECV_REQUEST_FAILURE;
+                        finish(r, p, stepFailure[p->step]);
+                }
+                /*a step that takes longer than TIMEOUT fails the way the
+                *socket timeout of a blocking probe would
+                */
+        }
+
+        r->dns.reset();
+        delete[] r->probes;
+        r->probes = nullptr;
+        free(fds);
+        free(owners);
+
+        r->stats.milliseconds = PollScheduler::now() - began;
+}
+
+/***************************************************************************
+* int ProbeEngine::run(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Probes every target once, with one thread per reactor, and
+*       returns when all of them are done
+*
+* Parameters:
+*        run    O/P     int     number of targets probed, or a negative
+*                               pingError
+**************************************************************************/
+int ProbeEngine::run(void)
+{
+        if(reactors == nullptr)
+                return INITIALIZATION_FAILURE;
+
+        for(size_t i = 0; i <= targets->size() / 64; i++)
+                done[i].store(0);
+
+        for(unsigned i = 0; i < reactorCount; i++){
+                Reactor* r = &reactors[i];
+                size_t start = r->begin + r->resume;
+                r->resume = 0;
+
+                for(size_t p = r->begin; p < start; p++)
+                        done[p / 64].fetch_or(1ULL << (p % 64));
+                r->next.store(start);
+                memset(&r->stats, 0, sizeof(EngineStats));
+        }
+        /*a resumed partition starts after its checkpoint, the skipped targets
+        *count as done for the next checkpoint
+        */
+
+        std::vector<std::thread> threads;
+        threads.reserve(reactorCount);
+        for(unsigned i = 0; i < reactorCount; i++)
+                threads.push_back(std::thread(&ProbeEngine::runReactor, this, i));
+
+        for(size_t i = 0; i < threads.size(); i++)
+                threads[i].join();
+
+        EngineStats totals;
+        getTotals(&totals);
+
+        return totals.probes;
+}
+
+/***************************************************************************
+* unsigned ProbeEngine::getReactors(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of reactors
+*
+* Parameters:
+*        getReactors    O/P     unsigned        number of reactors
+**************************************************************************/
+unsigned ProbeEngine::getReactors(void)
+{
+        return reactorCount;
+}
+
+/***************************************************************************
+* bool ProbeEngine::getStats(unsigned reactor, EngineStats* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the statistics of one reactor for the last run
+*
+* Parameters:
+*        reactor        I/P     unsigned        index of the reactor
+*        out    O/P     EngineStats*    the statistics
+*        getStats       O/P     bool    false if there is no such reactor
+**************************************************************************/
+bool ProbeEngine::getStats(unsigned reactor, EngineStats* out)
+{
+        if(reactors == nullptr || reactor >= reactorCount)
+                return false;
+
+        *out = reactors[reactor].stats;
+        return true;
+}
+
+/***************************************************************************
+* void ProbeEngine::getTotals(EngineStats* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the statistics of all reactors for the last run
+*       summed, the time is the one of the slowest reactor
+*
+* Parameters:
+*        out    O/P     EngineStats*    the statistics
+**************************************************************************/
+void ProbeEngine::getTotals(EngineStats* out)
+{
+        memset(out, 0, sizeof(EngineStats));
+        out->cpu = -1;
+
+        for(unsigned i = 0; reactors != nullptr && i < reactorCount; i++){
+                const EngineStats* s = &reactors[i].stats;
+                out->probes   += s->probes;
+                out->answered += s->answered;
+                out->stolen   += s->stolen;
+                if(s->milliseconds > out->milliseconds)
+                        out->milliseconds = s->milliseconds;
+        }
+}
+
+/***************************************************************************
+* uint64_t ProbeEngine::checkpointId(unsigned reactor)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the snapshot checkpoint ID of a reactor's partition.
+*       It covers the list size and the reactor count, so a checkpoint never
+*       applies to a partition made from a different split
+*
+* Parameters:
+*        reactor        I/P     unsigned        index of the reactor
+*        checkpointId   O/P     uint64_t        the ID
+**************************************************************************/
+uint64_t ProbeEngine::checkpointId(unsigned reactor)
+{
+        uint64_t key[3] = {targets->size(), reactorCount, reactor};
+
+        return mc_hash64(key, sizeof(key), 0x656E67696E65ULL);
+}
+
+/***************************************************************************
+* void ProbeEngine::saveProgress(SnapshotWriter* w)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds a checkpoint for every partition to a snapshot. The
+*       checkpoint is the first target of the partition not probed yet, so
+*       resuming from it probes nothing twice except targets that finished
+*       out of order. Safe to call from another thread while run() is going
+*
+* Parameters:
+*        w      I/O     SnapshotWriter* snapshot to add the checkpoints to
+**************************************************************************/
+void ProbeEngine::saveProgress(SnapshotWriter* w)
+{
+        for(unsigned i = 0; reactors != nullptr && i < reactorCount; i++){
+                const Reactor* r = &reactors[i];
+                size_t p = r->begin;
+
+                while(p < r->end){
+                        uint64_t bits = done[p / 64].load(std::memory_order_acquire);
+                        if(p % 64 == 0 && bits == ~0ULL){
+                                p += 64;
+                                continue;
+                        }
+                        if(!(bits & 1ULL << (p % 64)))
+                                break;
+                        p++;
+                }
+                if(p > r->end)
+                        p = r->end;
+
+                w->addCheckpoint(checkpointId(i), p - r->begin,
+                                                        r->end - r->begin);
+        }
+}
+
+/***************************************************************************
+* unsigned ProbeEngine::resumeProgress(SnapshotReader* r)
+* Author: agent
+* Date: 10/19/2026
+* Description: Makes the next run() continue every partition from its
+*       checkpoint in a snapshot, for a scan that was interrupted. The engine
+*       must be built over the same list with the same reactor count
+*
+* Parameters:
+*        r      I/P     SnapshotReader* snapshot to resume from
+*        resumeProgress O/P     unsigned        number of partitions resumed
+**************************************************************************/
+unsigned ProbeEngine::resumeProgress(SnapshotReader* r)
+{
+        unsigned resumed = 0;
+
+        for(unsigned i = 0; reactors != nullptr && i < reactorCount; i++){
+                Reactor* reactor = &reactors[i];
+                MC_ScanCheckpoint c;
+
+                if(!r->getCheckpoint(checkpointId(i), &c)
+                                || c.total != reactor->end - reactor->begin
+                                || c.position > c.total)
+                        continue;
+
+                reactor->resume = c.position;
+                resumed++;
+        }
+
+        return resumed;
+}
@@ -0,0 +1,594 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  favicon.cpp
+* Author:  agent
+* Procedures:
+* FaviconStore(X)       -Constructor
+* ~FaviconStore -Destructor
+* grow          -Doubles the store's hash table
+* unescape      -Removes the JSON escapes of a string value in place
+* decodeBase64  -Decodes base64 text in place
+* put           -Stores a favicon once and returns its hash
+* get           -Looks up a stored favicon by its hash
+* size          -Returns the number of distinct favicons stored
+* storedBytes   -Returns the number of bytes the favicons take up
+* isDecoding    -Checks if favicons are stored as raw PNG bytes
+* FaviconSplitter(X)    -Constructor
+* ~FaviconSplitter      -Destructor
+* reset         -Starts splitting a new response
+* append        -Adds a character to the favicon being collected
+* feed          -Copies the next chunk of a response, minus the favicon
+* getHash       -Returns the hash the last favicon was stored under
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+
+#define FAVICON_TABLE_SIZE 64
+/*initial slots of the store's hash table, always a power of two*/
+#define FAVICON_VALUE_SIZE 4096
+/*initial size of the buffer a favicon is collected in*/
+#define BASE64_MARKER "base64,"
+
+enum splitterState{SPLIT_NORMAL, SPLIT_STRING, SPLIT_AFTER_STRING,
+                SPLIT_VALUE_START, SPLIT_VALUE
+};
+            /*NORMAL and STRING copy the input and look for the favicon key,
+            *AFTER_STRING waits for its colon and VALUE_START for the opening
+            *quote of the value. VALUE collects the favicon instead of
+            *copying it
+            */
+
+
+/***************************************************************************
+* FaviconStore::FaviconStore(bool decode)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+*        decode I/P     bool    true to store the decoded PNG bytes instead of
+*                               the base64 text
+**************************************************************************/
+FaviconStore::FaviconStore(bool decode)
+{
+        this->decode = decode;
+        this->count  = 0;
+        this->bytes  = 0;
+        this->capacity = FAVICON_TABLE_SIZE;
+        this->table  = (Entry*)calloc(capacity, sizeof(Entry));
+        if(table == nullptr)
+                capacity = 0;
+}
+
+/***************************************************************************
+* FaviconStore::~FaviconStore(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor, frees every stored favicon
+*
+* Parameters:
+**************************************************************************/
+FaviconStore::~FaviconStore(void)
+{
+        for(size_t i = 0; i < capacity; i++)
+                free(table[i].data);
+        free(table);
+}
+
+/***************************************************************************
+* bool FaviconStore::grow(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Doubles the hash table and moves the entries over. The
+*       favicon data itself is not copied
+*
+* Parameters:
+*        grow   O/P     bool    false if the new table could not be allocated
+**************************************************************************/
+bool FaviconStore::grow(void)
+{
+        size_t newCapacity = capacity ? capacity * 2 : FAVICON_TABLE_SIZE;
+        Entry* newTable = (Entry*)calloc(newCapacity, sizeof(Entry));
+        if(newTable == nullptr)
+                return false;
+
+        for(size_t i = 0; i < capacity; i++){
+                if(table[i].data == nullptr)
+                        continue;
+
+                size_t j = table[i].hash & (newCapacity - 1);
+                while(newTable[j].data != nullptr)
+                        j = (j + 1) & (newCapacity - 1);
+                newTable[j] = table[i];
+        }
+
+        free(table);
+        table    = newTable;
+        capacity = newCapacity;
+
+        return true;
+}
+
+/***************************************************************************
+* static size_t unescape(char* value, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Removes the JSON escapes of a string value in place. Servers
+*       escape the slashes of the data URI and some escape '=' as \u003d,
+*       so the same icon can arrive spelled differently
+*
+* Parameters:
+*        value  I/O     char*   string value without its quotes
+*        length I/P     size_t  length of the value
+*        unescape       O/P     size_t  length after unescaping
+**************************************************************************/
+static size_t unescape(char* value, size_t length)
+{
+        size_t out = 0;
+
+        for(size_t i = 0; i < length; i++){
+                if(value[i] != '\\' || i + 1 >= length){
+                        value[out++] = value[i];
+                        continue;
+                }
+
+                char c = value[++i];
+                if(c == 'u' && i + 4 < length){
+                        unsigned code = 0;
+                        for(int k = 1; k <= 4; k++){
+                                char h = value[i + k];
+                                code <<= 4;
+                                if(h >= '0' && h <= '9')
+                                        code |= h - '0';
+                                else if(h >= 'a' && h <= 'f')
+                                        code |= h - 'a' + 10;
+                                else if(h >= 'A' && h <= 'F')
+                                        code |= h - 'A' + 10;
+                        }
+                        i += 4;
+                        value[out++] = code < 0x80 ? (char)code : '?';
+                        /*base64 is plain ASCII, anything else is garbage*/
+                }
+                else{
+                        value[out++] = c == 'n' ? '\n' : c == 'r' ? '\r' : c;
+                }
+        }
+
+        return out;
+}
+
+/***************************************************************************
+* static size_t decodeBase64(char* text, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Decodes base64 text in place, characters outside the alphabet
+*       such as line breaks are skipped and decoding stops at the padding
+*
+* Parameters:
+*        text   I/O     char*   base64 text, receives the decoded bytes
+*        length I/P     size_t  length of the text
+*        decodeBase64   O/P     size_t  number of decoded bytes
+**************************************************************************/
+static size_t decodeBase64(char* text, size_t length)
+{
+        size_t out = 0;
+        uint32_t bits = 0;
+        int count = 0;
+
+        for(size_t i = 0; i < length && text[i] != '='; i++){
+                char c = text[i];
+                int v;
+                if(c >= 'A' && c <= 'Z')
+                        v = c - 'A';
+                else if(c >= 'a' && c <= 'z')
+                        v = c - 'a' + 26;
+                else if(c >= '0' && c <= '9')
+                        v = c - '0' + 52;
+                else if(c == '+')
+                        v = 62;
+                else if(c == '/')
+                        v = 63;
+                else
+                        continue;
+
+                bits = (bits << 6) | v;
+                if(++count == 4){
+                        text[out++] = (char)(bits >> 16);
+                        text[out++] = (char)(bits >> 8);
+                        text[out++] = (char)bits;
+                        bits  = 0;
+                        count = 0;
+                }
+                /*every 4 characters give 3 bytes, so the output never
+                *overtakes the input
+                */
+        }
+
+        if(count == 3){
+                text[out++] = (char)(bits >> 10);
+                text[out++] = (char)(bits >> 2);
+        }
+        else if(count == 2){
+                text[out++] = (char)(bits >> 4);
+        }
+
+        return out;
+}
+
+/***************************************************************************
+* uint64_t FaviconStore::put(char* value, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Stores a favicon unless the same one is stored already and
+*       returns the hash it is stored under. The value is unescaped and, when
+*       decoding, base64 decoded in place, so it is clobbered
+*
+* Parameters:
+*        value  I/O     char*   favicon string value from the response, without
+*                               its quotes
+*        length I/P     size_t  length of the value
+*        put    O/P     uint64_t        hash of the favicon, 0 if it could not
+*                                       be stored
+**************************************************************************/
+uint64_t FaviconStore::put(char* value, size_t length)
+{
+        length = unescape(value, length);
+
+        const char* data = value;
+        if(decode){
+                size_t marker = sizeof(BASE64_MARKER) - 1;
+                for(size_t i = 0; i + marker <= length; i++){
+                        if(!memcmp(value + i, BASE64_MARKER, marker)){
+                                data   = value + i + marker;
+                                length = decodeBase64(value + i + marker,
+                                                        length - i - marker);
+                                break;
+                        }
+                }
+        }
+        /*a value that is not a base64 data URI is kept as it is*/
+
+        uint64_t hash = mc_hash64(data, length, 0);
+        if(hash == 0)
+                hash = 1;
+        /*0 means no favicon*/
+
+        std::lock_guard<std::mutex> guard(lock);
+
+        if((count + 1) * 4 > capacity * 3 && !grow())
+                return 0;
+        /*keep the table at most three quarters full*/
+
+        size_t i = hash & (capacity - 1);
+        while(table[i].data != nullptr){
+                if(table[i].hash == hash && table[i].length == length
+                                && !memcmp(table[i].data, data, length))
+                        return hash;
+                /*already stored, the common case*/
+
+                if(table[i].hash == hash)
+                        return 0;
+                /*a different favicon with the same hash can not be
+                *referenced, leave it out rather than mix them up
+                */
+
+                i = (i + 1) & (capacity - 1);
+        }
+
+        uint8_t* copy = (uint8_t*)malloc(length ? length : 1);
+        if(copy == nullptr)
+                return 0;
+        memcpy(copy, data, length);
+
+        table[i].hash   = hash;
+        table[i].data   = copy;
+        table[i].length = length;
+        count++;
+        bytes += length;
+
+        return hash;
+}
+
+/***************************************************************************
+* bool FaviconStore::get(uint64_t hash, const uint8_t** data, size_t* length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Looks up a stored favicon by its hash. The data stays valid
+*       until the store is destroyed
+*
+* Parameters:
+*        hash   I/P     uint64_t        hash of the favicon
+*        data   I/O     const uint8_t** receives the stored bytes
+*        length I/O     size_t* receives the number of stored bytes
+*        get    O/P     bool    false if no favicon is stored under the hash
+**************************************************************************/
+bool FaviconStore::get(uint64_t hash, const uint8_t** data, size_t* length)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(capacity == 0)
+                return false;
+
+        size_t i = hash & (capacity - 1);
+        while(table[i].data != nullptr){
+                if(table[i].hash == hash){
+                        *data   = table[i].data;
+                        *length = table[i].length;
+                        return true;
+                }
+                i = (i + 1) & (capacity - 1);
+        }
+
+        return false;
+}
+
+/***************************************************************************
+* size_t FaviconStore::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of distinct favicons stored
+*
+* Parameters:
+*        size   O/P     size_t  number of favicons
+**************************************************************************/
+size_t FaviconStore::size(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        return count;
+}
+
+/***************************************************************************
+* size_t FaviconStore::storedBytes(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of bytes the stored favicons take up
+*
+* Parameters:
+*        storedBytes    O/P     size_t  total length of the favicons
+**************************************************************************/
+size_t FaviconStore::storedBytes(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        return bytes;
+}
+
+/***************************************************************************
+* bool FaviconStore::isDecoding(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks if favicons are stored as raw PNG bytes
+*
+* Parameters:
+*        isDecoding     O/P     bool    true if base64 favicons are decoded
+**************************************************************************/
+bool FaviconStore::isDecoding(void)
+{
+        return decode;
+}
+
+
+/***************************************************************************
+* FaviconSplitter::FaviconSplitter(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+**************************************************************************/
+FaviconSplitter::FaviconSplitter(void)
+{
+        value         = nullptr;
+        valueCapacity = 0;
+        reset(nullptr);
+}
+
+/***************************************************************************
+* FaviconSplitter::~FaviconSplitter(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+FaviconSplitter::~FaviconSplitter(void)
+{
+        free(value);
+}
+
+/***************************************************************************
+* void FaviconSplitter::reset(FaviconStore* s)
+* Author: agent
+* Date: 10/19/2026
+* Description: Starts splitting a new response. The collection buffer is kept
+*       for the next response
+*
+* Parameters:
+*        s      I/P     FaviconStore*   store to put the favicon in
+**************************************************************************/
+void FaviconSplitter::reset(FaviconStore* s)
+{
+        this->store       = s;
+        this->valueLength = 0;
+        this->hash        = 0;
+        this->state       = SPLIT_NORMAL;
+        this->escape      = false;
+        this->keyMatched  = false;
+        this->depth       = 0;
+        this->keyLength   = 0;
+}
+
+/***************************************************************************
+* bool FaviconSplitter::append(char c)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds a character to the favicon being collected, growing the
+*       buffer as needed
+*
+* Parameters:
+*        c      I/P     char    character to add
+*        append O/P     bool    false if the buffer could not grow
+**************************************************************************/
+bool FaviconSplitter::append(char c)
+{
+        if(valueLength == valueCapacity){
+                size_t grown = valueCapacity ? valueCapacity * 2
+                                                : FAVICON_VALUE_SIZE;
+                char* p = (char*)realloc(value, grown);
+                if(p == nullptr)
+                        return false;
+                value         = p;
+                valueCapacity = grown;
+        }
+
+        value[valueLength++] = c;
+        return true;
+}
+
+/***************************************************************************
+* size_t FaviconSplitter::feed(const char* data, size_t length, char* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Copies the next chunk of a response to out, except for the
+*       value of the top level "favicon" key. Once that value has been
+*       collected it is stored and a FAVICON_REFERENCE to its hash is written
+*       in its place. Chunks can split the JSON anywhere
+*
+* Parameters:
+*        data   I/P     const char*     next chunk of the response
+*        length I/P     size_t  length of the chunk
+*        out    I/O     char*   receives the kept part, must have room for
+*                               length + FAVICON_REFERENCE_SIZE characters
+*        feed   O/P     size_t  number of characters written to out
+**************************************************************************/
+size_t FaviconSplitter::feed(const char* data, size_t length, char* out)
+{
+        size_t n = 0;
+
+        for(size_t i = 0; i < length; i++){
+                char c = data[i];
+
+                switch(state){
+                case SPLIT_AFTER_STRING:
+                        if(c == ' ' || c == '\t' || c == '\r' || c == '\n'){
+                                out[n++] = c;
+                                break;
+                        }
+                        if(c == ':' && keyMatched){
+                                out[n++] = c;
+                                state = SPLIT_VALUE_START;
+                                break;
+                        }
+                        state = SPLIT_NORMAL;
+                        /*not the favicon key, handle the character normally*/
+                        /*fall through*/
+                case SPLIT_NORMAL:
+                        out[n++] = c;
+                        if(c == '"'){
+                                state     = SPLIT_STRING;
+                                keyLength = 0;
+                        }
+                        else if(c == '{' || c == '['){
+                                depth++;
+                        }
+                        else if((c == '}' || c == ']') && depth > 0){
+                                depth--;
+                        }
+                        break;
+
+                case SPLIT_STRING:
+                        out[n++] = c;
+                        if(escape){
+                                escape = false;
+                        }
+                        else if(c == '\\'){
+                                escape = true;
+                        }
+                        else if(c == '"'){
+                                keyMatched = store != nullptr && hash == 0
+                                        && depth == 1 && keyLength == 7
+                                        && !memcmp(key, "favicon", 7);
+                                state = SPLIT_AFTER_STRING;
+                                break;
+                        }
+                        if(keyLength < sizeof(key))
+                                key[keyLength] = c;
+                        keyLength++;
+                        break;
+
+                case SPLIT_VALUE_START:
+                        out[n++] = c;
+                        if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                                break;
+                        if(c == '"'){
+                                state       = SPLIT_VALUE;
+                                valueLength = 0;
+                                break;
+                        }
+                        state = SPLIT_NORMAL;
+                        if(c == '{' || c == '[')
+                                depth++;
+                        /*not a string, there is nothing to store*/
+                        break;
+
+                case SPLIT_VALUE:
+                        if(escape || c != '"'){
+                                escape = !escape && c == '\\';
+                                if(!append(c))
+                                        keyMatched = false;
+                                /*a favicon that did not fit is dropped*/
+                                break;
+                        }
+
+                        if(keyMatched)
+                                hash = store->put(value, valueLength);
+                        if(hash != 0){
+                                n += snprintf(out + n, FAVICON_REFERENCE_SIZE,
+                                                FAVICON_REFERENCE "%016llx",
+                                                (unsigned long long)hash);
+                        }
+                        out[n++] = '"';
+                        /*reference the stored favicon, or leave an empty
+                        *string if it could not be stored
+                        */
+                        state = SPLIT_NORMAL;
+                        break;
+                }
+        }
+
+        return n;
+}
+
+/***************************************************************************
+* uint64_t FaviconSplitter::getHash(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the hash the last response's favicon was stored under
+*
+* Parameters:
+*        getHash        O/P     uint64_t        hash of the favicon, 0 if there
+*                                               was none
+**************************************************************************/
+uint64_t FaviconSplitter::getHash(void)
+{
+        return hash;
+}
@@ -0,0 +1,266 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+/***************************************************************************
+* File:  hasher.cpp
+* Author:  agent
+* Procedures:
+* ResponseHasher(X)     -Constructor
+* reset         -Starts a new hash with the given field mask
+* isMaskedKey   -Checks if the last key read is one of the masked fields
+* update        -Feeds the next chunk of the response into the hash
+* digest        -Returns the hash of everything fed so far
+* hashResponse  -Hashes a complete response in one call
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+enum hasherState{HASH_NORMAL, HASH_STRING, HASH_AFTER_STRING, HASH_SKIP_START,
+                HASH_SKIP_STRING, HASH_SKIP_NESTED, HASH_SKIP_SCALAR
+};
+            /*NORMAL and STRING hash the input. AFTER_STRING waits to see if
+            *the string was a key. The SKIP states drop the value of a masked
+            *key, SKIP_STRING returns to NORMAL or SKIP_NESTED depending on
+            *the depth
+            */
+
+static const struct{
+        unsigned mask;
+        const char* key;
+        unsigned length;
+} maskedKeys[] = {
+        {HASH_MASK_SAMPLE,      "sample",       6},
+        {HASH_MASK_FAVICON,     "favicon",      7},
+        {HASH_MASK_ONLINE,      "online",       6},
+        {HASH_MASK_DESCRIPTION, "description",  11},
+};
+            /*JSON key of every mask bit*/
+
+
+/***************************************************************************
+* ResponseHasher::ResponseHasher(unsigned mask)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+*        mask   I/P     unsigned        hashMask bits of the fields to skip
+**************************************************************************/
+ResponseHasher::ResponseHasher(unsigned mask)
+{
+        reset(mask);
+}
+
+/***************************************************************************
+* void ResponseHasher::reset(unsigned mask)
+* Author: agent
+* Date: 10/19/2026
+* Description: Starts a new hash with the given field mask
+*
+* Parameters:
+*        mask   I/P     unsigned        hashMask bits of the fields to skip
+**************************************************************************/
+void ResponseHasher::reset(unsigned mask)
+{
+        this->hash      = FNV_OFFSET;
+        this->mask      = mask;
+        this->state     = HASH_NORMAL;
+        this->escape    = false;
+        this->keyMasked = false;
+        this->depth     = 0;
+        this->keyLength = 0;
+}
+
+/***************************************************************************
+* bool ResponseHasher::isMaskedKey(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks if the string that was just read is one of the masked
+*       field names
+*
+* Parameters:
+*        isMaskedKey    O/P     bool    true if the field should be skipped
+**************************************************************************/
+bool ResponseHasher::isMaskedKey(void)
+{
+        if(mask == HASH_MASK_NONE)
+                return false;
+
+        for(unsigned i = 0; i < sizeof(maskedKeys)/sizeof(maskedKeys[0]); i++){
+                if((mask & maskedKeys[i].mask)
+                                && keyLength == maskedKeys[i].length
+                                && !memcmp(key, maskedKeys[i].key, keyLength))
+                        return true;
+        }
+
+        return false;
+}
+
+/***************************************************************************
+* void ResponseHasher::update(const char* data, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Feeds the next chunk of the response into the hash. Chunks can
+*       split the JSON anywhere, the parser state carries over between calls
+*
+* Parameters:
+*        data   I/P     const char*     next chunk of the response
+*        length I/P     size_t  length of the chunk
+**************************************************************************/
+void ResponseHasher::update(const char* data, size_t length)
+{
+        uint64_t h = this->hash;
+
+        for(size_t i = 0; i < length; i++){
+                char c = data[i];
+
+                switch(state){
+                case HASH_AFTER_STRING:
+                        if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                                break;
+                        /*whitespace between a key and its colon is not hashed*/
+
+                        if(c == ':' && keyMasked){
+                                h = (h ^ (uint8_t)c) * FNV_PRIME;
+                                state = HASH_SKIP_START;
+                                break;
+                        }
+                        state = HASH_NORMAL;
+                        /*not a masked key, handle the character normally*/
+                        /*fall through*/
+                case HASH_NORMAL:
+                        h = (h ^ (uint8_t)c) * FNV_PRIME;
+                        if(c == '"'){
+                                state     = HASH_STRING;
+                                keyLength = 0;
+                        }
+                        break;
+
+                case HASH_STRING:
+                        h = (h ^ (uint8_t)c) * FNV_PRIME;
+                        if(escape){
+                                escape = false;
+                        }
+                        else if(c == '\\'){
+                                escape = true;
+                        }
+                        else if(c == '"'){
+                                keyMasked = isMaskedKey();
+                                state     = HASH_AFTER_STRING;
+                                break;
+                        }
+                        if(keyLength < sizeof(key))
+                                key[keyLength] = c;
+                        keyLength++;
+                        /*keep the start of the string in case it is a key*/
+                        break;
+
+                case HASH_SKIP_START:
+                        if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+                                break;
+                        if(c == '"'){
+                                depth = 0;
+                                state = HASH_SKIP_STRING;
+                        }
+                        else if(c == '{' || c == '['){
+                                depth = 1;
+                                state = HASH_SKIP_NESTED;
+                        }
+                        else{
+                                state = HASH_SKIP_SCALAR;
+                        }
+                        break;
+
+                case HASH_SKIP_STRING:
+                        if(escape)
+                                escape = false;
+                        else if(c == '\\')
+                                escape = true;
+                        else if(c == '"')
+                                state = depth ? HASH_SKIP_NESTED : HASH_NORMAL;
+                        break;
+
+                case HASH_SKIP_NESTED:
+                        if(c == '"'){
+                                state = HASH_SKIP_STRING;
+                        }
+                        else if(c == '{' || c == '['){
+                                depth++;
+                        }
+                        else if(c == '}' || c == ']'){
+                                if(--depth == 0)
+                                        state = HASH_NORMAL;
+                        }
+                        break;
+
+                case HASH_SKIP_SCALAR:
+                        if(c == ',' || c == '}' || c == ']'){
+                                h = (h ^ (uint8_t)c) * FNV_PRIME;
+                                state = HASH_NORMAL;
+                        }
+                        /*the scalar ends at the next separator, which belongs
+                        *to the enclosing object and is hashed
+                        */
+                        break;
+                }
+        }
+
+        this->hash = h;
+}
+
+/***************************************************************************
+* uint64_t ResponseHasher::digest(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the hash of everything fed so far
+*
+* Parameters:
+*        digest O/P     uint64_t        hash of the response
+**************************************************************************/
+uint64_t ResponseHasher::digest(void)
+{
+        return this->hash;
+}
+
+/***************************************************************************
+* uint64_t ResponseHasher::hashResponse(const char* data, size_t length,
+*                                                       unsigned mask)
+* Author: agent
+* Date: 10/19/2026
+* Description: Hashes a complete response in one call, gives the same value
+*       as feeding it through update() in chunks
+*
+* Parameters:
+*        data   I/P     const char*     response to hash
+*        length I/P     size_t  length of the response
+*        mask   I/P     unsigned        hashMask bits of the fields to skip
+*        hashResponse   O/P     uint64_t        hash of the response
+**************************************************************************/
+uint64_t ResponseHasher::hashResponse(const char* data, size_t length,
+                                                unsigned mask)
+{
+        ResponseHasher h(mask);
+        h.update(data, length);
+
+        return h.digest();
+}
@@ -0,0 +1,504 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  hedge.cpp
+* Author:  agent
+* Procedures:
+* HedgeBudget(X)        -Constructor
+* setPolicy     -Sets the hedge delay and the budget of extra attempts
+* getPolicy     -Returns the current policy
+* recordProbe   -Adds the budget share of a probe
+* tryHedge      -Takes an extra attempt from the budget
+* recordWin     -Counts a hedge that finished first
+* hedgeDelay    -Returns how long a target's probe waits before hedging
+* getProbes     -Returns the number of probes counted
+* getHedges     -Returns the number of hedged attempts started
+* getWins       -Returns the number of hedged attempts that won
+* startAttempt  -Starts a non-blocking connection attempt
+* openHedged    -Connects to the target, hedging with a second attempt
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#define poll WSAPoll
+#define IN_PROGRESS() (WSAGetLastError() == WSAEWOULDBLOCK)
+#define SEND_CAST (const char*)
+#define OPT_CAST (char*)
+typedef int socklen_t;
+#else
+#include <poll.h>
+#include <errno.h>
+#define IN_PROGRESS() (errno == EINPROGRESS)
+#define SEND_CAST
+#define OPT_CAST
+#endif // _WIN32
+
+
+#define ATTEMPT_CONNECTING 0
+#define ATTEMPT_SENT 1
+#define ATTEMPT_FAILED 2
+/*states of a connection attempt*/
+
+#define HEDGE_MIN_HISTORY 4
+/*latencies a target needs before its own history decides the delay*/
+
+static const HedgePolicy defaultPolicy = {
+        95,     /*quantile*/
+        50,     /*minDelay*/
+        1000,   /*defaultDelay*/
+        5,      /*budgetPercent*/
+        10      /*budgetBurst*/
+};
+
+struct HedgeAttempt{
+        SocketHandle sock;
+        int state;
+        bool limited;
+        /*the attempt holds a rate limiter slot of its own*/
+        uint64_t requestStart;
+        const struct sockaddr_in* address;
+};
+
+
+/***************************************************************************
+* HedgeBudget::HedgeBudget(const HedgePolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+*        p      I/P     const HedgePolicy*      policy, nullptr for the
+*                                               defaults
+**************************************************************************/
+HedgeBudget::HedgeBudget(const HedgePolicy* p)
+{
+        probes = 0;
+        hedges = 0;
+        wins   = 0;
+
+        setPolicy(p);
+}
+
+/***************************************************************************
+* void HedgeBudget::setPolicy(const HedgePolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the hedge delay and the budget of extra attempts. The
+*       saved up budget starts full
+*
+* Parameters:
+*        p      I/P     const HedgePolicy*      policy, nullptr for the
+*                                               defaults
+**************************************************************************/
+void HedgeBudget::setPolicy(const HedgePolicy* p)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        policy = p ? *p : defaultPolicy;
+        if(policy.quantile > 100)
+                policy.quantile = 100;
+
+        tokens = policy.budgetBurst;
+}
+
+/***************************************************************************
+* void HedgeBudget::getPolicy(HedgePolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the current policy
+*
+* Parameters:
+*        p      I/O     HedgePolicy*    policy to fill
+**************************************************************************/
+void HedgeBudget::getPolicy(HedgePolicy* p)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        *p = policy;
+}
+
+/***************************************************************************
+* void HedgeBudget::recordProbe(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Counts a probe and adds its share to the budget
+*
+* Parameters:
+**************************************************************************/
+void HedgeBudget::recordProbe(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        probes++;
+        tokens += policy.budgetPercent / 100.0;
+        if(tokens > policy.budgetBurst)
+                tokens = policy.budgetBurst;
+}
+
+/***************************************************************************
+* bool HedgeBudget::tryHedge(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Takes an extra attempt from the budget
+*
+* Parameters:
+*        tryHedge       O/P     bool    true if a hedge may be started
+**************************************************************************/
+bool HedgeBudget::tryHedge(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(tokens < 1.0)
+                return false;
+
+        tokens -= 1.0;
+        hedges++;
+
+        return true;
+}
+
+/***************************************************************************
+* void HedgeBudget::recordWin(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Counts a hedged attempt that finished before the original
+*
+* Parameters:
+**************************************************************************/
+void HedgeBudget::recordWin(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        wins++;
+}
+
+/***************************************************************************
+* uint32_t HedgeBudget::hedgeDelay(const uint32_t* history, size_t count)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns how long a probe waits for its connection or first
+*       response byte before it is hedged, the policy quantile of the
+*       target's recent latencies
+*
+* Parameters:
+*        history        I/P     const uint32_t* recent latencies of the target
+*        count  I/P     size_t  number of latencies, at most HEDGE_HISTORY
+*        hedgeDelay     O/P     uint32_t        delay in milliseconds
+**************************************************************************/
+uint32_t HedgeBudget::hedgeDelay(const uint32_t* history, size_t count)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(count < HEDGE_MIN_HISTORY)
+                return policy.defaultDelay > policy.minDelay ?
+                                policy.defaultDelay : policy.minDelay;
+
+        uint32_t sorted[HEDGE_HISTORY];
+        for(size_t i = 0; i < count; i++){
+                size_t j = i;
+                while(j > 0 && sorted[j-1] > history[i]){
+                        sorted[j] = sorted[j-1];
+                        j--;
+                }
+                sorted[j] = history[i];
+        }
+        /*insertion sort, the history is tiny*/
+
+        uint32_t delay = sorted[(count - 1) * policy.quantile / 100];
+
+        return delay > policy.minDelay ? delay : policy.minDelay;
+}
+
+/***************************************************************************
+* uint64_t HedgeBudget::getProbes(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of probes counted
+*
+* Parameters:
+*        getProbes      O/P     uint64_t        number of probes
+**************************************************************************/
+uint64_t HedgeBudget::getProbes(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        return probes;
+}
+
+/***************************************************************************
+* uint64_t HedgeBudget::getHedges(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of hedged attempts started
+*
+* Parameters:
+*        getHedges      O/P     uint64_t        number of hedges
+**************************************************************************/
+uint64_t HedgeBudget::getHedges(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        return hedges;
+}
+
+/***************************************************************************
+* uint64_t HedgeBudget::getWins(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of hedged attempts that finished first
+*
+* Parameters:
+*        getWins        O/P     uint64_t        number of winning hedges
+**************************************************************************/
+uint64_t HedgeBudget::getWins(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+        return wins;
+}
+
+
+/***************************************************************************
+* static bool startAttempt(HedgeAttempt* a, SourcePool* sources)
+* Author: agent
+* Date: 10/19/2026
+* Description: Opens a non-blocking socket and starts connecting it to the
+*       attempt's address
+*
+* Parameters:
+*        a      I/O     HedgeAttempt*   attempt with its address set
+*        sources        I/P     SourcePool*     local addresses to bind to, or
+*                                               nullptr
+*        startAttempt   O/P     bool    false if the attempt failed right away
+**************************************************************************/
+static bool startAttempt(HedgeAttempt* a, SourcePool* sources)
+{
+        a->state = ATTEMPT_FAILED;
+        a->sock.reset(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+
+        if(!a->sock.valid() || !mc_setBlocking(a->sock.get(), false))
+                return false;
+        if(sources != nullptr && !sources->bindSocket(a->sock.get()))
+                return false;
+
+        if(connect(a->sock.get(), (struct sockaddr*)a->address,
+                                sizeof(*a->address)) < 0 && !IN_PROGRESS())
+                return false;
+        /*the connection completes in the background, poll() reports it as
+        *writable
+        */
+
+        a->state = ATTEMPT_CONNECTING;
+        return true;
+}
+
+/***************************************************************************
+* bool Ping::openHedged(SocketHandle* sock, uint64_t* connectStart,
+*                                               uint64_t* requestStart)
+* Author: agent
+* Date: 10/19/2026
+* Description: Connects to the prepared endpoint and sends the prepared
+*       request like openDirect(). If the connection or the first response
+*       byte has not arrived by the hedge delay and the budget allows it, a
+*       second attempt is started to the alternate address. The first
+*       attempt to get there wins, the other one is reset
+*
+* Parameters:
+*        sock   I/O     SocketHandle*   receives the winning blocking socket
+*        connectStart   I/O     uint64_t*       receives the time the first
+*                                               attempt started
+*        requestStart   I/O     uint64_t*       receives the time the winner
+*                                               sent its request
+*        openHedged     O/P     bool    false if the probe failed, error holds
+*                                       the reason
+**************************************************************************/
+bool Ping::openHedged(SocketHandle* sock, uint64_t* connectStart,
+                                                uint64_t* requestStart)
+{
+        HedgeAttempt attempts[2];
+        size_t started   = 0;
+        bool hedgeDone   = false;
+        bool connected   = false;
+        int winner       = -1;
+        pingError failure = CONNECT_FAILURE;
+
+        hedger->recordProbe();
+        uint32_t delay = hedger->hedgeDelay(latencyHistory, latencyCount);
+        uint64_t limit = timeout.tv_sec * 1000 + timeout.tv_usec / 1000;
+
+        if(limiter != nullptr){
+                limiter->acquire(server.sin_addr.s_addr);
+                limiterHeld = true;
+                heldAddress = server.sin_addr.s_addr;
+        }
+        /*the original attempt waits for the rate limiter like any probe*/
+
+        uint64_t start = mc_currentMillis();
+        *connectStart  = start;
+
+        attempts[0].address = &prepared.address;
+        attempts[0].limited = false;
+        if(!startAttempt(&attempts[0], sources)){
+                error = attempts[0].sock.valid() ? CONNECT_FAILURE
+                                                : SOCKET_OPEN_FAILURE;
+                milliseconds = -1;
+                return false;
+        }
+        attempts[0].sock.setAbortive(abortiveClose);
+        started = 1;
+
+        while(winner < 0){
+                uint64_t now = mc_currentMillis();
+                if(now >= start + limit)
+                        break;
+
+                if(!hedgeDone && now >= start + delay){
+                        hedgeDone = true;
+                        HedgeAttempt* h = &attempts[1];
+                        h->address = &prepared.alternate;
+                        h->limited = false;
+
+                        if(limiter == nullptr
+                                || limiter->tryAcquire(h->address->sin_addr.s_addr,
+                                                                nullptr))
+                                h->limited = limiter != nullptr;
+                        else
+                                h = nullptr;
+                        /*a hedge must not break the rate limits, it is
+                        *skipped instead of waited for
+                        */
+
+                        if(h != nullptr && hedger->tryHedge()){
+                                startAttempt(h, sources);
+                                h->sock.setAbortive(abortiveClose);
+                                started = 2;
+                        }
+                        else if(h != nullptr && h->limited){
+                                limiter->release(h->address->sin_addr.s_addr);
+                                h->limited = false;
+                        }
+                }
+
+                struct pollfd fds[2];
+                int index[2];
+                int n = 0;
+                for(size_t i = 0; i < started; i++){
+                        if(attempts[i].state == ATTEMPT_FAILED)
+                                continue;
+                        fds[n].fd      = attempts[i].sock.get();
+                        fds[n].events  = attempts[i].state == ATTEMPT_CONNECTING ?
+                                                        POLLOUT : POLLIN;
+                        fds[n].revents = 0;
+                        index[n++]     = i;
+                }
+                if(n == 0)
+                        break;
+                /*every attempt failed*/
+
+                uint64_t until = start + limit;
+                if(!hedgeDone && start + delay < until)
+                        until = start + delay;
+
+                if(poll(fds, n, until > now ? until - now : 0) <= 0)
+                        continue;
+
+                for(int j = 0; j < n && winner < 0; j++){
+                        if(fds[j].revents == 0)
+                                continue;
+                        HedgeAttempt* a = &attempts[index[j]];
+
+                        if(a->state == ATTEMPT_CONNECTING){
+                                int err = 0;
+                                socklen_t length = sizeof(err);
+                                getsockopt(a->sock.get(), SOL_SOCKET, SO_ERROR,
+                                                OPT_CAST &err, &length);
+                                if(err != 0){
+                                        a->state = ATTEMPT_FAILED;
+                                        continue;
+                                }
+                                connected = true;
+
+                                if(mode == PROBE_CONNECT_ONLY){
+                                        winner = index[j];
+                                        break;
+                                }
+
+                                a->requestStart = mc_currentMillis();
+                                int sent = send(a->sock.get(), SEND_CAST prepared.packet,
+                                                        prepared.packetLength, 0);
+                                if(sent < (int)prepared.packetLength){
+                                        a->state = ATTEMPT_FAILED;
+                                        failure  = SEND_FAILURE;
+                                        continue;
+                                }
+                                a->state = ATTEMPT_SENT;
+                        }
+                        else{
+                                char c;
+                                if(recv(a->sock.get(), &c, 1, MSG_PEEK) <= 0){
+                                        a->state = ATTEMPT_FAILED;
+                                        failure  = RECEIVE_FAILURE;
+                                        continue;
+                                }
+                                winner = index[j];
+                                /*the first response byte is waiting, the
+                                *rest of the exchange is read as usual
+                                */
+                        }
+                }
+        }
+
+        if(winner == 1 && attempts[1].limited){
+                limiter->release(heldAddress);
+                heldAddress = attempts[1].address->sin_addr.s_addr;
+        }
+        else if(started == 2 && attempts[1].limited)
+                limiter->release(attempts[1].address->sin_addr.s_addr);
+        /*the probe keeps holding the winner's slot, the concurrency cap
+        *counts the address it is connected to
+        */
+
+        if(winner < 0){
+                if(connected && failure == CONNECT_FAILURE)
+                        failure = RECEIVE_FAILURE;
+                error = failure;
+                milliseconds = -1;
+                return false;
+        }
+
+        HedgeAttempt* w = &attempts[winner];
+        if(winner == 1)
+                hedger->recordWin();
+
+        for(size_t i = 0; i < started; i++)
+                attempts[i].sock.setAbortive(true);
+        /*the losing attempt is cancelled with a reset*/
+        w->sock.setAbortive(abortiveClose);
+
+        mc_setBlocking(w->sock.get(), true);
+        w->sock.setTimeout(&timeout);
+        server = *w->address;
+        *requestStart = w->requestStart;
+
+        if(mode == PROBE_CONNECT_ONLY)
+                milliseconds = mc_currentMillis() - start;
+
+        sock->reset(w->sock.release());
+        sock->setAbortive(abortiveClose);
+
+        return true;
+}
@@ -26,9 +26,32 @@
 * Ping()        -Default constructor
 * initializeSocket      -(Windows Only) Sets up the WSA OS features
 * buildHandshake        -Function that creates the handshake packet
+* encodeHandshake       -Encodes the handshake and status request packets
+* writeVarInt   -Encodes a protocol varint
+* prepare       -Resolves the target and encodes its packets for repeat probes
+* openDirect    -Connects to the target and sends the prepared request
+* recordLatency -Adds a first response latency to the target's history
 * readVarInt    -Reads in data from a varint from the socket
 * checkIfIP     -Checks an inputted string if it is a domain or IP
+* parseIPv4     -Parses an IPv4 literal into a network order address
+* resolveIPv4   -Resolves a host to its first IPv4 address
+* lookupIPv4    -Looks up the first two IPv4 addresses of a domain
+* mc_hash64     -Fast non-cryptographic hash used across the library
 * SRV_Lookup    -Performs an SRV DNS record lookup
+* readDNSName   -Reads a possibly compressed domain name out of a DNS packet
+* readBE16      -Reads a big endian 16 bit value
+* encodeQuestion        -Encodes a DNS query with one question
+* buildSRVQuestion      -Encodes the DNS query of an SRV lookup
+* buildAQuestion        -Encodes the DNS query of an A lookup
+* parseSRVAnswer        -Reads the SRV records out of a DNS response
+* parseAAnswer  -Reads the IPv4 addresses out of a DNS response
+* SRV_LookupAll -Returns every record of an SRV lookup
+* selectSRV     -Picks a record by RFC 2782 priority and weight
+* selectFastestSRV      -Picks the healthy record with the lowest latency
+* findSRVStats  -Finds or adds the latency statistics of an SRV backend
+* recordSRVResult       -Updates the statistics of the SRV backend probed
+* setSRVPreference      -Selects how SRV records are chosen
+* setChunkCallback      -Streams response bodies to a callback
 * ~Ping()       -Destructor
 * ping_free     -Frees any dynamic data
 * getError      -returns the ping error code
@@ -36,26 +59,56 @@
 * getPing       -returns the ping latency of the connection
 * getDNSerror   -Returns the DNS error occured while searching for the IP the
 *                       domain points to
+* probe         -Performs the Server List Ping exchange for connectMC
+* getAddress    -Returns the address of the server
+* getPort       -Returns the port of the server
+* getResult     -Fills a PingResult with the outcome of the last probe
+* setSink       -Sets the result sink completed probes are written to
+* setRateLimiter        -Sets the rate limiter probes must pass before connecting
+* setSourcePool -Sets the local addresses probes are bound to
+* setAbortiveClose      -Makes probes reset their connection when done
+* setFastOpen   -Sends the request in the SYN with TCP Fast Open
+* usedFastOpen  -Tells whether the last request went out in the SYN
+* setProtocolVersion    -Sets the protocol version sent in the handshake
+* setDNSCacheTime       -Sets how long a resolved target is reused
+* resetPrepared -Forces the next probe to resolve the target again
+* setHedging    -Sets the budget hedged probes are drawn from
+* setChangeDetection    -Turns response change detection on or off
+* getResponseHash       -Returns the hash of the last response
+* setProbeMode  -Selects how much of the exchange a probe performs
+* getProbeMode  -Returns the probe mode
+* getStateKey   -Returns the key of the target in a state snapshot
+* exportState   -Copies the resolved address and last result out
+* importState   -Restores the resolved address and last result
+* currentMicros -Returns the wall clock time in microseconds
+* readSynData   -Tells whether a connection's SYN carried accepted data
+* recvStamped   -Receives data along with its kernel receive timestamp
+* getKernelRTT  -Returns the kernel's smoothed RTT of the last probe
+* getStampedPing        -Returns the kernel timestamped ping of the last probe
+* setFaviconStore       -Sets the store favicons are split out into
+* getFaviconHash        -Returns the stored favicon hash of the last response
+* releaseResponse       -Frees the response unless it is the caller's buffer
+* setResponseBuffer     -Makes probes write the response into a caller buffer
+* getResponseLength     -Returns the full length of the last response
 ***************************************************************************/
 
 
 
 #ifdef _WIN32
 #define _WIN32_WINNT 0x501
-#define CLOSE(X)            closesocket(X)
 #endif // _WIN32
-#ifdef __linux__
-#define CLOSE(X)            shutdown(X, 1)
-#endif // __linux__
 
 
 #include "MinecraftPing.h"
 #ifndef _WIN32
 #include <endian.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #define SEND_CAST
 #define RECV_CAST
 #else
 #include <stdlib.h>
+#include <ws2tcpip.h>
 #define htobe16(x) _byteswap_ushort(x)
 #define htole32(x) (x)
 #define SEND_CAST (const char*)
@@ -83,11 +136,112 @@ static WinsockInit winsockInit;
 
 
 
+/***************************************************************************
+* static uint64_t currentMicros(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the wall clock time in microseconds, the clock the
+*       kernel receive timestamps are taken with
+*
+* Parameters:
+*        currentMicros  O/P     uint64_t        microseconds since the epoch
+**************************************************************************/
+static uint64_t currentMicros(void)
+{
+        struct timeval now;
+        gettimeofday(&now, NULL);
+
+        return (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+/***************************************************************************
+* static bool readSynData(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Tells whether the data sent in the SYN of a connection was
+*       acknowledged by the SYN-ACK, that is whether TCP Fast Open saved the
+*       round trip
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        readSynData    O/P     bool    true if the SYN carried accepted data
+**************************************************************************/
+static bool readSynData(int fd)
+{
+#if defined(__linux__) && defined(TCPI_OPT_SYN_DATA)
+        struct tcp_info info;
+        socklen_t length = sizeof(info);
+
+        if(getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &length) < 0)
+                return false;
+
+        return (info.tcpi_options & TCPI_OPT_SYN_DATA) != 0;
+#else
+        (void)fd;
+        return false;
+#endif // __linux__
+}
+
+/***************************************************************************
+* static int recvStamped(int fd, uint8_t* buffer, int length,
+*                                                       uint64_t* stamp)
+* Author: agent
+* Date: 10/19/2026
+* Description: Receives data like recv() and reports when the kernel
+*       received the first of it, if the socket has SO_TIMESTAMPNS turned on
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        buffer I/O     uint8_t*        buffer to receive into
+*        length I/P     int     size of the buffer
+*        stamp  I/O     uint64_t*       receive time in microseconds since the
+*                                       epoch, only set if it is still 0
+*        recvStamped    O/P     int     bytes received, same as recv()
+**************************************************************************/
+static int recvStamped(int fd, uint8_t* buffer, int length, uint64_t* stamp)
+{
+#ifdef __linux__
+        char control[CMSG_SPACE(sizeof(struct timespec))];
+        struct iovec vec;
+        struct msghdr msg;
+
+        vec.iov_base = buffer;
+        vec.iov_len  = length;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov        = &vec;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+
+        int read = recvmsg(fd, &msg, 0);
+        if(read <= 0 || *stamp != 0)
+                return read;
+
+        for(struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c != nullptr;
+                                                c = CMSG_NXTHDR(&msg, c)){
+                if(c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS){
+                        struct timespec ts;
+                        memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                        *stamp = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+                }
+        }
+
+        return read;
+#else
+        (void)stamp;
+        return recv(fd, RECV_CAST buffer, length, 0);
+#endif // __linux__
+}
+
 /***************************************************************************
 * int Ping::connectMC(void)
 * Author: SkibbleBip
 * Date: Unknown, 2020   v1 Initial
 * Date: 09/09/2021      v2 Cleaned up, optimized, and added safety checking
+* Date: 10/19/2026      v3 Split the protocol into probe(), completed probes
+*                               are written to the result sink, responses
+*                               identical to the last one return UNCHANGED
+*                               when change detection is on
 * Description: Function that attempts to initialize a connection to the
 *                       minecraft server and query it's status
 *
@@ -98,6 +252,71 @@ static WinsockInit winsockInit;
 *   Negative values means something internal errored out.
 **************************************************************************/
 int Ping::connectMC(void)
+{
+        int ret = probe();
+
+        if(srvChosen >= 0)
+                recordSRVResult(ret == OK || ret == REDIRECTED);
+        /*remember how the SRV backend did for latency based selection*/
+
+        if(truncated && (ret == OK || ret == REDIRECTED)){
+                error = BUFFER_TRUNCATED;
+                ret   = BUFFER_TRUNCATED;
+        }
+        /*the caller's buffer was too small, neededLength tells how big it
+        *has to be
+        */
+
+        if(limiterHeld){
+                limiter->release(heldAddress);
+                limiterHeld = false;
+        }
+        /*the probe is over, let the next one to this IP through*/
+
+        completedAt = mc_currentMillis();
+        /*stamp the time the probe finished*/
+
+        if(bodyRead && (ret == OK || ret == REDIRECTED)){
+                responseHash = hasher.digest();
+
+                if(detectChanges){
+                        if(responseHash == lastHash){
+                                error = UNCHANGED;
+                                return UNCHANGED;
+                        }
+                        lastHash = responseHash;
+                }
+        }
+        /*the response was hashed while it was received. When change
+        *detection is on, a response matching the previous one is not
+        *emitted to the sink
+        */
+
+        if(sink != nullptr){
+                PingResult result;
+                getResult(&result);
+                sink->write(&result);
+        }
+        /*stream the completed probe to the sink, if there is one*/
+
+        return ret;
+}
+
+/***************************************************************************
+* int Ping::probe(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Performs the actual Server List Ping exchange with the server,
+*       split out of connectMC() so the result can be post-processed in one
+*       place regardless of which path the probe returned from. The probe
+*       mode decides where the exchange stops and what the latency measures:
+*       the TCP handshake for CONNECT_ONLY, the status request round trip for
+*       STATUS_ONLY and the ping/pong round trip otherwise
+*
+* Parameters:
+*        probe  O/P     int     return status, same as connectMC()
+**************************************************************************/
+int Ping::probe(void)
 {
         /*attempt to connect to the Minecraft Server. Returns a positive number
         *if successfully communicated with the server, returns 0 when the server
@@ -106,11 +325,18 @@ int Ping::connectMC(void)
         */
         error = OK;
 
-        unsigned short _port = this->port;
-        DNS_Response dnsr;
-
-        free(pingResponse);
-        pingResponse = nullptr;
+        releaseResponse();
+        responseLength = 0;
+        neededLength = 0;
+        truncated = false;
+        bodyRead = false;
+        responseHash = 0;
+        kernelRtt    = -1;
+        stampedPing  = -1;
+        sentInSyn    = false;
+        server.sin_addr.s_addr = 0;
+        hasher.reset(hashMask);
+        splitter.reset(favicons);
 
 
 
@@ -127,199 +353,47 @@ int Ping::connectMC(void)
 #endif // windows requires you to initialize the socket before opening
 
 
-        const char* addressToProcess;
-        /*the IP address the server's domain points to*/
-        char* backAddress;
-        /*the backend url to the server, as SRV records could have a
-        *re-direct the minecraft server requires
+        if(!prepare())
+                return error;
+        /*resolve the target and encode its handshake, or reuse what the last
+        *probe prepared while the DNS cache time has not run out
         */
-        struct in_addr addr;
-        /*struct to contain the IP address info*/
-
-        if(checkIfIP(frontAddress)){
-                addressToProcess = frontAddress;
-                /*the url is an IP, it is assumed it can directly
-                *connect to the IP
-                */
-        }
-        else{
-                struct hostent* _host;  //struct to contain the host info
-                SRV_Lookup((char*)frontAddress, &dnsr);
-                dnsError = dnsr.dns_error;
-                /*attempt SRV record lookup, set the error code from the
-                *record's response
-                */
-
-                if(dnsError == NOERROR_STATUS){
-                        _host       = gethostbyname(dnsr.url);
-                        backAddress = dnsr.url;
-                        /*the SRV Record was found, get the backend address
-                        *and get the _host object that contains the properties
-                        *of the server domain
-                        */
-                        error = REDIRECTED;
-                        /* Set error return to the redirected value */
 
-                }
-                else if(dnsError == NXDOMAIN_STATUS){
-                        _host       = gethostbyname(frontAddress);
-                        backAddress = (char*)frontAddress;
-                        /*SRV record was not found, attempt to check A name
-                        *through gethostbyname, assume the backend address is
-                        *the same as the frontend address
-                        */
+        server   = prepared.address;
+        error    = (pingError)prepared.status;
+        dnsError = prepared.dnsError;
 
-                }
-                else{
-                        error        = SRV_FAILURE;
-                        free(pingResponse);
-                        pingResponse = nullptr;
-                        milliseconds = -1;
-                        return error;
-                /*the SRV record failed to successfully request a lookup,
-                *something went wrong set the error code and return to let
-                *user know there was a failure
-                */
 
-                }
 
-                if(_host != nullptr){
-                        addr.s_addr      = *(u_long*)_host->h_addr_list[0];
-                        /*get first hostname from the list*/
-                        addressToProcess = inet_ntoa(addr);
-                        /*get the IP octal values of the IP address*/
-                        dnsError         = NOERROR_STATUS;
-                        /*overwrite SRV_Lookup's response code, as
-                        *gethostbyname was able to resolve the location
-                        *of the url
-                        */
+        SocketHandle sock;
+        uint64_t connectStart;
+        uint64_t requestStart;
 
-                }
-                else{
-                        error        = NO_DOMAIN;
-                        pingResponse = nullptr;
-                        milliseconds = -1;
+        if(hedger != nullptr){
+                if(!openHedged(&sock, &connectStart, &requestStart))
                         return error;
-                        /*if _host was nullptr, that's ok, it just means
-                        *the DNS server could not find the domain, it does
-                        not exist. return NO_DOMAIN to let user know the server was
-                        *not found
-                        */
-                }
-
-
-
-        }
-        /*some non-notchian servers (specifically those that are protected by
-        * DDOS Protection Services such as Cloudflare or TCPShield)
-        * do not allow handshaking from direct IPs, they prefer that they
-        * connect through DNS-recorded domains, henceforth they only allow the
-        * URL of the server be included in the handshake, not the IP. This part
-        * checks if the inputted Minecraft server location is an IP or URL.
-        * This assumes you are aware whether or not the destination accepts IPs
-        * or URLs. Attempting to connect from an invalid URL will result
-        * in a DNS_FAILURE error and a return error.
-        */
-
-
-        server.sin_family      = AF_INET;
-        server.sin_port        = htons(_port);
-        server.sin_addr.s_addr =  inet_addr(addressToProcess);
-        /*initialize the server connection configuration as an INET /24 IP,
-        * and initialize the port.
-        * set the IP address of the server
-        */
-
-
-
-        sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        /*create the socket as /24 IP, TCP stream*/
-
-        if(sock < 0){
-        /*if the socket is negative, then it failed, return out*/
-                error = SOCKET_OPEN_FAILURE;
-                milliseconds = -1;
-                free(pingResponse);
-                pingResponse = nullptr;
-
-                return error;
         }
-        /*open the socket*/
-
-#ifdef _WIN32
-        unsigned long mode = 0;
-        /* 0 is blocking, != is non-blocking  */
-        ioctlsocket(sock, FIONBIO, &mode);
-        /*in *nix, sockets are blocking by default*/
- 	DWORD timeout_ms = timeout.tv_sec * 1000 + timeout.tv_usec / 1000;
-	setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, SEND_CAST  (const char*)&timeout_ms, sizeof(timeout_ms));
-#else  // _WIN32
-	setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, SEND_CAST  &timeout, sizeof(timeout));
-#endif 
-        /*set socket options as blocking, set the timeout for the connection*/
-
-
-        int connectR = connect(sock, (struct sockaddr*)&server, sizeof(server));
-        /*client-connect
-        *connect to the socket
-        */
-
-        if(connectR<0){
-        /*if response is negative, then it failed, possibly the
-        * server is down, so return 0
-        */
-
-                error = CONNECT_FAILURE;
-                pingResponse = nullptr;
-                milliseconds = -1;
+        else if(!openDirect(&sock, &connectStart, &requestStart)){
                 return error;
-
         }
-
-        uint8_t handshakePacket[HANDSHAKE_MAX_SIZE];
-        size_t packetSize = buildHandshake(handshakePacket, backAddress);
-        /*build the handshake packet*/
-
-        if(packetSize < 0){
-        /*if the handshake packet building failed, it's possible a domain
-        *that was too long was given to it, therefor we should error out
+        /*connect and send the prepared request, racing a second attempt
+        *against the first when hedging is on
         */
-                error = BAD_DOMAIN;
-                dnsError = INVALID_DOMAIN;
-                pingResponse = nullptr;
-                milliseconds = -1;
-                return error;
-        }
-
 
-        int sendVal = send(sock, SEND_CAST handshakePacket, packetSize, 0);
-        /*send the handshake packet*/
+        kernelRtt = mc_readKernelRTT(sock.get());
+        /*the handshake already gave the kernel its first RTT sample*/
 
-        if(sendVal <0){
-        /*if send response is negative, then it failed to send*/
-                error = SEND_FAILURE;
-                pingResponse = nullptr;
-                milliseconds = -1;
-                return error;
-        }
-        sendVal = send(sock, SEND_CAST request, 2, 0);
-        /*follow up immediatly with a request packet*/
-        if(sendVal <0){
-        /*if response negative, then it failed*/
-                error = SEND_FAILURE;
-                pingResponse = nullptr;
-                milliseconds = -1;
+        if(mode == PROBE_CONNECT_ONLY)
                 return error;
-        }
-
+        /*the port is open, that is all a connect-only probe wants to know*/
 
 
 
-        readVarInt(sock);
+        readVarInt(sock.get());
         /*eat the first varInt, this variable isnt needed for anything*/
 
         char id;
-        int size = recv(sock, RECV_CAST &id, 1, 0);
+        int size = recv(sock.get(), RECV_CAST &id, 1, 0);
         /*attempt to get the ID of the transmission.
         * Minecraft's packet ID is 0x0
         */
@@ -330,6 +404,13 @@ int Ping::connectMC(void)
                 milliseconds = -1;
                 return error;
         }
+        recordLatency(mc_currentMillis() - connectStart);
+        /*the first response byte arrived, remember how long it took*/
+
+        if(fastOpen)
+                sentInSyn = readSynData(sock.get());
+        /*the SYN-ACK has long arrived, it tells if it took the request*/
+
         if(id != 0){
                 /*if the ID is not 0, then it is not a regular reply-could
                 * be a reject packet or trash
@@ -341,7 +422,11 @@ int Ping::connectMC(void)
         }
 
 
-        int json_length = readVarInt(sock);
+        if(mode == PROBE_STATUS_ONLY)
+                milliseconds = mc_currentMillis() - requestStart;
+        /*the status packet header arriving closes the request round trip*/
+
+        int json_length = readVarInt(sock.get());
         if(json_length < 0){
                 milliseconds = -1;
                 pingResponse = nullptr;
@@ -355,12 +440,46 @@ int Ping::connectMC(void)
         */
 
 
-        pingResponse = (char*)malloc(json_length*sizeof(char)+1);
+        size_t capacity = json_length;
+        if(favicons != nullptr && capacity > BUFFER_SIZE)
+                capacity = BUFFER_SIZE;
+        /*with a favicon store the response grows as it arrives instead, most
+        *of a large response is the favicon and that is not kept in it
+        */
+
+        bool streaming = chunkCallback != nullptr && mode != PROBE_LATENCY_ONLY;
+        size_t total   = json_length;
+        if(streaming && total == 0 && chunkCallback(chunkUser, "", 0, 0, 1)){
+                error = RECEIVE_FAILURE;
+                milliseconds = -1;
+                return error;
+        }
+        /*a streamed body is handed to the callback and not kept at all, an
+        *empty one still gets its final chunk
+        */
+
+        bool keeping = !streaming && mode != PROBE_LATENCY_ONLY;
+        if(keeping && userBuffer != nullptr){
+                pingResponse = userBuffer;
+                capacity     = userCapacity - 1;
+        }
+        /*write into the caller's buffer, whatever does not fit is only
+        *counted
+        */
+        else if(keeping){
+                pingResponse = (char*)malloc(capacity*sizeof(char)+1);
+                if(pingResponse == nullptr){
+                        error = INITIALIZATION_FAILURE;
+                        milliseconds = -1;
+                        return error;
+                }
+        }
         /**pingResponse becomes dynamically allocated**/
-        /*memory to hold the ping response, +1 for the null terminator*/
+        /*memory to hold the ping response, +1 for the null terminator. A
+        *latency-only probe drains the response without keeping it
+        */
         char buffer[BUFFER_SIZE];
         int read  = 999;
-        int total = json_length;
         int s = 0;
 
         while(json_length >0){
@@ -370,27 +489,106 @@ int Ping::connectMC(void)
         * allocate new space into the pingResponse using realloc and the size
         * that was returned in the buffer
         */
-                read = recv(sock, buffer, BUFFER_SIZE, 0);
-                if(read <0){
-                        /*if recv replies with negative, then it failed*/
+                read = recv(sock.get(), buffer, json_length < BUFFER_SIZE ?
+                                        json_length : BUFFER_SIZE, 0);
+                if(read <= 0){
+                        /*if recv replies with negative, then it failed. 0
+                        *means the server hung up before the whole response
+                        *arrived
+                        */
                         error = RECEIVE_FAILURE;
-                        free(pingResponse);
-                        pingResponse = nullptr;
+                        releaseResponse();
                         milliseconds = -1;
                         return error;
                 }
 
 
-                memcpy(pingResponse+s, buffer, read);
-                /*add the buffer to the pingResponse*/
+                if(streaming || (pingResponse != nullptr
+                                        && pingResponse == userBuffer)){
+                        char kept[BUFFER_SIZE + FAVICON_REFERENCE_SIZE];
+                        const char* keep = buffer;
+                        size_t keptLength = read;
+                        if(favicons != nullptr){
+                                keptLength = splitter.feed(buffer, read, kept);
+                                keep = kept;
+                        }
+                        hasher.update(keep, keptLength);
+
+                        if(streaming){
+                                if(chunkCallback(chunkUser, keep, keptLength,
+                                                total, json_length == read)){
+                                        error = RECEIVE_FAILURE;
+                                        milliseconds = -1;
+                                        return error;
+                                }
+                        }
+                        else if((size_t)s < capacity){
+                                memcpy(pingResponse+s, keep,
+                                        keptLength < capacity - s ?
+                                        keptLength : capacity - s);
+                        }
+                        s+=keptLength;
+                }
+                /*hand the chunk to the callback as soon as it arrives, or
+                *copy what fits into the caller's buffer. The hash covers the
+                *whole response either way
+                */
+                else if(pingResponse != nullptr && favicons != nullptr){
+                        size_t needed = s + read + FAVICON_REFERENCE_SIZE;
+                        if(needed > capacity){
+                                while(capacity < needed)
+                                        capacity *= 2;
+                                char* grown = (char*)realloc(pingResponse,
+                                                                capacity + 1);
+                                if(grown == nullptr){
+                                        error = INITIALIZATION_FAILURE;
+                                        releaseResponse();
+                                        milliseconds = -1;
+                                        return error;
+                                }
+                                pingResponse = grown;
+                        }
 
-                s+=read;
+                        size_t kept = splitter.feed(buffer, read, pingResponse+s);
+                        hasher.update(pingResponse+s, kept);
+                        s+=kept;
+                }
+                /*the favicon is diverted into the store and the rest of the
+                *response is kept and hashed, reference included
+                */
+                else if(pingResponse != nullptr){
+                        memcpy(pingResponse+s, buffer, read);
+                        hasher.update(buffer, read);
+                        s+=read;
+                }
+                /*add the buffer to the pingResponse and the hash*/
                 json_length = json_length - read;
             /*subtract the amount currently processed in the buffer
             *from the total
             */
         }//end while
-        pingResponse[total] = '\0';
+        if(pingResponse != nullptr){
+                responseLength = (size_t)s < capacity ? s : capacity;
+                pingResponse[responseLength] = '\0';
+                truncated = responseLength < (size_t)s;
+        }
+        neededLength = s;
+        bodyRead = mode != PROBE_LATENCY_ONLY;
+
+        if(mode == PROBE_STATUS_ONLY){
+                kernelRtt = mc_readKernelRTT(sock.get());
+                return error;
+        }
+        /*a status-only probe skips the ping/pong round trip*/
+
+#ifdef __linux__
+        int stampOn = 1;
+        setsockopt(sock.get(), SOL_SOCKET, SO_TIMESTAMPNS, &stampOn,
+                                                        sizeof(stampOn));
+#endif // __linux__
+        /*have the kernel timestamp the pong when it arrives, so the time our
+        *process takes to get to it is left out
+        */
 
         /**PING PACKET
                         ID: 0X1     LONG: 8 BYTES
@@ -421,7 +619,9 @@ int Ping::connectMC(void)
 *receiving the ping-pong packets
 */
 
-        sendVal = send(sock, SEND_CAST pingPacket, 10, 0);
+        uint64_t sentAt = currentMicros();
+        uint64_t pongAt = 0;
+        int sendVal = send(sock.get(), SEND_CAST pingPacket, 10, 0);
         /*send the packet*/
         if(sendVal < 0){
                 error = SEND_FAILURE;
@@ -431,9 +631,11 @@ int Ping::connectMC(void)
         else{
                 uint8_t pingReply[10];
                 int total = 0;
-                read = 0;
                 do{
-                        read = recv(sock, RECV_CAST &pingReply[read], 10 - total, 0);
+                        read = recvStamped(sock.get(), &pingReply[total],
+                                                        10 - total, &pongAt);
+                        if(read <= 0)
+                                break;
                         total +=read;
 
                 }while(total <10);
@@ -442,7 +644,7 @@ int Ping::connectMC(void)
                 */
 
 
-                if(read < 0){
+                if(read <= 0){
                         /*if read fail, set the error code to RECEIVE_FAILURE,
                         *set ping to negative. this is a soft error
                         */
@@ -480,6 +682,14 @@ int Ping::connectMC(void)
                                         *this is the ping duration
                                         */
 
+                                        if(pongAt >= sentAt)
+                                                stampedPing = pongAt - sentAt;
+                                        kernelRtt = mc_readKernelRTT(sock.get());
+                                        /*the same round trip ended by the
+                                        *kernel's receive timestamp, and the
+                                        *RTT the kernel measured itself
+                                        */
+
                                 }
                         }
                 }
@@ -487,11 +697,8 @@ int Ping::connectMC(void)
         // @todo this is ugly as sin, clean it up
 
 
-       CLOSE(sock);
-       /*cleanup any windows related stuff*/
-
-
         return error;
+        /*the socket handle closes the connection*/
     /*return what we ended up on, hopefully we were successful*/
 }
 
@@ -509,7 +716,8 @@ Ping::Ping( const char* address, uint16_t p)
 {
         port = p;
         strncpy(frontAddress, address, DOMAIN_MAX_SIZE);
-        frontAddress[DOMAIN_MAX_SIZE-1] = '\000';
+        frontAddress[DOMAIN_MAX_SIZE] = '\000';
+        actualAddress[0] = '\000';
 
         timeout.tv_sec = 5;
         timeout.tv_usec = 0;
@@ -517,6 +725,42 @@ Ping::Ping( const char* address, uint16_t p)
         error = OK;
         dnsError = NOERROR_STATUS;
         milliseconds = 0;
+        kernelRtt    = -1;
+        stampedPing  = -1;
+        responseLength = 0;
+        completedAt = 0;
+        sink = nullptr;
+        limiter = nullptr;
+        limiterHeld = false;
+        sources = nullptr;
+        abortiveClose = false;
+        fastOpen = false;
+        sentInSyn = false;
+        prepared.valid = false;
+        protocolVersion = VERSION;
+        dnsCacheTime = DNS_CACHE_TIME;
+        hedger = nullptr;
+        latencyCount = 0;
+        latencyNext = 0;
+        heldAddress = 0;
+        server.sin_addr.s_addr = 0;
+        detectChanges = false;
+        hashMask = HASH_MASK_NONE;
+        responseHash = 0;
+        lastHash = 0;
+        mode = PROBE_FULL;
+        favicons = nullptr;
+        srvPrefer = SRV_PREFER_WEIGHT;
+        memset(srvStats, 0, sizeof(srvStats));
+        srvStatsNext = 0;
+        srvChosen = -1;
+        userBuffer = nullptr;
+        userCapacity = 0;
+        neededLength = 0;
+        truncated = false;
+        chunkCallback = nullptr;
+        chunkUser = nullptr;
+        bodyRead = false;
 
 
 }
@@ -535,11 +779,51 @@ Ping::Ping(const Ping &obj)
         port = obj.port;
         strncpy(frontAddress, obj.frontAddress, DOMAIN_MAX_SIZE);
         frontAddress[DOMAIN_MAX_SIZE] = '\000';
+        memcpy(actualAddress, obj.actualAddress, sizeof(actualAddress));
         timeout = obj.timeout;
-        pingResponse = obj.pingResponse;
+        pingResponse = obj.pingResponse != obj.userBuffer ?
+                                obj.pingResponse : nullptr;
+        userBuffer = nullptr;
+        userCapacity = 0;
+        neededLength = obj.neededLength;
+        truncated = obj.truncated;
+        chunkCallback = obj.chunkCallback;
+        chunkUser = obj.chunkUser;
+        bodyRead = obj.bodyRead;
+        /*the caller's buffer belongs to the original*/
         error = obj.error;
         dnsError = obj.dnsError;
         milliseconds = obj.milliseconds;
+        kernelRtt    = obj.kernelRtt;
+        stampedPing  = obj.stampedPing;
+        responseLength = obj.responseLength;
+        completedAt = obj.completedAt;
+        sink = obj.sink;
+        limiter = obj.limiter;
+        limiterHeld = false;
+        sources = obj.sources;
+        abortiveClose = obj.abortiveClose;
+        fastOpen = obj.fastOpen;
+        sentInSyn = obj.sentInSyn;
+        prepared = obj.prepared;
+        protocolVersion = obj.protocolVersion;
+        dnsCacheTime = obj.dnsCacheTime;
+        hedger = obj.hedger;
+        memcpy(latencyHistory, obj.latencyHistory, sizeof(latencyHistory));
+        latencyCount = obj.latencyCount;
+        latencyNext = obj.latencyNext;
+        heldAddress = 0;
+        server = obj.server;
+        detectChanges = obj.detectChanges;
+        hashMask = obj.hashMask;
+        favicons = obj.favicons;
+        srvPrefer = obj.srvPrefer;
+        memcpy(srvStats, obj.srvStats, sizeof(srvStats));
+        srvStatsNext = obj.srvStatsNext;
+        srvChosen = obj.srvChosen;
+        responseHash = obj.responseHash;
+        lastHash = obj.lastHash;
+        mode = obj.mode;
 }
 
 /***************************************************************************
@@ -554,12 +838,49 @@ Ping::Ping()
 {
         port = 0;
         frontAddress[0] = '\000';
+        actualAddress[0] = '\000';
         timeout.tv_sec = 5;
         timeout.tv_usec = 0;
         pingResponse = nullptr;
         error = OK;
         dnsError = NOERROR_STATUS;
         milliseconds = 0;
+        kernelRtt    = -1;
+        stampedPing  = -1;
+        responseLength = 0;
+        completedAt = 0;
+        sink = nullptr;
+        limiter = nullptr;
+        limiterHeld = false;
+        sources = nullptr;
+        abortiveClose = false;
+        fastOpen = false;
+        sentInSyn = false;
+        prepared.valid = false;
+        protocolVersion = VERSION;
+        dnsCacheTime = DNS_CACHE_TIME;
+        hedger = nullptr;
+        latencyCount = 0;
+        latencyNext = 0;
+        heldAddress = 0;
+        server.sin_addr.s_addr = 0;
+        detectChanges = false;
+        hashMask = HASH_MASK_NONE;
+        responseHash = 0;
+        lastHash = 0;
+        mode = PROBE_FULL;
+        favicons = nullptr;
+        srvPrefer = SRV_PREFER_WEIGHT;
+        memset(srvStats, 0, sizeof(srvStats));
+        srvStatsNext = 0;
+        srvChosen = -1;
+        userBuffer = nullptr;
+        userCapacity = 0;
+        neededLength = 0;
+        truncated = false;
+        chunkCallback = nullptr;
+        chunkUser = nullptr;
+        bodyRead = false;
 }
 
 #ifdef _WIN32
@@ -586,61 +907,411 @@ bool WinsockInit::initializeSocket(void)
 #endif // _WIN32
 
 /***************************************************************************
-* size_t Ping::buildHandshake(uint8_t* buffer, char* host)
-* Author: SkibbleBip
-* Date: Unknown, 2020   v1 Initial
-* Date: 09/09/2021      v2 Optimized code to make it faster, added safety
-*                               checking
-* Description: Function that creates the handshake packet
+* bool Ping::openDirect(SocketHandle* sock, uint64_t* connectStart,
+*                                               uint64_t* requestStart)
+* Author: agent
+* Date: 10/19/2026
+* Description: Opens a blocking connection to the prepared endpoint and sends
+*       the prepared request, split out of probe() so hedged probes can
+*       replace it
 *
 * Parameters:
-*        buffer I/O     uint8_t*        buffer to contain the packet data
-*        host   I/P     char*   domain of the host being queried
-*        buildHandshake O/P     size_t  size of the packet generated
+*        sock   I/O     SocketHandle*   receives the connected socket
+*        connectStart   I/O     uint64_t*       receives the time the connect
+*                                               started
+*        requestStart   I/O     uint64_t*       receives the time the request
+*                                               was sent
+*        openDirect     O/P     bool    false if the probe failed, error holds
+*                                       the reason
 **************************************************************************/
-size_t Ping::buildHandshake(uint8_t* buffer, char* host)
+bool Ping::openDirect(SocketHandle* sock, uint64_t* connectStart,
+                                                uint64_t* requestStart)
 {
-        ///inspired by https://github.com/theodik/mcping/blob/master/mcping.c
-
-        /**                 PROTOCOL VERSION: VARINT (-1)
-        PACKET ID: 0X00     SERVER ADDRESS: STRING
-                            SERVER PORT: UNSIGNED SHORT
-                            NEXT STATE: VARINT (1)
-        **/
+        sock->reset(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+        /*create the socket as /24 IP, TCP stream. The handle closes it on
+        *every return path
+        */
 
-        size_t hostLength = strnlen(host, DOMAIN_MAX_SIZE+1);
-        if(hostLength > DOMAIN_MAX_SIZE){
-                return -1;
+        if(!sock->valid()){
+        /*if the socket is negative, then it failed, return out*/
+                error = SOCKET_OPEN_FAILURE;
+                milliseconds = -1;
+                return false;
         }
+        /*open the socket*/
 
-        size_t length = 1 /*packet ID*/ + 5; /*protocol version*/
-        length = length + hostLength +1;
-        length = length + 2; /*port*/
-        length = length +1; /*state*/
-
+#ifdef _WIN32
+        unsigned long blocking = 0;
+        /* 0 is blocking, != is non-blocking  */
+        ioctlsocket(sock->get(), FIONBIO, &blocking);
+        /*in *nix, sockets are blocking by default*/
+#endif // _WIN32
+        sock->setTimeout(&timeout);
+        sock->setAbortive(abortiveClose);
+        /*set socket options as blocking, set the timeout for the connection
+        *and for every receive, so a server that stalls mid-response can not
+        *hang the probe
+        */
 
-        int i = 0;
-        buffer[i++] = length;
-        buffer[i++] = ID;
-        memcpy(buffer+i, version, 5);
-        i = i+5;
-        buffer[i++] = hostLength;
-        memcpy(buffer + i, host, hostLength);
-        i = i+hostLength;
-        buffer[i++] = (port >> 8) & 0xFF; /* MSB */
-        buffer[i++] = port & 0xFF;  /*LSB*/
-        buffer[i] = NEXT_STATE;
+        if(sources != nullptr && !sources->bindSocket(sock->get())){
+                error = SOCKET_OPEN_FAILURE;
+                milliseconds = -1;
+                return false;
+        }
+        /*spread the probes over the local addresses of the source pool*/
 
-        length = length+1;
 
-        return length;
-}
+        if(limiter != nullptr){
+                limiter->acquire(server.sin_addr.s_addr);
+                limiterHeld = true;
+                heldAddress = server.sin_addr.s_addr;
+        }
+        /*wait for the rate limiter before the SYN goes out, the wait is
+        *not part of the measured latency
+        */
+
+        bool tfo = false;
+#ifdef TCP_FASTOPEN_CONNECT
+        if(fastOpen && mode != PROBE_CONNECT_ONLY){
+                int on = 1;
+                tfo = setsockopt(sock->get(), IPPROTO_TCP, TCP_FASTOPEN_CONNECT,
+                                                        &on, sizeof(on)) == 0;
+        }
+#endif // TCP_FASTOPEN_CONNECT
+        /*with TCP Fast Open connect() returns at once and the SYN goes out
+        *with the first send(), carrying the request when the kernel has a
+        *cookie for the server. Without one, or on kernels that lack the
+        *option, it is an ordinary handshake
+        */
+
+        *connectStart = mc_currentMillis();
+        int connectR = connect(sock->get(), (struct sockaddr*)&server,
+                                                        sizeof(server));
+        /*client-connect
+        *connect to the socket
+        */
+
+        if(connectR<0){
+        /*if response is negative, then it failed, possibly the
+        * server is down, so return 0
+        */
+
+                error = CONNECT_FAILURE;
+                milliseconds = -1;
+                return false;
+
+        }
+
+        if(mode == PROBE_CONNECT_ONLY){
+                milliseconds = mc_currentMillis() - *connectStart;
+                return true;
+        }
+
+        *requestStart = mc_currentMillis();
+        int sendVal = send(sock->get(), SEND_CAST prepared.packet,
+                                                prepared.packetLength, 0);
+        /*send the prepared handshake and request packets in one write*/
+
+        if(sendVal < (int)prepared.packetLength){
+        /*if send response is negative, then it failed to send. With Fast
+        *Open the connection is only made by the send, so its failure is the
+        *server being unreachable
+        */
+                error = tfo ? CONNECT_FAILURE : SEND_FAILURE;
+                milliseconds = -1;
+                return false;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static size_t writeVarInt(uint8_t* buffer, int32_t value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes a protocol varint, negative values always take 5 bytes
+*
+* Parameters:
+*        buffer I/O     uint8_t*        at least 5 bytes to write to
+*        value  I/P     int32_t value to encode
+*        writeVarInt    O/P     size_t  number of bytes written
+**************************************************************************/
+static size_t writeVarInt(uint8_t* buffer, int32_t value)
+{
+        uint32_t v = (uint32_t)value;
+        size_t i = 0;
+
+        do{
+                buffer[i] = v & 0x7F;
+                v >>= 7;
+                if(v != 0)
+                        buffer[i] |= 0x80;
+                i++;
+        }while(v != 0);
+
+        return i;
+}
+
+/***************************************************************************
+* size_t Ping::buildHandshake(uint8_t* buffer, const char* host,
+*                                                       uint16_t hostPort)
+* Author: SkibbleBip
+* Date: Unknown, 2020   v1 Initial
+* Date: 09/09/2021      v2 Optimized code to make it faster, added safety
+*                               checking
+* Date: 10/19/2026      v3 Encodes the length and protocol version as
+*                               varints and appends the request packet, so
+*                               the whole status request is one write
+* Description: Function that creates the handshake packet followed by the
+*       status request packet
+*
+* Parameters:
+*        buffer I/O     uint8_t*        PREPARED_PACKET_SIZE bytes to contain
+*                                       the packet data
+*        host   I/P     const char*     domain of the host being queried
+*        hostPort       I/P     uint16_t        port the host is reached on
+*        buildHandshake O/P     size_t  size of the packets generated, 0 if
+*                                       the host is too long
+**************************************************************************/
+size_t Ping::buildHandshake(uint8_t* buffer, const char* host, uint16_t hostPort)
+{
+        return encodeHandshake(buffer, host, hostPort, protocolVersion);
+}
+
+/***************************************************************************
+* size_t Ping::encodeHandshake(uint8_t* buffer, const char* host,
+*                                       uint16_t hostPort, int32_t protocol)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes the handshake packet followed by the status request
+*       packet, shared by Ping and the probe engine
+*
+* Parameters:
+*        buffer I/O     uint8_t*        PREPARED_PACKET_SIZE bytes to contain
+*                                       the packet data
+*        host   I/P     const char*     domain of the host being queried
+*        hostPort       I/P     uint16_t        port the host is reached on
+*        protocol       I/P     int32_t protocol version the handshake
+*                                       announces
+*        encodeHandshake        O/P     size_t  size of the packets generated,
+*                                               0 if the host is too long
+**************************************************************************/
+size_t Ping::encodeHandshake(uint8_t* buffer, const char* host,
+                                        uint16_t hostPort, int32_t protocol)
+{
+        static const uint8_t request[2] = {0x1, 0x0};
+        /*status request: length 1, packet ID 0*/
+
+        ///inspired by https://github.com/theodik/mcping/blob/master/mcping.c
+
+        /**                 PROTOCOL VERSION: VARINT (-1)
+        PACKET ID: 0X00     SERVER ADDRESS: STRING
+                            SERVER PORT: UNSIGNED SHORT
+                            NEXT STATE: VARINT (1)
+        **/
+
+        size_t hostLength = strnlen(host, DOMAIN_MAX_SIZE+1);
+        if(hostLength > DOMAIN_MAX_SIZE){
+                return 0;
+        }
+
+        uint8_t body[PREPARED_PACKET_SIZE];
+        size_t i = 0;
+        body[i++] = ID;
+        i += writeVarInt(body + i, protocol);
+        i += writeVarInt(body + i, hostLength);
+        memcpy(body + i, host, hostLength);
+        i += hostLength;
+        body[i++] = (hostPort >> 8) & 0xFF; /* MSB */
+        body[i++] = hostPort & 0xFF;  /*LSB*/
+        body[i++] = NEXT_STATE;
+        /*the packet is built first, its length prefix is a varint that can
+        *take more than one byte for long hosts
+        */
+
+        size_t length = writeVarInt(buffer, i);
+        memcpy(buffer + length, body, i);
+        length += i;
+
+        memcpy(buffer + length, request, sizeof(request));
+        length += sizeof(request);
+
+        return length;
+}
+
+/***************************************************************************
+* bool Ping::prepare(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Resolves the target and encodes its handshake and request
+*       packets, unless the last probe already did and its DNS cache time has
+*       not run out. IP targets never need to be resolved again, so after the
+*       first probe only the connect, one write and the reads are left
+*
+* Parameters:
+*        prepare        O/P     bool    false if the target could not be
+*                                       resolved, error holds the reason
+**************************************************************************/
+bool Ping::prepare(void)
+{
+        uint64_t now = mc_currentMillis();
+
+        if(prepared.valid && now < prepared.expires)
+                return true;
+
+        prepared.valid = false;
+        unsigned short _port = this->port;
+        SRV_Answer srv;
+        const char* backAddress = frontAddress;
+        /*the backend url to the server, as SRV records could have a
+        *re-direct the minecraft server requires. IPs are handshaked as-is
+        */
+        uint32_t address;
+        /*the IP address the server's domain points to*/
+        uint32_t alternate = 0;
+
+        prepared.status   = OK;
+        prepared.dnsError = dnsError;
+        srvChosen = -1;
+        uint32_t ttl = UINT32_MAX;
+
+        if(parseIPv4(frontAddress, strlen(frontAddress), &address)){
+                prepared.expires = UINT64_MAX;
+                /*the url is an IP, it is assumed it can directly
+                *connect to the IP
+                */
+        }
+        else{
+                bool found;     //whether the host resolved to an address
+                SRV_LookupAll(frontAddress, &srv);
+                dnsError = srv.dns_error;
+                /*attempt SRV record lookup, set the error code from the
+                *record's response
+                */
+
+                int chosen = -1;
+                if(dnsError == NOERROR_STATUS){
+                        chosen = srvPrefer == SRV_PREFER_LATENCY ?
+                                        selectFastestSRV(&srv) :
+                                        selectSRV(&srv, mc_hash64(&now,
+                                                sizeof(now), (uintptr_t)this));
+                        if(chosen < 0)
+                                dnsError = NXDOMAIN_STATUS;
+                }
+                /*pick one of the records. A domain without any SRV record
+                *answers NOERROR with no records, it is handled like one that
+                *does not exist
+                */
+
+                if(dnsError == NOERROR_STATUS){
+                        const SRV_Record* r = &srv.records[chosen];
+                        found       = lookupIPv4(r->target, &address, &alternate);
+                        backAddress = r->target;
+                        _port       = r->port;
+                        ttl         = r->ttl;
+                        srvChosen   = findSRVStats(r->target, r->port);
+                        /*the SRV Record was found, get the backend address
+                        *and port and resolve the backend domain
+                        */
+                        prepared.status = REDIRECTED;
+                        /* Set error return to the redirected value */
+
+                }
+                else if(dnsError == NXDOMAIN_STATUS){
+                        found       = lookupIPv4(frontAddress, &address,
+                                                                &alternate);
+                        /*SRV record was not found, attempt to check A name
+                        *through getaddrinfo, assume the backend address is
+                        *the same as the frontend address
+                        */
+
+                }
+                else{
+                        error        = SRV_FAILURE;
+                        milliseconds = -1;
+                        return false;
+                /*the SRV record failed to successfully request a lookup,
+                *something went wrong set the error code and return to let
+                *user know there was a failure
+                */
+
+                }
+
+                if(!found){
+                        error        = NO_DOMAIN;
+                        milliseconds = -1;
+                        return false;
+                        /*if nothing was found, that's ok, it just means
+                        *the DNS server could not find the domain, it does
+                        not exist. return NO_DOMAIN to let user know the server was
+                        *not found
+                        */
+                }
+
+                /*the first address is probed, a second one is kept for
+                *hedged probes if there is one
+                */
+                dnsError          = NOERROR_STATUS;
+                prepared.dnsError = NOERROR_STATUS;
+                /*overwrite SRV_Lookup's response code, as
+                *getaddrinfo was able to resolve the location
+                *of the url
+                */
+                prepared.expires  = now + dnsCacheTime;
+                if(ttl < dnsCacheTime / 1000)
+                        prepared.expires = now + (uint64_t)ttl * 1000;
+                /*a record is not reused past its TTL*/
+        }
+        /*some non-notchian servers (specifically those that are protected by
+        * DDOS Protection Services such as Cloudflare or TCPShield)
+        * do not allow handshaking from direct IPs, they prefer that they
+        * connect through DNS-recorded domains, henceforth they only allow the
+        * URL of the server be included in the handshake, not the IP. This part
+        * checks if the inputted Minecraft server location is an IP or URL.
+        * This assumes you are aware whether or not the destination accepts IPs
+        * or URLs. Attempting to connect from an invalid URL will result
+        * in a DNS_FAILURE error and a return error.
+        */
+
+        memset(&prepared.address, 0, sizeof(prepared.address));
+        prepared.address.sin_family      = AF_INET;
+        prepared.address.sin_port        = htons(_port);
+        prepared.address.sin_addr.s_addr = address;
+        prepared.alternate = prepared.address;
+        if(alternate != 0)
+                prepared.alternate.sin_addr.s_addr = alternate;
+        /*initialize the server connection configuration as an INET /24 IP,
+        * and initialize the port.
+        * set the IP address of the server
+        */
+
+        prepared.packetLength = buildHandshake(prepared.packet, backAddress,
+                                                                _port);
+        if(prepared.packetLength == 0){
+        /*if the handshake packet building failed, it's possible a domain
+        *that was too long was given to it, therefor we should error out
+        */
+                error        = BAD_DOMAIN;
+                dnsError     = INVALID_DOMAIN;
+                milliseconds = -1;
+                return false;
+        }
+
+        strncpy(actualAddress, backAddress, DOMAIN_MAX_SIZE);
+        actualAddress[DOMAIN_MAX_SIZE] = '\000';
+        /*remember the host the handshake names, snapshots keep it*/
+
+        prepared.valid = true;
+        return true;
+}
 
 
 /***************************************************************************
 * int Ping::readVarInt(int s)
 * Author: SkibbleBip
-* Date: Unknown, 2020
+* Date: Unknown, 2020   v1 Initial
+* Date: 10/19/2026      v2 Decodes through mc_decodeVarInt, which the probe
+*                               engine shares
 * Description: Reads from a socket data and processes it to read the variable
 *       integer from the packet
 *
@@ -650,12 +1321,14 @@ size_t Ping::buildHandshake(uint8_t* buffer, char* host)
 **************************************************************************/
 int Ping::readVarInt(int s)
 {
-        char size;
-        int number = 0;
-        int result = 0;
-        do{
-                int b = recv(s, &size, 1, 0);
-                if(b<0){
+        uint8_t bytes[5];
+        size_t number = 0;
+        int32_t result;
+        int used = 0;
+
+        while(used == 0){
+                int b = recv(s, RECV_CAST &bytes[number], 1, 0);
+                if(b<=0){
                         /*receive the varInt buffer character. if recv'ing
                         *responds with a negative, then it failed
                         */
@@ -663,19 +1336,19 @@ int Ping::readVarInt(int s)
                         return -1;
 
                 }
-                result |= (size&0x7F)<<(7*number);
                 number++;
+                used = mc_decodeVarInt(bytes, number, &result);
                 /*process the varint and turn it back into a regular integer*/
-                if(number>5){
-                /*if more than 5 bytes are found in the varInt, then it's a
-                *bad varint
-                */
-                        error = MALFORMED_VARINT_PACKET;
-                        return -1;
+        }
 
-                }
-        }while((size&0x80) !=0);
+        if(used < 0){
+        /*if more than 5 bytes are found in the varInt, then it's a
+        *bad varint
+        */
+                error = MALFORMED_VARINT_PACKET;
+                return -1;
 
+        }
 
         return result;
     /*return the integer value of the varInt*/
@@ -684,7 +1357,9 @@ int Ping::readVarInt(int s)
 /***************************************************************************
 * bool Ping::checkIfIP(const char* in)
 * Author: SkibbleBip
-* Date: Unknown, 2020
+* Date: Unknown, 2020   v1 Initial
+* Date: 10/19/2026      v2 Replaced the strlen() per character loop with a
+*                               single pass through parseIPv4
 * Description: Checks if a string contains an IP or a domain url
 *
 * Parameters:
@@ -693,24 +1368,167 @@ int Ping::readVarInt(int s)
 **************************************************************************/
 bool Ping::checkIfIP(const char* in)
 {
-        int c = 0;
+        uint32_t addr;
 
-        for(unsigned int i=0; i < strlen(in); i++){
-                if(in[i] > 57 || in[i] < 48)
+        return parseIPv4(in, strnlen(in, DOMAIN_MAX_SIZE+1), &addr);
+        /*the string is an IP if it parses as a dotted quad*/
+}
+
+/***************************************************************************
+* bool Ping::parseIPv4(const char* in, size_t length, uint32_t* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Parses a dotted quad IPv4 literal in a single pass without
+*       needing a null terminator
+*
+* Parameters:
+*        in     I/P     const char*     characters to parse
+*        length I/P     size_t  number of characters to parse
+*        out    I/O     uint32_t*       parsed address in network byte order
+*        parseIPv4      O/P     bool    true if the string is an IPv4 literal
+**************************************************************************/
+bool Ping::parseIPv4(const char* in, size_t length, uint32_t* out)
+{
+        if(length < 7 || length > 15)
+                return false;
+        /*shortest literal is 0.0.0.0, longest is 255.255.255.255*/
+
+        uint32_t addr   = 0;
+        unsigned octet  = 0;
+        unsigned digits = 0;
+        unsigned dots   = 0;
+
+        for(size_t i = 0; i < length; i++){
+                unsigned c = (unsigned char)in[i] - '0';
+
+                if(c < 10){
+                        octet = octet * 10 + c;
+                        digits++;
+                        if(digits > 3 || octet > 255)
+                                return false;
+                        /*an octet is at most 3 digits and at most 255*/
+                }
+                else if(in[i] == '.' && digits != 0 && dots < 3){
+                        addr   = (addr << 8) | octet;
+                        octet  = 0;
+                        digits = 0;
+                        dots++;
+                        /*close the current octet*/
+                }
+                else{
                         return false;
-        /*if the character is not numeric, then it is definately not an IP*/
+                        /*any other character means it is not an IP*/
+                }
+        }
+
+        if(dots != 3 || digits == 0)
+                return false;
+        /*there must be exactly 4 non-empty octets*/
+
+        *out = htonl((addr << 8) | octet);
+        return true;
+}
+
+/***************************************************************************
+* pingError Ping::resolveIPv4(const char* host, uint32_t* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Resolves a host to its first IPv4 address, IP literals are
+*       parsed without a lookup. SRV records are not followed
+*
+* Parameters:
+*        host   I/P     const char*     IP or domain
+*        out    I/O     uint32_t*       receives the address in network order
+*        resolveIPv4    O/P     pingError       OK, BAD_DOMAIN if the host is
+*                                               too long or NO_DOMAIN if it
+*                                               does not resolve
+**************************************************************************/
+pingError Ping::resolveIPv4(const char* host, uint32_t* out)
+{
+        size_t length = strnlen(host, DOMAIN_MAX_SIZE + 1);
+        if(length > DOMAIN_MAX_SIZE)
+                return BAD_DOMAIN;
+
+        if(parseIPv4(host, length, out))
+                return OK;
+
+        if(!lookupIPv4(host, out, nullptr))
+                return NO_DOMAIN;
+
+        return OK;
+}
+
+/***************************************************************************
+* bool Ping::lookupIPv4(const char* host, uint32_t* first, uint32_t* second)
+* Author: agent
+* Date: 10/19/2026
+* Description: Looks up the IPv4 addresses of a domain with getaddrinfo.
+*       Unlike gethostbyname it returns its own list, so the reactors and the
+*       cache refresh threads can resolve at the same time
+*
+* Parameters:
+*        host   I/P     const char*     domain to look up
+*        first  I/O     uint32_t*       receives the first address in network
+*                                       order
+*        second I/O     uint32_t*       receives the second address, left
+*                                       alone if there is none. May be nullptr
+*        lookupIPv4     O/P     bool    false if the domain did not resolve
+**************************************************************************/
+bool Ping::lookupIPv4(const char* host, uint32_t* first, uint32_t* second)
+{
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family   = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        /*one entry per address instead of one per socket type*/
+
+        struct addrinfo* list = nullptr;
+        if(getaddrinfo(host, nullptr, &hints, &list) != 0 || list == nullptr)
+                return false;
 
-        if(in[i] == '.')
-                c++;
-                /*add 1 to the decimal count*/
+        int n = 0;
+        for(struct addrinfo* a = list; a != nullptr && n < 2; a = a->ai_next){
+                if(a->ai_family != AF_INET)
+                        continue;
+                uint32_t ip = ((struct sockaddr_in*)a->ai_addr)->sin_addr.s_addr;
+                if(n == 0)
+                        *first = ip;
+                else if(second != nullptr)
+                        *second = ip;
+                n++;
         }
+        freeaddrinfo(list);
 
-        if(c == 3)
-                return true;
-        /*if there are 3 decimals, then its an IP*/
+        return n != 0;
+}
 
-        return false;
-        /*else return false*/
+/***************************************************************************
+* uint64_t mc_hash64(const void* data, size_t length, uint64_t seed)
+* Author: agent
+* Date: 10/19/2026
+* Description: Fast non-cryptographic 64 bit FNV-1a hash. Passing the result
+*       of a previous call as the seed continues the hash, so data can be
+*       hashed in chunks. Pass 0 to start a new hash
+*
+* Parameters:
+*        data   I/P     const void*     bytes to hash
+*        length I/P     size_t  number of bytes to hash
+*        seed   I/P     uint64_t        previous hash value, or 0
+*        mc_hash64      O/P     uint64_t        resulting hash
+**************************************************************************/
+uint64_t mc_hash64(const void* data, size_t length, uint64_t seed)
+{
+        const uint8_t* in = (const uint8_t*)data;
+        uint64_t h = seed ? seed : 0xcbf29ce484222325ULL;
+        /*FNV-1a 64 bit offset basis*/
+
+        for(size_t i = 0; i < length; i++){
+                h ^= in[i];
+                h *= 0x100000001b3ULL;
+                /*FNV-1a 64 bit prime*/
+        }
+
+        return h;
 }
 
 /***************************************************************************
@@ -719,7 +1537,11 @@ bool Ping::checkIfIP(const char* in)
 * Date: Unknown, 2020   v1: Initial
 * Date: 09/05/2021      v2: Fixed dynamic allocation and replaced it with array
 *                               memory
-* Description: Performs SRV lookup of the minecraft server
+* Date: 10/19/2026      v3: Picks from every record of the answer with
+*                               selectSRV()
+* Description: Performs SRV lookup of the minecraft server. A domain without
+*       any usable SRV record reports NXDOMAIN_STATUS, the caller then falls
+*       back to the domain's own address
 *
 * Parameters:
 *        domain I/P     char*   name of the domain being searched for, can only
@@ -729,368 +1551,1341 @@ bool Ping::checkIfIP(const char* in)
 **************************************************************************/
 void Ping::SRV_Lookup(const char* domain, DNS_Response* dnsr)
 {
-        struct timeval random;
-        /*random number generator*/
-        char label[63];
-        /*chunks of labels*/
-        char tmpDomain[DOMAIN_MAX_SIZE+16] = "_minecraft._tcp.";
+        SRV_Answer answer;
+        SRV_LookupAll(domain, &answer);
 
-        if(strnlen(domain, DOMAIN_MAX_SIZE+1) > DOMAIN_MAX_SIZE){
-        /*if the domain submitted is too long, then return an error*/
-                memset(dnsr, 0, sizeof(DNS_Response));
-                dnsr->dns_error = INVALID_DOMAIN;
+        memset(dnsr, 0, sizeof(DNS_Response));
+        dnsr->dns_error = answer.dns_error;
+        if(answer.dns_error != NOERROR_STATUS)
                 return;
-        }
 
-        if(strncmp(domain, tmpDomain, 16)){
-        //if url doesnt start with _minecraft._tcp., then add it
-                strncat(tmpDomain, domain, DOMAIN_MAX_SIZE);
-        }
-        else{
-                strncpy(tmpDomain, domain, DOMAIN_MAX_SIZE);
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        int chosen = selectSRV(&answer, mc_hash64(&now, sizeof(now), 0));
+        if(chosen < 0){
+                dnsr->dns_error = NXDOMAIN_STATUS;
+                return;
         }
 
+        strcpy(dnsr->url, answer.records[chosen].target);
+        dnsr->port = answer.records[chosen].port;
+}
+
+/***************************************************************************
+* static bool readDNSName(const uint8_t* packet, int length, int* offset,
+*                                                               char* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads a possibly compressed domain name out of a DNS packet
+*
+* Parameters:
+*        packet I/P     const uint8_t*  DNS packet
+*        length I/P     int     length of the packet
+*        offset I/O     int*    offset of the name, moved past it
+*        out    I/O     char*   receives the dotted name, DOMAIN_MAX_SIZE + 1
+*                               bytes, or nullptr to skip the name
+*        readDNSName    O/P     bool    false if the name runs out of the
+*                                       packet, loops or is too long
+**************************************************************************/
+static bool readDNSName(const uint8_t* packet, int length, int* offset,
+                                                                char* out)
+{
+        int pos = *offset;
+        int written = 0;
+        int jumps = 0;
+        bool jumped = false;
 
+        while(true){
+                if(pos >= length)
+                        return false;
 
-#ifdef _WIN32
-        if(winsockInit.init_status){
-        //initialize the socket
-            // error = INITIALIZATION_FAILURE;
-            memset(dnsr, 0, sizeof(DNS_Response));
-            dnsr->dns_error = WSA_INITIALIZE_FAILURE;
-            return;
-            //if failed to initialize the windows socket, then return -1
+                uint8_t size = packet[pos];
+                if((size & 0xc0) == 0xc0){
+                        if(pos + 1 >= length || ++jumps > 16)
+                                return false;
+                        if(!jumped)
+                                *offset = pos + 2;
+                        jumped = true;
+                        pos = ((size & 0x3f) << 8) | packet[pos + 1];
+                        continue;
+                }
+                /*a compression pointer to a name earlier in the packet*/
+
+                if(size == 0){
+                        if(!jumped)
+                                *offset = pos + 1;
+                        break;
+                }
+
+                if(pos + 1 + size > length
+                                || written + size + 1 > DOMAIN_MAX_SIZE + 1)
+                        return false;
+                if(out != nullptr){
+                        memcpy(out + written, packet + pos + 1, size);
+                        out[written + size] = '.';
+                }
+                written += size + 1;
+                pos     += size + 1;
         }
-#endif // windows requires you to initialize the socket before opening
 
+        if(out != nullptr)
+                out[written ? written - 1 : 0] = '\0';
+        /*drop the trailing dot, the root name is an empty string*/
 
-/**
-                    DNS HEADER
-ID: 16 bits | QR: 1 bit | OPCODE: 4 bit | AUTHORITIVE ANSWER: 1 bit |
-TRUNCATE: 1 bit | RECURSION DESIRED: 1 bit | RECURSION AVAILABLE: 1 bit |
- Z: 3 bits(000) | RESPONSE CODE: 4 bits (0-5) | QUESTION COUNT: 16 bits |
-ANSWER COUNT: 16 bits | NAME RESOURCE COUNTS: 16 bits |
-ADDITIONAL RESOURCE COUNTS: 16 bits
-**/
-/**/
-/**/
-/**/    gettimeofday(&random, NULL);
-/**/    uint32_t time = htole32(random.tv_sec);  /*Long is 4 bytes*/
-/**/
-        uint8_t mcHeader[12] = {0x0, 0x0, 0x1, 0x0, 0x0, 0x1,
-                                0x0, 0x0, 0x0, 0x0, 0x0, 0x0
-                                };
-
-        memcpy(mcHeader, (void*)(&time), 2);
-        /*copy the payload random number to the first 2 bytes*/
+        return true;
+}
 
-/**                     DNS QUESTION
-    QNAME: length octet + that number of octets + null octet.
-    Example: \002my\006server\003org\000 == my.server.org
+/***************************************************************************
+* static uint16_t readBE16(const uint8_t* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads a big endian 16 bit value
+*
+* Parameters:
+*        p      I/P     const uint8_t*  first byte
+*        readBE16       O/P     uint16_t        value in host order
+**************************************************************************/
+static uint16_t readBE16(const uint8_t* p)
+{
+        return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+/***************************************************************************
+* static size_t encodeQuestion(const char* prefix, const char* domain,
+*                               uint16_t id, uint16_t qtype, uint8_t* packet)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes a DNS query with one question for the prefix followed
+*       by the domain
+*
+* Parameters:
+*        prefix I/P     const char*     labels put in front of the domain,
+*                                       ending with a dot, or ""
+*        domain I/P     const char*     name of the domain being searched for,
+*                                       can only be 253 characters long
+*        id     I/P     uint16_t        query ID, copied as is
+*        qtype  I/P     uint16_t        record type asked for
+*        packet I/O     uint8_t*        receives the query, 512 bytes
+*        encodeQuestion O/P     size_t  length of the query, 0 if the name is
+*                                       not a valid DNS name
+**************************************************************************/
+static size_t encodeQuestion(const char* prefix, const char* domain,
+                                uint16_t id, uint16_t qtype, uint8_t* packet)
+{
+        if(strnlen(domain, DOMAIN_MAX_SIZE+1) > DOMAIN_MAX_SIZE)
+                return 0;
+        /*if the domain submitted is too long, then return an error*/
+
+/**
+                    DNS HEADER
+ID: 16 bits | QR: 1 bit | OPCODE: 4 bit | AUTHORITIVE ANSWER: 1 bit |
+TRUNCATE: 1 bit | RECURSION DESIRED: 1 bit | RECURSION AVAILABLE: 1 bit |
+ Z: 3 bits(000) | RESPONSE CODE: 4 bits (0-5) | QUESTION COUNT: 16 bits |
+ANSWER COUNT: 16 bits | NAME RESOURCE COUNTS: 16 bits |
+ADDITIONAL RESOURCE COUNTS: 16 bits
+**/
+        static const uint8_t header[12] = {0x0, 0x0, 0x1, 0x0, 0x0, 0x1,
+                                        0x0, 0x0, 0x0, 0x0, 0x0, 0x0
+                                        };
+        memcpy(packet, header, sizeof(header));
+        memcpy(packet, &id, sizeof(id));
+        /*one question with recursion desired*/
+
+/**                     DNS QUESTION
+    QNAME: length octet + that number of octets + null octet.
+    Example: \002my\006server\003org\000 == my.server.org
     QTYPE: 2 octet code, 16 bits, d1 for A record, d5 for CNAME,
         d33 for SRV Lookup
     QCLASS: 2 octet, 16 bits
 **/
+        const char* parts[2] = {prefix, domain};
+        size_t label = sizeof(header);
+        size_t pos   = label + 1;
+
+        for(int p = 0; p < 2; p++){
+                for(const char* c = parts[p]; *c != '\0'; c++){
+                        if(*c != '.'){
+                                if(pos - label > 63)
+                                        return 0;
+                                packet[pos++] = *c;
+                                continue;
+                        }
+                        /*labels are at most 63 characters long*/
 
-        Minecraft_DNS_Question mcQuestion;
-        /*the question section of the DNS request*/
+                        if(pos == label + 1)
+                                return 0;
+                        packet[label] = pos - label - 1;
+                        label = pos++;
+                        /*a dot closes the label, empty ones are invalid*/
+                }
+        }
 
-        uint8_t j = 0;
-        uint8_t i;
+        if(pos != label + 1){
+                packet[label] = pos - label - 1;
+                packet[pos++] = 0;
+        }
+        else
+                packet[label] = 0;
+        /*close the last label with the root, a trailing dot already is it*/
+
+        if(pos - sizeof(header) > 255)
+                return 0;
+        /*the prefix counts towards the 255 byte limit of a name*/
+
+        packet[pos++] = qtype >> 8;
+        packet[pos++] = qtype & 0xff;
+        /*qtype = 0x0021 = 33 for an SRV record, 0x0001 for an A record*/
+        packet[pos++] = 0x00;
+        packet[pos++] = 0x01;
+        /*qclass = 0x001, Internet address*/
 
-        for(i = 0; i<strnlen(tmpDomain, DOMAIN_MAX_SIZE+16); i++){
-                if(j >= 63){
-                /*if the label size is greater than 63, then the domain is
-                *invalid
-                */
-                        memset(dnsr, 0, sizeof(DNS_Response));
-                        dnsr->dns_error = INVALID_DOMAIN;
+        return pos;
+}
+
+/***************************************************************************
+* size_t Ping::buildSRVQuestion(const char* domain, uint16_t id,
+*                                                       uint8_t* packet)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes the DNS query for the _minecraft._tcp SRV record of
+*       a domain, the prefix is added unless the domain already has it
+*
+* Parameters:
+*        domain I/P     const char*     name of the domain being searched for,
+*                                       can only be 253 characters long
+*        id     I/P     uint16_t        query ID, copied as is
+*        packet I/O     uint8_t*        receives the query, 512 bytes
+*        buildSRVQuestion       O/P     size_t  length of the query, 0 if the
+*                                               name is not a valid DNS name
+**************************************************************************/
+size_t Ping::buildSRVQuestion(const char* domain, uint16_t id, uint8_t* packet)
+{
+        static const char prefix[] = "_minecraft._tcp.";
+
+        return encodeQuestion(strncmp(domain, prefix, sizeof(prefix) - 1)
+                                ? prefix : "", domain, id, 0x0021, packet);
+}
+
+/***************************************************************************
+* size_t Ping::buildAQuestion(const char* domain, uint16_t id,
+*                                                       uint8_t* packet)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes the DNS query for the A records of a domain
+*
+* Parameters:
+*        domain I/P     const char*     name of the domain being searched for,
+*                                       can only be 253 characters long
+*        id     I/P     uint16_t        query ID, copied as is
+*        packet I/O     uint8_t*        receives the query, 512 bytes
+*        buildAQuestion O/P     size_t  length of the query, 0 if the name is
+*                                       not a valid DNS name
+**************************************************************************/
+size_t Ping::buildAQuestion(const char* domain, uint16_t id, uint8_t* packet)
+{
+        return encodeQuestion("", domain, id, 0x0001, packet);
+}
+
+/***************************************************************************
+* void Ping::parseSRVAnswer(const uint8_t* packet, int length,
+*                                                       SRV_Answer* answer)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads the SRV records out of a DNS response, up to
+*       SRV_MAX_RECORDS. Records with the "." target, which mark the service
+*       as unavailable, and records of other types are left out. A response
+*       cut short keeps the records read before the cut
+*
+* Parameters:
+*        packet I/P     const uint8_t*  DNS response
+*        length I/P     int     length of the response
+*        answer I/O     SRV_Answer*     receives the records and the DNS error
+*                                       code
+**************************************************************************/
+void Ping::parseSRVAnswer(const uint8_t* packet, int length, SRV_Answer* answer)
+{
+        memset(answer, 0, sizeof(SRV_Answer));
+
+        if(length < 12){
+                answer->dns_error = RECV_REQUEST_FAILURE;
+                return;
+        }
+        /*anything shorter than a header is no answer*/
+
+        uint16_t questions = readBE16(packet+4);
+        uint16_t answers   = readBE16(packet+6);
+        answer->dns_error  = (DNS_ERROR)(packet[3]&0x0f);
+        /*get the error code and the number of questions and answers*/
+
+        int offset = 12;
+        for(uint16_t q = 0; q < questions; q++){
+                if(!readDNSName(packet, length, &offset, nullptr))
                         return;
-                }
+                offset += 4;
+        }
+        /*skip the question, the answers follow it*/
+
+/**                     DNS ANSWER
+    NAME: same value as QNAME, usually a pointer to it
+    TYPE: 2 octets of type code, specifies the meaning of RDATA
+        (0x0001 A, 0x0005 CNAME, 0x0021 SRV)
+    CLASS: 2 octets specify the class of RDATA
+    TTL: time to live
+    RDLENGTH: length of RDATA
+    RDATA: SRV is PRIORITY: 16 bits | WEIGHT: 16 bits | PORT: 16 bits |
+        TARGET: domain name
+**/
+        for(uint16_t a = 0; a < answers && answer->count < SRV_MAX_RECORDS; a++){
+                if(!readDNSName(packet, length, &offset, nullptr)
+                                || offset + 10 > length)
+                        return;
+
+                uint16_t type   = readBE16(packet+offset);
+                uint32_t ttl    = (uint32_t)readBE16(packet+offset+4) << 16
+                                        | readBE16(packet+offset+6);
+                uint16_t rdlength = readBE16(packet+offset+8);
+                int rdata = offset + 10;
+                offset = rdata + rdlength;
+                if(offset > length)
+                        return;
+                /*a truncated answer keeps the records read so far*/
+
+                if(type != 0x0021 || rdlength < 7)
+                        continue;
+                /*CNAMEs and other records that came along are skipped*/
+
+                SRV_Record* r = &answer->records[answer->count];
+                int target = rdata + 6;
+                if(!readDNSName(packet, length, &target, r->target)
+                                || r->target[0] == '\0')
+                        continue;
+
+                r->priority = readBE16(packet+rdata);
+                r->weight   = readBE16(packet+rdata+2);
+                r->port     = readBE16(packet+rdata+4);
+                r->ttl      = ttl;
+                answer->count++;
+        }
+}
+
+/***************************************************************************
+* int Ping::parseAAnswer(const uint8_t* packet, int length,
+*                               uint32_t* addresses, int max, uint32_t* ttl)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads the IPv4 addresses out of the A records of a DNS
+*       response. The CNAMEs a resolver puts in front of them are skipped
+*
+* Parameters:
+*        packet I/P     const uint8_t*  DNS response
+*        length I/P     int     length of the response
+*        addresses      I/O     uint32_t*       receives up to max addresses
+*                                               in network order
+*        max    I/P     int     size of the address array
+*        ttl    I/O     uint32_t*       receives the lowest TTL of the records
+*                                       read, UINT32_MAX if there were none
+*        parseAAnswer   O/P     int     number of addresses read, or the
+*                                       negated DNS response code if the
+*                                       lookup failed
+**************************************************************************/
+int Ping::parseAAnswer(const uint8_t* packet, int length, uint32_t* addresses,
+                                                int max, uint32_t* ttl)
+{
+        *ttl = UINT32_MAX;
+
+        if(length < 12)
+                return -RECV_REQUEST_FAILURE;
+        if(packet[3] & 0x0f)
+                return -(packet[3] & 0x0f);
+        /*a response code other than NOERROR means there is no address*/
+
+        uint16_t questions = readBE16(packet+4);
+        uint16_t answers   = readBE16(packet+6);
+
+        int offset = 12;
+        for(uint16_t q = 0; q < questions; q++){
+                if(!readDNSName(packet, length, &offset, nullptr))
+                        return 0;
+                offset += 4;
+        }
+        /*skip the question, the answers follow it*/
+
+        int count = 0;
+        for(uint16_t a = 0; a < answers && count < max; a++){
+                if(!readDNSName(packet, length, &offset, nullptr)
+                                || offset + 10 > length)
+                        break;
+
+                uint16_t type     = readBE16(packet+offset);
+                uint16_t rdlength = readBE16(packet+offset+8);
+                uint32_t recordTtl = (uint32_t)readBE16(packet+offset+4) << 16
+                                        | readBE16(packet+offset+6);
+                int rdata = offset + 10;
+                offset = rdata + rdlength;
+                if(offset > length)
+                        break;
+                /*a truncated answer keeps the addresses read so far*/
+
+                if(type != 0x0001 || rdlength != 4)
+                        continue;
+
+                memcpy(&addresses[count++], packet+rdata, 4);
+                if(recordTtl < *ttl)
+                        *ttl = recordTtl;
+        }
+
+        return count;
+}
 
+/***************************************************************************
+* void Ping::SRV_LookupAll(const char* domain, SRV_Answer* answer)
+* Author: agent
+* Date: 10/19/2026
+* Description: Performs the SRV lookup of the minecraft server and returns
+*       every record of the answer, up to SRV_MAX_RECORDS, with its priority,
+*       weight and TTL. Records with the "." target, which mark the service
+*       as unavailable, are left out
+*
+* Parameters:
+*        domain I/P     const char*     name of the domain being searched for,
+*                                       can only be 253 characters long
+*        answer I/O     SRV_Answer*     receives the records and the DNS error
+*                                       code
+**************************************************************************/
+void Ping::SRV_LookupAll(const char* domain, SRV_Answer* answer)
+{
+        struct timeval random;
+        /*random number generator*/
 
-                if(tmpDomain[i] != '.'){
-                        label[j] = tmpDomain[i];
-                        j++;
-                /*add new char to the temp label and increase the temp counter*/
+#ifdef _WIN32
+        if(winsockInit.init_status){
+        //initialize the socket
+            // error = INITIALIZATION_FAILURE;
+            memset(answer, 0, sizeof(SRV_Answer));
+            answer->dns_error = WSA_INITIALIZE_FAILURE;
+            return;
+            //if failed to initialize the windows socket, then return -1
+        }
+#endif // windows requires you to initialize the socket before opening
+
+        gettimeofday(&random, NULL);
+        uint16_t id = (uint16_t)htole32(random.tv_sec);
+        /*the query ID is the low bytes of the time*/
+
+        uint8_t toSend[512];
+        /*max size of a DNS packet is 512 bytes*/
+        size_t z = buildSRVQuestion(domain, id, toSend);
+        if(z == 0){
+                memset(answer, 0, sizeof(SRV_Answer));
+                answer->dns_error = INVALID_DOMAIN;
+                return;
+        }
+
+        SocketHandle s(socket(AF_INET,SOCK_DGRAM,IPPROTO_UDP));
+        /*the handle closes the socket on every return path*/
+        if(!s.valid()){
+                memset(answer, 0, sizeof(SRV_Answer));
+                answer->dns_error = SEND_REQUEST_FAILURE;
+                return;
+        }
+
+        struct timeval dnsTimeout;
+        dnsTimeout.tv_sec  = TIMEOUT;
+        dnsTimeout.tv_usec = 0;
+        s.setTimeout(&dnsTimeout);
+        /*a resolver that never answers would otherwise block recvfrom()
+        *forever
+        */
+
+        sockaddr_in dest;
+        dest.sin_family=AF_INET;        /*open the socket on the dns port 53*/
+        dest.sin_port=htons(53);
+#ifdef _WIN32
+        FIXED_INFO pfi;
+        unsigned long ulOutBufLen = sizeof(FIXED_INFO);
+        GetNetworkParams(&pfi, &ulOutBufLen);
+        dest.sin_addr.s_addr=inet_addr(pfi.DnsServerList.IpAddress.String);
+#endif // _WIN32
+#ifdef __linux__
+        res_init();
+        dest = _res.nsaddr_list[0];
+#endif // __linux__
+
+/*perform the lookup of the DNS server on either windows or *nix
+*(usually the router)
+*/
+
+
+
+        int val = sendto(s.get(),
+                        RECV_CAST toSend,
+                        z,
+                        0,
+                        (sockaddr*)&dest,
+                        sizeof(dest)
+                        );
+        /*send the DNS packet to the gateway*/
+
+
+        if(val<0){
+            /*if sending failed, return an error*/
+                memset(answer, 0, sizeof(SRV_Answer));
+                answer->dns_error = SEND_REQUEST_FAILURE;
+                return;
+
+        }
+
+
+        uint8_t incoming[512];
+        /*Max size of a DNS packet is 512 bytes*/
+#ifdef _WIN32
+        int x = sizeof(dest);
+#else
+        unsigned int x = sizeof(dest);
+        /*windows is stupid for not agreeing with everyone else*/
+#endif
+
+        do
+        {
+                val = recvfrom(s.get(), RECV_CAST incoming, 512, 0, (sockaddr*)&dest, &x);
+
+                if(val<12){
+                        /*if failed to receive, return an error. Anything
+                        *shorter than a header is no answer either
+                        */
+                        memset(answer, 0, sizeof(SRV_Answer));
+                        answer->dns_error = RECV_REQUEST_FAILURE;
+                        return;
                 }
-                else{
-                /*copy the label to the output domain string*/
 
-                        label[j] = '\000';
-                        mcQuestion.QNAME[i] = '\000';
-                        mcQuestion.QNAME[i-j] = j;
-                        memcpy(mcQuestion.QNAME +i-j+1, label, j);
-                        j = 0;
+        }while(memcmp(incoming, &id, sizeof(id)));
+        /*as the machine may receive multiple DNS packets from various unrelated
+        *services, we need to make sure the nabbed dns packet actually belongs
+        *to our application. To do this, we compare our sent packet to the
+        *received packet. if the IDs dont match, attempt to receive a new packet
+        */
 
+        parseSRVAnswer(incoming, val, answer);
+}
 
+/***************************************************************************
+* int Ping::selectSRV(const SRV_Answer* answer, uint64_t random)
+* Author: agent
+* Date: 10/19/2026
+* Description: Picks the record to connect to the way RFC 2782 orders them:
+*       only the records with the lowest priority are considered, and among
+*       them one is drawn with a probability proportional to its weight.
+*       Records with weight 0 are only picked when every weight is 0
+*
+* Parameters:
+*        answer I/P     const SRV_Answer*       records of the lookup
+*        random I/P     uint64_t        random value for the weighted draw
+*        selectSRV      O/P     int     index of the chosen record, -1 if there
+*                                       are none
+**************************************************************************/
+int Ping::selectSRV(const SRV_Answer* answer, uint64_t random)
+{
+        if(answer->count == 0)
+                return -1;
+
+        uint16_t priority = UINT16_MAX;
+        for(uint16_t i = 0; i < answer->count; i++){
+                if(answer->records[i].priority < priority)
+                        priority = answer->records[i].priority;
+        }
+
+        uint32_t total = 0;
+        uint32_t candidates = 0;
+        for(uint16_t i = 0; i < answer->count; i++){
+                if(answer->records[i].priority == priority){
+                        total += answer->records[i].weight;
+                        candidates++;
                 }
         }
 
-        mcQuestion.QNAME[i]   = '\0';
-        mcQuestion.QNAME[i-j] =  j;
-        memcpy(mcQuestion.QNAME +i-j+1, label, j);
-        /*add the final length, label, and null terminator*/
+        uint32_t pick = total ? random % total : random % candidates;
+        for(uint16_t i = 0; i < answer->count; i++){
+                const SRV_Record* r = &answer->records[i];
+                if(r->priority != priority)
+                        continue;
+
+                uint32_t share = total ? r->weight : 1;
+                if(pick < share)
+                        return i;
+                pick -= share;
+        }
+        /*walk the running sum of the weights until it passes the draw*/
+
+        return -1;
+}
+
+/***************************************************************************
+* Ping::~Ping(void)
+* Author: SkibbleBip
+* Date: 09/09/2021
+* Description: Destructor of the Ping class
+*
+* Parameters:
+**************************************************************************/
+Ping::~Ping(void)
+{
+
+        releaseResponse();
+        //free the response
+
+        //exit
+}
+
+
+/***************************************************************************
+* void Ping::ping_free(void)
+* Author: SkibbleBip
+* Date: 09/09/2021
+* Description: Frees the dynamic response generated by the class
+*
+* Parameters:
+**************************************************************************/
+void Ping::ping_free(void)
+{
+        releaseResponse();
+        this->responseLength = 0;
+}
+
+/***************************************************************************
+* pingError Ping::getError(void)
+* Author: SkibbleBip
+* Date: 09/09/2021
+* Description: returns the ping error code
+*
+* Parameters:
+*        getError       O/P     pingError       The returned error code
+**************************************************************************/
+pingError Ping::getError(void)
+{
+        return this->error;
+}
+
+/***************************************************************************
+* char* Ping::getResponse(void)
+* Author: SkibbleBip
+* Date: 09/09/2021
+* Description: returns the string response of the ping process
+*
+* Parameters:
+*        getResponse    O/P     char*   The returned string
+**************************************************************************/
+char* Ping::getResponse(void)
+{
+        return this->pingResponse;
+}
+
+/***************************************************************************
+* long Ping::getPing(void)
+* Author: SkibbleBip
+* Date: 09/09/2021
+* Description: returns the ping latency of the connection
+*
+* Parameters:
+*        getPing        O/P     long    The returned latency value
+**************************************************************************/
+long Ping::getPing(void)
+{
+        return this->milliseconds;
+}
+
+/***************************************************************************
+* long Ping::getKernelRTT(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the smoothed round trip time the kernel measured for
+*       the last probe's connection. Unlike getPing() it does not grow when
+*       the host is too busy to get to the response right away
+*
+* Parameters:
+*        getKernelRTT   O/P     long    RTT in microseconds, -1 if it is not
+*                                       available
+**************************************************************************/
+long Ping::getKernelRTT(void)
+{
+        return this->kernelRtt;
+}
+
+/***************************************************************************
+* long Ping::getStampedPing(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the ping/pong round trip of the last probe, ended by
+*       the time the kernel received the pong instead of the time the probe
+*       got to read it
+*
+* Parameters:
+*        getStampedPing O/P     long    round trip in microseconds, -1 if the
+*                                       probe had no pong or the platform
+*                                       has no receive timestamps
+**************************************************************************/
+long Ping::getStampedPing(void)
+{
+        return this->stampedPing;
+}
+
+/***************************************************************************
+* DNS_ERROR Ping::getDNSerror(void)
+* Author: SkibbleBip
+* Date: 09/09/2021
+* Description: Returns the DNS error occured while searching for the IP the
+*       domain points to
+*
+* Parameters:
+*        getDNSserver   O/P     DNS_ERROR       Returned DNS error code
+**************************************************************************/
+DNS_ERROR Ping::getDNSerror(void)
+{
+        return this->dnsError;
+}
+
+/***************************************************************************
+* const char* Ping::getAddress(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the address the Ping object was created with
+*
+* Parameters:
+*        getAddress     O/P     const char*     address of the server
+**************************************************************************/
+const char* Ping::getAddress(void)
+{
+        return this->frontAddress;
+}
+
+/***************************************************************************
+* uint16_t Ping::getPort(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the port the Ping object was created with
+*
+* Parameters:
+*        getPort        O/P     uint16_t        port of the server
+**************************************************************************/
+uint16_t Ping::getPort(void)
+{
+        return this->port;
+}
+
+/***************************************************************************
+* void Ping::getResult(PingResult* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Fills a PingResult with the outcome of the last probe. The
+*       strings point into the Ping object and are only valid until the next
+*       connectMC() or until the object is destroyed
+*
+* Parameters:
+*        out    I/O     PingResult*     result to fill
+**************************************************************************/
+void Ping::getResult(PingResult* out)
+{
+        out->host           = this->frontAddress;
+        out->response       = this->pingResponse;
+        out->responseLength = this->pingResponse ? this->responseLength : 0;
+        out->timestamp      = this->completedAt;
+        out->ipv4           = this->server.sin_addr.s_addr;
+        out->port           = this->port;
+        out->error          = this->error;
+        out->dnsError       = this->dnsError;
+        out->milliseconds   = this->milliseconds;
+        out->kernelRtt      = this->kernelRtt;
+        out->stampedPing    = this->stampedPing;
+        out->fastOpen       = this->sentInSyn;
+}
+
+/***************************************************************************
+* void Ping::setSink(ResultSink* s)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the sink completed probes are written to. The sink is not
+*       owned by the Ping object, pass nullptr to stop writing results
+*
+* Parameters:
+*        s      I/P     ResultSink*     sink to write results to
+**************************************************************************/
+void Ping::setSink(ResultSink* s)
+{
+        this->sink = s;
+}
+
+/***************************************************************************
+* void Ping::setChangeDetection(bool enable, unsigned mask)
+* Author: agent
+* Date: 10/19/2026
+* Description: Turns change detection on or off. With it on, connectMC()
+*       returns UNCHANGED and skips the result sink when the response hashes
+*       the same as the last successful one. The hash leaves out the fields
+*       in the mask
+*
+* Parameters:
+*        enable I/P     bool    turn change detection on
+*        mask   I/P     unsigned        hashMask bits of the fields to ignore
+**************************************************************************/
+void Ping::setChangeDetection(bool enable, unsigned mask)
+{
+        if(mask != this->hashMask)
+                this->lastHash = 0;
+        /*hashes taken with another mask can not be compared*/
 
+        this->detectChanges = enable;
+        this->hashMask      = mask;
+}
 
-        mcQuestion.QTYPE  = htobe16(0x0021);
-        /*qtype = 0x0021 = 33, SRV record*/
-        mcQuestion.QCLASS = htobe16(0x0001);
-        /*qclass = 0x001, Internet address*/
-/******************************************************************************/
-                /**End of setting up question**/
+/***************************************************************************
+* uint64_t Ping::getResponseHash(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the hash of the last response, 0 if there was none
+*
+* Parameters:
+*        getResponseHash        O/P     uint64_t        hash of the response
+**************************************************************************/
+uint64_t Ping::getResponseHash(void)
+{
+        return this->responseHash;
+}
 
-        int z = i  +1 + 4;
-        /*size of the domain name +null terminator + the type and class bytes*/
+/***************************************************************************
+* void Ping::setProbeMode(probeMode m)
+* Author: agent
+* Date: 10/19/2026
+* Description: Selects how much of the Server List Ping exchange connectMC()
+*       performs, see probeMode
+*
+* Parameters:
+*        m      I/P     probeMode       probe mode
+**************************************************************************/
+void Ping::setProbeMode(probeMode m)
+{
+        mode = m;
+}
 
-        uint8_t toSend[512];
-        /*max size of a DNS packet is 512 bytes*/
+/***************************************************************************
+* probeMode Ping::getProbeMode(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the probe mode
+*
+* Parameters:
+*        getProbeMode   O/P     probeMode       probe mode
+**************************************************************************/
+probeMode Ping::getProbeMode(void)
+{
+        return mode;
+}
 
-        memcpy(toSend, &mcHeader, sizeof(mcHeader));
-        memcpy(toSend+sizeof(mcHeader), mcQuestion.QNAME, i+1);
-        toSend[sizeof(mcHeader)+i+1] = '\0';
-        /*copy the header and question to the send buffer*/
-        memcpy(toSend+sizeof(mcHeader)+z-3, &mcQuestion.QTYPE, 2);
-        memcpy(toSend+sizeof(mcHeader)+z-1, &mcQuestion.QCLASS, 2);
+/***************************************************************************
+* uint64_t Ping::getStateKey(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the key the target's state is stored under in a
+*       snapshot
+*
+* Parameters:
+*        getStateKey    O/P     uint64_t        hash of the host and port
+**************************************************************************/
+uint64_t Ping::getStateKey(void)
+{
+        return mc_hash64(frontAddress, strlen(frontAddress), port);
+}
 
-        int s = socket(AF_INET,SOCK_DGRAM,IPPROTO_UDP);
-        sockaddr_in dest;
-        dest.sin_family=AF_INET;        /*open the socket on the dns port 53*/
-        dest.sin_port=htons(53);
-#ifdef _WIN32
-        FIXED_INFO pfi;
-        unsigned long ulOutBufLen = sizeof(FIXED_INFO);
-        GetNetworkParams(&pfi, &ulOutBufLen);
-        dest.sin_addr.s_addr=inet_addr(pfi.DnsServerList.IpAddress.String);
-#endif // _WIN32
-#ifdef __linux__
-        res_init();
-        dest = _res.nsaddr_list[0];
-#endif // __linux__
+/***************************************************************************
+* const char* Ping::exportState(MC_TargetState* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Copies the resolved address, its expiry and the last result
+*       of the target out for a snapshot
+*
+* Parameters:
+*        out    O/P     MC_TargetState* the state, scheduler fields are 0
+*        exportState    O/P     const char*     SRV target the handshake
+*                                               names, nullptr if it names
+*                                               the host itself
+**************************************************************************/
+const char* Ping::exportState(MC_TargetState* out)
+{
+        memset(out, 0, sizeof(MC_TargetState));
+        out->key          = getStateKey();
+        out->completedAt  = completedAt;
+        out->lastHash     = lastHash;
+        out->milliseconds = milliseconds;
+        out->error        = error;
+        out->dnsError     = dnsError;
+
+        if(!prepared.valid)
+                return nullptr;
+
+        out->flags    |= STATE_RESOLVED;
+        out->expires   = prepared.expires;
+        out->ipv4      = prepared.address.sin_addr.s_addr;
+        out->alternate = prepared.alternate.sin_addr.s_addr;
+        out->port      = ntohs(prepared.address.sin_port);
+        out->status    = prepared.status;
+
+        return prepared.status == REDIRECTED ? actualAddress : nullptr;
+}
 
-/*perform the lookup of the DNS server on either windows or *nix
-*(usually the router)
-*/
+/***************************************************************************
+* bool Ping::importState(const MC_TargetState* state, const char* backend)
+* Author: agent
+* Date: 10/19/2026
+* Description: Restores the last result of the target from a snapshot, and
+*       its resolved address while that has not expired, so the next probe
+*       skips DNS entirely. The last response hash lets change detection
+*       carry on across a restart
+*
+* Parameters:
+*        state  I/P     const MC_TargetState*   state from a snapshot
+*        backend        I/P     const char*     SRV target the handshake
+*                                               names, nullptr for the host
+*        importState    O/P     bool    true if the resolved address was
+*                                       restored
+**************************************************************************/
+bool Ping::importState(const MC_TargetState* state, const char* backend)
+{
+        if(state->key != getStateKey())
+                return false;
 
+        completedAt  = state->completedAt;
+        lastHash     = state->lastHash;
+        milliseconds = state->milliseconds;
+        error        = (pingError)state->error;
+        dnsError     = (DNS_ERROR)state->dnsError;
 
+        if(!(state->flags & STATE_RESOLVED) || state->expires <= mc_currentMillis())
+                return false;
+        /*a stale address is resolved again by the next probe*/
 
-        int val = sendto(s,
-                        RECV_CAST toSend,
-                        sizeof(mcHeader)+z+1,
-                        0,
-                        (sockaddr*)&dest,
-                        sizeof(dest)
-                        );
-        /*send the DNS packet to the gateway*/
+        const char* host = backend != nullptr ? backend : frontAddress;
 
+        memset(&prepared.address, 0, sizeof(prepared.address));
+        prepared.address.sin_family      = AF_INET;
+        prepared.address.sin_port        = htons(state->port);
+        prepared.address.sin_addr.s_addr = state->ipv4;
+        prepared.alternate = prepared.address;
+        if(state->alternate != 0)
+                prepared.alternate.sin_addr.s_addr = state->alternate;
 
-        if(val<0){
-            /*if sending failed, return an error*/
-                memset(dnsr, 0, sizeof(DNS_Response));
-                dnsr->dns_error = SEND_REQUEST_FAILURE;
-                return;
+        prepared.packetLength = buildHandshake(prepared.packet, host,
+                                                                state->port);
+        if(prepared.packetLength == 0)
+                return false;
 
-        }
+        prepared.expires  = state->expires;
+        prepared.status   = state->status;
+        prepared.dnsError = (DNS_ERROR)state->dnsError;
+        strncpy(actualAddress, host, DOMAIN_MAX_SIZE);
+        actualAddress[DOMAIN_MAX_SIZE] = '\000';
+        srvChosen = backend != nullptr ? findSRVStats(backend, state->port) : -1;
+        /*the backend's latency keeps being tracked as if it was just picked*/
 
+        prepared.valid = true;
+        return true;
+}
 
-        uint8_t incoming[512];
-        /*Max size of a DNS packet is 512 bytes*/
-#ifdef _WIN32
-        int x = sizeof(dest);
-#else
-        unsigned int x = sizeof(dest);
-        /*windows is stupid for not agreeing with everyone else*/
-#endif
+/***************************************************************************
+* void Ping::setRateLimiter(RateLimiter* l)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the rate limiter connectMC() waits on before connecting.
+*       The limiter is not owned by the Ping object and can be shared
+*
+* Parameters:
+*        l      I/P     RateLimiter*    rate limiter, nullptr for none
+**************************************************************************/
+void Ping::setRateLimiter(RateLimiter* l)
+{
+        limiter = l;
+}
 
-        uint16_t _id;
-        uint16_t _answers;
-        uint16_t _port;
-        uint8_t  _error;
-        //DNS packet answer properties
+/***************************************************************************
+* void Ping::setSourcePool(SourcePool* pool)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the pool of local addresses probes are bound to before
+*       connecting. The pool is not owned by the Ping object and can be shared
+*
+* Parameters:
+*        pool   I/P     SourcePool*     source pool, nullptr to let the system
+*                                       pick the local address
+**************************************************************************/
+void Ping::setSourcePool(SourcePool* pool)
+{
+        sources = pool;
+}
 
-        do
-        {
-                val = recvfrom(s, RECV_CAST incoming, 512, 0, (sockaddr*)&dest, &x);
-    /**         DNS Answer
-        NAME (QNAME FORMAT) | TYPE: 16 bits | CLASS: 16 bits | TTL: 32 bits |
-        RDLENGTH: 16 bits
-        RDATA:      depends, look up the format for SRV
-    **/
-
-                if(val<0){
-                        /*if failed to receive, return an error*/
-                        memset(dnsr, 0, sizeof(DNS_Response));
-                        dnsr->dns_error = RECV_REQUEST_FAILURE;
-                        return;
-                }
+/***************************************************************************
+* void Ping::setAbortiveClose(bool enable)
+* Author: agent
+* Date: 10/19/2026
+* Description: Makes probes reset their connection when they are done instead
+*       of closing it gracefully, so the local port does not sit in TIME_WAIT
+*
+* Parameters:
+*        enable I/P     bool    true for an abortive close
+**************************************************************************/
+void Ping::setAbortiveClose(bool enable)
+{
+        abortiveClose = enable;
+}
 
-                _id      = *((uint16_t*)(incoming));
-                _answers = *((uint16_t*)(incoming+6));
-                _answers = htons(_answers);
-                _error   = incoming[3]&0x0f;
-                /*get ID of the packet, error code and the number of answers*/
+/***************************************************************************
+* void Ping::setFastOpen(bool enable)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sends the handshake and status request in the SYN with TCP
+*       Fast Open when the kernel holds a cookie for the server, saving a
+*       round trip on repeat probes. The first probe of a server fetches the
+*       cookie, servers without Fast Open get an ordinary handshake. Linux
+*       only, and not used by connect-only or hedged probes. A status-only
+*       latency then includes the handshake, as the request goes out first
+*
+* Parameters:
+*        enable I/P     bool    true to use TCP Fast Open
+**************************************************************************/
+void Ping::setFastOpen(bool enable)
+{
+        fastOpen = enable;
+}
 
-        }while(_id != *((uint16_t*)mcHeader));
-        //}while(memcmp(&_id, mcHeader, 2));
-        /*as the machine may receive multiple DNS packets from various unrelated
-        *services, we need to make sure the nabbed dns packet actually belongs
-        *to our application. To do this, we compare our sent packet to the
-        *received packet. if the IDs dont match, attempt to receive a new packet
-        */
+/***************************************************************************
+* bool Ping::usedFastOpen(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Tells whether the request of the last probe went out in the
+*       SYN and the server accepted it
+*
+* Parameters:
+*        usedFastOpen   O/P     bool    true if Fast Open saved the round trip
+**************************************************************************/
+bool Ping::usedFastOpen(void)
+{
+        return sentInSyn;
+}
 
-        if(_answers < 1){
-                /*if there were no answers, then return out to let
-                *the user know
-                */
-                memset(dnsr, 0, sizeof(DNS_Response));
-                dnsr->dns_error  = (DNS_ERROR)_error;
-                return;
+/***************************************************************************
+* void Ping::setProtocolVersion(int version)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the protocol version sent in the handshake, -1 by
+*       default. The prepared handshake is rebuilt on the next probe
+*
+* Parameters:
+*        version        I/P     int     protocol version number
+**************************************************************************/
+void Ping::setProtocolVersion(int version)
+{
+        if(protocolVersion != version){
+                protocolVersion = version;
+                prepared.valid  = false;
         }
+}
 
+/***************************************************************************
+* void Ping::setDNSCacheTime(uint32_t ms)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets how long a resolved domain target is reused before it is
+*       resolved again. IP targets are never resolved again
+*
+* Parameters:
+*        ms     I/P     uint32_t        cache time in milliseconds, 0 resolves
+*                                       on every probe
+**************************************************************************/
+void Ping::setDNSCacheTime(uint32_t ms)
+{
+        dnsCacheTime = ms;
+        prepared.valid = false;
+}
 
-        signed int size = incoming[12];
-        unsigned int next_stop = 0;
-        int v = 1;
-        while(size != 0){
-                next_stop +=size;
-                size = incoming[next_stop + 12 + v++];
-        }
-        /*get location of the last part of the srv record query
-        *string in the packet
-        */
+/***************************************************************************
+* void Ping::resetPrepared(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Forces the next probe to resolve the target and rebuild its
+*       packets, for callers that know the DNS records changed
+*
+* Parameters:
+**************************************************************************/
+void Ping::resetPrepared(void)
+{
+        prepared.valid = false;
+}
 
-        /*Past this point it is assumed that the packet transmission
-        *and receival was successful
-        */
+/***************************************************************************
+* void Ping::recordLatency(uint64_t ms)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds the time from connect to the first response byte to the
+*       target's latency history, which decides when a probe is hedged
+*
+* Parameters:
+*        ms     I/P     uint64_t        latency in milliseconds
+**************************************************************************/
+void Ping::recordLatency(uint64_t ms)
+{
+        latencyHistory[latencyNext] = ms > UINT32_MAX ? UINT32_MAX : ms;
+        latencyNext = (latencyNext + 1) % HEDGE_HISTORY;
+        if(latencyCount < HEDGE_HISTORY)
+                latencyCount++;
+}
 
-        _port = *((uint16_t*)(incoming+12 + next_stop + 20 + v));
-        _port = ntohs(_port);
-        /*get the backend port of the server*/
+/***************************************************************************
+* void Ping::setHedging(HedgeBudget* budget)
+* Author: agent
+* Date: 10/19/2026
+* Description: Turns hedged probes on. A probe that has not connected or seen
+*       its first response byte by the hedge delay starts a second attempt,
+*       as long as the budget allows it. The budget is not owned by the Ping
+*       object and is meant to be shared
+*
+* Parameters:
+*        budget I/P     HedgeBudget*    hedge budget, nullptr turns hedging off
+**************************************************************************/
+void Ping::setHedging(HedgeBudget* budget)
+{
+        hedger = budget;
+}
 
-        next_stop = next_stop + 12/*size of header*/
-        + v/*size of question string*/ + 22 /*location of the answer*/;
-        size = incoming[next_stop];
-        uint32_t next_stop2 = 0;
+/***************************************************************************
+* void Ping::setFaviconStore(FaviconStore* store)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the store favicons are split out into. Responses then
+*       carry a FAVICON_REFERENCE to the stored hash in place of the base64
+*       icon. The store is not owned by the Ping object, pass nullptr to keep
+*       favicons in the response again
+*
+* Parameters:
+*        store  I/P     FaviconStore*   store to put favicons in
+**************************************************************************/
+void Ping::setFaviconStore(FaviconStore* store)
+{
+        this->favicons = store;
+}
 
+/***************************************************************************
+* uint64_t Ping::getFaviconHash(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the hash the last response's favicon is stored under
+*
+* Parameters:
+*        getFaviconHash O/P     uint64_t        hash of the favicon, 0 if the
+*                                               response had none or no store
+*                                               is set
+**************************************************************************/
+uint64_t Ping::getFaviconHash(void)
+{
+        return splitter.getHash();
+}
 
-        while(size != 0){
-                memcpy(dnsr->url+next_stop2, incoming+next_stop+1, size);
-                next_stop += size+1;
-                next_stop2+=size+1;
-                dnsr->url[next_stop2-1] = '.';
+/***************************************************************************
+* void Ping::releaseResponse(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Frees the response, unless it was written into the buffer the
+*       caller provided
+*
+* Parameters:
+**************************************************************************/
+void Ping::releaseResponse(void)
+{
+        if(pingResponse != userBuffer)
+                free(pingResponse);
+        pingResponse = nullptr;
+}
 
-                size = incoming[next_stop];
+/***************************************************************************
+* void Ping::setResponseBuffer(char* buffer, size_t capacity)
+* Author: agent
+* Date: 10/19/2026
+* Description: Makes probes write the response into a buffer the caller
+*       owns instead of allocating one. A response that does not fit is cut
+*       off and the probe returns BUFFER_TRUNCATED, getResponseLength() then
+*       tells how big the buffer has to be. The buffer is used until it is
+*       replaced, pass nullptr to allocate responses again
+*
+* Parameters:
+*        buffer I/O     char*   buffer to write the null terminated response
+*                               to, or nullptr
+*        capacity       I/P     size_t  size of the buffer, terminator included
+**************************************************************************/
+void Ping::setResponseBuffer(char* buffer, size_t capacity)
+{
+        if(pingResponse != nullptr && pingResponse == userBuffer){
+                pingResponse   = nullptr;
+                responseLength = 0;
         }
+        /*the old buffer is the caller's again*/
 
-        dnsr->url[next_stop2-1] = '\0';
-        dnsr->dns_error = (DNS_ERROR)_error;
-        dnsr->port = _port;
-#ifdef _WIN32
-        WSACleanup();
-#endif
-
-
-
-/**                     DNS ANSWER
-    NAME: same value as QNAME
-    TYPE: 2 octets of type code, specifies the meaning of RDATA
-        (0x0001 A, 0x0005 CNAME, 0x0021 SRV)
-    CLASS: 2 octets specify the class of RDATA
-    TTL: time to live
-    RDLENGTH: length of RDATA
-    RDATA: response
-**/
-
+        if(capacity == 0)
+                buffer = nullptr;
 
+        this->userBuffer   = buffer;
+        this->userCapacity = buffer ? capacity : 0;
 }
 
 /***************************************************************************
-* Ping::~Ping(void)
-* Author: SkibbleBip
-* Date: 09/09/2021
-* Description: Destructor of the Ping class
+* size_t Ping::getResponseLength(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the full length of the last response, which can be
+*       more than was kept when it did not fit the caller's buffer
 *
 * Parameters:
+*        getResponseLength      O/P     size_t  length of the response without
+*                                               the null terminator
 **************************************************************************/
-Ping::~Ping(void)
+size_t Ping::getResponseLength(void)
 {
-
-        free(this->pingResponse);
-        //free the response
-
-        //exit
+        return this->neededLength;
 }
 
-
 /***************************************************************************
-* void Ping::ping_free(void)
-* Author: SkibbleBip
-* Date: 09/09/2021
-* Description: Frees the dynamic response generated by the class
+* int Ping::findSRVStats(const char* target, uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Finds the latency statistics of an SRV backend, or takes over
+*       the oldest slot for it
 *
 * Parameters:
+*        target I/P     const char*     target of the SRV record
+*        port   I/P     uint16_t        port of the SRV record
+*        findSRVStats   O/P     int     index of the statistics slot
 **************************************************************************/
-void Ping::ping_free(void)
+int Ping::findSRVStats(const char* target, uint16_t port)
 {
-        free(this->pingResponse);
-        this->pingResponse = nullptr;
+        uint64_t key = mc_hash64(target, strlen(target), port + 1);
+
+        for(int i = 0; i < SRV_MAX_RECORDS; i++){
+                if(srvStats[i].key == key)
+                        return i;
+        }
+
+        int slot = srvStatsNext;
+        srvStatsNext = (srvStatsNext + 1) % SRV_MAX_RECORDS;
+
+        srvStats[slot].key      = key;
+        srvStats[slot].latency  = 0;
+        srvStats[slot].failures = 0;
+
+        return slot;
 }
 
 /***************************************************************************
-* pingError Ping::getError(void)
-* Author: SkibbleBip
-* Date: 09/09/2021
-* Description: returns the ping error code
+* void Ping::recordSRVResult(bool healthy)
+* Author: agent
+* Date: 10/19/2026
+* Description: Updates the statistics of the SRV backend the last probe went
+*       to. A failed backend is prepared again on the next probe, so another
+*       record gets its turn
 *
 * Parameters:
-*        getError       O/P     pingError       The returned error code
+*        healthy        I/P     bool    true if the probe succeeded
 **************************************************************************/
-pingError Ping::getError(void)
+void Ping::recordSRVResult(bool healthy)
 {
-        return this->error;
+        SRVStats* st = &srvStats[srvChosen];
+
+        if(!healthy){
+                if(st->failures < UINT8_MAX)
+                        st->failures++;
+                if(srvPrefer == SRV_PREFER_LATENCY)
+                        prepared.valid = false;
+                return;
+        }
+
+        uint32_t sample = milliseconds > 0 ? milliseconds : 1;
+        st->latency  = st->latency ? (st->latency * 7 + sample) / 8 : sample;
+        st->failures = 0;
+        /*moving average, 0 is kept for backends never measured*/
 }
 
 /***************************************************************************
-* char* Ping::getResponse(void)
-* Author: SkibbleBip
-* Date: 09/09/2021
-* Description: returns the string response of the ping process
+* int Ping::selectFastestSRV(const SRV_Answer* answer)
+* Author: agent
+* Date: 10/19/2026
+* Description: Picks the record with the lowest measured latency among the
+*       healthy records of the lowest priority that has any. Records that
+*       were never probed are tried first, so every backend gets measured.
+*       When every record has failed, falls back to selectSRV()
 *
 * Parameters:
-*        getResponse    O/P     char*   The returned string
+*        answer I/P     const SRV_Answer*       records of the lookup
+*        selectFastestSRV       O/P     int     index of the chosen record, -1
+*                                               if there are none
 **************************************************************************/
-char* Ping::getResponse(void)
+int Ping::selectFastestSRV(const SRV_Answer* answer)
 {
-        return this->pingResponse;
+        int best = -1;
+        uint32_t bestLatency = 0;
+        uint16_t bestPriority = 0;
+
+        for(uint16_t i = 0; i < answer->count; i++){
+                const SRV_Record* r = &answer->records[i];
+                const SRVStats* st = &srvStats[findSRVStats(r->target, r->port)];
+                if(st->failures)
+                        continue;
+
+                if(best < 0 || r->priority < bestPriority
+                                || (r->priority == bestPriority
+                                        && st->latency < bestLatency)){
+                        best         = i;
+                        bestLatency  = st->latency;
+                        bestPriority = r->priority;
+                }
+                /*an unmeasured backend has latency 0 and wins its priority*/
+        }
+
+        if(best >= 0)
+                return best;
+
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        return selectSRV(answer, mc_hash64(&now, sizeof(now), (uintptr_t)this));
 }
 
 /***************************************************************************
-* long Ping::getPing(void)
-* Author: SkibbleBip
-* Date: 09/09/2021
-* Description: returns the ping latency of the connection
+* void Ping::setSRVPreference(srvPreference preference)
+* Author: agent
+* Date: 10/19/2026
+* Description: Selects how the SRV record to probe through is chosen, by the
+*       RFC 2782 priority and weight or by the lowest measured latency. The
+*       choice is made whenever the target is prepared, see setDNSCacheTime()
 *
 * Parameters:
-*        getPing        O/P     long    The returned latency value
+*        preference     I/P     srvPreference   SRV_PREFER_WEIGHT or
+*                                               SRV_PREFER_LATENCY
 **************************************************************************/
-long Ping::getPing(void)
+void Ping::setSRVPreference(srvPreference preference)
 {
-        return this->milliseconds;
+        this->srvPrefer = preference;
+        this->prepared.valid = false;
 }
 
 /***************************************************************************
-* DNS_ERROR Ping::getDNSerror(void)
-* Author: SkibbleBip
-* Date: 09/09/2021
-* Description: Returns the DNS error occured while searching for the IP the
-*       domain points to
+* void Ping::setChunkCallback(mc_chunkCallback callback, void* user)
+* Author: agent
+* Date: 10/19/2026
+* Description: Hands the status response body to a callback in chunks as
+*       they are received, instead of keeping it. getResponse() then returns
+*       nullptr, the response hash and change detection still work. Chunks
+*       have the favicon replaced when a favicon store is set. Pass nullptr to
+*       keep responses again
 *
 * Parameters:
-*        getDNSserver   O/P     DNS_ERROR       Returned DNS error code
+*        callback       I/P     mc_chunkCallback        function that receives
+*                                                       the chunks, or nullptr
+*        user   I/P     void*   passed to the callback as is
 **************************************************************************/
-DNS_ERROR Ping::getDNSerror(void)
+void Ping::setChunkCallback(mc_chunkCallback callback, void* user)
 {
-        return this->dnsError;
+        this->chunkCallback = callback;
+        this->chunkUser     = user;
 }
-
-
@@ -31,15 +31,147 @@
 *                               milliseconds for processing
 * ping_SRV_Lookup       -Calls the SRV Lookup function in the C++ library and
 *                               checks the DNS cache for the domain
+* ping_SRV_LookupAll    -Returns every record of an SRV lookup
+* mc_selectSRV  -Picks an SRV record by RFC 2782 priority and weight
+* ping_setSRVPreference -Selects how SRV records are chosen
+* ping_setChunkCallback -Streams response bodies to a callback
+* newQueryClient        -Calls the C++ QueryClient constructor
+* destroyQueryClient    -Calls the C++ QueryClient destructor
+* queryClient_add       -Adds a target to query
+* queryClient_run       -Queries every target and waits for the answers
+* queryClient_getError  -Returns the error code of a target
+* queryClient_getPing   -Returns the handshake round trip of a target
+* queryClient_getValue  -Returns a full stat value of a target
+* queryClient_getPlayerCount    -Returns the number of players listed
+* queryClient_getPlayer -Returns a player name
+* newBedrockClient      -Calls the C++ BedrockClient constructor
+* destroyBedrockClient  -Calls the C++ BedrockClient destructor
+* bedrockClient_add     -Adds a target to ping
+* bedrockClient_run     -Pings every target and waits for the answers
+* bedrockClient_getError        -Returns the error code of a target
+* bedrockClient_getPing -Returns the round trip of a target
+* bedrockClient_getResponse     -Returns the status string of a target
+* bedrockClient_getField        -Returns one field of a target's status
+* bedrockClient_getServerGUID   -Returns the GUID a target's server reported
 * ping_getDNSerror      -Calls the C++ library DNS error handle and returns
 *                               the DNS error code
 * ping_ping_free        -Calls the C++ library data freeing function
+* newTargetList -Calls the C++ TargetList default constructor
+* destroyTargetList     -Calls the C++ TargetList destructor
+* targetList_load       -Memory-maps and parses a target file
+* targetList_add        -Adds a single target to the list
+* targetList_size       -Returns the number of unique targets
+* targetList_getHost    -Returns the host of a target
+* targetList_getPort    -Returns the port of a target
+* targetList_createPing -Creates a Ping object for a target
+* newNDJSONSink -Opens a buffered NDJSON result sink
+* newBinaryLogSink      -Opens a binary append-only result log
+* sink_flush    -Flushes a result sink
+* destroySink   -Flushes and destroys a result sink
+* ping_setSink  -Sets the sink a Ping object writes its results to
+* ping_getResult        -Fills a PingResult with the outcome of the last probe
+* newBinaryLogReader    -Memory-maps a binary result log for reading
+* binaryLogReader_size  -Returns the number of records in a log
+* binaryLogReader_get   -Reads a record of a log
+* destroyBinaryLogReader        -Releases a binary result log
+* ping_setChangeDetection       -Turns response change detection on or off
+* ping_getResponseHash  -Returns the hash of the last response
+* ping_setProbeMode     -Selects how much of the exchange a probe performs
+* ping_getKernelRTT     -Returns the kernel's smoothed RTT of the last probe
+* ping_getStampedPing   -Returns the kernel timestamped ping of the last probe
+* newFaviconStore       -Calls the C++ FaviconStore constructor
+* destroyFaviconStore   -Calls the C++ FaviconStore destructor
+* faviconStore_put      -Stores a favicon once and returns its hash
+* faviconStore_get      -Looks up a stored favicon by its hash
+* faviconStore_size     -Returns the number of distinct favicons stored
+* ping_setFaviconStore  -Sets the store favicons are split out into
+* ping_getFaviconHash   -Returns the stored favicon hash of the last response
+* mc_initProbeContext   -Constructs a Ping object in caller-provided storage
+* mc_releaseProbeContext        -Destroys a Ping object in caller storage
+* mc_probeInto  -Probes and writes the response into a caller buffer
+* newRateLimiter        -Calls the C++ RateLimiter constructor
+* destroyRateLimiter    -Calls the C++ RateLimiter destructor
+* rateLimiter_setPolicy -Sets the rates, bursts and concurrency cap
+* ping_setRateLimiter   -Sets the rate limiter probes must pass
+* newSourcePool -Calls the C++ SourcePool default constructor
+* destroySourcePool     -Calls the C++ SourcePool destructor
+* sourcePool_add        -Adds a local address to a source pool
+* ping_setSourcePool    -Sets the local addresses probes are bound to
+* ping_setAbortiveClose -Makes probes reset their connection when done
+* ping_setFastOpen      -Sends the request in the SYN with TCP Fast Open
+* ping_usedFastOpen     -Tells whether the last request went out in the SYN
+* ping_setProtocolVersion       -Sets the protocol version sent in the handshake
+* ping_setDNSCacheTime  -Sets how long a resolved target is reused
+* newHedgeBudget        -Calls the C++ HedgeBudget constructor
+* destroyHedgeBudget    -Calls the C++ HedgeBudget destructor
+* ping_setHedging       -Turns hedged probes on for a Ping object
+* newScanCoordinator    -Calls the C++ ScanCoordinator constructor
+* destroyScanCoordinator        -Calls the C++ ScanCoordinator destructor
+* scanCoordinator_setProbeMode  -Sets the probe mode of a sharded scan
+* scanCoordinator_setDeadline   -Sets how long serve waits for the shards
+* scanCoordinator_setBindAddress        -Sets the address serve listens on
+* scanCoordinator_setToken      -Sets the token remote workers must send
+* scanCoordinator_setUploadLimit        -Caps the shard blob a worker may send
+* scanCoordinator_runLocal      -Scans every shard in a forked local process
+* scanCoordinator_serve -Hands the shards out to remote workers
+* mc_runScanWorker      -Scans the shards a remote coordinator hands out
+* mc_mergeLogs  -Merges binary result logs into one
+* newProbeEngine        -Calls the C++ ProbeEngine constructor
+* destroyProbeEngine    -Calls the C++ ProbeEngine destructor
+* probeEngine_setSink   -Sets the sink every reactor writes results to
+* probeEngine_setProbeMode      -Sets the probe mode of the engine
+* probeEngine_setAffinity       -Turns pinning reactors to CPUs on or off
+* probeEngine_setWindow -Sets how many probes a reactor keeps in flight
+* probeEngine_run       -Probes every target once
+* probeEngine_getReactors       -Returns the number of reactors
+* probeEngine_getStats  -Returns the statistics of one reactor
+* probeEngine_getTotals -Returns the statistics of all reactors summed
+* probeEngine_saveProgress      -Adds the scan checkpoints to a snapshot
+* probeEngine_resumeProgress    -Resumes a scan from a snapshot
+* newSnapshotWriter     -Calls the C++ SnapshotWriter default constructor
+* destroySnapshotWriter -Calls the C++ SnapshotWriter destructor
+* snapshotWriter_add    -Adds the state of a target to a snapshot
+* snapshotWriter_write  -Writes the snapshot file
+* snapshotWriter_clear  -Drops everything added to a snapshot
+* newSnapshotReader     -Opens a state snapshot
+* destroySnapshotReader -Closes a state snapshot
+* snapshotReader_restore        -Restores a target from a snapshot
+* newSeriesStore        -Creates a time series store in memory or in a file
+* destroySeriesStore    -Calls the C++ SeriesStore destructor
+* seriesStore_record    -Appends a sample to a series
+* seriesStore_recordPing        -Appends the last probe of a Ping to a series
+* seriesStore_range     -Returns the samples of a series in a time range
+* seriesStore_downsample        -Aggregates a series into fixed buckets
+* seriesStore_flush     -Writes a file backed store to disk
+* newStatusCache        -Calls the C++ StatusCache constructor
+* destroyStatusCache    -Calls the C++ StatusCache destructor
+* statusCache_shared    -Returns the process wide status cache
+* statusCache_setPolicy -Sets how long statuses are served
+* statusCache_setConfigure      -Sets the callback that configures new Pings
+* statusCache_get       -Returns the status of a server, probing it if needed
+* statusCache_getStats  -Returns the request and probe counters
+* mc_hashResponse       -Hashes a response with masked fields left out
+* newPollScheduler      -Calls the C++ PollScheduler default constructor
+* destroyPollScheduler  -Calls the C++ PollScheduler destructor
+* scheduler_setPolicy   -Sets the scheduler intervals, jitter and deadlines
+* scheduler_add -Schedules a Ping object in a priority tier
+* scheduler_remove      -Stops scheduling a target
+* scheduler_next        -Takes the targets that are due to be polled
+* scheduler_report      -Reports the result of a poll
+* scheduler_run -Polls every due target, up to a budget
+* scheduler_nextDue     -Returns the time the next poll is due
+* scheduler_getPing     -Returns the Ping object of a target
 ***************************************************************************/
 
 
 #include "MinecraftPing.h"
 #include <new>
 
+static_assert(sizeof(Ping) <= sizeof(MC_ProbeContext),
+                "MC_PROBE_CONTEXT_SIZE is too small to hold a Ping object");
+static_assert(alignof(Ping) <= alignof(MC_ProbeContext),
+                "MC_ProbeContext is not aligned for a Ping object");
+
 extern "C" {
 /*These are all implementations of the C frontend of the library.
 *If the user wants to link this library to a C program, the user
@@ -92,6 +224,120 @@ extern "C" {
                 Ping::SRV_Lookup(domain, dnsr);
         }
 
+        void ping_SRV_LookupAll(const char* domain, SRV_Answer* answer)
+        {
+                Ping::SRV_LookupAll(domain, answer);
+        }
+
+        int mc_selectSRV(const SRV_Answer* answer, uint64_t random)
+        {
+                return Ping::selectSRV(answer, random);
+        }
+
+        void ping_setSRVPreference(Ping* p, srvPreference preference)
+        {
+                p->setSRVPreference(preference);
+        }
+
+        void ping_setChunkCallback(Ping* p, mc_chunkCallback callback,
+                                                                void* user)
+        {
+                p->setChunkCallback(callback, user);
+        }
+
+        QueryClient* newQueryClient(void)
+        {
+                return new(std::nothrow) QueryClient();
+        }
+
+        void destroyQueryClient(QueryClient* q)
+        {
+                delete q;
+        }
+
+        int queryClient_add(QueryClient* q, const char* host, uint16_t port)
+        {
+                return q->add(host, port);
+        }
+
+        int queryClient_run(QueryClient* q, uint32_t timeoutMs)
+        {
+                return q->run(timeoutMs);
+        }
+
+        pingError queryClient_getError(QueryClient* q, int handle)
+        {
+                return q->getError(handle);
+        }
+
+        long queryClient_getPing(QueryClient* q, int handle)
+        {
+                return q->getPing(handle);
+        }
+
+        const char* queryClient_getValue(QueryClient* q, int handle,
+                                                        const char* key)
+        {
+                return q->getValue(handle, key);
+        }
+
+        size_t queryClient_getPlayerCount(QueryClient* q, int handle)
+        {
+                return q->getPlayerCount(handle);
+        }
+
+        const char* queryClient_getPlayer(QueryClient* q, int handle,
+                                                        size_t index)
+        {
+                return q->getPlayer(handle, index);
+        }
+
+        BedrockClient* newBedrockClient(void)
+        {
+                return new(std::nothrow) BedrockClient();
+        }
+
+        void destroyBedrockClient(BedrockClient* b)
+        {
+                delete b;
+        }
+
+        int bedrockClient_add(BedrockClient* b, const char* host, uint16_t port)
+        {
+                return b->add(host, port);
+        }
+
+        int bedrockClient_run(BedrockClient* b, uint32_t timeoutMs)
+        {
+                return b->run(timeoutMs);
+        }
+
+        pingError bedrockClient_getError(BedrockClient* b, int handle)
+        {
+                return b->getError(handle);
+        }
+
+        long bedrockClient_getPing(BedrockClient* b, int handle)
+        {
+                return b->getPing(handle);
+        }
+
+        const char* bedrockClient_getResponse(BedrockClient* b, int handle)
+        {
+                return b->getResponse(handle);
+        }
+
+        const char* bedrockClient_getField(BedrockClient* b, int handle,
+                                                        bedrockField field)
+        {
+                return b->getField(handle, field);
+        }
+
+        uint64_t bedrockClient_getServerGUID(BedrockClient* b, int handle)
+        {
+                return b->getServerGUID(handle);
+        }
+
         DNS_ERROR ping_getDNSerror(Ping* p)
         {
                 return p->getDNSerror();
@@ -102,6 +348,589 @@ extern "C" {
                 p->ping_free();
         }*/
 
+        TargetList* newTargetList(void)
+        {
+                return new(std::nothrow) TargetList();
+        }
+
+        void destroyTargetList(TargetList* t)
+        {
+                delete t;
+        }
+
+        int targetList_load(TargetList* t, const char* path, uint16_t defaultPort)
+        {
+                return t->load(path, defaultPort);
+        }
+
+        int targetList_add(TargetList* t, const char* host, uint16_t port)
+        {
+                return t->add(host, port);
+        }
+
+        size_t targetList_size(TargetList* t)
+        {
+                return t->size();
+        }
+
+        const char* targetList_getHost(TargetList* t, size_t index)
+        {
+                return t->getHost(index);
+        }
+
+        uint16_t targetList_getPort(TargetList* t, size_t index)
+        {
+                return t->getPort(index);
+        }
+
+        Ping* targetList_createPing(TargetList* t, size_t index)
+        {
+                return t->createPing(index);
+        }
+
+        ResultSink* newNDJSONSink(const char* path)
+        {
+                NDJSONSink* s = new(std::nothrow) NDJSONSink();
+                if(s != nullptr && s->open(path) != OK){
+                        delete s;
+                        return nullptr;
+                }
+                return s;
+        }
+
+        ResultSink* newBinaryLogSink(const char* path)
+        {
+                BinaryLogSink* s = new(std::nothrow) BinaryLogSink();
+                if(s != nullptr && s->open(path) != OK){
+                        delete s;
+                        return nullptr;
+                }
+                return s;
+        }
+
+        int sink_flush(ResultSink* s)
+        {
+                return s->flush();
+        }
+
+        void destroySink(ResultSink* s)
+        {
+                delete s;
+        }
+
+        void ping_setSink(Ping* p, ResultSink* s)
+        {
+                p->setSink(s);
+        }
+
+        void ping_getResult(Ping* p, PingResult* out)
+        {
+                p->getResult(out);
+        }
+
+        BinaryLogReader* newBinaryLogReader(const char* path)
+        {
+                BinaryLogReader* r = new(std::nothrow) BinaryLogReader();
+                if(r != nullptr && r->open(path) != OK){
+                        delete r;
+                        return nullptr;
+                }
+                return r;
+        }
+
+        size_t binaryLogReader_size(BinaryLogReader* r)
+        {
+                return r->size();
+        }
+
+        int binaryLogReader_get(BinaryLogReader* r, size_t index, PingResult* out)
+        {
+                return r->get(index, out);
+        }
+
+        void destroyBinaryLogReader(BinaryLogReader* r)
+        {
+                delete r;
+        }
+
+        void ping_setChangeDetection(Ping* p, int enable, unsigned mask)
+        {
+                p->setChangeDetection(enable != 0, mask);
+        }
+
+        uint64_t ping_getResponseHash(Ping* p)
+        {
+                return p->getResponseHash();
+        }
+
+        void ping_setProbeMode(Ping* p, enum probeMode mode)
+        {
+                p->setProbeMode(mode);
+        }
+
+        long ping_getKernelRTT(Ping* p)
+        {
+                return p->getKernelRTT();
+        }
+
+        long ping_getStampedPing(Ping* p)
+        {
+                return p->getStampedPing();
+        }
+
+        FaviconStore* newFaviconStore(int decode)
+        {
+                return new(std::nothrow) FaviconStore(decode != 0);
+        }
+
+        void destroyFaviconStore(FaviconStore* s)
+        {
+                delete s;
+        }
+
+        uint64_t faviconStore_put(FaviconStore* s, char* value, size_t length)
+        {
+                return s->put(value, length);
+        }
+
+        int faviconStore_get(FaviconStore* s, uint64_t hash,
+                                const uint8_t** data, size_t* length)
+        {
+                return s->get(hash, data, length);
+        }
+
+        size_t faviconStore_size(FaviconStore* s)
+        {
+                return s->size();
+        }
+
+        void ping_setFaviconStore(Ping* p, FaviconStore* s)
+        {
+                p->setFaviconStore(s);
+        }
+
+        uint64_t ping_getFaviconHash(Ping* p)
+        {
+                return p->getFaviconHash();
+        }
+
+        Ping* mc_initProbeContext(struct MC_ProbeContext* ctx,
+                                        const char* address, uint16_t port)
+        {
+                return new(ctx->storage) Ping(address, port);
+        }
+
+        void mc_releaseProbeContext(struct MC_ProbeContext* ctx)
+        {
+                ((Ping*)ctx->storage)->~Ping();
+        }
+
+        int mc_probeInto(Ping* p, char* buffer, size_t capacity,
+                                                        size_t* length)
+        {
+                p->setResponseBuffer(buffer, capacity);
+                int ret = p->connectMC();
+                if(length != nullptr)
+                        *length = p->getResponseLength();
+                p->setResponseBuffer(nullptr, 0);
+                /*the buffer is only borrowed for this probe, a later
+                *connectMC() must not write through it
+                */
+                return ret;
+        }
+
+        RateLimiter* newRateLimiter(const struct RateLimitPolicy* p)
+        {
+                return new(std::nothrow) RateLimiter(p);
+        }
+
+        void destroyRateLimiter(RateLimiter* l)
+        {
+                delete l;
+        }
+
+        void rateLimiter_setPolicy(RateLimiter* l, const struct RateLimitPolicy* p)
+        {
+                l->setPolicy(p);
+        }
+
+        void ping_setRateLimiter(Ping* p, RateLimiter* l)
+        {
+                p->setRateLimiter(l);
+        }
+
+        SourcePool* newSourcePool(void)
+        {
+                return new(std::nothrow) SourcePool();
+        }
+
+        void destroySourcePool(SourcePool* pool)
+        {
+                delete pool;
+        }
+
+        int sourcePool_add(SourcePool* pool, const char* address)
+        {
+                return pool->add(address);
+        }
+
+        void ping_setSourcePool(Ping* p, SourcePool* pool)
+        {
+                p->setSourcePool(pool);
+        }
+
+        void ping_setAbortiveClose(Ping* p, int enable)
+        {
+                p->setAbortiveClose(enable);
+        }
+
+        void ping_setFastOpen(Ping* p, int enable)
+        {
+                p->setFastOpen(enable);
+        }
+
+        int ping_usedFastOpen(Ping* p)
+        {
+                return p->usedFastOpen();
+        }
+
+        void ping_setProtocolVersion(Ping* p, int version)
+        {
+                p->setProtocolVersion(version);
+        }
+
+        void ping_setDNSCacheTime(Ping* p, uint32_t ms)
+        {
+                p->setDNSCacheTime(ms);
+        }
+
+        HedgeBudget* newHedgeBudget(const struct HedgePolicy* p)
+        {
+                return new(std::nothrow) HedgeBudget(p);
+        }
+
+        void destroyHedgeBudget(HedgeBudget* b)
+        {
+                delete b;
+        }
+
+        void ping_setHedging(Ping* p, HedgeBudget* b)
+        {
+                p->setHedging(b);
+        }
+
+        ScanCoordinator* newScanCoordinator(TargetList* targets, unsigned shards)
+        {
+                return new(std::nothrow) ScanCoordinator(targets, shards);
+        }
+
+        void destroyScanCoordinator(ScanCoordinator* c)
+        {
+                delete c;
+        }
+
+        void scanCoordinator_setProbeMode(ScanCoordinator* c, enum probeMode mode)
+        {
+                c->setProbeMode(mode);
+        }
+
+        void scanCoordinator_setDeadline(ScanCoordinator* c, uint32_t seconds)
+        {
+                c->setDeadline(seconds);
+        }
+
+        int scanCoordinator_setBindAddress(ScanCoordinator* c,
+                                                        const char* address)
+        {
+                return c->setBindAddress(address);
+        }
+
+        int scanCoordinator_setToken(ScanCoordinator* c, const char* token)
+        {
+                return c->setToken(token);
+        }
+
+        void scanCoordinator_setUploadLimit(ScanCoordinator* c, uint64_t bytes)
+        {
+                c->setUploadLimit(bytes);
+        }
+
+        int scanCoordinator_runLocal(ScanCoordinator* c, const char* output)
+        {
+                return c->runLocal(output);
+        }
+
+        int scanCoordinator_serve(ScanCoordinator* c, uint16_t port,
+                                                        const char* output)
+        {
+                return c->serve(port, output);
+        }
+
+        int mc_runScanWorker(const char* host, uint16_t port,
+                                const char* workPath, const char* token)
+        {
+                return ScanCoordinator::runWorker(host, port, workPath, token);
+        }
+
+        int mc_mergeLogs(const char* output, const char* const* inputs,
+                                                                size_t count)
+        {
+                return ScanCoordinator::merge(output, inputs, count);
+        }
+
+        ProbeEngine* newProbeEngine(TargetList* targets, unsigned reactors)
+        {
+                return new(std::nothrow) ProbeEngine(targets, reactors);
+        }
+
+        void destroyProbeEngine(ProbeEngine* e)
+        {
+                delete e;
+        }
+
+        void probeEngine_setSink(ProbeEngine* e, ResultSink* s)
+        {
+                e->setSink(s);
+        }
+
+        void probeEngine_setProbeMode(ProbeEngine* e, enum probeMode mode)
+        {
+                e->setProbeMode(mode);
+        }
+
+        void probeEngine_setAffinity(ProbeEngine* e, int enable)
+        {
+                e->setAffinity(enable != 0);
+        }
+
+        void probeEngine_setWindow(ProbeEngine* e, unsigned probes)
+        {
+                e->setWindow(probes);
+        }
+
+        int probeEngine_run(ProbeEngine* e)
+        {
+                return e->run();
+        }
+
+        unsigned probeEngine_getReactors(ProbeEngine* e)
+        {
+                return e->getReactors();
+        }
+
+        int probeEngine_getStats(ProbeEngine* e, unsigned reactor,
+                                                struct EngineStats* out)
+        {
+                return e->getStats(reactor, out);
+        }
+
+        void probeEngine_getTotals(ProbeEngine* e, struct EngineStats* out)
+        {
+                e->getTotals(out);
+        }
+
+        void probeEngine_saveProgress(ProbeEngine* e, SnapshotWriter* w)
+        {
+                e->saveProgress(w);
+        }
+
+        unsigned probeEngine_resumeProgress(ProbeEngine* e, SnapshotReader* r)
+        {
+                return e->resumeProgress(r);
+        }
+
+        SnapshotWriter* newSnapshotWriter(void)
+        {
+                return new(std::nothrow) SnapshotWriter();
+        }
+
+        void destroySnapshotWriter(SnapshotWriter* w)
+        {
+                delete w;
+        }
+
+        int snapshotWriter_add(SnapshotWriter* w, Ping* p, PollScheduler* s,
+                                                                int handle)
+        {
+                return w->add(p, s, handle);
+        }
+
+        int snapshotWriter_write(SnapshotWriter* w, const char* path)
+        {
+                return w->write(path);
+        }
+
+        void snapshotWriter_clear(SnapshotWriter* w)
+        {
+                w->clear();
+        }
+
+        SnapshotReader* newSnapshotReader(const char* path)
+        {
+                SnapshotReader* r = new(std::nothrow) SnapshotReader();
+                if(r != nullptr && r->open(path) != OK){
+                        delete r;
+                        return nullptr;
+                }
+
+                return r;
+        }
+
+        void destroySnapshotReader(SnapshotReader* r)
+        {
+                delete r;
+        }
+
+        int snapshotReader_restore(SnapshotReader* r, Ping* p, PollScheduler* s,
+                                                                int handle)
+        {
+                return r->restore(p, s, handle);
+        }
+
+        SeriesStore* newSeriesStore(const char* path, size_t series,
+                                                        uint32_t blocks)
+        {
+                SeriesStore* s = new(std::nothrow) SeriesStore();
+                if(s == nullptr)
+                        return nullptr;
+
+                int ret = path == nullptr ? s->create(series, blocks)
+                                        : s->open(path, series, blocks);
+                if(ret != OK){
+                        delete s;
+                        return nullptr;
+                }
+
+                return s;
+        }
+
+        void destroySeriesStore(SeriesStore* s)
+        {
+                delete s;
+        }
+
+        int seriesStore_record(SeriesStore* s, size_t index, uint64_t timestamp,
+                                                long milliseconds, long online)
+        {
+                return s->record(index, timestamp, milliseconds, online);
+        }
+
+        int seriesStore_recordPing(SeriesStore* s, size_t index, Ping* p)
+        {
+                return s->record(index, p);
+        }
+
+        size_t seriesStore_range(SeriesStore* s, size_t index, uint64_t from,
+                uint64_t to, struct MC_SeriesSample* out, size_t max)
+        {
+                return s->range(index, from, to, out, max);
+        }
+
+        size_t seriesStore_downsample(SeriesStore* s, size_t index,
+                        uint64_t from, uint64_t to, uint64_t bucket,
+                        struct MC_SeriesBucket* out, size_t max)
+        {
+                return s->downsample(index, from, to, bucket, out, max);
+        }
+
+        int seriesStore_flush(SeriesStore* s)
+        {
+                return s->flush();
+        }
+
+        StatusCache* newStatusCache(const struct CachePolicy* p)
+        {
+                return new(std::nothrow) StatusCache(p);
+        }
+
+        void destroyStatusCache(StatusCache* c)
+        {
+                delete c;
+        }
+
+        StatusCache* statusCache_shared(void)
+        {
+                return StatusCache::shared();
+        }
+
+        void statusCache_setPolicy(StatusCache* c, const struct CachePolicy* p)
+        {
+                c->setPolicy(p);
+        }
+
+        void statusCache_setConfigure(StatusCache* c,
+                                mc_cacheConfigure callback, void* user)
+        {
+                c->setConfigure(callback, user);
+        }
+
+        int statusCache_get(StatusCache* c, const char* host, uint16_t port,
+                        struct PingResult* out, char* buffer, size_t capacity,
+                        enum cacheState* state)
+        {
+                return c->get(host, port, out, buffer, capacity, state);
+        }
+
+        void statusCache_getStats(StatusCache* c, struct CacheStats* out)
+        {
+                c->getStats(out);
+        }
+
+        uint64_t mc_hashResponse(const char* data, size_t length, unsigned mask)
+        {
+                return ResponseHasher::hashResponse(data, length, mask);
+        }
+
+        PollScheduler* newPollScheduler(void)
+        {
+                return new(std::nothrow) PollScheduler();
+        }
+
+        void destroyPollScheduler(PollScheduler* s)
+        {
+                delete s;
+        }
+
+        void scheduler_setPolicy(PollScheduler* s, const SchedulerPolicy* p)
+        {
+                s->setPolicy(p);
+        }
+
+        int scheduler_add(PollScheduler* s, Ping* p, unsigned tier)
+        {
+                return s->add(p, tier, PollScheduler::now());
+        }
+
+        int scheduler_remove(PollScheduler* s, int handle)
+        {
+                return s->remove(handle);
+        }
+
+        size_t scheduler_next(PollScheduler* s, int* handles, size_t max)
+        {
+                return s->next(PollScheduler::now(), handles, max);
+        }
+
+        void scheduler_report(PollScheduler* s, int handle, int result)
+        {
+                s->report(handle, result, PollScheduler::now());
+        }
+
+        size_t scheduler_run(PollScheduler* s, size_t budget)
+        {
+                return s->run(PollScheduler::now(), budget);
+        }
+
+        uint64_t scheduler_nextDue(PollScheduler* s)
+        {
+                return s->nextDue();
+        }
+
+        Ping* scheduler_getPing(PollScheduler* s, int handle)
+        {
+                return s->getPing(handle);
+        }
+
 
 
 }
@@ -18,6 +18,7 @@ use std::fmt;
 #[derive(FromPrimitive)]
 #[repr(C)]
 pub enum c_pingError {
+    BUFFER_TRUNCATED = -12,
     SOCKET_INITIALIZATION_FAILURE = -11,
     SOCKET_OPEN_FAILURE = -10,
     RECEIVE_FAILURE = -9,
@@ -33,6 +34,7 @@ pub enum c_pingError {
     CONNECT_FAILURE = 0,
     OK = 1,
     REDIRECTED = 2,
+    UNCHANGED = 3,
 }
 /*ping attempt error codes (C layer)*/
 
@@ -41,6 +43,7 @@ pub enum c_pingError {
 #[derive(FromPrimitive)]
 #[derive(PartialEq)]
 pub enum pingError {
+    BUFFER_TRUNCATED = c_pingError::BUFFER_TRUNCATED as isize,
     SOCKET_INITIALIZATION_FAILURE = c_pingError::SOCKET_INITIALIZATION_FAILURE as isize,
     SOCKET_OPEN_FAILURE = c_pingError::SOCKET_OPEN_FAILURE as isize,
     RECEIVE_FAILURE = c_pingError::RECEIVE_FAILURE as isize,
@@ -63,6 +66,7 @@ pub enum pingStatus {
     CONNECT_FAILURE = c_pingError::CONNECT_FAILURE as isize,
     OK = c_pingError::OK as isize,
     REDIRECTED = c_pingError::REDIRECTED as isize,
+    UNCHANGED = c_pingError::UNCHANGED as isize,
 }
 /*normal reply values*/
 
@@ -88,6 +92,7 @@ impl fmt::Display for pingStatus {
             pingStatus::CONNECT_FAILURE => write!(f, "Connection refused"),
             pingStatus::OK => write!(f, "Connection established"),
             pingStatus::REDIRECTED => write!(f, "Connection established, redirecting"),
+            pingStatus::UNCHANGED => write!(f, "Connection established, response unchanged"),
         }
     }
 }
@@ -103,6 +108,7 @@ impl fmt::Debug for pingStatus {
 impl fmt::Display for pingError {
     fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
         match self {
+            pingError::BUFFER_TRUNCATED => write!(f, "Response truncated to the buffer"),
             pingError::SOCKET_INITIALIZATION_FAILURE => write!(f, "Socket inititialization error"),
             pingError::SOCKET_OPEN_FAILURE => write!(f, "Socket open error"),
             pingError::RECEIVE_FAILURE => write!(f, "Receive error"),
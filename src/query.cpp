@@ -0,0 +1,647 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  query.cpp
+* Author:  agent
+* Procedures:
+* QueryClient(X)        -Constructor
+* ~QueryClient  -Destructor
+* sessionOf     -Encodes a target index as a query session ID
+* indexOf       -Decodes the target index from a session ID
+* clearResult   -Frees the result of a target
+* add           -Adds a target to query
+* sendPending   -Sends the queued requests in batches
+* requeue       -Queues the unanswered requests once more
+* parseStat     -Parses a full stat answer
+* handle        -Processes an answer datagram
+* drain         -Processes every waiting answer datagram
+* run           -Queries every target and waits for the answers
+* size          -Returns the number of targets
+* getError      -Returns the error code of a target
+* getPing       -Returns the handshake round trip of a target
+* getValue      -Returns a full stat value of a target
+* getPlayerCount        -Returns the number of players listed
+* getPlayer     -Returns a player name
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+
+#define QUERY_MAGIC_0 0xFE
+#define QUERY_MAGIC_1 0xFD
+#define QUERY_TYPE_HANDSHAKE 0x09
+#define QUERY_TYPE_STAT 0x00
+#define QUERY_REQUEST_SIZE 15
+/*largest request, the full stat with its token and padding*/
+#define QUERY_SOCKET_BUFFER (4 << 20)
+/*receive buffer asked for, thousands of answers can arrive at once*/
+#define QUERY_INITIAL_TARGETS 64
+#define QUERY_STAT_PADDING "splitnum\0\x80\0"
+#define QUERY_STAT_PADDING_SIZE 11
+#define QUERY_PLAYER_PADDING_SIZE 10
+/*"\x01player_\0\0", comes before the player list*/
+
+enum queryState{QUERY_SKIP, QUERY_SEND_HANDSHAKE, QUERY_WAIT_TOKEN,
+                QUERY_SEND_STAT, QUERY_WAIT_STAT, QUERY_DONE
+};
+            /*SKIP targets did not resolve. SEND states are queued to be sent
+            *with the next batch, WAIT states have their request in flight
+            */
+
+
+/***************************************************************************
+* QueryClient::QueryClient(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+**************************************************************************/
+QueryClient::QueryClient(void)
+{
+        targets  = nullptr;
+        count    = 0;
+        capacity = 0;
+        packets  = nullptr;
+        queue    = nullptr;
+        queued   = 0;
+}
+
+/***************************************************************************
+* QueryClient::~QueryClient(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+QueryClient::~QueryClient(void)
+{
+        for(size_t i = 0; i < count; i++)
+                clearResult(&targets[i]);
+        free(targets);
+        free(packets);
+        free(queue);
+}
+
+/***************************************************************************
+* static uint32_t sessionOf(size_t index)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes a target index as a query session ID. The server only
+*       keeps the low 4 bits of every byte, so the index is spread over them
+*
+* Parameters:
+*        index  I/P     size_t  target index, below QUERY_MAX_TARGETS
+*        sessionOf      O/P     uint32_t        session ID
+**************************************************************************/
+static uint32_t sessionOf(size_t index)
+{
+        return (index & 0xF) | (index >> 4 & 0xF) << 8
+                | (index >> 8 & 0xF) << 16 | (uint32_t)(index >> 12 & 0xF) << 24;
+}
+
+/***************************************************************************
+* static size_t indexOf(uint32_t session)
+* Author: agent
+* Date: 10/19/2026
+* Description: Decodes the target index from a session ID
+*
+* Parameters:
+*        session        I/P     uint32_t        session ID of an answer
+*        indexOf        O/P     size_t  target index
+**************************************************************************/
+static size_t indexOf(uint32_t session)
+{
+        return (session & 0xF) | (session >> 8 & 0xF) << 4
+                | (session >> 16 & 0xF) << 8 | (session >> 24 & 0xF) << 12;
+}
+
+/***************************************************************************
+* void QueryClient::clearResult(Target* t)
+* Author: agent
+* Date: 10/19/2026
+* Description: Frees the result of a target
+*
+* Parameters:
+*        t      I/O     Target* target to clear
+**************************************************************************/
+void QueryClient::clearResult(Target* t)
+{
+        free(t->payload);
+        free(t->players);
+        t->payload       = nullptr;
+        t->payloadLength = 0;
+        t->valuesOffset  = 0;
+        t->players       = nullptr;
+        t->playerCount   = 0;
+}
+
+/***************************************************************************
+* int QueryClient::add(const char* host, uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds a target to query. The host is resolved right away, a
+*       host that does not resolve keeps its error and is skipped by run()
+*
+* Parameters:
+*        host   I/P     const char*     IP or domain of the server
+*        port   I/P     uint16_t        query port, the server's query.port
+*        add    O/P     int     handle of the target, INITIALIZATION_FAILURE
+*                               if the client is full or out of memory
+**************************************************************************/
+int QueryClient::add(const char* host, uint16_t port)
+{
+        if(count >= QUERY_MAX_TARGETS)
+                return INITIALIZATION_FAILURE;
+
+        if(count == capacity){
+                size_t grown = capacity ? capacity * 2 : QUERY_INITIAL_TARGETS;
+                Target* t = (Target*)realloc(targets, grown * sizeof(Target));
+                if(t == nullptr)
+                        return INITIALIZATION_FAILURE;
+                targets  = t;
+                capacity = grown;
+        }
+
+        Target* t = &targets[count];
+        memset(t, 0, sizeof(Target));
+        t->milliseconds = -1;
+
+        uint32_t ip;
+        t->error = Ping::resolveIPv4(host, &ip);
+        t->state = t->error == OK ? QUERY_SEND_HANDSHAKE : QUERY_SKIP;
+        if(t->error == OK)
+                t->error = CONNECT_FAILURE;
+        /*not queried yet*/
+
+        t->address.sin_family      = AF_INET;
+        t->address.sin_port        = htons(port);
+        t->address.sin_addr.s_addr = ip;
+
+        return count++;
+}
+
+/***************************************************************************
+* size_t QueryClient::sendPending(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sends the queued handshake and full stat requests, up to
+*       DATAGRAM_BATCH datagrams per system call where the platform allows it
+*
+* Parameters:
+*        fd     I/P     int     the client's UDP socket
+*        sendPending    O/P     size_t  number of targets that failed to send
+**************************************************************************/
+size_t QueryClient::sendPending(int fd)
+{
+        size_t failed = 0;
+        size_t done   = 0;
+        uint64_t now  = PollScheduler::now();
+
+        while(done < queued){
+                uint8_t requests[DATAGRAM_BATCH][QUERY_REQUEST_SIZE];
+                size_t lengths[DATAGRAM_BATCH];
+                size_t batch = 0;
+
+                for(; batch < DATAGRAM_BATCH && done + batch < queued; batch++){
+                        Target* t = &targets[queue[done + batch]];
+                        uint8_t* r = requests[batch];
+                        uint32_t session = htonl(sessionOf(queue[done + batch]));
+
+                        r[0] = QUERY_MAGIC_0;
+                        r[1] = QUERY_MAGIC_1;
+                        r[2] = t->state == QUERY_SEND_STAT ? QUERY_TYPE_STAT
+                                                        : QUERY_TYPE_HANDSHAKE;
+                        memcpy(r + 3, &session, 4);
+                        lengths[batch] = 7;
+
+                        if(t->state == QUERY_SEND_STAT){
+                                uint32_t token = htonl(t->token);
+                                memcpy(r + 7, &token, 4);
+                                memset(r + 11, 0, 4);
+                                lengths[batch] = QUERY_REQUEST_SIZE;
+                                /*the padding asks for the full stat instead
+                                *of the basic one
+                                */
+                        }
+                }
+
+                struct Datagram datagrams[DATAGRAM_BATCH];
+                for(size_t i = 0; i < batch; i++){
+                        datagrams[i].data    = requests[i];
+                        datagrams[i].length  = lengths[i];
+                        datagrams[i].address = targets[queue[done + i]].address;
+                }
+                failed += sendDatagrams(fd, datagrams, batch);
+                /*a datagram that could not go out gets another chance in the
+                *resend pass
+                */
+
+                for(size_t i = 0; i < batch; i++){
+                        Target* t = &targets[queue[done + i]];
+                        t->state  = t->state == QUERY_SEND_STAT ? QUERY_WAIT_STAT
+                                                        : QUERY_WAIT_TOKEN;
+                        if(t->state == QUERY_WAIT_TOKEN && t->sentAt == 0)
+                                t->sentAt = now;
+                        /*the handshake answer does not tell which send it
+                        *answers, the round trip counts from the first one
+                        */
+                }
+
+                done += batch;
+        }
+
+        queued = 0;
+        return failed;
+}
+
+/***************************************************************************
+* void QueryClient::requeue(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Queues the handshake or full stat request of every target
+*       still waiting for its answer once more
+*
+* Parameters:
+**************************************************************************/
+void QueryClient::requeue(void)
+{
+        for(size_t i = 0; i < count; i++){
+                Target* t = &targets[i];
+                if(t->state == QUERY_WAIT_TOKEN)
+                        t->state = QUERY_SEND_HANDSHAKE;
+                else if(t->state == QUERY_WAIT_STAT)
+                        t->state = QUERY_SEND_STAT;
+                else
+                        continue;
+                queue[queued++] = i;
+        }
+}
+
+/***************************************************************************
+* bool QueryClient::parseStat(Target* t, const uint8_t* data, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Keeps a full stat answer and indexes its player list. The
+*       answer is a list of null terminated key and value strings ended by an
+*       empty key, followed by the null terminated player names ended by an
+*       empty name
+*
+* Parameters:
+*        t      I/O     Target* target the answer belongs to
+*        data   I/P     const uint8_t*  answer without its type and session
+*        length I/P     size_t  length of the answer
+*        parseStat      O/P     bool    false if the answer is malformed
+**************************************************************************/
+bool QueryClient::parseStat(Target* t, const uint8_t* data, size_t length)
+{
+        clearResult(t);
+
+        if(length < QUERY_STAT_PADDING_SIZE
+                        || memcmp(data, QUERY_STAT_PADDING, QUERY_STAT_PADDING_SIZE))
+                return false;
+
+        t->payload = (char*)malloc(length + 2);
+        if(t->payload == nullptr)
+                return false;
+        memcpy(t->payload, data, length);
+        t->payload[length]     = '\0';
+        t->payload[length + 1] = '\0';
+        t->payloadLength = length;
+        /*two extra terminators, so a truncated answer still ends every
+        *string and the list
+        */
+
+        size_t pos = QUERY_STAT_PADDING_SIZE;
+        t->valuesOffset = pos;
+        while(pos < length && t->payload[pos] != '\0'){
+                pos += strlen(t->payload + pos) + 1;
+                pos += strlen(t->payload + pos) + 1;
+        }
+        pos++;
+        /*skip the key and value pairs and the empty key that ends them*/
+
+        if(pos + QUERY_PLAYER_PADDING_SIZE > length)
+                return true;
+        /*an answer without the player section still has its values*/
+        pos += QUERY_PLAYER_PADDING_SIZE;
+
+        uint32_t players = 0;
+        for(size_t p = pos; p < length && t->payload[p] != '\0';
+                                                p += strlen(t->payload + p) + 1)
+                players++;
+
+        if(players == 0)
+                return true;
+
+        t->players = (uint32_t*)malloc(players * sizeof(uint32_t));
+        if(t->players == nullptr)
+                return false;
+
+        for(size_t p = pos; t->playerCount < players;
+                                                p += strlen(t->payload + p) + 1)
+                t->players[t->playerCount++] = p;
+
+        return true;
+}
+
+/***************************************************************************
+* bool QueryClient::handle(const uint8_t* data, size_t length,
+*                                       const struct sockaddr_in* from)
+* Author: agent
+* Date: 10/19/2026
+* Description: Processes an answer datagram. A handshake answer queues the
+*       full stat request, a full stat answer finishes the target. Answers
+*       from the wrong address or for a finished stage are ignored
+*
+* Parameters:
+*        data   I/P     const uint8_t*  datagram
+*        length I/P     size_t  length of the datagram
+*        from   I/P     const struct sockaddr_in*       sender of the datagram
+*        now    I/P     uint64_t        current time in milliseconds
+*        handle O/P     bool    true if the answer finished its target
+**************************************************************************/
+bool QueryClient::handle(const uint8_t* data, size_t length,
+                                const struct sockaddr_in* from, uint64_t now)
+{
+        if(length < 5)
+                return false;
+
+        uint32_t session;
+        memcpy(&session, data + 1, 4);
+        size_t index = indexOf(ntohl(session));
+        if(index >= count)
+                return false;
+
+        Target* t = &targets[index];
+        if(from->sin_addr.s_addr != t->address.sin_addr.s_addr
+                                || from->sin_port != t->address.sin_port)
+                return false;
+
+        if(data[0] == QUERY_TYPE_HANDSHAKE && (t->state == QUERY_WAIT_TOKEN
+                                        || t->state == QUERY_SEND_HANDSHAKE)){
+                char token[16];
+                size_t n = length - 5 < sizeof(token) - 1 ? length - 5
+                                                        : sizeof(token) - 1;
+                memcpy(token, data + 5, n);
+                token[n] = '\0';
+                /*the challenge token is sent as a decimal string*/
+
+                t->token = (int32_t)strtol(token, nullptr, 10);
+                t->milliseconds = now - t->sentAt;
+                t->error = RECEIVE_FAILURE;
+                /*the server answered, only the full stat is missing now*/
+
+                if(t->state == QUERY_WAIT_TOKEN)
+                        queue[queued++] = index;
+                t->state = QUERY_SEND_STAT;
+                return false;
+        }
+
+        if(data[0] == QUERY_TYPE_STAT && (t->state == QUERY_WAIT_STAT
+                                        || t->state == QUERY_SEND_STAT)){
+                if(t->state == QUERY_SEND_STAT)
+                        return false;
+                /*an answer to the request from before a resend, the queued
+                *request would come back a second time
+                */
+
+                t->error = parseStat(t, data + 5, length - 5) ? OK : BAD_RESPONSE;
+                t->state = QUERY_DONE;
+                return true;
+        }
+
+        return false;
+}
+
+/***************************************************************************
+* void QueryClient::drain(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Processes every answer waiting on the socket without blocking,
+*       before the next send goes out with the full stat requests the
+*       handshakes queued
+*
+* Parameters:
+*        fd     I/P     int     the client's UDP socket
+**************************************************************************/
+void QueryClient::drain(int fd)
+{
+        uint64_t now = PollScheduler::now();
+        size_t received;
+
+        do{
+                struct Datagram datagrams[DATAGRAM_BATCH];
+                for(int i = 0; i < DATAGRAM_BATCH; i++){
+                        datagrams[i].data   = packets + i * QUERY_PACKET_SIZE;
+                        datagrams[i].length = QUERY_PACKET_SIZE;
+                }
+                received = receiveDatagrams(fd, datagrams, DATAGRAM_BATCH);
+
+                for(size_t i = 0; i < received; i++){
+                        if(handle(datagrams[i].data, datagrams[i].length,
+                                                &datagrams[i].address, now))
+                                pending--;
+                }
+        }while(received == DATAGRAM_BATCH);
+}
+
+/***************************************************************************
+* int QueryClient::run(uint32_t timeoutMs)
+* Author: agent
+* Date: 10/19/2026
+* Description: Queries every target through one UDP socket and waits for the
+*       answers. Requests still unanswered halfway through the timeout are
+*       sent once more. Previous results are replaced
+*
+* Parameters:
+*        timeoutMs      I/P     uint32_t        time to wait for all answers
+*        run    O/P     int     number of targets that answered, or a negative
+*                               pingError if the socket could not be set up
+**************************************************************************/
+int QueryClient::run(uint32_t timeoutMs)
+{
+        if(packets == nullptr)
+                packets = (uint8_t*)malloc(DATAGRAM_BATCH * QUERY_PACKET_SIZE);
+        free(queue);
+        queue = (uint32_t*)malloc((count ? count : 1) * sizeof(uint32_t));
+        if(packets == nullptr || queue == nullptr)
+                return INITIALIZATION_FAILURE;
+        queued  = 0;
+        pending = 0;
+
+        for(size_t i = 0; i < count; i++){
+                Target* t = &targets[i];
+                if(t->state == QUERY_SKIP)
+                        continue;
+
+                clearResult(t);
+                t->state        = QUERY_SEND_HANDSHAKE;
+                t->error        = CONNECT_FAILURE;
+                t->milliseconds = -1;
+                t->sentAt       = 0;
+                queue[queued++] = i;
+                pending++;
+        }
+
+        int ret = exchange(timeoutMs, QUERY_SOCKET_BUFFER);
+
+        int answered = 0;
+        for(size_t i = 0; i < count; i++){
+                if(targets[i].error == OK)
+                        answered++;
+                if(targets[i].state != QUERY_SKIP)
+                        targets[i].state = QUERY_DONE;
+        }
+
+        return ret == OK ? answered : ret;
+}
+
+/***************************************************************************
+* size_t QueryClient::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of targets
+*
+* Parameters:
+*        size   O/P     size_t  number of targets
+**************************************************************************/
+size_t QueryClient::size(void)
+{
+        return count;
+}
+
+/***************************************************************************
+* pingError QueryClient::getError(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the error code of a target's last query. OK if the
+*       full stat arrived, CONNECT_FAILURE if the server never answered,
+*       RECEIVE_FAILURE if only the handshake was answered, BAD_RESPONSE for
+*       a malformed answer and the resolver's error for hosts that did not
+*       resolve
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        getError       O/P     pingError       error code
+**************************************************************************/
+pingError QueryClient::getError(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count)
+                return INITIALIZATION_FAILURE;
+
+        return targets[handle].error;
+}
+
+/***************************************************************************
+* long QueryClient::getPing(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the round trip of the target's handshake
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        getPing        O/P     long    latency in milliseconds, -1 if the
+*                                       handshake was not answered
+**************************************************************************/
+long QueryClient::getPing(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count)
+                return -1;
+
+        return targets[handle].milliseconds;
+}
+
+/***************************************************************************
+* const char* QueryClient::getValue(int handle, const char* key)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns a value of the target's full stat, such as hostname,
+*       version, plugins, map, numplayers or maxplayers. Valid until the next
+*       run() or until the client is destroyed
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        key    I/P     const char*     key of the value
+*        getValue       O/P     const char*     the value, nullptr if the key
+*                                               is missing
+**************************************************************************/
+const char* QueryClient::getValue(int handle, const char* key)
+{
+        if(handle < 0 || (size_t)handle >= count
+                                        || targets[handle].payload == nullptr)
+                return nullptr;
+
+        const Target* t = &targets[handle];
+        size_t pos = t->valuesOffset;
+        while(pos < t->payloadLength && t->payload[pos] != '\0'){
+                const char* k = t->payload + pos;
+                pos += strlen(k) + 1;
+                const char* v = t->payload + pos;
+                pos += strlen(v) + 1;
+
+                if(!strcmp(k, key))
+                        return v;
+        }
+
+        return nullptr;
+}
+
+/***************************************************************************
+* size_t QueryClient::getPlayerCount(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of players in the target's player list
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        getPlayerCount O/P     size_t  number of players listed
+**************************************************************************/
+size_t QueryClient::getPlayerCount(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count)
+                return 0;
+
+        return targets[handle].playerCount;
+}
+
+/***************************************************************************
+* const char* QueryClient::getPlayer(int handle, size_t index)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns a name of the target's player list. Valid until the
+*       next run() or until the client is destroyed
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        index  I/P     size_t  index of the player
+*        getPlayer      O/P     const char*     player name, nullptr if the
+*                                               index is out of range
+**************************************************************************/
+const char* QueryClient::getPlayer(int handle, size_t index)
+{
+        if(handle < 0 || (size_t)handle >= count
+                                || index >= targets[handle].playerCount)
+                return nullptr;
+
+        return targets[handle].payload + targets[handle].players[index];
+}
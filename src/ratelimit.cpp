@@ -0,0 +1,484 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  ratelimit.cpp
+* Author:  agent
+* Procedures:
+* RateLimiter(X)        -Constructor
+* ~RateLimiter()        -Destructor
+* setPolicy     -Sets the rates, bursts and concurrency cap
+* tryAcquire    -Takes the tokens for a probe if they are available
+* acquire       -Waits until a probe is allowed and takes its tokens
+* release       -Marks a probe to an IP as finished
+* now           -Returns a monotonic timestamp in microseconds
+* refill        -Adds the tokens a bucket earned since it was last used
+* find          -Finds or creates the bucket of a destination
+* grow          -Grows a bucket table, dropping idle buckets
+* tryAcquireLocked      -tryAcquire with the lock already held
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+#include <chrono>
+
+
+#define EMPTY_BUCKET 0
+#define USED_BUCKET 1
+
+struct RateLimiter::Bucket{
+        uint32_t key;
+        /*IP or subnet in host byte order*/
+        uint32_t active;
+        /*probes in flight to the IP, unused for subnets*/
+        double tokens;
+        /*tokens left in the bucket*/
+        uint64_t last;
+        /*time the tokens were last refilled, in microseconds*/
+        uint8_t used;
+        /*USED_BUCKET if the slot holds a destination*/
+};
+
+
+/***************************************************************************
+* static void refill(double* tokens, uint64_t* last, double rate,
+*                                       double burst, uint64_t now)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds the tokens a bucket earned since it was last refilled,
+*       never holding more than the burst
+*
+* Parameters:
+*        tokens I/O     double* tokens in the bucket
+*        last   I/O     uint64_t*       time of the last refill
+*        rate   I/P     double  tokens earned per second
+*        burst  I/P     double  maximum tokens
+*        now    I/P     uint64_t        current time in microseconds
+**************************************************************************/
+static void refill(double* tokens, uint64_t* last, double rate, double burst,
+                                                                uint64_t now)
+{
+        if(now > *last){
+                *tokens += (now - *last) * rate / 1000000.0;
+                if(*tokens > burst)
+                        *tokens = burst;
+        }
+        *last = now;
+}
+
+/***************************************************************************
+* static uint64_t waitFor(double tokens, double rate)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns how long a bucket takes to earn a whole token
+*
+* Parameters:
+*        tokens I/P     double  tokens in the bucket
+*        rate   I/P     double  tokens earned per second
+*        waitFor        O/P     uint64_t        wait in microseconds
+**************************************************************************/
+static uint64_t waitFor(double tokens, double rate)
+{
+        return (uint64_t)((1.0 - tokens) * 1000000.0 / rate) + 1;
+}
+
+/***************************************************************************
+* static double burstOf(uint32_t burst, double rate)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the size of a bucket. An unset burst allows one
+*       second worth of connections, and at least one
+*
+* Parameters:
+*        burst  I/P     uint32_t        configured burst
+*        rate   I/P     double  configured rate
+*        burstOf        O/P     double  bucket size
+**************************************************************************/
+static double burstOf(uint32_t burst, double rate)
+{
+        double size = burst ? burst : rate;
+
+        return size < 1.0 ? 1.0 : size;
+}
+
+
+/***************************************************************************
+* RateLimiter::RateLimiter(const RateLimitPolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+*        p      I/P     const RateLimitPolicy*  rates and caps to enforce
+**************************************************************************/
+RateLimiter::RateLimiter(const RateLimitPolicy* p)
+{
+        ips.slots     = nullptr;
+        ips.mask      = 0;
+        ips.count     = 0;
+        subnets.slots = nullptr;
+        subnets.mask  = 0;
+        subnets.count = 0;
+
+        setPolicy(p);
+}
+
+/***************************************************************************
+* RateLimiter::~RateLimiter()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+RateLimiter::~RateLimiter()
+{
+        free(ips.slots);
+        free(subnets.slots);
+}
+
+/***************************************************************************
+* void RateLimiter::setPolicy(const RateLimitPolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the rates, bursts and concurrency cap. The global bucket
+*       starts full again
+*
+* Parameters:
+*        p      I/P     const RateLimitPolicy*  rates and caps to enforce
+**************************************************************************/
+void RateLimiter::setPolicy(const RateLimitPolicy* p)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        policy = *p;
+        if(policy.subnetPrefix == 0 || policy.subnetPrefix > 32)
+                policy.subnetPrefix = 24;
+
+        subnetMask   = 0xFFFFFFFFu << (32 - policy.subnetPrefix);
+        globalTokens = burstOf(policy.globalBurst, policy.globalRate);
+        globalLast   = now();
+
+        released.notify_all();
+        /*waiters re-check against the new policy*/
+}
+
+/***************************************************************************
+* uint64_t RateLimiter::now(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns a monotonic timestamp in microseconds
+*
+* Parameters:
+*        now    O/P     uint64_t        microseconds since an arbitrary point
+**************************************************************************/
+uint64_t RateLimiter::now(void)
+{
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/***************************************************************************
+* bool RateLimiter::grow(BucketTable* table, double burst, double rate,
+*                                                       uint64_t now)
+* Author: agent
+* Date: 10/19/2026
+* Description: Rebuilds a bucket table with room for more destinations.
+*       Buckets that are full again and have nothing in flight carry no
+*       state and are dropped instead of copied
+*
+* Parameters:
+*        table  I/O     BucketTable*    table to grow
+*        burst  I/P     double  bucket size of the table
+*        rate   I/P     double  refill rate of the table
+*        now    I/P     uint64_t        current time in microseconds
+*        grow   O/P     bool    false if out of memory
+**************************************************************************/
+bool RateLimiter::grow(BucketTable* table, double burst, double rate,
+                                                                uint64_t now)
+{
+        size_t live = 0;
+
+        for(size_t i = 0; table->slots && i <= table->mask; i++){
+                Bucket* b = &table->slots[i];
+                if(b->used != USED_BUCKET)
+                        continue;
+
+                refill(&b->tokens, &b->last, rate, burst, now);
+                if(b->active == 0 && b->tokens >= burst)
+                        b->used = EMPTY_BUCKET;
+                else
+                        live++;
+        }
+
+        size_t size = 64;
+        while(size < live * 4)
+                size *= 2;
+        /*keep the table at most half full after the next doubling of live
+        *destinations
+        */
+
+        Bucket* slots = (Bucket*)calloc(size, sizeof(Bucket));
+        if(slots == nullptr)
+                return false;
+
+        for(size_t i = 0; table->slots && i <= table->mask; i++){
+                Bucket* b = &table->slots[i];
+                if(b->used != USED_BUCKET)
+                        continue;
+
+                size_t j = mc_hash64(&b->key, sizeof(b->key), 0) & (size - 1);
+                while(slots[j].used == USED_BUCKET)
+                        j = (j + 1) & (size - 1);
+                slots[j] = *b;
+        }
+
+        free(table->slots);
+        table->slots = slots;
+        table->mask  = size - 1;
+        table->count = live;
+
+        return true;
+}
+
+/***************************************************************************
+* RateLimiter::Bucket* RateLimiter::find(BucketTable* table, uint32_t key,
+*                                               double burst, uint64_t now)
+* Author: agent
+* Date: 10/19/2026
+* Description: Finds the bucket of a destination, creating a full one if the
+*       destination has not been seen
+*
+* Parameters:
+*        table  I/O     BucketTable*    table to search
+*        key    I/P     uint32_t        IP or subnet
+*        burst  I/P     double  bucket size of the table
+*        now    I/P     uint64_t        current time in microseconds
+*        find   O/P     Bucket* the bucket, nullptr if out of memory
+**************************************************************************/
+RateLimiter::Bucket* RateLimiter::find(BucketTable* table, uint32_t key,
+                                                double burst, uint64_t now)
+{
+        if(table->slots != nullptr){
+                size_t i = mc_hash64(&key, sizeof(key), 0) & table->mask;
+
+                while(table->slots[i].used == USED_BUCKET){
+                        if(table->slots[i].key == key)
+                                return &table->slots[i];
+                        i = (i + 1) & table->mask;
+                }
+        }
+
+        if(table->slots == nullptr || (table->count + 1) * 2 > table->mask + 1){
+                double rate = table == &ips ? policy.ipRate : policy.subnetRate;
+                if(!grow(table, burst, rate, now))
+                        return nullptr;
+        }
+        /*the table is kept at most half full so probe chains stay short*/
+
+        size_t i = mc_hash64(&key, sizeof(key), 0) & table->mask;
+        while(table->slots[i].used == USED_BUCKET)
+                i = (i + 1) & table->mask;
+
+        Bucket* b = &table->slots[i];
+        b->key    = key;
+        b->active = 0;
+        b->tokens = burst;
+        b->last   = now;
+        b->used   = USED_BUCKET;
+        table->count++;
+
+        return b;
+}
+
+/***************************************************************************
+* bool RateLimiter::tryAcquireLocked(uint32_t ipv4, uint64_t now,
+*                                                       uint64_t* wait)
+* Author: agent
+* Date: 10/19/2026
+* Description: Takes a token from every bucket the probe passes through, or
+*       none of them if any bucket is empty
+*
+* Parameters:
+*        ipv4   I/P     uint32_t        destination in network byte order
+*        now    I/P     uint64_t        current time in microseconds
+*        wait   I/O     uint64_t*       microseconds until the probe could be
+*                                       allowed, 0 if only a release can
+*                                       allow it
+*        tryAcquireLocked       O/P     bool    true if the probe may connect
+**************************************************************************/
+bool RateLimiter::tryAcquireLocked(uint32_t ipv4, uint64_t now, uint64_t* wait)
+{
+        bool allowed = true;
+        *wait = 0;
+
+        uint32_t ip = ntohl(ipv4);
+        Bucket* ipBucket     = nullptr;
+        Bucket* subnetBucket = nullptr;
+
+        if(policy.globalRate > 0){
+                refill(&globalTokens, &globalLast, policy.globalRate,
+                        burstOf(policy.globalBurst, policy.globalRate), now);
+                if(globalTokens < 1.0){
+                        allowed = false;
+                        *wait   = waitFor(globalTokens, policy.globalRate);
+                }
+        }
+
+        if(policy.ipRate > 0 || policy.maxPerIP > 0){
+                double burst = burstOf(policy.ipBurst, policy.ipRate);
+                ipBucket = find(&ips, ip, burst, now);
+
+                if(ipBucket != nullptr){
+                        if(policy.maxPerIP > 0
+                                        && ipBucket->active >= policy.maxPerIP){
+                                allowed = false;
+                                /*only a release of this IP can help*/
+                        }
+                        if(policy.ipRate > 0){
+                                refill(&ipBucket->tokens, &ipBucket->last,
+                                        policy.ipRate, burst, now);
+                                if(ipBucket->tokens < 1.0){
+                                        uint64_t w = waitFor(ipBucket->tokens,
+                                                                policy.ipRate);
+                                        if(w > *wait)
+                                                *wait = w;
+                                        allowed = false;
+                                }
+                        }
+                }
+        }
+
+        if(policy.subnetRate > 0){
+                double burst = burstOf(policy.subnetBurst, policy.subnetRate);
+                subnetBucket = find(&subnets, ip & subnetMask, burst, now);
+
+                if(subnetBucket != nullptr){
+                        refill(&subnetBucket->tokens, &subnetBucket->last,
+                                policy.subnetRate, burst, now);
+                        if(subnetBucket->tokens < 1.0){
+                                uint64_t w = waitFor(subnetBucket->tokens,
+                                                        policy.subnetRate);
+                                if(w > *wait)
+                                        *wait = w;
+                                allowed = false;
+                        }
+                }
+        }
+        /*a table that could not grow does not limit, dropping probes because
+        *of a failed allocation would be worse
+        */
+
+        if(!allowed)
+                return false;
+
+        if(policy.globalRate > 0)
+                globalTokens -= 1.0;
+        if(ipBucket != nullptr){
+                if(policy.ipRate > 0)
+                        ipBucket->tokens -= 1.0;
+                ipBucket->active++;
+        }
+        if(subnetBucket != nullptr)
+                subnetBucket->tokens -= 1.0;
+
+        return true;
+}
+
+/***************************************************************************
+* bool RateLimiter::tryAcquire(uint32_t ipv4, uint64_t* wait)
+* Author: agent
+* Date: 10/19/2026
+* Description: Takes the tokens for a probe to an IP if every limit allows
+*       it, without blocking. A successful call must be paired with release()
+*
+* Parameters:
+*        ipv4   I/P     uint32_t        destination in network byte order
+*        wait   I/O     uint64_t*       microseconds until the probe could be
+*                                       allowed, 0 if only a release can
+*                                       allow it. May be nullptr
+*        tryAcquire     O/P     bool    true if the probe may connect
+**************************************************************************/
+bool RateLimiter::tryAcquire(uint32_t ipv4, uint64_t* wait)
+{
+        uint64_t w;
+        std::lock_guard<std::mutex> guard(lock);
+
+        bool allowed = tryAcquireLocked(ipv4, now(), &w);
+        if(wait != nullptr)
+                *wait = w;
+
+        return allowed;
+}
+
+/***************************************************************************
+* void RateLimiter::acquire(uint32_t ipv4)
+* Author: agent
+* Date: 10/19/2026
+* Description: Waits until every limit allows a probe to an IP and takes its
+*       tokens. Must be paired with release()
+*
+* Parameters:
+*        ipv4   I/P     uint32_t        destination in network byte order
+**************************************************************************/
+void RateLimiter::acquire(uint32_t ipv4)
+{
+        std::unique_lock<std::mutex> guard(lock);
+        uint64_t wait;
+
+        while(!tryAcquireLocked(ipv4, now(), &wait)){
+                if(wait == 0)
+                        released.wait(guard);
+                else
+                        released.wait_for(guard, std::chrono::microseconds(wait));
+        }
+}
+
+/***************************************************************************
+* void RateLimiter::release(uint32_t ipv4)
+* Author: agent
+* Date: 10/19/2026
+* Description: Marks a probe to an IP as finished, letting the next probe
+*       waiting on the concurrency cap through
+*
+* Parameters:
+*        ipv4   I/P     uint32_t        destination in network byte order
+**************************************************************************/
+void RateLimiter::release(uint32_t ipv4)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(ips.slots == nullptr)
+                return;
+
+        uint32_t ip = ntohl(ipv4);
+        size_t i = mc_hash64(&ip, sizeof(ip), 0) & ips.mask;
+
+        while(ips.slots[i].used == USED_BUCKET){
+                if(ips.slots[i].key == ip){
+                        if(ips.slots[i].active > 0)
+                                ips.slots[i].active--;
+                        if(policy.maxPerIP > 0)
+                                released.notify_all();
+                        return;
+                }
+                i = (i + 1) & ips.mask;
+        }
+}
@@ -0,0 +1,730 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+/***************************************************************************
+* File:  scheduler.cpp
+* Author:  agent
+* Procedures:
+* PollScheduler()       -Default constructor
+* ~PollScheduler()      -Destructor
+* setPolicy     -Sets the intervals, jitter and tier deadlines
+* getPolicy     -Returns the current policy
+* add           -Schedules a Ping object in a priority tier
+* remove        -Stops scheduling a target
+* next          -Takes the targets that are due to be polled
+* report        -Reports the result of a poll and reschedules the target
+* run           -Polls every due target, up to a budget
+* nextDue       -Returns the time the next poll is due
+* getPing       -Returns the Ping object of a target
+* getInterval   -Returns the current poll interval of a target
+* getState      -Copies the interval and failures of a target out
+* restore       -Restores the interval and failures of a target
+* now           -Returns a monotonic timestamp in milliseconds
+* push          -Inserts an entry into its tier's heap
+* pop           -Removes an entry from a tier's heap
+* siftUp        -Restores the heap order towards the root
+* siftDown      -Restores the heap order towards the leaves
+* jitter        -Randomly moves an interval by the jitter percentage
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif // _WIN32
+
+
+#define NOT_QUEUED 0xFFFFFFFFu
+/*heap position of an entry that is being polled or was removed*/
+#define NO_ENTRY 0xFFFFFFFFu
+/*end of the free list*/
+
+struct PollScheduler::Entry{
+        Ping* ping;
+        /*target being polled, nullptr if the entry was removed*/
+        uint64_t due;
+        /*time the next poll is due*/
+        uint64_t lastHash;
+        /*hash of the last response, 0 if none was read yet*/
+        uint32_t interval;
+        /*current interval before jitter*/
+        uint32_t failures;
+        /*consecutive polls that did not reach the server*/
+        uint32_t heapPosition;
+        /*position in the tier's heap, the next free entry once removed*/
+        uint8_t tier;
+        /*priority tier, 0 is served first*/
+        uint8_t inFlight;
+        /*handed out by next() and not reported yet*/
+};
+
+static const SchedulerPolicy defaultPolicy = {
+        60000,          /*baseInterval: 1 minute*/
+        15000,          /*minInterval: 15 seconds*/
+        600000,         /*maxInterval: 10 minutes*/
+        120000,         /*deadInterval: 2 minutes*/
+        3600000,        /*deadMaxInterval: 1 hour*/
+        10,             /*jitterPercent*/
+        {1000, 5000, 30000, 120000}     /*tierDeadline*/
+};
+
+
+/***************************************************************************
+* PollScheduler::PollScheduler()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor
+*
+* Parameters:
+**************************************************************************/
+PollScheduler::PollScheduler()
+{
+        entries  = nullptr;
+        count    = 0;
+        capacity = 0;
+        freeHead = NO_ENTRY;
+
+        for(unsigned i = 0; i < SCHEDULER_TIERS; i++){
+                heaps[i]        = nullptr;
+                heapSize[i]     = 0;
+                heapCapacity[i] = 0;
+        }
+
+        policy = defaultPolicy;
+        random = now() | 1;
+        /*seed the jitter generator, xorshift state can not be 0*/
+}
+
+/***************************************************************************
+* PollScheduler::~PollScheduler()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor. The Ping objects are not owned by the scheduler
+*
+* Parameters:
+**************************************************************************/
+PollScheduler::~PollScheduler()
+{
+        free(entries);
+        for(unsigned i = 0; i < SCHEDULER_TIERS; i++)
+                free(heaps[i]);
+}
+
+/***************************************************************************
+* void PollScheduler::setPolicy(const SchedulerPolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the intervals, jitter and tier deadlines. Targets pick up
+*       the new intervals at their next report
+*
+* Parameters:
+*        p      I/P     const SchedulerPolicy*  new policy
+**************************************************************************/
+void PollScheduler::setPolicy(const SchedulerPolicy* p)
+{
+        policy = *p;
+
+        if(policy.minInterval == 0)
+                policy.minInterval = 1;
+        if(policy.maxInterval < policy.minInterval)
+                policy.maxInterval = policy.minInterval;
+        if(policy.deadMaxInterval < policy.deadInterval)
+                policy.deadMaxInterval = policy.deadInterval;
+        if(policy.jitterPercent > 100)
+                policy.jitterPercent = 100;
+}
+
+/***************************************************************************
+* void PollScheduler::getPolicy(SchedulerPolicy* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the current policy
+*
+* Parameters:
+*        p      I/O     SchedulerPolicy*        policy to fill
+**************************************************************************/
+void PollScheduler::getPolicy(SchedulerPolicy* p)
+{
+        *p = policy;
+}
+
+/***************************************************************************
+* uint64_t PollScheduler::now(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns a monotonic timestamp in milliseconds, the time base
+*       every scheduler call uses
+*
+* Parameters:
+*        now    O/P     uint64_t        milliseconds since an arbitrary point
+**************************************************************************/
+uint64_t PollScheduler::now(void)
+{
+#ifdef _WIN32
+        return GetTickCount64();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif // _WIN32
+}
+
+/***************************************************************************
+* uint32_t PollScheduler::jitter(uint32_t interval)
+* Author: agent
+* Date: 10/19/2026
+* Description: Randomly moves an interval by up to the jitter percentage in
+*       either direction
+*
+* Parameters:
+*        interval       I/P     uint32_t        interval to jitter
+*        jitter O/P     uint32_t        jittered interval
+**************************************************************************/
+uint32_t PollScheduler::jitter(uint32_t interval)
+{
+        uint64_t spread = (uint64_t)interval * policy.jitterPercent / 100;
+        if(spread == 0)
+                return interval;
+
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        /*xorshift64, plenty for spreading polls*/
+
+        uint64_t offset = random % (2 * spread + 1);
+
+        return interval - spread + offset;
+}
+
+/***************************************************************************
+* void PollScheduler::siftUp(unsigned tier, size_t position)
+* Author: agent
+* Date: 10/19/2026
+* Description: Moves a heap entry towards the root until the heap is ordered
+*
+* Parameters:
+*        tier   I/P     unsigned        heap to fix
+*        position       I/P     size_t  position of the entry to move
+**************************************************************************/
+void PollScheduler::siftUp(unsigned tier, size_t position)
+{
+        uint32_t* heap = heaps[tier];
+        uint32_t index = heap[position];
+
+        while(position > 0){
+                size_t parent = (position - 1) / 2;
+                if(entries[heap[parent]].due <= entries[index].due)
+                        break;
+
+                heap[position] = heap[parent];
+                entries[heap[position]].heapPosition = position;
+                position = parent;
+        }
+
+        heap[position] = index;
+        entries[index].heapPosition = position;
+}
+
+/***************************************************************************
+* void PollScheduler::siftDown(unsigned tier, size_t position)
+* Author: agent
+* Date: 10/19/2026
+* Description: Moves a heap entry towards the leaves until the heap is ordered
+*
+* Parameters:
+*        tier   I/P     unsigned        heap to fix
+*        position       I/P     size_t  position of the entry to move
+**************************************************************************/
+void PollScheduler::siftDown(unsigned tier, size_t position)
+{
+        uint32_t* heap = heaps[tier];
+        size_t size    = heapSize[tier];
+        uint32_t index = heap[position];
+
+        for(;;){
+                size_t child = position * 2 + 1;
+                if(child >= size)
+                        break;
+                if(child + 1 < size
+                        && entries[heap[child+1]].due < entries[heap[child]].due)
+                        child++;
+                if(entries[index].due <= entries[heap[child]].due)
+                        break;
+
+                heap[position] = heap[child];
+                entries[heap[position]].heapPosition = position;
+                position = child;
+        }
+
+        heap[position] = index;
+        entries[index].heapPosition = position;
+}
+
+/***************************************************************************
+* bool PollScheduler::push(uint32_t index)
+* Author: agent
+* Date: 10/19/2026
+* Description: Inserts an entry into the heap of its tier
+*
+* Parameters:
+*        index  I/P     uint32_t        entry to insert
+*        push   O/P     bool    false if out of memory
+**************************************************************************/
+bool PollScheduler::push(uint32_t index)
+{
+        unsigned tier = entries[index].tier;
+
+        if(heapSize[tier] == heapCapacity[tier]){
+                size_t newCapacity = heapCapacity[tier] ? heapCapacity[tier] * 2 : 64;
+                uint32_t* tmp = (uint32_t*)realloc(heaps[tier],
+                                        newCapacity * sizeof(uint32_t));
+                if(tmp == nullptr)
+                        return false;
+
+                heaps[tier]        = tmp;
+                heapCapacity[tier] = newCapacity;
+        }
+
+        heaps[tier][heapSize[tier]] = index;
+        siftUp(tier, heapSize[tier]++);
+
+        return true;
+}
+
+/***************************************************************************
+* void PollScheduler::pop(unsigned tier, size_t position)
+* Author: agent
+* Date: 10/19/2026
+* Description: Removes the entry at a position from a tier's heap
+*
+* Parameters:
+*        tier   I/P     unsigned        heap to remove from
+*        position       I/P     size_t  position of the entry
+**************************************************************************/
+void PollScheduler::pop(unsigned tier, size_t position)
+{
+        uint32_t* heap = heaps[tier];
+
+        entries[heap[position]].heapPosition = NOT_QUEUED;
+
+        if(--heapSize[tier] == position)
+                return;
+        /*the last entry needs no re-ordering*/
+
+        heap[position] = heap[heapSize[tier]];
+        siftDown(tier, position);
+        siftUp(tier, entries[heap[position]].heapPosition);
+        /*the moved entry can belong either above or below its new spot*/
+}
+
+/***************************************************************************
+* int PollScheduler::add(Ping* p, unsigned tier, uint64_t now)
+* Author: agent
+* Date: 10/19/2026
+* Description: Schedules a Ping object. Its first poll is spread over one
+*       base interval so adding many targets at once does not create a burst
+*
+* Parameters:
+*        p      I/P     Ping*   target to poll, not owned by the scheduler
+*        tier   I/P     unsigned        priority tier, 0 is the highest
+*        now    I/P     uint64_t        current time from now()
+*        add    O/P     int     handle of the target, negative on failure
+**************************************************************************/
+int PollScheduler::add(Ping* p, unsigned tier, uint64_t now)
+{
+        if(p == nullptr || tier >= SCHEDULER_TIERS)
+                return INITIALIZATION_FAILURE;
+
+        uint32_t index;
+
+        if(freeHead != NO_ENTRY){
+                index    = freeHead;
+                freeHead = entries[index].heapPosition;
+        }
+        else{
+                if(count == capacity){
+                        size_t newCapacity = capacity ? capacity * 2 : 64;
+                        if(newCapacity >= NO_ENTRY)
+                                return INITIALIZATION_FAILURE;
+
+                        Entry* tmp = (Entry*)realloc(entries,
+                                                newCapacity * sizeof(Entry));
+                        if(tmp == nullptr)
+                                return INITIALIZATION_FAILURE;
+
+                        entries  = tmp;
+                        capacity = newCapacity;
+                }
+                index = count++;
+        }
+
+        Entry* e        = &entries[index];
+        e->ping         = p;
+        e->lastHash     = 0;
+        e->interval     = policy.baseInterval;
+        e->failures     = 0;
+        e->tier         = tier;
+        e->inFlight     = 0;
+        e->heapPosition = NOT_QUEUED;
+
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        e->due = now + (policy.baseInterval ? random % policy.baseInterval : 0);
+
+        if(!push(index)){
+                e->ping         = nullptr;
+                e->heapPosition = freeHead;
+                freeHead        = index;
+                return INITIALIZATION_FAILURE;
+        }
+
+        return index;
+}
+
+/***************************************************************************
+* bool PollScheduler::remove(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Stops scheduling a target. A target that is being polled is
+*       dropped when its result is reported
+*
+* Parameters:
+*        handle I/P     int     handle returned by add()
+*        remove O/P     bool    false if the handle is not valid
+**************************************************************************/
+bool PollScheduler::remove(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count || entries[handle].ping == nullptr)
+                return false;
+
+        Entry* e = &entries[handle];
+
+        if(e->heapPosition != NOT_QUEUED)
+                pop(e->tier, e->heapPosition);
+
+        e->ping = nullptr;
+        if(!e->inFlight){
+                e->heapPosition = freeHead;
+                freeHead        = handle;
+        }
+        /*in flight entries go on the free list once they are reported*/
+
+        return true;
+}
+
+/***************************************************************************
+* size_t PollScheduler::next(uint64_t now, int* handles, size_t max)
+* Author: agent
+* Date: 10/19/2026
+* Description: Takes up to max targets that are due. Polls that are past
+*       their tier deadline go first in tier order, then due polls in tier
+*       order. The targets are not rescheduled until report() is called
+*
+* Parameters:
+*        now    I/P     uint64_t        current time from now()
+*        handles        I/O     int*    handles of the targets to poll
+*        max    I/P     size_t  size of the handles array
+*        next   O/P     size_t  number of handles filled
+**************************************************************************/
+size_t PollScheduler::next(uint64_t now, int* handles, size_t max)
+{
+        size_t n = 0;
+
+        for(unsigned tier = 0; tier < SCHEDULER_TIERS && n < max; tier++){
+                while(n < max && heapSize[tier] > 0){
+                        Entry* e = &entries[heaps[tier][0]];
+                        if(e->due + policy.tierDeadline[tier] > now)
+                                break;
+
+                        e->inFlight = 1;
+                        handles[n++] = heaps[tier][0];
+                        pop(tier, 0);
+                }
+        }
+        /*overdue polls of any tier beat every poll that is merely due*/
+
+        for(unsigned tier = 0; tier < SCHEDULER_TIERS && n < max; tier++){
+                while(n < max && heapSize[tier] > 0){
+                        Entry* e = &entries[heaps[tier][0]];
+                        if(e->due > now)
+                                break;
+
+                        e->inFlight = 1;
+                        handles[n++] = heaps[tier][0];
+                        pop(tier, 0);
+                }
+        }
+
+        return n;
+}
+
+/***************************************************************************
+* void PollScheduler::report(int handle, int result, uint64_t now)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reports the result of a poll and reschedules the target.
+*       Results that did not reach the server back off from the dead
+*       interval. Responses that hash the same as the previous one, or
+*       UNCHANGED results, back off towards the max interval and changed
+*       responses tighten towards the min interval. The hash is the one the
+*       Ping takes of every response, so this works without change detection
+*
+* Parameters:
+*        handle I/P     int     handle of the polled target
+*        result I/P     int     return value of connectMC()
+*        now    I/P     uint64_t        current time from now()
+**************************************************************************/
+void PollScheduler::report(int handle, int result, uint64_t now)
+{
+        if(handle < 0 || (size_t)handle >= count || !entries[handle].inFlight)
+                return;
+
+        Entry* e = &entries[handle];
+        e->inFlight = 0;
+
+        if(e->ping == nullptr){
+                e->heapPosition = freeHead;
+                freeHead        = handle;
+                return;
+        }
+        /*the target was removed while it was being polled*/
+
+        uint64_t interval;
+
+        if(result == OK || result == REDIRECTED || result == UNCHANGED){
+                uint64_t hash = e->ping->getResponseHash();
+                bool same = result == UNCHANGED
+                                || (hash != 0 && hash == e->lastHash);
+
+                if(e->failures > 0){
+                        interval = policy.baseInterval;
+                        /*the target came back, start over*/
+                }
+                else if(same){
+                        interval = (uint64_t)e->interval * 3 / 2;
+                        /*static target, slowly back off*/
+                }
+                else if(hash == 0 || e->lastHash == 0){
+                        interval = e->interval;
+                        /*no response to compare with, keep the pace*/
+                }
+                else{
+                        interval = e->interval / 2;
+                        /*volatile target, poll it faster*/
+                }
+
+                if(hash != 0)
+                        e->lastHash = hash;
+
+                if(interval < policy.minInterval)
+                        interval = policy.minInterval;
+                if(interval > policy.maxInterval)
+                        interval = policy.maxInterval;
+
+                e->failures = 0;
+        }
+        else{
+                if(e->failures < 31)
+                        e->failures++;
+
+                interval = (uint64_t)policy.deadInterval << (e->failures - 1);
+                if(interval > policy.deadMaxInterval)
+                        interval = policy.deadMaxInterval;
+                /*the server did not answer, back off exponentially*/
+        }
+
+        e->interval = interval;
+        e->due      = now + jitter(interval);
+
+        if(!push(handle)){
+                e->ping         = nullptr;
+                e->heapPosition = freeHead;
+                freeHead        = handle;
+        }
+        /*out of memory, the target can not be rescheduled*/
+}
+
+/***************************************************************************
+* size_t PollScheduler::run(uint64_t now, size_t budget)
+* Author: agent
+* Date: 10/19/2026
+* Description: Polls up to budget due targets with connectMC() and reports
+*       their results
+*
+* Parameters:
+*        now    I/P     uint64_t        current time from now()
+*        budget I/P     size_t  maximum number of polls
+*        run    O/P     size_t  number of targets polled
+**************************************************************************/
+size_t PollScheduler::run(uint64_t now, size_t budget)
+{
+        int handles[64];
+        size_t total = 0;
+
+        while(total < budget){
+                size_t want = budget - total;
+                if(want > sizeof(handles)/sizeof(handles[0]))
+                        want = sizeof(handles)/sizeof(handles[0]);
+
+                size_t n = next(now, handles, want);
+                if(n == 0)
+                        break;
+
+                for(size_t i = 0; i < n; i++){
+                        int result = entries[handles[i]].ping->connectMC();
+                        report(handles[i], result, PollScheduler::now());
+                }
+                total += n;
+        }
+
+        return total;
+}
+
+/***************************************************************************
+* uint64_t PollScheduler::nextDue(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the time the earliest poll is due, so the caller knows
+*       how long it can sleep
+*
+* Parameters:
+*        nextDue        O/P     uint64_t        due time, UINT64_MAX if nothing
+*                                               is scheduled
+**************************************************************************/
+uint64_t PollScheduler::nextDue(void)
+{
+        uint64_t due = UINT64_MAX;
+
+        for(unsigned tier = 0; tier < SCHEDULER_TIERS; tier++){
+                if(heapSize[tier] > 0 && entries[heaps[tier][0]].due < due)
+                        due = entries[heaps[tier][0]].due;
+        }
+
+        return due;
+}
+
+/***************************************************************************
+* Ping* PollScheduler::getPing(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the Ping object of a target
+*
+* Parameters:
+*        handle I/P     int     handle of the target
+*        getPing        O/P     Ping*   target, nullptr if the handle is invalid
+**************************************************************************/
+Ping* PollScheduler::getPing(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count)
+                return nullptr;
+
+        return entries[handle].ping;
+}
+
+/***************************************************************************
+* uint32_t PollScheduler::getInterval(int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the current poll interval of a target, before jitter
+*
+* Parameters:
+*        handle I/P     int     handle of the target
+*        getInterval    O/P     uint32_t        interval in milliseconds, 0 if
+*                                               the handle is invalid
+**************************************************************************/
+uint32_t PollScheduler::getInterval(int handle)
+{
+        if(handle < 0 || (size_t)handle >= count || entries[handle].ping == nullptr)
+                return 0;
+
+        return entries[handle].interval;
+}
+
+/***************************************************************************
+* bool PollScheduler::getState(int handle, MC_TargetState* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Copies the poll interval and failure count of a target into
+*       its snapshot state
+*
+* Parameters:
+*        handle I/P     int     handle of the target
+*        out    I/O     MC_TargetState* state to fill in
+*        getState       O/P     bool    false if the handle is invalid
+**************************************************************************/
+bool PollScheduler::getState(int handle, MC_TargetState* out)
+{
+        if(handle < 0 || (size_t)handle >= count || entries[handle].ping == nullptr)
+                return false;
+
+        out->interval = entries[handle].interval;
+        out->failures = entries[handle].failures;
+        out->flags   |= STATE_SCHEDULED;
+
+        return true;
+}
+
+/***************************************************************************
+* bool PollScheduler::restore(int handle, const MC_TargetState* state,
+*                                                               uint64_t now)
+* Author: agent
+* Date: 10/19/2026
+* Description: Restores the poll interval and failure count of a target from
+*       a snapshot. The next poll is spread over the restored interval, so a
+*       restarted poller keeps its old pace instead of polling everything at
+*       the base interval
+*
+* Parameters:
+*        handle I/P     int     handle of the target
+*        state  I/P     const MC_TargetState*   state from a snapshot
+*        now    I/P     uint64_t        current time from now()
+*        restore        O/P     bool    false if the handle is invalid or the
+*                                       state has no scheduler fields
+**************************************************************************/
+bool PollScheduler::restore(int handle, const MC_TargetState* state,
+                                                                uint64_t now)
+{
+        if(handle < 0 || (size_t)handle >= count || entries[handle].ping == nullptr
+                        || !(state->flags & STATE_SCHEDULED) || state->interval == 0)
+                return false;
+
+        Entry* e    = &entries[handle];
+        e->interval = state->interval;
+        e->failures = state->failures < 31 ? state->failures : 31;
+
+        if(e->heapPosition == NOT_QUEUED)
+                return true;
+        /*a target being polled is rescheduled when it is reported*/
+
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        e->due = now + random % e->interval;
+
+        size_t position = e->heapPosition;
+        siftDown(e->tier, position);
+        siftUp(e->tier, e->heapPosition);
+        /*the due time can move either way*/
+
+        return true;
+}
@@ -0,0 +1,953 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+
+/***************************************************************************
+* File:  series.cpp
+* Author:  agent
+* Procedures:
+* putVarint     -Encodes an unsigned varint
+* getVarint     -Decodes an unsigned varint
+* zigzag        -Maps a signed delta to an unsigned one
+* unzigzag      -Reverses zigzag
+* SeriesStore() -Default constructor
+* ~SeriesStore()        -Destructor
+* attach        -Lays the store out over a block of memory
+* create        -Creates a store in memory
+* mapWritable   -Memory-maps a file for reading and writing
+* open          -Creates or reopens a store backed by a file
+* record        -Appends a sample to a series
+* collect       -Decodes the samples of a series in a time range
+* range         -Returns the samples of a series in a time range
+* compareLongs  -qsort comparison of two longs
+* summarize     -Fills the min, avg, max and p95 of a set of values
+* downsample    -Aggregates the samples of a series into fixed buckets
+* size          -Returns the number of series
+* capacity      -Returns the memory or file size of the store
+* flush         -Writes a file backed store to disk
+* close         -Releases the store
+* findKey       -Finds a JSON key in a response
+* parseOnline   -Extracts players.online from a status response
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+
+#define LATENCY_NONE 0xFFFF
+#define ONLINE_NONE 0xFFFFFFFF
+/*stored in place of the latency of a failed probe and a missing count*/
+#define BLOCK_HEADER_SIZE 16
+#define BLOCK_SAMPLES (1 + (SERIES_BLOCK_SIZE - BLOCK_HEADER_SIZE) / 3)
+/*most samples a block can hold, a delta takes at least 3 bytes*/
+
+
+struct SeriesStore::Series{
+        uint32_t head;
+        /*block the newest samples are in*/
+        uint32_t filled;
+        /*blocks of the ring in use, 0 for an empty series*/
+        uint32_t online;
+        uint16_t latency;
+        /*newest sample, the base of the next delta*/
+        uint16_t reserved;
+};
+        /*ring state of one series, 16 bytes*/
+
+struct SeriesBlock{
+        uint32_t first;
+        uint32_t last;
+        /*seconds since the store's epoch of the first and last sample*/
+        uint32_t online;
+        uint16_t latency;
+        /*first sample, the deltas build on it*/
+        uint8_t count;
+        /*samples in the block*/
+        uint8_t used;
+        /*bytes of data in use*/
+        uint8_t data[SERIES_BLOCK_SIZE - BLOCK_HEADER_SIZE];
+        /*time, latency and player count deltas of the following samples*/
+};
+
+
+/***************************************************************************
+* static size_t putVarint(uint8_t* out, uint64_t value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes an unsigned varint
+*
+* Parameters:
+*        out    I/O     uint8_t*        receives at most 10 bytes
+*        value  I/P     uint64_t        value to encode
+*        putVarint      O/P     size_t  bytes written
+**************************************************************************/
+static size_t putVarint(uint8_t* out, uint64_t value)
+{
+        size_t n = 0;
+        while(value >= 0x80){
+                out[n++] = (uint8_t)value | 0x80;
+                value >>= 7;
+        }
+        out[n++] = (uint8_t)value;
+
+        return n;
+}
+
+/***************************************************************************
+* static size_t getVarint(const uint8_t* in, size_t length, uint64_t* value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Decodes an unsigned varint
+*
+* Parameters:
+*        in     I/P     const uint8_t*  encoded bytes
+*        length I/P     size_t  bytes available
+*        value  I/O     uint64_t*       receives the value
+*        getVarint      O/P     size_t  bytes read, 0 if the varint is cut
+*                                       short
+**************************************************************************/
+static size_t getVarint(const uint8_t* in, size_t length, uint64_t* value)
+{
+        *value = 0;
+        for(size_t i = 0; i < length && i < 10; i++){
+                *value |= (uint64_t)(in[i] & 0x7f) << (7 * i);
+                if(!(in[i] & 0x80))
+                        return i + 1;
+        }
+
+        return 0;
+}
+
+/***************************************************************************
+* static uint64_t zigzag(int64_t delta)
+* Author: agent
+* Date: 10/19/2026
+* Description: Maps a signed delta to an unsigned one so small changes in
+*       either direction encode to one byte
+*
+* Parameters:
+*        delta  I/P     int64_t signed delta
+*        zigzag O/P     uint64_t        encoded delta
+**************************************************************************/
+static uint64_t zigzag(int64_t delta)
+{
+        return ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+}
+
+/***************************************************************************
+* static int64_t unzigzag(uint64_t value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reverses zigzag
+*
+* Parameters:
+*        value  I/P     uint64_t        encoded delta
+*        unzigzag       O/P     int64_t signed delta
+**************************************************************************/
+static int64_t unzigzag(uint64_t value)
+{
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/***************************************************************************
+* SeriesStore::SeriesStore()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor, create() or open() sets the store up
+*
+* Parameters:
+**************************************************************************/
+SeriesStore::SeriesStore()
+{
+        map             = nullptr;
+        mapSize         = 0;
+        mapped          = false;
+        series          = nullptr;
+        blocks          = nullptr;
+        count           = 0;
+        blocksPerSeries = 0;
+        epoch           = 0;
+}
+
+/***************************************************************************
+* SeriesStore::~SeriesStore()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor, a file backed store is flushed first
+*
+* Parameters:
+**************************************************************************/
+SeriesStore::~SeriesStore()
+{
+        close();
+}
+
+/***************************************************************************
+* int SeriesStore::attach(uint8_t* data, size_t size, bool fresh, size_t n,
+*                                                       uint32_t b)
+* Author: agent
+* Date: 10/19/2026
+* Description: Lays the store out over a block of memory, writing a new
+*       header or checking the one already there
+*
+* Parameters:
+*        data   I/P     uint8_t*        memory of the store, zeroed if fresh
+*        size   I/P     size_t  size of the memory
+*        fresh  I/P     bool    true if the header has to be written
+*        n      I/P     size_t  number of series
+*        b      I/P     uint32_t        blocks per series
+*        attach O/P     int     OK, or BAD_RESPONSE if an existing store
+*                               has a different layout
+**************************************************************************/
+int SeriesStore::attach(uint8_t* data, size_t size, bool fresh, size_t n,
+                                                                uint32_t b)
+{
+        uint64_t series64 = n;
+        size_t states = (SERIES_HEADER_SIZE + n * sizeof(Series)
+                        + SERIES_BLOCK_SIZE - 1) & ~(size_t)(SERIES_BLOCK_SIZE - 1);
+        /*blocks start on a block boundary, a cache line on common CPUs*/
+
+        if(fresh){
+                struct timeval now;
+                gettimeofday(&now, NULL);
+                uint64_t start = (uint64_t)now.tv_sec * 1000;
+
+                memcpy(data, SERIES_MAGIC, sizeof(SERIES_MAGIC));
+                memcpy(data + 8, &b, sizeof(b));
+                memcpy(data + 16, &series64, sizeof(series64));
+                memcpy(data + 24, &start, sizeof(start));
+        }
+        /*the epoch is a whole second, samples store seconds from it*/
+
+        if(size < SERIES_HEADER_SIZE)
+                return BAD_RESPONSE;
+
+        uint32_t storedBlocks = 0;
+        uint64_t storedSeries = 0;
+        memcpy(&storedBlocks, data + 8, sizeof(storedBlocks));
+        memcpy(&storedSeries, data + 16, sizeof(storedSeries));
+        if(memcmp(data, SERIES_MAGIC, sizeof(SERIES_MAGIC))
+                        || storedBlocks != b || storedSeries != series64
+                        || states + (uint64_t)n * b * SERIES_BLOCK_SIZE != size)
+                return BAD_RESPONSE;
+        /*an existing store is only reopened with the layout it was made with*/
+
+        memcpy(&epoch, data + 24, sizeof(epoch));
+        map             = data;
+        mapSize         = size;
+        series          = (Series*)(data + SERIES_HEADER_SIZE);
+        blocks          = data + states;
+        count           = n;
+        blocksPerSeries = b;
+
+        return OK;
+}
+
+/***************************************************************************
+* int SeriesStore::create(size_t n, uint32_t b)
+* Author: agent
+* Date: 10/19/2026
+* Description: Creates an empty store in memory
+*
+* Parameters:
+*        n      I/P     size_t  number of series
+*        b      I/P     uint32_t        blocks of SERIES_BLOCK_SIZE bytes per
+*                                       series
+*        create O/P     int     OK, or INITIALIZATION_FAILURE if the memory
+*                               could not be allocated
+**************************************************************************/
+int SeriesStore::create(size_t n, uint32_t b)
+{
+        close();
+
+        if(n == 0 || b == 0)
+                return INITIALIZATION_FAILURE;
+
+        size_t states = (SERIES_HEADER_SIZE + n * sizeof(Series)
+                        + SERIES_BLOCK_SIZE - 1) & ~(size_t)(SERIES_BLOCK_SIZE - 1);
+        size_t size = states + n * (size_t)b * SERIES_BLOCK_SIZE;
+
+        uint8_t* data = (uint8_t*)calloc(1, size);
+        if(data == nullptr)
+                return INITIALIZATION_FAILURE;
+
+        mapped = false;
+        return attach(data, size, true, n, b);
+}
+
+/***************************************************************************
+* static uint8_t* mapWritable(const char* path, size_t* size, bool* fresh)
+* Author: agent
+* Date: 10/19/2026
+* Description: Memory-maps a whole file for reading and writing, creating it
+*       with the given size if it does not exist or is empty
+*
+* Parameters:
+*        path   I/P     const char*     file to map
+*        size   I/O     size_t* size of a new file, receives the size of the
+*                               mapping
+*        fresh  I/O     bool*   set if the file was created
+*        mapWritable    O/P     uint8_t*        mapping, nullptr on failure
+**************************************************************************/
+static uint8_t* mapWritable(const char* path, size_t* size, bool* fresh)
+{
+        *fresh = false;
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+                        FILE_SHARE_READ, NULL, OPEN_ALWAYS, 0, NULL);
+        if(file == INVALID_HANDLE_VALUE)
+                return nullptr;
+
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize)){
+                CloseHandle(file);
+                return nullptr;
+        }
+        if(fileSize.QuadPart == 0)
+                *fresh = true;
+        else
+                *size = fileSize.QuadPart;
+
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                        (DWORD)((uint64_t)*size >> 32), (DWORD)*size, NULL);
+        CloseHandle(file);
+        /*a fresh file is extended, with zeros, to the size of the mapping*/
+        if(mapping == NULL)
+                return nullptr;
+
+        uint8_t* data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+        CloseHandle(mapping);
+        /*the view keeps the mapping alive*/
+        return data;
+#else
+        int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if(fd < 0)
+                return nullptr;
+
+        struct stat st;
+        if(fstat(fd, &st) < 0){
+                ::close(fd);
+                return nullptr;
+        }
+        if(st.st_size == 0){
+                if(ftruncate(fd, *size) < 0){
+                        ::close(fd);
+                        return nullptr;
+                }
+                *fresh = true;
+        }else
+                *size = st.st_size;
+        /*a new file is extended sparsely, blocks only take disk space once
+        *samples land in them
+        */
+
+        void* data = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(data == MAP_FAILED)
+                return nullptr;
+
+        return (uint8_t*)data;
+#endif // _WIN32
+}
+
+/***************************************************************************
+* int SeriesStore::open(const char* path, size_t n, uint32_t b)
+* Author: agent
+* Date: 10/19/2026
+* Description: Creates a store backed by a file, or reopens the one a
+*       previous run left there so its history is kept. The kernel writes
+*       samples back to the file on its own, flush() forces it
+*
+* Parameters:
+*        path   I/P     const char*     file of the store
+*        n      I/P     size_t  number of series
+*        b      I/P     uint32_t        blocks of SERIES_BLOCK_SIZE bytes per
+*                                       series
+*        open   O/P     int     OK, INITIALIZATION_FAILURE if the file could
+*                               not be mapped, or BAD_RESPONSE if it holds a
+*                               store with a different layout
+**************************************************************************/
+int SeriesStore::open(const char* path, size_t n, uint32_t b)
+{
+        close();
+
+        if(n == 0 || b == 0)
+                return INITIALIZATION_FAILURE;
+
+        size_t states = (SERIES_HEADER_SIZE + n * sizeof(Series)
+                        + SERIES_BLOCK_SIZE - 1) & ~(size_t)(SERIES_BLOCK_SIZE - 1);
+        size_t size = states + n * (size_t)b * SERIES_BLOCK_SIZE;
+
+        bool fresh;
+        uint8_t* data = mapWritable(path, &size, &fresh);
+        if(data == nullptr)
+                return INITIALIZATION_FAILURE;
+
+        mapped = true;
+        int ret = attach(data, size, fresh, n, b);
+        if(ret != OK){
+                mc_unmapFile(data, size);
+                mapped = false;
+        }
+        /*a file of another size or layout is left alone*/
+
+        return ret;
+}
+
+/***************************************************************************
+* bool SeriesStore::record(size_t index, uint64_t timestamp,
+*                                       long milliseconds, long online)
+* Author: agent
+* Date: 10/19/2026
+* Description: Appends a sample to a series. The sample is delta encoded
+*       against the one before it, when it does not fit the newest block
+*       the next block of the ring is started, dropping the oldest samples
+*       once the ring is full. Samples are kept in order, one older than the
+*       newest is stored with the newest one's time
+*
+* Parameters:
+*        index  I/P     size_t  series of the target
+*        timestamp      I/P     uint64_t        time of the sample in
+*                                               milliseconds since the epoch
+*        milliseconds   I/P     long    latency, negative for a failed probe
+*        online I/P     long    player count, negative if there was none
+*        record O/P     bool    false if the index is out of range
+**************************************************************************/
+bool SeriesStore::record(size_t index, uint64_t timestamp, long milliseconds,
+                                                                long online)
+{
+        uint16_t latency = milliseconds < 0 ? LATENCY_NONE
+                        : milliseconds >= LATENCY_NONE ? LATENCY_NONE - 1
+                        : (uint16_t)milliseconds;
+        uint32_t players = online < 0 ? ONLINE_NONE
+                        : (uint64_t)online >= ONLINE_NONE ? ONLINE_NONE - 1
+                        : (uint32_t)online;
+        uint64_t seconds = timestamp > epoch ? (timestamp - epoch) / 1000 : 0;
+        if(seconds > UINT32_MAX)
+                seconds = UINT32_MAX;
+        /*clamp the sample into what a block can hold*/
+
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(index >= count)
+                return false;
+
+        Series* s = &series[index];
+        SeriesBlock* block = (SeriesBlock*)(blocks
+                        + ((size_t)index * blocksPerSeries + s->head)
+                        * SERIES_BLOCK_SIZE);
+
+        if(s->filled > 0){
+                if(seconds < block->last)
+                        seconds = block->last;
+
+                uint8_t delta[30];
+                size_t n = putVarint(delta, seconds - block->last);
+                n += putVarint(delta + n, zigzag((int64_t)latency - s->latency));
+                n += putVarint(delta + n, zigzag((int64_t)players - s->online));
+
+                if(block->count < UINT8_MAX
+                                && block->used + n <= sizeof(block->data)){
+                        memcpy(block->data + block->used, delta, n);
+                        block->used += n;
+                        block->count++;
+                        block->last = seconds;
+                        s->latency  = latency;
+                        s->online   = players;
+                        return true;
+                }
+                /*most samples of a steady poll take 3 bytes*/
+
+                s->head = (s->head + 1) % blocksPerSeries;
+                if(s->filled < blocksPerSeries)
+                        s->filled++;
+                block = (SeriesBlock*)(blocks
+                                + ((size_t)index * blocksPerSeries + s->head)
+                                * SERIES_BLOCK_SIZE);
+        }else
+                s->filled = 1;
+        /*the block is full, move on to the next one, overwriting the
+        *oldest once every block is in use
+        */
+
+        block->first   = seconds;
+        block->last    = seconds;
+        block->online  = players;
+        block->latency = latency;
+        block->count   = 1;
+        block->used    = 0;
+        s->latency     = latency;
+        s->online      = players;
+
+        return true;
+}
+
+/***************************************************************************
+* bool SeriesStore::record(size_t index, const PingResult* result)
+* Author: agent
+* Date: 10/19/2026
+* Description: Appends a completed probe to a series, its latency and the
+*       players.online of its response
+*
+* Parameters:
+*        index  I/P     size_t  series of the target
+*        result I/P     const PingResult*       the probe
+*        record O/P     bool    false if the index is out of range
+**************************************************************************/
+bool SeriesStore::record(size_t index, const PingResult* result)
+{
+        long online = -1;
+        if(result->response != nullptr)
+                online = parseOnline(result->response, result->responseLength);
+
+        return record(index, result->timestamp, result->milliseconds, online);
+}
+
+/***************************************************************************
+* bool SeriesStore::record(size_t index, Ping* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Appends the last probe of a Ping to a series. Call it after
+*       connectMC(), an UNCHANGED probe is recorded too
+*
+* Parameters:
+*        index  I/P     size_t  series of the target
+*        p      I/P     Ping*   the probed target
+*        record O/P     bool    false if the index is out of range
+**************************************************************************/
+bool SeriesStore::record(size_t index, Ping* p)
+{
+        PingResult result;
+        p->getResult(&result);
+
+        return record(index, &result);
+}
+
+/***************************************************************************
+* size_t SeriesStore::collect(size_t index, uint64_t from, uint64_t to,
+*                                       MC_SeriesSample* out, size_t max)
+* Author: agent
+* Date: 10/19/2026
+* Description: Decodes the samples of a series in a time range, oldest
+*       first. Blocks entirely outside the range are skipped without being
+*       decoded. The lock must be held
+*
+* Parameters:
+*        index  I/P     size_t  series of the target
+*        from   I/P     uint64_t        start of the range, inclusive
+*        to     I/P     uint64_t        end of the range, exclusive
+*        out    I/O     MC_SeriesSample*        receives the samples
+*        max    I/P     size_t  size of out
+*        collect        O/P     size_t  samples written
+**************************************************************************/
+size_t SeriesStore::collect(size_t index, uint64_t from, uint64_t to,
+                                        MC_SeriesSample* out, size_t max)
+{
+        if(index >= count)
+                return 0;
+
+        const Series* s = &series[index];
+        uint32_t oldest = (s->head + 1 + blocksPerSeries - s->filled)
+                                                        % blocksPerSeries;
+        size_t n = 0;
+
+        for(uint32_t i = 0; i < s->filled && n < max; i++){
+                const SeriesBlock* block = (const SeriesBlock*)(blocks
+                        + ((size_t)index * blocksPerSeries
+                        + (oldest + i) % blocksPerSeries) * SERIES_BLOCK_SIZE);
+
+                if(epoch + (uint64_t)block->last * 1000 < from)
+                        continue;
+                if(epoch + (uint64_t)block->first * 1000 >= to)
+                        break;
+
+                uint64_t seconds = block->first;
+                int64_t latency  = block->latency;
+                int64_t players  = block->online;
+                size_t offset    = 0;
+
+                for(unsigned j = 0; j < block->count && n < max; j++){
+                        if(j > 0){
+                                uint64_t d[3];
+                                for(int k = 0; k < 3; k++){
+                                        size_t used = getVarint(block->data
+                                                + offset, block->used - offset,
+                                                &d[k]);
+                                        if(used == 0)
+                                                return n;
+                                        offset += used;
+                                }
+                                seconds += d[0];
+                                latency += unzigzag(d[1]);
+                                players += unzigzag(d[2]);
+                        }
+                        /*the first sample is in the header, every other
+                        *one is three deltas
+                        */
+
+                        uint64_t timestamp = epoch + seconds * 1000;
+                        if(timestamp < from)
+                                continue;
+                        if(timestamp >= to)
+                                return n;
+
+                        out[n].timestamp    = timestamp;
+                        out[n].milliseconds = latency == LATENCY_NONE ? -1
+                                                                : (long)latency;
+                        out[n].online       = players == ONLINE_NONE ? -1
+                                                                : (long)players;
+                        n++;
+                }
+        }
+
+        return n;
+}
+
+/***************************************************************************
+* size_t SeriesStore::range(size_t index, uint64_t from, uint64_t to,
+*                                       MC_SeriesSample* out, size_t max)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the samples of a series in a time range, oldest
+*       first
+*
+* Parameters:
+*        index  I/P     size_t  series of the target
+*        from   I/P     uint64_t        start of the range in milliseconds
+*                                       since the epoch, inclusive
+*        to     I/P     uint64_t        end of the range, exclusive
+*        out    I/O     MC_SeriesSample*        receives the samples
+*        max    I/P     size_t  size of out
+*        range  O/P     size_t  samples written
+**************************************************************************/
+size_t SeriesStore::range(size_t index, uint64_t from, uint64_t to,
+                                        MC_SeriesSample* out, size_t max)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        return collect(index, from, to, out, max);
+}
+
+/***************************************************************************
+* static int compareLongs(const void* a, const void* b)
+* Author: agent
+* Date: 10/19/2026
+* Description: qsort comparison of two longs
+*
+* Parameters:
+*        a      I/P     const void*     first long
+*        b      I/P     const void*     second long
+*        compareLongs   O/P     int     <0, 0 or >0
+**************************************************************************/
+static int compareLongs(const void* a, const void* b)
+{
+        long x = *(const long*)a;
+        long y = *(const long*)b;
+
+        return (x > y) - (x < y);
+}
+
+/***************************************************************************
+* static void summarize(long* values, size_t n, long* min, long* max,
+*                                               long* p95, double* avg)
+* Author: agent
+* Date: 10/19/2026
+* Description: Fills the min, avg, max and nearest rank 95th percentile of
+*       a set of values, or -1 for all of them if the set is empty
+*
+* Parameters:
+*        values I/O     long*   the values, sorted in place
+*        n      I/P     size_t  number of values
+*        min    I/O     long*   receives the minimum
+*        max    I/O     long*   receives the maximum
+*        p95    I/O     long*   receives the 95th percentile
+*        avg    I/O     double* receives the mean
+**************************************************************************/
+static void summarize(long* values, size_t n, long* min, long* max, long* p95,
+                                                                double* avg)
+{
+        if(n == 0){
+                *min = *max = *p95 = -1;
+                *avg = -1;
+                return;
+        }
+
+        qsort(values, n, sizeof(long), compareLongs);
+
+        double sum = 0;
+        for(size_t i = 0; i < n; i++)
+                sum += values[i];
+
+        *min = values[0];
+        *max = values[n - 1];
+        *p95 = values[(n * 95 + 99) / 100 - 1];
+        *avg = sum / n;
+}
+
+/***************************************************************************
+* size_t SeriesStore::downsample(size_t index, uint64_t from, uint64_t to,
+*               uint64_t bucket, MC_SeriesBucket* out, size_t max)
+* Author: agent
+* Date: 10/19/2026
+* Description: Aggregates the samples of a series in a time range into
+*       buckets of a fixed width, the min, avg, max and p95 of the latency
+*       and of the player count of each. Every bucket of the range is
+*       returned, empty ones with 0 samples, so the output can be plotted
+*       directly
+*
+* Parameters:
+*        index  I/P     size_t  series of the target
+*        from   I/P     uint64_t        start of the range in milliseconds
+*                                       since the epoch, inclusive
+*        to     I/P     uint64_t        end of the range, exclusive
+*        bucket I/P     uint64_t        width of a bucket in milliseconds
+*        out    I/O     MC_SeriesBucket*        receives the buckets
+*        max    I/P     size_t  size of out, later buckets are dropped
+*        downsample     O/P     size_t  buckets written, 0 if out of memory
+**************************************************************************/
+size_t SeriesStore::downsample(size_t index, uint64_t from, uint64_t to,
+                uint64_t bucket, MC_SeriesBucket* out, size_t max)
+{
+        if(bucket == 0 || to <= from)
+                return 0;
+
+        size_t buckets = (to - from - 1) / bucket + 1;
+        if(buckets > max)
+                buckets = max;
+        if(buckets == 0)
+                return 0;
+
+        size_t room = (size_t)blocksPerSeries * BLOCK_SAMPLES;
+        MC_SeriesSample* samples = (MC_SeriesSample*)malloc(room
+                                        * sizeof(MC_SeriesSample));
+        long* latencies = (long*)malloc(room * sizeof(long));
+        long* players   = (long*)malloc(room * sizeof(long));
+        if(samples == nullptr || latencies == nullptr || players == nullptr){
+                free(samples);
+                free(latencies);
+                free(players);
+                return 0;
+        }
+
+        uint64_t end = from + buckets * bucket;
+        if(end > to || end < from)
+                end = to;
+        size_t n;
+        {
+                std::lock_guard<std::mutex> guard(lock);
+                n = collect(index, from, end, samples, room);
+        }
+        /*decode under the lock, aggregate after it is released*/
+
+        size_t next = 0;
+        for(size_t i = 0; i < buckets; i++){
+                MC_SeriesBucket* b = &out[i];
+                b->start    = from + i * bucket;
+                b->samples  = 0;
+                b->failures = 0;
+
+                size_t l = 0;
+                size_t p = 0;
+                while(next < n && samples[next].timestamp - from < (i + 1) * bucket){
+                        b->samples++;
+                        if(samples[next].milliseconds < 0)
+                                b->failures++;
+                        else
+                                latencies[l++] = samples[next].milliseconds;
+                        if(samples[next].online >= 0)
+                                players[p++] = samples[next].online;
+                        next++;
+                }
+                /*the samples are in order, each bucket is the next run*/
+
+                summarize(latencies, l, &b->latencyMin, &b->latencyMax,
+                                        &b->latencyP95, &b->latencyAvg);
+                summarize(players, p, &b->onlineMin, &b->onlineMax,
+                                        &b->onlineP95, &b->onlineAvg);
+        }
+
+        free(samples);
+        free(latencies);
+        free(players);
+
+        return buckets;
+}
+
+/***************************************************************************
+* size_t SeriesStore::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of series
+*
+* Parameters:
+*        size   O/P     size_t  number of series, 0 before create() or open()
+**************************************************************************/
+size_t SeriesStore::size(void)
+{
+        return count;
+}
+
+/***************************************************************************
+* size_t SeriesStore::capacity(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the bytes of memory, or of file, the store takes.
+*       It does not grow with the samples recorded
+*
+* Parameters:
+*        capacity       O/P     size_t  size of the store in bytes
+**************************************************************************/
+size_t SeriesStore::capacity(void)
+{
+        return mapSize;
+}
+
+/***************************************************************************
+* int SeriesStore::flush(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes a file backed store to disk. An in memory store has
+*       nothing to flush
+*
+* Parameters:
+*        flush  O/P     int     OK, or SEND_FAILURE if the write failed
+**************************************************************************/
+int SeriesStore::flush(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(!mapped)
+                return OK;
+
+#ifdef _WIN32
+        if(!FlushViewOfFile(map, 0))
+                return SEND_FAILURE;
+#else
+        if(msync(map, mapSize, MS_SYNC) < 0)
+                return SEND_FAILURE;
+#endif // _WIN32
+
+        return OK;
+}
+
+/***************************************************************************
+* void SeriesStore::close(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Releases the store. A file backed store is flushed and
+*       unmapped, an in memory one is dropped
+*
+* Parameters:
+**************************************************************************/
+void SeriesStore::close(void)
+{
+        if(map == nullptr)
+                return;
+
+        if(mapped){
+                flush();
+                mc_unmapFile(map, mapSize);
+        }else
+                free(map);
+
+        map             = nullptr;
+        mapSize         = 0;
+        mapped          = false;
+        series          = nullptr;
+        blocks          = nullptr;
+        count           = 0;
+        blocksPerSeries = 0;
+}
+
+/***************************************************************************
+* static size_t findKey(const char* json, size_t length, size_t start,
+*                                                       const char* key)
+* Author: agent
+* Date: 10/19/2026
+* Description: Finds a quoted JSON key. A match whose opening quote is
+*       escaped is inside a string value and is skipped
+*
+* Parameters:
+*        json   I/P     const char*     response to search
+*        length I/P     size_t  length of the response
+*        start  I/P     size_t  offset to search from
+*        key    I/P     const char*     key, with its quotes
+*        findKey        O/P     size_t  offset just past the key, 0 if it was
+*                                       not found
+**************************************************************************/
+static size_t findKey(const char* json, size_t length, size_t start,
+                                                        const char* key)
+{
+        size_t keyLength = strlen(key);
+
+        for(size_t i = start; i + keyLength <= length; i++){
+                if(json[i] == '"' && (i == 0 || json[i - 1] != '\\')
+                                && !memcmp(json + i, key, keyLength))
+                        return i + keyLength;
+        }
+
+        return 0;
+}
+
+/***************************************************************************
+* long SeriesStore::parseOnline(const char* response, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Extracts players.online from a status response without
+*       parsing the rest of it
+*
+* Parameters:
+*        response       I/P     const char*     JSON status response
+*        length I/P     size_t  length of the response
+*        parseOnline    O/P     long    the player count, -1 if the response
+*                                       has none
+**************************************************************************/
+long SeriesStore::parseOnline(const char* response, size_t length)
+{
+        size_t i = findKey(response, length, 0, "\"players\"");
+        if(i == 0)
+                return -1;
+        i = findKey(response, length, i, "\"online\"");
+        if(i == 0)
+                return -1;
+
+        while(i < length && (response[i] == ' ' || response[i] == ':'
+                                || response[i] == '\t' || response[i] == '\n'
+                                || response[i] == '\r'))
+                i++;
+        if(i == length || response[i] < '0' || response[i] > '9')
+                return -1;
+
+        long online = 0;
+        while(i < length && response[i] >= '0' && response[i] <= '9'
+                                                && online < 1000000000L)
+                online = online * 10 + (response[i++] - '0');
+
+        return online;
+}
@@ -0,0 +1,1269 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  shard.cpp
+* Author:  agent
+* Procedures:
+* ShardRing()   -Default constructor
+* ~ShardRing()  -Destructor
+* build         -Places the points of every shard on the ring
+* shardOf       -Returns the shard a target hash belongs to
+* getShards     -Returns the number of shards
+* mix32         -Spreads the bits of a target hash over the ring
+* comparePoints -qsort comparison of two ring points
+* ScanCoordinator(X, Y) -Constructor
+* ~ScanCoordinator()    -Destructor
+* setProbeMode  -Sets the probe mode the shards are scanned with
+* setDeadline   -Sets how long serve() waits for the shards to come back
+* setBindAddress        -Sets the address serve() listens on
+* setToken      -Sets the shared token remote workers must send
+* setUploadLimit        -Caps the blob file a worker may send for a shard
+* takeShard     -Takes the next shard nobody is scanning
+* finishShard   -Marks an assigned shard as done or hands it back
+* buildShard    -Writes the targets of a shard as "host:port" lines
+* scanShard     -Scans the targets of a shard into a log
+* mergeShards   -Merges every shard log into the output log
+* runLocal      -Scans every shard in a forked local process
+* serve         -Hands the shards out to remote workers
+* serveWorker   -Runs the protocol with one connected worker
+* runWorker     -Connects to a coordinator and scans the shards it hands out
+* scanList      -Probes every target of a list into a binary log
+* merge         -Merges binary logs into one
+* sameToken     -Compares a received token without leaking where it differs
+* checkShardLog -Checks a shard log a worker sent before it is accepted
+* shardPath     -Builds the path of a shard log
+* sendAll       -Sends a whole buffer
+* recvAll       -Receives an exact number of bytes
+* recvLine      -Receives a single protocol line
+* sendFile      -Sends the contents of a file
+* recvFile      -Receives bytes into a file
+* fileSize      -Returns the size of a file
+***************************************************************************/
+
+
+#include <thread>
+#include <vector>
+/*the standard headers come first, MinecraftPing.h defines nullptr*/
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#define poll WSAPoll
+#define SHUT_RDWR SD_BOTH
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#include <poll.h>
+#endif // _WIN32
+
+
+#define SHARD_PENDING 0
+#define SHARD_ASSIGNED 1
+#define SHARD_DONE 2
+/*states of a shard while the coordinator hands them out*/
+
+#define LINE_MAX_SIZE 128
+#define COPY_CHUNK (64 * 1024)
+#define ACCEPT_TIMEOUT 1000
+/*milliseconds between checks whether every shard is done*/
+#define SERVE_DEADLINE (24 * 60 * 60)
+/*seconds serve() waits for every shard by default*/
+#define UPLOAD_LIMIT (1ULL << 30)
+/*bytes of blob file a worker may send for one shard by default*/
+#define REAP_INTERVAL 20000
+/*microseconds between checks for finished local shard processes*/
+
+
+/***************************************************************************
+* static uint32_t mix32(uint32_t h)
+* Author: agent
+* Date: 10/19/2026
+* Description: Spreads the bits of a hash over the whole ring, so targets
+*       whose hashes only differ in the low bits do not clump together
+*
+* Parameters:
+*        h      I/P     uint32_t        hash to mix
+*        mix32  O/P     uint32_t        mixed hash
+**************************************************************************/
+static uint32_t mix32(uint32_t h)
+{
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+
+        return h;
+}
+
+/***************************************************************************
+* static int comparePoints(const void* a, const void* b)
+* Author: agent
+* Date: 10/19/2026
+* Description: qsort comparison of two ring points
+*
+* Parameters:
+*        a      I/P     const void*     first point
+*        b      I/P     const void*     second point
+*        comparePoints  O/P     int     order of the points
+**************************************************************************/
+static int comparePoints(const void* a, const void* b)
+{
+        uint64_t x = *(const uint64_t*)a;
+        uint64_t y = *(const uint64_t*)b;
+
+        return x < y ? -1 : x > y;
+}
+
+/***************************************************************************
+* ShardRing::ShardRing()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor, creates an empty ring
+*
+* Parameters:
+**************************************************************************/
+ShardRing::ShardRing()
+{
+        points = nullptr;
+        count  = 0;
+        shards = 0;
+}
+
+/***************************************************************************
+* ShardRing::~ShardRing()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+ShardRing::~ShardRing()
+{
+        free(points);
+}
+
+/***************************************************************************
+* bool ShardRing::build(unsigned shards, unsigned virtualNodes)
+* Author: agent
+* Date: 10/19/2026
+* Description: Places virtualNodes points of every shard on the ring. The
+*       position of a point only depends on its shard and node number, so a
+*       ring with one more shard keeps every existing point
+*
+* Parameters:
+*        shards I/P     unsigned        number of shards
+*        virtualNodes   I/P     unsigned        points per shard
+*        build  O/P     bool    false if out of memory or shards is 0
+**************************************************************************/
+bool ShardRing::build(unsigned shards, unsigned virtualNodes)
+{
+        free(points);
+        points       = nullptr;
+        count        = 0;
+        this->shards = 0;
+
+        if(shards == 0)
+                return false;
+        if(virtualNodes == 0)
+                virtualNodes = 1;
+
+        points = (uint64_t*)malloc((size_t)shards * virtualNodes * sizeof(uint64_t));
+        if(points == nullptr)
+                return false;
+
+        for(unsigned s = 0; s < shards; s++){
+                for(unsigned v = 0; v < virtualNodes; v++){
+                        uint32_t node[2] = {s, v};
+                        uint64_t h = mc_hash64(node, sizeof(node), 0);
+                        uint32_t position = (uint32_t)(h ^ (h >> 32));
+
+                        points[count++] = ((uint64_t)position << 32) | s;
+                }
+        }
+
+        qsort(points, count, sizeof(uint64_t), comparePoints);
+        this->shards = shards;
+
+        return true;
+}
+
+/***************************************************************************
+* unsigned ShardRing::shardOf(uint32_t hash)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the shard a target belongs to, the owner of the first
+*       point at or after the target's position on the ring
+*
+* Parameters:
+*        hash   I/P     uint32_t        hash of the target, MC_Target::hash
+*        shardOf        O/P     unsigned        shard of the target
+**************************************************************************/
+unsigned ShardRing::shardOf(uint32_t hash)
+{
+        if(count == 0)
+                return 0;
+
+        uint64_t key = (uint64_t)mix32(hash) << 32;
+        size_t low  = 0;
+        size_t high = count;
+
+        while(low < high){
+                size_t middle = (low + high) / 2;
+                if(points[middle] < key)
+                        low = middle + 1;
+                else
+                        high = middle;
+        }
+
+        if(low == count)
+                low = 0;
+        /*past the last point the ring wraps around to the first*/
+
+        return (uint32_t)points[low];
+}
+
+/***************************************************************************
+* unsigned ShardRing::getShards(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of shards
+*
+* Parameters:
+*        getShards      O/P     unsigned        number of shards
+**************************************************************************/
+unsigned ShardRing::getShards(void)
+{
+        return shards;
+}
+
+
+/***************************************************************************
+* static char* shardPath(const char* output, unsigned shard)
+* Author: agent
+* Date: 10/19/2026
+* Description: Builds the path of a shard log, "<output>.shard<index>"
+*
+* Parameters:
+*        output I/P     const char*     path of the merged log
+*        shard  I/P     unsigned        index of the shard
+*        shardPath      O/P     char*   malloc'd path, nullptr if out of memory
+**************************************************************************/
+static char* shardPath(const char* output, unsigned shard)
+{
+        size_t length = strlen(output) + 32;
+        char* path = (char*)malloc(length);
+        if(path != nullptr)
+                snprintf(path, length, "%s.shard%u", output, shard);
+
+        return path;
+}
+
+/***************************************************************************
+* static bool sendAll(int fd, const void* data, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sends a whole buffer, looping over partial sends
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        data   I/P     const void*     bytes to send
+*        length I/P     size_t  number of bytes
+*        sendAll        O/P     bool    false if the connection failed
+**************************************************************************/
+static bool sendAll(int fd, const void* data, size_t length)
+{
+        const char* p = (const char*)data;
+
+        while(length > 0){
+                int sent = send(fd, p, length > COPY_CHUNK ? COPY_CHUNK : length, 0);
+                if(sent <= 0)
+                        return false;
+                p      += sent;
+                length -= sent;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static bool recvAll(int fd, void* data, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Receives exactly length bytes
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        data   I/O     void*   buffer to fill
+*        length I/P     size_t  number of bytes
+*        recvAll        O/P     bool    false if the connection failed
+**************************************************************************/
+static bool recvAll(int fd, void* data, size_t length)
+{
+        char* p = (char*)data;
+
+        while(length > 0){
+                int read = recv(fd, p, length > COPY_CHUNK ? COPY_CHUNK : length, 0);
+                if(read <= 0)
+                        return false;
+                p      += read;
+                length -= read;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static bool recvLine(int fd, char* line)
+* Author: agent
+* Date: 10/19/2026
+* Description: Receives a single protocol line. Lines are short and only
+*       exchanged once per shard, so they are read a byte at a time to never
+*       read into the payload that follows
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        line   I/O     char*   buffer of LINE_MAX_SIZE bytes, receives the
+*                               line without its newline
+*        recvLine       O/P     bool    false if the connection failed or the
+*                                       line was too long
+**************************************************************************/
+static bool recvLine(int fd, char* line)
+{
+        for(size_t i = 0; i < LINE_MAX_SIZE; i++){
+                if(recv(fd, &line[i], 1, 0) != 1)
+                        return false;
+                if(line[i] == '\n'){
+                        line[i] = '\0';
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/***************************************************************************
+* static long long fileSize(FILE* f)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the size of an open file and rewinds it
+*
+* Parameters:
+*        f      I/P     FILE*   open file
+*        fileSize       O/P     long long       size in bytes, negative on error
+**************************************************************************/
+static long long fileSize(FILE* f)
+{
+        if(fseek(f, 0, SEEK_END))
+                return -1;
+        long long size = ftell(f);
+        rewind(f);
+
+        return size;
+}
+
+/***************************************************************************
+* static bool sendFile(int fd, FILE* f, long long size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sends size bytes of an open file
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        f      I/P     FILE*   file positioned at its start
+*        size   I/P     long long       bytes to send
+*        sendFile       O/P     bool    false if reading or sending failed
+**************************************************************************/
+static bool sendFile(int fd, FILE* f, long long size)
+{
+        char* buffer = (char*)malloc(COPY_CHUNK);
+        if(buffer == nullptr)
+                return false;
+
+        bool ok = true;
+        while(ok && size > 0){
+                size_t want = size > COPY_CHUNK ? COPY_CHUNK : size;
+                ok = fread(buffer, 1, want, f) == want && sendAll(fd, buffer, want);
+                size -= want;
+        }
+
+        free(buffer);
+        return ok;
+}
+
+/***************************************************************************
+* static bool recvFile(int fd, const char* path, unsigned long long size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Receives size bytes into a new file
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        path   I/P     const char*     file to create
+*        size   I/P     unsigned long long      bytes to receive
+*        recvFile       O/P     bool    false if receiving or writing failed
+**************************************************************************/
+static bool recvFile(int fd, const char* path, unsigned long long size)
+{
+        FILE* f = fopen(path, "wb");
+        char* buffer = (char*)malloc(COPY_CHUNK);
+        bool ok = f != nullptr && buffer != nullptr;
+
+        while(ok && size > 0){
+                size_t want = size > COPY_CHUNK ? COPY_CHUNK : size;
+                ok = recvAll(fd, buffer, want) && fwrite(buffer, 1, want, f) == want;
+                size -= want;
+        }
+
+        free(buffer);
+        if(f != nullptr && fclose(f))
+                ok = false;
+
+        return ok;
+}
+
+/***************************************************************************
+* static bool sameToken(const char* received, const char* token)
+* Author: agent
+* Date: 10/19/2026
+* Description: Compares a received token with the expected one. Every byte
+*       is looked at whatever the result, so the time taken does not tell a
+*       guesser how much of the token was right
+*
+* Parameters:
+*        received       I/P     const char*     token the worker sent
+*        token  I/P     const char*     expected token
+*        sameToken      O/P     bool    true if they are equal
+**************************************************************************/
+static bool sameToken(const char* received, const char* token)
+{
+        size_t length = strlen(token);
+        uint8_t diff  = strlen(received) != length;
+
+        for(size_t i = 0; i < length; i++)
+                diff |= (uint8_t)(received[i] ^ token[i]);
+        /*received is at least as long as the loop whenever diff is still 0,
+        *a shorter one stops at its terminator, which differs from the token
+        */
+
+        return diff == 0;
+}
+
+/***************************************************************************
+* static bool checkShardLog(const char* path, size_t targets)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks a shard log a worker sent back. The reader checks
+*       every record against the blob file, and a shard can hold no more
+*       records than it has targets
+*
+* Parameters:
+*        path   I/P     const char*     shard log that was received
+*        targets        I/P     size_t  number of targets in the shard
+*        checkShardLog  O/P     bool    true if the log can be merged
+**************************************************************************/
+static bool checkShardLog(const char* path, size_t targets)
+{
+        BinaryLogReader reader;
+
+        return reader.open(path) == OK && reader.size() <= targets;
+}
+
+
+/***************************************************************************
+* ScanCoordinator::ScanCoordinator(TargetList* targets, unsigned shards)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor
+*
+* Parameters:
+*        targets        I/P     TargetList*     targets to scan, not owned
+*        shards I/P     unsigned        number of shards to split them into
+**************************************************************************/
+ScanCoordinator::ScanCoordinator(TargetList* targets, unsigned shards)
+{
+        this->targets = targets;
+        mode          = PROBE_FULL;
+        shardsDone    = 0;
+        deadline      = SERVE_DEADLINE;
+        bindAddress   = htonl(INADDR_LOOPBACK);
+        token[0]      = '\0';
+        uploadLimit   = UPLOAD_LIMIT;
+
+        ring.build(shards ? shards : 1);
+        shardState = (uint8_t*)calloc(ring.getShards(), 1);
+}
+
+/***************************************************************************
+* ScanCoordinator::~ScanCoordinator()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+ScanCoordinator::~ScanCoordinator()
+{
+        free(shardState);
+}
+
+/***************************************************************************
+* void ScanCoordinator::setProbeMode(probeMode m)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the probe mode the shards are scanned with, remote
+*       workers are told the mode with every shard
+*
+* Parameters:
+*        m      I/P     probeMode       probe mode
+**************************************************************************/
+void ScanCoordinator::setProbeMode(probeMode m)
+{
+        mode = m;
+}
+
+/***************************************************************************
+* void ScanCoordinator::setDeadline(uint32_t seconds)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets how long serve() waits for every shard log to come back
+*       before it gives up, a day by default
+*
+* Parameters:
+*        seconds        I/P     uint32_t        deadline, 0 waits forever
+**************************************************************************/
+void ScanCoordinator::setDeadline(uint32_t seconds)
+{
+        this->deadline = seconds;
+}
+
+/***************************************************************************
+* int ScanCoordinator::setBindAddress(const char* address)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the local IPv4 address serve() listens on, the loopback
+*       address by default. Any address other than a loopback one also
+*       needs a token
+*
+* Parameters:
+*        address        I/P     const char*     dotted IPv4 address,
+*                                               "0.0.0.0" for every interface
+*        setBindAddress O/P     int     OK, or BAD_DOMAIN if it is not an
+*                                       IPv4 address
+**************************************************************************/
+int ScanCoordinator::setBindAddress(const char* address)
+{
+        uint32_t ip;
+        if(address == nullptr || !Ping::parseIPv4(address, strlen(address), &ip))
+                return BAD_DOMAIN;
+
+        bindAddress = ip;
+        return OK;
+}
+
+/***************************************************************************
+* int ScanCoordinator::setToken(const char* token)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the shared token every remote worker has to send in its
+*       HELLO line before it is handed a shard
+*
+* Parameters:
+*        token  I/P     const char*     token of printable characters without
+*                                       spaces, nullptr or "" to clear it
+*        setToken       O/P     int     OK, or INITIALIZATION_FAILURE if the
+*                                       token is too long or not printable
+**************************************************************************/
+int ScanCoordinator::setToken(const char* token)
+{
+        size_t length = token ? strlen(token) : 0;
+        if(length > SHARD_TOKEN_MAX)
+                return INITIALIZATION_FAILURE;
+
+        for(size_t i = 0; i < length; i++){
+                if(token[i] <= ' ' || token[i] > '~')
+                        return INITIALIZATION_FAILURE;
+        }
+        /*the token travels inside a protocol line*/
+
+        memcpy(this->token, token ? token : "", length);
+        this->token[length] = '\0';
+        return OK;
+}
+
+/***************************************************************************
+* void ScanCoordinator::setUploadLimit(uint64_t bytes)
+* Author: agent
+* Date: 10/19/2026
+* Description: Caps the blob file a remote worker may send back for one
+*       shard, 1 GiB by default. The log itself can never be larger than one
+*       record per target of the shard
+*
+* Parameters:
+*        bytes  I/P     uint64_t        largest blob file accepted
+**************************************************************************/
+void ScanCoordinator::setUploadLimit(uint64_t bytes)
+{
+        uploadLimit = bytes;
+}
+
+/***************************************************************************
+* int ScanCoordinator::takeShard(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Takes the next shard nobody is scanning
+*
+* Parameters:
+*        takeShard      O/P     int     index of the shard, -1 if none is left
+**************************************************************************/
+int ScanCoordinator::takeShard(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        for(unsigned i = 0; i < ring.getShards(); i++){
+                if(shardState[i] == SHARD_PENDING){
+                        shardState[i] = SHARD_ASSIGNED;
+                        return i;
+                }
+        }
+
+        return -1;
+}
+
+/***************************************************************************
+* void ScanCoordinator::finishShard(unsigned shard, bool done)
+* Author: agent
+* Date: 10/19/2026
+* Description: Marks an assigned shard as done, or hands it back so the next
+*       worker that connects picks it up
+*
+* Parameters:
+*        shard  I/P     unsigned        index of the shard
+*        done   I/P     bool    true if its log was received
+**************************************************************************/
+void ScanCoordinator::finishShard(unsigned shard, bool done)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(shardState[shard] != SHARD_ASSIGNED)
+                return;
+
+        shardState[shard] = done ? SHARD_DONE : SHARD_PENDING;
+        if(done)
+                shardsDone++;
+}
+
+/***************************************************************************
+* char* ScanCoordinator::buildShard(unsigned shard, size_t* length,
+*                                                       size_t* count)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes the targets of a shard as "host:port" lines, the
+*       format TargetList::loadBuffer() reads
+*
+* Parameters:
+*        shard  I/P     unsigned        index of the shard
+*        length I/O     size_t* receives the length of the text
+*        count  I/O     size_t* receives the number of targets
+*        buildShard     O/P     char*   malloc'd text, nullptr if out of memory
+**************************************************************************/
+char* ScanCoordinator::buildShard(unsigned shard, size_t* length, size_t* count)
+{
+        size_t capacity = 4096;
+        size_t size     = 0;
+        char* text      = (char*)malloc(capacity);
+
+        *count = 0;
+        for(size_t i = 0; text != nullptr && i < targets->size(); i++){
+                const MC_Target* t = targets->getTarget(i);
+                if(ring.shardOf(t->hash) != shard)
+                        continue;
+
+                if(size + t->hostLength + 8 > capacity){
+                        capacity = capacity * 2 + t->hostLength + 8;
+                        char* tmp = (char*)realloc(text, capacity);
+                        if(tmp == nullptr){
+                                free(text);
+                                return nullptr;
+                        }
+                        text = tmp;
+                }
+
+                size += sprintf(text + size, "%s:%u\n", targets->getHost(i),
+                                                                t->port);
+                (*count)++;
+        }
+
+        *length = size;
+        return text;
+}
+
+/***************************************************************************
+* int ScanCoordinator::scanList(TargetList* list, const char* path,
+*                                                       probeMode m)
+* Author: agent
+* Date: 10/19/2026
+* Description: Probes every target of a list one after the other and writes
+*       the results into a new binary log
+*
+* Parameters:
+*        list   I/P     TargetList*     targets to probe
+*        path   I/P     const char*     log to create
+*        m      I/P     probeMode       probe mode
+*        scanList       O/P     int     number of targets probed, or a
+*                                       negative pingError
+**************************************************************************/
+int ScanCoordinator::scanList(TargetList* list, const char* path, probeMode m)
+{
+        BinaryLogSink sink;
+
+        int ret = sink.open(path, false);
+        if(ret != OK)
+                return ret;
+
+        size_t probed = 0;
+        for(size_t i = 0; i < list->size(); i++){
+                Ping* p = list->createPing(i);
+                if(p == nullptr)
+                        return INITIALIZATION_FAILURE;
+
+                p->setSink(&sink);
+                p->setProbeMode(m);
+                p->connectMC();
+                delete p;
+                probed++;
+        }
+
+        sink.close();
+        return probed;
+}
+
+/***************************************************************************
+* int ScanCoordinator::scanShard(unsigned shard, const char* path)
+* Author: agent
+* Date: 10/19/2026
+* Description: Scans the targets of one shard into a log
+*
+* Parameters:
+*        shard  I/P     unsigned        index of the shard
+*        path   I/P     const char*     log to create
+*        scanShard      O/P     int     number of targets probed, or a
+*                                       negative pingError
+**************************************************************************/
+int ScanCoordinator::scanShard(unsigned shard, const char* path)
+{
+        TargetList list;
+
+        for(size_t i = 0; i < targets->size(); i++){
+                const MC_Target* t = targets->getTarget(i);
+                if(ring.shardOf(t->hash) == shard
+                                && list.add(targets->getHost(i), t->port) < 0)
+                        return INITIALIZATION_FAILURE;
+        }
+
+        return scanList(&list, path, mode);
+}
+
+/***************************************************************************
+* int ScanCoordinator::merge(const char* output, const char* const* inputs,
+*                                                               size_t count)
+* Author: agent
+* Date: 10/19/2026
+* Description: Merges binary logs into a new log. The records are copied in
+*       input order and their strings are rewritten into the output's blob
+*       file, so the blob offsets stay valid
+*
+* Parameters:
+*        output I/P     const char*     log to create
+*        inputs I/P     const char* const*      logs to merge
+*        count  I/P     size_t  number of input logs
+*        merge  O/P     int     number of records merged, or a negative
+*                               pingError
+**************************************************************************/
+int ScanCoordinator::merge(const char* output, const char* const* inputs,
+                                                                size_t count)
+{
+        BinaryLogSink sink;
+
+        int ret = sink.open(output, false);
+        if(ret != OK)
+                return ret;
+
+        int merged = 0;
+        for(size_t i = 0; i < count; i++){
+                BinaryLogReader reader;
+
+                ret = reader.open(inputs[i]);
+                if(ret != OK)
+                        return ret;
+
+                for(size_t j = 0; j < reader.size(); j++){
+                        PingResult r;
+                        if(reader.get(j, &r) && sink.write(&r) == OK)
+                                merged++;
+                }
+        }
+
+        if(sink.flush() != OK)
+                return INITIALIZATION_FAILURE;
+
+        return merged;
+}
+
+/***************************************************************************
+* int ScanCoordinator::mergeShards(const char* output)
+* Author: agent
+* Date: 10/19/2026
+* Description: Merges every shard log into the output log and removes the
+*       shard logs once the merge worked
+*
+* Parameters:
+*        output I/P     const char*     log to create
+*        mergeShards    O/P     int     number of records merged, or a
+*                                       negative pingError
+**************************************************************************/
+int ScanCoordinator::mergeShards(const char* output)
+{
+        unsigned shards = ring.getShards();
+        char** paths = (char**)calloc(shards, sizeof(char*));
+        if(paths == nullptr)
+                return INITIALIZATION_FAILURE;
+
+        int ret = OK;
+        for(unsigned i = 0; i < shards && ret == OK; i++){
+                paths[i] = shardPath(output, i);
+                if(paths[i] == nullptr)
+                        ret = INITIALIZATION_FAILURE;
+        }
+
+        if(ret == OK)
+                ret = merge(output, paths, shards);
+
+        for(unsigned i = 0; i < shards; i++){
+                if(ret >= 0 && paths[i] != nullptr){
+                        char blob[LINE_MAX_SIZE + DOMAIN_MAX_SIZE];
+                        remove(paths[i]);
+                        snprintf(blob, sizeof(blob), "%s.blob", paths[i]);
+                        remove(blob);
+                }
+                free(paths[i]);
+        }
+        free(paths);
+
+        return ret;
+}
+
+/***************************************************************************
+* int ScanCoordinator::runLocal(const char* output)
+* Author: agent
+* Date: 10/19/2026
+* Description: Scans every shard in its own forked process, then merges the
+*       shard logs into the output log. No more processes than there are
+*       cores run at once, the next shard starts as one finishes. Not
+*       available on Windows
+*
+* Parameters:
+*        output I/P     const char*     log to create
+*        runLocal       O/P     int     number of records merged, or a
+*                                       negative pingError
+**************************************************************************/
+int ScanCoordinator::runLocal(const char* output)
+{
+#ifdef _WIN32
+        (void)output;
+        return INITIALIZATION_FAILURE;
+#else
+        unsigned shards = ring.getShards();
+        unsigned slots  = ProbeEngine::availableCores();
+        if(slots > shards)
+                slots = shards;
+
+        pid_t* workers = (pid_t*)malloc(slots * sizeof(pid_t));
+        if(workers == nullptr || shardState == nullptr){
+                free(workers);
+                return INITIALIZATION_FAILURE;
+        }
+
+        fflush(nullptr);
+        /*buffered output would otherwise be written once per child*/
+
+        unsigned started = 0;
+        unsigned running = 0;
+        bool failed      = false;
+
+        while(running > 0 || (started < shards && !failed)){
+                while(running < slots && started < shards && !failed){
+                        char* path = shardPath(output, started);
+                        if(path == nullptr){
+                                failed = true;
+                                break;
+                        }
+
+                        pid_t pid = fork();
+                        if(pid == 0){
+                                int ret = scanShard(started, path);
+                                _exit(ret < 0 ? 1 : 0);
+                        }
+                        free(path);
+
+                        if(pid < 0){
+                                failed = true;
+                                break;
+                        }
+                        workers[running++] = pid;
+                        started++;
+                }
+                /*fill every free slot with the next shard*/
+
+                bool reaped = false;
+                for(unsigned i = 0; i < running; i++){
+                        int status;
+                        pid_t pid = waitpid(workers[i], &status, WNOHANG);
+                        if(pid == 0)
+                                continue;
+
+                        if(pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+                                failed = true;
+                        workers[i--] = workers[--running];
+                        reaped = true;
+                }
+                /*only our own children are waited for, other children of
+                *the process are left alone
+                */
+
+                if(!reaped && running > 0)
+                        usleep(REAP_INTERVAL);
+        }
+        free(workers);
+
+        if(failed)
+                return INITIALIZATION_FAILURE;
+        /*the shard logs that were written are kept for inspection*/
+
+        return mergeShards(output);
+#endif // _WIN32
+}
+
+/***************************************************************************
+* int ScanCoordinator::serveWorker(int fd, const char* output)
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs the worker protocol with one connected worker, handing
+*       it shards until none is left. A worker without the token is turned
+*       away. A shard whose log never arrives, is too large or does not
+*       check out is handed back for the next worker
+*
+* Parameters:
+*        fd     I/P     int     connected worker, owned and closed by serve()
+*        output I/P     const char*     path of the merged log
+*        serveWorker    O/P     int     number of shards the worker scanned,
+*                                       or a negative pingError
+**************************************************************************/
+int ScanCoordinator::serveWorker(int fd, const char* output)
+{
+        char line[LINE_MAX_SIZE];
+        int scanned = 0;
+
+        if(!recvLine(fd, line) || strncmp(line, "HELLO", 5)
+                        || (token[0] == '\0' ? line[5] != '\0'
+                        : line[5] != ' ' || !sameToken(line + 6, token))){
+                shutdown(fd, SHUT_RDWR);
+                return BAD_RESPONSE;
+        }
+        /*the connection is only closed once serve() returns, the shutdown
+        *tells a turned away worker right away
+        */
+
+        for(;;){
+                int shard = takeShard();
+                if(shard < 0){
+                        sendAll(fd, "DONE\n", 5);
+                        return scanned;
+                }
+
+                size_t length, count;
+                char* text = buildShard(shard, &length, &count);
+                char* path = shardPath(output, shard);
+                bool done  = false;
+
+                if(text != nullptr && path != nullptr){
+                        int n = snprintf(line, sizeof(line), "SHARD %d %d %zu\n",
+                                                        shard, (int)mode, length);
+                        unsigned index;
+                        unsigned long long logBytes, blobBytes;
+                        char blob[LINE_MAX_SIZE + DOMAIN_MAX_SIZE];
+                        snprintf(blob, sizeof(blob), "%s.blob", path);
+
+                        done = sendAll(fd, line, n)
+                                && sendAll(fd, text, length)
+                                && recvLine(fd, line)
+                                && sscanf(line, "RESULT %u %llu %llu", &index,
+                                                &logBytes, &blobBytes) == 3
+                                && index == (unsigned)shard
+                                && logBytes <= LOG_HEADER_SIZE
+                                        + count * sizeof(MC_LogRecord)
+                                && blobBytes <= uploadLimit
+                                && recvFile(fd, path, logBytes)
+                                && recvFile(fd, blob, blobBytes)
+                                && checkShardLog(path, count);
+                        /*a worker cannot fill the disk, nor have records
+                        *merged that point outside their blob
+                        */
+                }
+                free(text);
+                free(path);
+
+                finishShard(shard, done);
+                if(!done){
+                        shutdown(fd, SHUT_RDWR);
+                        return RECEIVE_FAILURE;
+                }
+                scanned++;
+        }
+}
+
+/***************************************************************************
+* int ScanCoordinator::serve(uint16_t port, const char* output)
+* Author: agent
+* Date: 10/19/2026
+* Description: Listens for remote workers and hands the shards out to them,
+*       one thread per connected worker. Returns once every shard log came
+*       back and was merged into the output log, or once the deadline passed.
+*       At the deadline the workers still connected are cut off and the shard
+*       logs that did arrive are kept for inspection. Listening anywhere but
+*       on a loopback address needs a token
+*
+* Parameters:
+*        port   I/P     uint16_t        TCP port to listen on
+*        output I/P     const char*     log to create
+*        serve  O/P     int     number of records merged, or a negative
+*                               pingError, RECEIVE_FAILURE if the deadline
+*                               passed first
+**************************************************************************/
+int ScanCoordinator::serve(uint16_t port, const char* output)
+{
+        if(shardState == nullptr)
+                return INITIALIZATION_FAILURE;
+        if(token[0] == '\0' && (ntohl(bindAddress) >> 24) != 127)
+                return INITIALIZATION_FAILURE;
+        /*anyone who can reach the port could take shards and send logs*/
+
+        SocketHandle listener(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+        if(!listener.valid())
+                return SOCKET_OPEN_FAILURE;
+
+        int one = 1;
+        setsockopt(listener.get(), SOL_SOCKET, SO_REUSEADDR, (const char*)&one,
+                                                                sizeof(one));
+
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family      = AF_INET;
+        address.sin_port        = htons(port);
+        address.sin_addr.s_addr = bindAddress;
+
+        if(bind(listener.get(), (struct sockaddr*)&address, sizeof(address))
+                                        || listen(listener.get(), 64))
+                return SOCKET_OPEN_FAILURE;
+
+        std::vector<std::thread> workers;
+        std::vector<int> sockets;
+        uint64_t end  = PollScheduler::now() + (uint64_t)deadline * 1000;
+        bool finished = false;
+
+        while(deadline == 0 || PollScheduler::now() < end){
+                {
+                        std::lock_guard<std::mutex> guard(lock);
+                        finished = shardsDone == ring.getShards();
+                }
+                if(finished)
+                        break;
+
+                struct pollfd pfd;
+                pfd.fd      = listener.get();
+                pfd.events  = POLLIN;
+                pfd.revents = 0;
+                if(poll(&pfd, 1, ACCEPT_TIMEOUT) <= 0)
+                        continue;
+                /*woken up regularly to check whether the scan is done, a
+                *receive timeout does not apply to accept() on every platform
+                */
+
+                int fd = accept(listener.get(), nullptr, nullptr);
+                if(fd < 0)
+                        continue;
+
+                sockets.push_back(fd);
+                workers.push_back(std::thread(&ScanCoordinator::serveWorker,
+                                                        this, fd, output));
+        }
+
+        if(!finished){
+                for(size_t i = 0; i < sockets.size(); i++)
+                        shutdown(sockets[i], SHUT_RDWR);
+        }
+        /*the deadline passed, wake up the workers stuck in a transfer*/
+
+        for(size_t i = 0; i < workers.size(); i++){
+                workers[i].join();
+                SocketHandle closing(sockets[i]);
+        }
+
+        {
+                std::lock_guard<std::mutex> guard(lock);
+                finished = shardsDone == ring.getShards();
+        }
+        /*the last shard may have come back right at the deadline*/
+
+        if(!finished)
+                return RECEIVE_FAILURE;
+
+        return mergeShards(output);
+}
+
+/***************************************************************************
+* int ScanCoordinator::runWorker(const char* host, uint16_t port,
+*                                                       const char* workPath)
+* Author: agent
+* Date: 10/19/2026
+* Description: Connects to a coordinator started with serve() and scans the
+*       shards it hands out until it says DONE
+*
+* Parameters:
+*        host   I/P     const char*     address of the coordinator
+*        port   I/P     uint16_t        port of the coordinator
+*        workPath       I/P     const char*     scratch log each shard is
+*                                               scanned into
+*        token  I/P     const char*     token the coordinator expects, or
+*                                       nullptr
+*        runWorker      O/P     int     number of shards scanned, or a
+*                                       negative pingError
+**************************************************************************/
+int ScanCoordinator::runWorker(const char* host, uint16_t port,
+                                const char* workPath, const char* token)
+{
+        if(token != nullptr && strlen(token) > SHARD_TOKEN_MAX)
+                return INITIALIZATION_FAILURE;
+
+        char line[LINE_MAX_SIZE];
+        int hello = snprintf(line, sizeof(line), token && *token ? "HELLO %s\n"
+                                                        : "HELLO\n", token);
+
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port   = htons(port);
+
+        uint32_t ip;
+        pingError resolved = Ping::resolveIPv4(host, &ip);
+        if(resolved != OK)
+                return resolved;
+        address.sin_addr.s_addr = ip;
+
+        SocketHandle sock(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+        if(!sock.valid())
+                return SOCKET_OPEN_FAILURE;
+        if(connect(sock.get(), (struct sockaddr*)&address, sizeof(address)))
+                return CONNECT_FAILURE;
+        if(!sendAll(sock.get(), line, hello))
+                return SEND_FAILURE;
+
+        size_t blobLength = strlen(workPath) + sizeof(".blob");
+        char* blobPath = (char*)malloc(blobLength);
+        if(blobPath == nullptr)
+                return INITIALIZATION_FAILURE;
+        snprintf(blobPath, blobLength, "%s.blob", workPath);
+
+        int scanned = 0;
+        int ret     = OK;
+
+        while(ret == OK){
+                unsigned shard;
+                int m;
+                size_t length;
+
+                if(!recvLine(sock.get(), line)){
+                        ret = RECEIVE_FAILURE;
+                        break;
+                }
+                if(!strcmp(line, "DONE"))
+                        break;
+                if(sscanf(line, "SHARD %u %d %zu", &shard, &m, &length) != 3
+                                                || length > UPLOAD_LIMIT){
+                        ret = BAD_RESPONSE;
+                        break;
+                }
+
+                char* text = (char*)malloc(length ? length : 1);
+                if(text == nullptr){
+                        ret = INITIALIZATION_FAILURE;
+                        break;
+                }
+                if(!recvAll(sock.get(), text, length)){
+                        free(text);
+                        ret = RECEIVE_FAILURE;
+                        break;
+                }
+
+                TargetList list;
+                int loaded = list.loadBuffer(text, length);
+                free(text);
+                if(loaded < 0){
+                        ret = loaded;
+                        break;
+                }
+
+                int probed = scanList(&list, workPath, (probeMode)m);
+                if(probed < 0){
+                        ret = probed;
+                        break;
+                }
+
+                FILE* log  = fopen(workPath, "rb");
+                FILE* blob = fopen(blobPath, "rb");
+                long long logBytes  = log ? fileSize(log) : -1;
+                long long blobBytes = blob ? fileSize(blob) : -1;
+
+                if(logBytes < 0 || blobBytes < 0){
+                        ret = INITIALIZATION_FAILURE;
+                }
+                else{
+                        int n = snprintf(line, sizeof(line), "RESULT %u %lld %lld\n",
+                                                shard, logBytes, blobBytes);
+                        if(!sendAll(sock.get(), line, n)
+                                        || !sendFile(sock.get(), log, logBytes)
+                                        || !sendFile(sock.get(), blob, blobBytes))
+                                ret = SEND_FAILURE;
+                        else
+                                scanned++;
+                }
+
+                if(log != nullptr)
+                        fclose(log);
+                if(blob != nullptr)
+                        fclose(blob);
+        }
+
+        remove(workPath);
+        remove(blobPath);
+        free(blobPath);
+
+        return ret == OK ? scanned : ret;
+}
@@ -0,0 +1,1094 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+/***************************************************************************
+* File:  sinks.cpp
+* Author:  agent
+* Procedures:
+* writeEscaped  -Writes a JSON escaped string
+* skipSpace     -Skips JSON whitespace
+* scanString    -Checks a JSON string
+* scanNumber    -Checks a JSON number
+* scanLiteral   -Checks true, false or null
+* isJSONObject  -Checks that a response is exactly one JSON object
+* writeResponse -Writes a server response as a JSON value
+* NDJSONSink()  -Default constructor
+* ~NDJSONSink() -Destructor
+* NDJSONSink::open      -Opens the output file
+* NDJSONSink::write     -Writes a result as a single JSON line
+* NDJSONSink::flush     -Flushes buffered lines to disk
+* NDJSONSink::close     -Flushes and closes the output file
+* BinaryLogSink()       -Default constructor
+* ~BinaryLogSink()      -Destructor
+* BinaryLogSink::open   -Opens or creates the log and blob files
+* BinaryLogSink::write  -Appends a result to the log
+* BinaryLogSink::writeLocked    -Appends a result, lock already held
+* BinaryLogSink::flush  -Flushes the blob and log files to disk
+* BinaryLogSink::close  -Flushes and closes the log
+* mc_mapFile    -Memory-maps a whole file read only
+* mc_unmapFile  -Releases a mapping made by mc_mapFile
+* validRecord   -Checks that a log record lies inside the blob file
+* BinaryLogReader()     -Default constructor
+* ~BinaryLogReader()    -Destructor
+* BinaryLogReader::open -Memory-maps a log and its blob file
+* BinaryLogReader::size -Returns the number of records
+* BinaryLogReader::getRecord    -Returns a raw record
+* BinaryLogReader::get  -Fills a PingResult from a record
+* BinaryLogReader::close        -Releases the mappings
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+#include <ctype.h>
+
+
+#define BLOB_SUFFIX ".blob"
+#define JSON_MAX_DEPTH 64
+/*deepest nesting of a response that is still embedded as an object*/
+
+
+/***************************************************************************
+* static void writeEscaped(FILE* f, const char* in, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes a string as a quoted and escaped JSON string
+*
+* Parameters:
+*        f      I/P     FILE*   file to write to
+*        in     I/P     const char*     string to write
+*        length I/P     size_t  length of the string
+**************************************************************************/
+static void writeEscaped(FILE* f, const char* in, size_t length)
+{
+        size_t start = 0;
+
+        fputc('"', f);
+
+        for(size_t i = 0; i < length; i++){
+                unsigned char c = in[i];
+
+                if(c >= 0x20 && c != '"' && c != '\\')
+                        continue;
+                /*runs of plain characters are written in one go*/
+
+                fwrite(in + start, 1, i - start, f);
+                if(c == '"' || c == '\\')
+                        fprintf(f, "\\%c", c);
+                else
+                        fprintf(f, "\\u%04x", c);
+                start = i + 1;
+        }
+
+        fwrite(in + start, 1, length - start, f);
+        fputc('"', f);
+}
+
+/***************************************************************************
+* static size_t skipSpace(const char* in, size_t i, size_t end)
+* Author: agent
+* Date: 10/19/2026
+* Description: Skips JSON whitespace
+*
+* Parameters:
+*        in     I/P     const char*     text to scan
+*        i      I/P     size_t  position to start at
+*        end    I/P     size_t  end of the text
+*        skipSpace      O/P     size_t  position of the next token
+**************************************************************************/
+static size_t skipSpace(const char* in, size_t i, size_t end)
+{
+        while(i < end && (in[i] == ' ' || in[i] == '\t' || in[i] == '\r'
+                                                        || in[i] == '\n'))
+                i++;
+
+        return i;
+}
+
+/***************************************************************************
+* static bool scanString(const char* in, size_t* i, size_t end)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks the JSON string that starts at *i and moves past it
+*
+* Parameters:
+*        in     I/P     const char*     text to scan
+*        i      I/O     size_t* position of the opening quote
+*        end    I/P     size_t  end of the text
+*        scanString     O/P     bool    false if the string is not valid
+**************************************************************************/
+static bool scanString(const char* in, size_t* i, size_t end)
+{
+        size_t p = *i + 1;
+
+        while(p < end){
+                unsigned char c = in[p++];
+
+                if(c == '"'){
+                        *i = p;
+                        return true;
+                }
+                if(c < 0x20)
+                        return false;
+                /*control characters have to be escaped*/
+                if(c != '\\')
+                        continue;
+                if(p >= end)
+                        return false;
+
+                c = in[p++];
+                if(c == 'u'){
+                        for(int k = 0; k < 4; k++, p++){
+                                if(p >= end || !isxdigit((unsigned char)in[p]))
+                                        return false;
+                        }
+                }
+                else if(strchr("\"\\/bfnrt", c) == nullptr || c == '\000')
+                        return false;
+        }
+
+        return false;
+}
+
+/***************************************************************************
+* static bool scanNumber(const char* in, size_t* i, size_t end)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks the JSON number that starts at *i and moves past it
+*
+* Parameters:
+*        in     I/P     const char*     text to scan
+*        i      I/O     size_t* position of the number
+*        end    I/P     size_t  end of the text
+*        scanNumber     O/P     bool    false if the number is not valid
+**************************************************************************/
+static bool scanNumber(const char* in, size_t* i, size_t end)
+{
+        size_t p = *i;
+
+        if(p < end && in[p] == '-')
+                p++;
+        if(p >= end || !isdigit((unsigned char)in[p]))
+                return false;
+        if(in[p] == '0')
+                p++;
+        else{
+                while(p < end && isdigit((unsigned char)in[p]))
+                        p++;
+        }
+
+        if(p < end && in[p] == '.'){
+                p++;
+                if(p >= end || !isdigit((unsigned char)in[p]))
+                        return false;
+                while(p < end && isdigit((unsigned char)in[p]))
+                        p++;
+        }
+
+        if(p < end && (in[p] == 'e' || in[p] == 'E')){
+                p++;
+                if(p < end && (in[p] == '+' || in[p] == '-'))
+                        p++;
+                if(p >= end || !isdigit((unsigned char)in[p]))
+                        return false;
+                while(p < end && isdigit((unsigned char)in[p]))
+                        p++;
+        }
+
+        *i = p;
+        return true;
+}
+
+/***************************************************************************
+* static bool scanLiteral(const char* in, size_t* i, size_t end)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks the true, false or null literal that starts at *i and
+*       moves past it
+*
+* Parameters:
+*        in     I/P     const char*     text to scan
+*        i      I/O     size_t* position of the literal
+*        end    I/P     size_t  end of the text
+*        scanLiteral    O/P     bool    false if there is no literal
+**************************************************************************/
+static bool scanLiteral(const char* in, size_t* i, size_t end)
+{
+        static const char* literals[] = {"true", "false", "null"};
+
+        for(int k = 0; k < 3; k++){
+                size_t n = strlen(literals[k]);
+                if(end - *i >= n && memcmp(in + *i, literals[k], n) == 0){
+                        *i += n;
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/***************************************************************************
+* static bool isJSONObject(const char* in, size_t first, size_t last)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks that a response is exactly one well formed JSON object
+*       with nothing after it, so embedding it cannot end the record early
+*       or add fields to it. Nesting deeper than JSON_MAX_DEPTH is rejected
+*
+* Parameters:
+*        in     I/P     const char*     response to check
+*        first  I/P     size_t  position of the opening brace
+*        last   I/P     size_t  end of the response, trailing space removed
+*        isJSONObject   O/P     bool    true if the response can be embedded
+**************************************************************************/
+static bool isJSONObject(const char* in, size_t first, size_t last)
+{
+        char stack[JSON_MAX_DEPTH];
+        /*the open containers, '{' or '['*/
+        size_t depth = 0;
+        size_t i = first;
+        bool wantValue = true;
+
+        while(true){
+                i = skipSpace(in, i, last);
+                if(i >= last)
+                        return false;
+
+                if(wantValue){
+                        char c = in[i];
+
+                        if(c == '{' || c == '['){
+                                if(depth == JSON_MAX_DEPTH)
+                                        return false;
+                                stack[depth++] = c;
+                                i = skipSpace(in, i + 1, last);
+                                if(i < last && in[i] == (c == '{' ? '}' : ']')){
+                                        depth--;
+                                        i++;
+                                        wantValue = false;
+                                }
+                                else if(c == '{'){
+                                        if(i >= last || in[i] != '"'
+                                                || !scanString(in, &i, last))
+                                                return false;
+                                        i = skipSpace(in, i, last);
+                                        if(i >= last || in[i++] != ':')
+                                                return false;
+                                }
+                                /*an object starts with its first key, an
+                                *array with its first value
+                                */
+                                if(depth == 0)
+                                        break;
+                                continue;
+                        }
+
+                        if(c == '"'){
+                                if(!scanString(in, &i, last))
+                                        return false;
+                        }
+                        else if(c == '-' || isdigit((unsigned char)c)){
+                                if(!scanNumber(in, &i, last))
+                                        return false;
+                        }
+                        else if(!scanLiteral(in, &i, last))
+                                return false;
+
+                        wantValue = false;
+                        continue;
+                }
+
+                char c = in[i++];
+                char open = stack[depth-1];
+
+                if(c == ','){
+                        if(open == '{'){
+                                i = skipSpace(in, i, last);
+                                if(i >= last || in[i] != '"'
+                                                || !scanString(in, &i, last))
+                                        return false;
+                                i = skipSpace(in, i, last);
+                                if(i >= last || in[i++] != ':')
+                                        return false;
+                        }
+                        wantValue = true;
+                }
+                else if((c == '}' && open == '{') || (c == ']' && open == '[')){
+                        if(--depth == 0)
+                                break;
+                }
+                else
+                        return false;
+        }
+
+        return skipSpace(in, i, last) == last;
+}
+
+/***************************************************************************
+* static void writeResponse(FILE* f, const char* in, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes a server response as a JSON value. Responses that are
+*       well formed JSON objects are embedded as-is with line breaks
+*       flattened so the record stays on one line, anything else is written
+*       as a string
+*
+* Parameters:
+*        f      I/P     FILE*   file to write to
+*        in     I/P     const char*     response to write
+*        length I/P     size_t  length of the response
+**************************************************************************/
+static void writeResponse(FILE* f, const char* in, size_t length)
+{
+        size_t first = 0;
+        size_t last  = length;
+
+        while(first < length && (in[first] == ' ' || in[first] == '\t'
+                        || in[first] == '\r' || in[first] == '\n'))
+                first++;
+        while(last > first && (in[last-1] == ' ' || in[last-1] == '\t'
+                        || in[last-1] == '\r' || in[last-1] == '\n'))
+                last--;
+
+        if(last - first < 2 || in[first] != '{'
+                                || !isJSONObject(in, first, last)){
+                writeEscaped(f, in, length);
+                return;
+        }
+        /*not an object, keep it as a string so the line stays valid JSON and
+        *a hostile server cannot forge fields of the record
+        */
+
+        size_t start = first;
+        for(size_t i = first; i < last; i++){
+                if(in[i] == '\n' || in[i] == '\r'){
+                        fwrite(in + start, 1, i - start, f);
+                        fputc(' ', f);
+                        start = i + 1;
+                }
+        }
+        /*raw line breaks can only be whitespace between JSON tokens*/
+
+        fwrite(in + start, 1, last - start, f);
+}
+
+/***************************************************************************
+* NDJSONSink::NDJSONSink()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor
+*
+* Parameters:
+**************************************************************************/
+NDJSONSink::NDJSONSink()
+{
+        file   = nullptr;
+        buffer = nullptr;
+}
+
+/***************************************************************************
+* NDJSONSink::~NDJSONSink()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor, flushes anything still buffered
+*
+* Parameters:
+**************************************************************************/
+NDJSONSink::~NDJSONSink()
+{
+        close();
+}
+
+/***************************************************************************
+* int NDJSONSink::open(const char* path, bool append)
+* Author: agent
+* Date: 10/19/2026
+* Description: Opens the output file with a SINK_BUFFER_SIZE write buffer
+*
+* Parameters:
+*        path   I/P     const char*     file to write to
+*        append I/P     bool    append to the file instead of truncating it
+*        open   O/P     int     OK, or INITIALIZATION_FAILURE
+**************************************************************************/
+int NDJSONSink::open(const char* path, bool append)
+{
+        close();
+
+        buffer = (char*)malloc(SINK_BUFFER_SIZE);
+        if(buffer == nullptr)
+                return INITIALIZATION_FAILURE;
+
+        file = fopen(path, append ? "ab" : "wb");
+        if(file == nullptr){
+                free(buffer);
+                buffer = nullptr;
+                return INITIALIZATION_FAILURE;
+        }
+
+        setvbuf(file, buffer, _IOFBF, SINK_BUFFER_SIZE);
+        /*lines are only handed to the OS once the buffer fills up*/
+
+        return OK;
+}
+
+/***************************************************************************
+* int NDJSONSink::write(const PingResult* result)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes a result as a single JSON line
+*
+* Parameters:
+*        result I/P     const PingResult*       result to write
+*        write  O/P     int     OK, or SEND_FAILURE if the sink is not open or
+*                               the file could not be written to
+**************************************************************************/
+int NDJSONSink::write(const PingResult* result)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(file == nullptr)
+                return SEND_FAILURE;
+
+        const uint8_t* ip = (const uint8_t*)&result->ipv4;
+        /*the address is in network byte order, so the bytes are already in
+        *dotted order. inet_ntoa is avoided as it is not thread safe
+        */
+
+        fputs("{\"host\":", file);
+        writeEscaped(file, result->host, strlen(result->host));
+        fprintf(file, ",\"port\":%u,\"ip\":\"%u.%u.%u.%u\",\"time\":%llu,"
+                        "\"error\":%d,\"dns_error\":%d,\"latency\":%ld,"
+                        "\"kernel_rtt_us\":%ld,\"stamped_latency_us\":%ld,"
+                        "\"fast_open\":%s,\"response\":",
+                        result->port,
+                        ip[0], ip[1], ip[2], ip[3],
+                        (unsigned long long)result->timestamp,
+                        (int)result->error,
+                        (int)result->dnsError,
+                        result->milliseconds,
+                        result->kernelRtt,
+                        result->stampedPing,
+                        result->fastOpen ? "true" : "false");
+
+        if(result->response != nullptr)
+                writeResponse(file, result->response, result->responseLength);
+        else
+                fputs("null", file);
+
+        fputs("}\n", file);
+
+        if(ferror(file))
+                return SEND_FAILURE;
+        /*a full disk shows up as a failed write of the buffer, and stays
+        *reported until the sink is reopened
+        */
+
+        return OK;
+}
+
+/***************************************************************************
+* int NDJSONSink::flush(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Flushes buffered lines to disk
+*
+* Parameters:
+*        flush  O/P     int     OK, or SEND_FAILURE
+**************************************************************************/
+int NDJSONSink::flush(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(file == nullptr || fflush(file) != 0)
+                return SEND_FAILURE;
+
+        return OK;
+}
+
+/***************************************************************************
+* void NDJSONSink::close(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Flushes and closes the output file
+*
+* Parameters:
+**************************************************************************/
+void NDJSONSink::close(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(file != nullptr)
+                fclose(file);
+        free(buffer);
+        /*the buffer can only be freed after fclose has flushed it*/
+
+        file   = nullptr;
+        buffer = nullptr;
+}
+
+/***************************************************************************
+* BinaryLogSink::BinaryLogSink()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor
+*
+* Parameters:
+**************************************************************************/
+BinaryLogSink::BinaryLogSink()
+{
+        records      = nullptr;
+        blobs        = nullptr;
+        recordBuffer = nullptr;
+        blobBuffer   = nullptr;
+        blobSize     = 0;
+}
+
+/***************************************************************************
+* BinaryLogSink::~BinaryLogSink()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor, flushes anything still buffered
+*
+* Parameters:
+**************************************************************************/
+BinaryLogSink::~BinaryLogSink()
+{
+        close();
+}
+
+/***************************************************************************
+* int BinaryLogSink::open(const char* path, bool append)
+* Author: agent
+* Date: 10/19/2026
+* Description: Opens or creates the log file and its "<path>.blob" file. An
+*       existing log is appended to if its header matches
+*
+* Parameters:
+*        path   I/P     const char*     path of the log file
+*        append I/P     bool    append to an existing log instead of
+*                                       truncating it
+*        open   O/P     int     OK, BAD_RESPONSE if the existing file is not
+*                                       a log, or INITIALIZATION_FAILURE
+**************************************************************************/
+int BinaryLogSink::open(const char* path, bool append)
+{
+        close();
+
+        size_t pathLength = strlen(path);
+        char* blobPath = (char*)malloc(pathLength + sizeof(BLOB_SUFFIX));
+        if(blobPath == nullptr)
+                return INITIALIZATION_FAILURE;
+        memcpy(blobPath, path, pathLength);
+        memcpy(blobPath + pathLength, BLOB_SUFFIX, sizeof(BLOB_SUFFIX));
+
+        records = fopen(path, append ? "ab+" : "wb+");
+        blobs   = fopen(blobPath, append ? "ab" : "wb");
+        free(blobPath);
+
+        recordBuffer = (char*)malloc(SINK_BUFFER_SIZE);
+        blobBuffer   = (char*)malloc(SINK_BUFFER_SIZE);
+
+        if(records == nullptr || blobs == nullptr
+                        || recordBuffer == nullptr || blobBuffer == nullptr){
+                close();
+                return INITIALIZATION_FAILURE;
+        }
+
+        setvbuf(records, recordBuffer, _IOFBF, SINK_BUFFER_SIZE);
+        setvbuf(blobs, blobBuffer, _IOFBF, SINK_BUFFER_SIZE);
+        /*the buffers have to be set before any other operation on the files*/
+
+        fseek(records, 0, SEEK_END);
+        fseek(blobs, 0, SEEK_END);
+        long recordSize = ftell(records);
+        blobSize = ftell(blobs);
+        /*append mode writes always go to the end, find out how much is
+        *already there
+        */
+
+        uint8_t header[LOG_HEADER_SIZE];
+
+        if(recordSize == 0){
+                memset(header, 0, sizeof(header));
+                memcpy(header, LOG_MAGIC, sizeof(LOG_MAGIC));
+                uint32_t size = sizeof(MC_LogRecord);
+                memcpy(header + 8, &size, sizeof(size));
+
+                if(fwrite(header, 1, sizeof(header), records) != sizeof(header)){
+                        close();
+                        return INITIALIZATION_FAILURE;
+                }
+        }
+        else{
+                uint32_t size = 0;
+
+                fseek(records, 0, SEEK_SET);
+                if(fread(header, 1, sizeof(header), records) == sizeof(header))
+                        memcpy(&size, header + 8, sizeof(size));
+
+                if(size != sizeof(MC_LogRecord)
+                                || memcmp(header, LOG_MAGIC, sizeof(LOG_MAGIC))){
+                        close();
+                        return BAD_RESPONSE;
+                }
+                fseek(records, 0, SEEK_END);
+        }
+        /*new logs get a header, existing logs must have a matching one*/
+
+        return OK;
+}
+
+/***************************************************************************
+* int BinaryLogSink::write(const PingResult* result)
+* Author: agent
+* Date: 10/19/2026
+* Description: Appends a result to the log
+*
+* Parameters:
+*        result I/P     const PingResult*       result to write
+*        write  O/P     int     OK, or SEND_FAILURE
+**************************************************************************/
+int BinaryLogSink::write(const PingResult* result)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        return writeLocked(result);
+}
+
+/***************************************************************************
+* int BinaryLogSink::writeLocked(const PingResult* result)
+* Author: agent
+* Date: 10/19/2026
+* Description: Appends a result to the log, the caller holds the lock. The
+*       strings go into the blob file first, then the record pointing at them
+*
+* Parameters:
+*        result I/P     const PingResult*       result to write
+*        writeLocked    O/P     int     OK, or SEND_FAILURE
+**************************************************************************/
+int BinaryLogSink::writeLocked(const PingResult* result)
+{
+        if(records == nullptr)
+                return SEND_FAILURE;
+
+        size_t hostLength = strnlen(result->host, DOMAIN_MAX_SIZE);
+
+        MC_LogRecord r;
+        memset(&r, 0, sizeof(r));
+        r.timestamp      = result->timestamp;
+        r.blobOffset     = blobSize;
+        r.responseLength = result->response ? result->responseLength : 0;
+        r.ipv4           = result->ipv4;
+        r.milliseconds   = result->milliseconds;
+        r.port           = result->port;
+        r.error          = result->error;
+        r.dnsError       = result->dnsError;
+        r.hostLength     = hostLength;
+        r.flags          = (result->response ? LOG_HAS_RESPONSE : 0)
+                        | (result->fastOpen ? LOG_FAST_OPEN : 0);
+
+        if(fwrite(result->host, 1, hostLength, blobs) != hostLength
+                        || fputc('\000', blobs) == EOF)
+                return SEND_FAILURE;
+        blobSize += hostLength + 1;
+
+        if(result->response != nullptr){
+                if(fwrite(result->response, 1, r.responseLength, blobs)
+                                        != r.responseLength
+                                || fputc('\000', blobs) == EOF)
+                        return SEND_FAILURE;
+                blobSize += r.responseLength + 1;
+        }
+        /*both strings keep their terminators so a reader can hand out
+        *pointers straight into the mapping
+        */
+
+        if(fwrite(&r, sizeof(r), 1, records) != 1)
+                return SEND_FAILURE;
+
+        return OK;
+}
+
+/***************************************************************************
+* int BinaryLogSink::flush(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Flushes the blob file and then the log file, so a record on
+*       disk never points past the end of the blobs
+*
+* Parameters:
+*        flush  O/P     int     OK, or SEND_FAILURE
+**************************************************************************/
+int BinaryLogSink::flush(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(records == nullptr || fflush(blobs) != 0 || fflush(records) != 0)
+                return SEND_FAILURE;
+
+        return OK;
+}
+
+/***************************************************************************
+* void BinaryLogSink::close(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Flushes and closes the log
+*
+* Parameters:
+**************************************************************************/
+void BinaryLogSink::close(void)
+{
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(blobs != nullptr)
+                fclose(blobs);
+        if(records != nullptr)
+                fclose(records);
+        free(blobBuffer);
+        free(recordBuffer);
+
+        records      = nullptr;
+        blobs        = nullptr;
+        recordBuffer = nullptr;
+        blobBuffer   = nullptr;
+        blobSize     = 0;
+}
+
+/***************************************************************************
+* const void* mc_mapFile(const char* path, size_t* size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Memory-maps a whole file read only
+*
+* Parameters:
+*        path   I/P     const char*     file to map
+*        size   I/O     size_t* size of the mapping
+*        mc_mapFile     O/P     const void*     mapping, nullptr on failure or
+*                                               if the file is empty
+**************************************************************************/
+const void* mc_mapFile(const char* path, size_t* size)
+{
+        *size = 0;
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ
+                        | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0, NULL);
+        if(file == INVALID_HANDLE_VALUE)
+                return nullptr;
+
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0){
+                CloseHandle(file);
+                return nullptr;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if(mapping == NULL)
+                return nullptr;
+
+        const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        /*the view keeps the mapping alive*/
+        if(data == NULL)
+                return nullptr;
+
+        *size = fileSize.QuadPart;
+        return data;
+#else
+        int fd = open(path, O_RDONLY);
+        if(fd < 0)
+                return nullptr;
+
+        struct stat st;
+        if(fstat(fd, &st) < 0 || st.st_size == 0){
+                close(fd);
+                return nullptr;
+        }
+
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if(data == MAP_FAILED)
+                return nullptr;
+
+        *size = st.st_size;
+        return data;
+#endif // _WIN32
+}
+
+/***************************************************************************
+* void mc_unmapFile(const void* data, size_t size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Releases a mapping made by mc_mapFile
+*
+* Parameters:
+*        data   I/P     const void*     mapping to release
+*        size   I/P     size_t  size of the mapping
+**************************************************************************/
+void mc_unmapFile(const void* data, size_t size)
+{
+        if(data == nullptr)
+                return;
+
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        (void)size;
+#else
+        munmap((void*)data, size);
+#endif // _WIN32
+}
+
+/***************************************************************************
+* static bool validRecord(const MC_LogRecord* r, const char* blob,
+*                                                       size_t blobSize)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks that a log record's strings lie inside the blob file,
+*       that each ends with its null terminator where the record says and
+*       that the host has no null inside it. The sums are checked against
+*       what is left of the blob, so huge offsets and lengths cannot wrap
+*
+* Parameters:
+*        r      I/P     const MC_LogRecord*     record to check
+*        blob   I/P     const char*     blob file mapping
+*        blobSize       I/P     size_t  size of the blob file mapping
+*        validRecord    O/P     bool    true if the record can be read
+**************************************************************************/
+static bool validRecord(const MC_LogRecord* r, const char* blob, size_t blobSize)
+{
+        if(r->blobOffset >= blobSize
+                        || (uint64_t)r->hostLength >= blobSize - r->blobOffset)
+                return false;
+
+        const char* host = blob + r->blobOffset;
+        if(host[r->hostLength] != '\000'
+                        || memchr(host, '\000', r->hostLength) != nullptr)
+                return false;
+
+        if(r->flags & LOG_HAS_RESPONSE){
+                uint64_t left = blobSize - r->blobOffset - r->hostLength - 1;
+                if((uint64_t)r->responseLength >= left
+                                || host[r->hostLength + 1 + r->responseLength]
+                                                                != '\000')
+                        return false;
+        }
+        else if(r->responseLength != 0)
+                return false;
+
+        return r->error >= BUFFER_TRUNCATED && r->error <= UNCHANGED
+                        && r->dnsError <= INVALID_DOMAIN;
+}
+
+/***************************************************************************
+* BinaryLogReader::BinaryLogReader()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor
+*
+* Parameters:
+**************************************************************************/
+BinaryLogReader::BinaryLogReader()
+{
+        recordMap     = nullptr;
+        recordMapSize = 0;
+        blobMap       = nullptr;
+        blobMapSize   = 0;
+        count         = 0;
+}
+
+/***************************************************************************
+* BinaryLogReader::~BinaryLogReader()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+BinaryLogReader::~BinaryLogReader()
+{
+        close();
+}
+
+/***************************************************************************
+* int BinaryLogReader::open(const char* path)
+* Author: agent
+* Date: 10/19/2026
+* Description: Memory-maps a log and its blob file and checks every record.
+*       Trailing records whose strings never made it to disk are ignored,
+*       any other record that points outside the blob makes the log corrupt
+*
+* Parameters:
+*        path   I/P     const char*     path of the log file
+*        open   O/P     int     OK, BAD_RESPONSE if it is not a log or it is
+*                               corrupt, or INITIALIZATION_FAILURE
+**************************************************************************/
+int BinaryLogReader::open(const char* path)
+{
+        close();
+
+        recordMap = (const uint8_t*)mc_mapFile(path, &recordMapSize);
+        if(recordMap == nullptr)
+                return INITIALIZATION_FAILURE;
+
+        uint32_t size = 0;
+        if(recordMapSize >= LOG_HEADER_SIZE)
+                memcpy(&size, recordMap + 8, sizeof(size));
+
+        if(size != sizeof(MC_LogRecord)
+                        || memcmp(recordMap, LOG_MAGIC, sizeof(LOG_MAGIC))){
+                close();
+                return BAD_RESPONSE;
+        }
+
+        size_t pathLength = strlen(path);
+        char* blobPath = (char*)malloc(pathLength + sizeof(BLOB_SUFFIX));
+        if(blobPath == nullptr){
+                close();
+                return INITIALIZATION_FAILURE;
+        }
+        memcpy(blobPath, path, pathLength);
+        memcpy(blobPath + pathLength, BLOB_SUFFIX, sizeof(BLOB_SUFFIX));
+
+        blobMap = (const char*)mc_mapFile(blobPath, &blobMapSize);
+        free(blobPath);
+        /*an empty blob file is only valid for an empty log*/
+
+        count = (recordMapSize - LOG_HEADER_SIZE) / sizeof(MC_LogRecord);
+
+        while(count > 0 && !validRecord(getRecord(count - 1), blobMap,
+                                                                blobMapSize))
+                count--;
+        /*drop trailing records whose strings never made it to disk*/
+
+        for(size_t i = 0; i < count; i++){
+                if(!validRecord(getRecord(i), blobMap, blobMapSize)){
+                        close();
+                        return BAD_RESPONSE;
+                }
+        }
+
+        return OK;
+}
+
+/***************************************************************************
+* size_t BinaryLogReader::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of records in the log
+*
+* Parameters:
+*        size   O/P     size_t  number of records
+**************************************************************************/
+size_t BinaryLogReader::size(void)
+{
+        return count;
+}
+
+/***************************************************************************
+* const MC_LogRecord* BinaryLogReader::getRecord(size_t index)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns a raw record of the log
+*
+* Parameters:
+*        index  I/P     size_t  index of the record
+*        getRecord      O/P     const MC_LogRecord*     record, nullptr if out
+*                                                       of range
+**************************************************************************/
+const MC_LogRecord* BinaryLogReader::getRecord(size_t index)
+{
+        if(recordMap == nullptr
+                        || LOG_HEADER_SIZE + (index + 1) * sizeof(MC_LogRecord)
+                                > recordMapSize)
+                return nullptr;
+
+        return (const MC_LogRecord*)(recordMap + LOG_HEADER_SIZE
+                                        + index * sizeof(MC_LogRecord));
+}
+
+/***************************************************************************
+* bool BinaryLogReader::get(size_t index, PingResult* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Fills a PingResult from a record of the log. The strings point
+*       into the mapping
+*
+* Parameters:
+*        index  I/P     size_t  index of the record
+*        out    I/O     PingResult*     result to fill
+*        get    O/P     bool    false if out of range or the record no
+*                               longer fits the blob
+**************************************************************************/
+bool BinaryLogReader::get(size_t index, PingResult* out)
+{
+        if(index >= count)
+                return false;
+
+        const MC_LogRecord* r = getRecord(index);
+        if(!validRecord(r, blobMap, blobMapSize))
+                return false;
+        /*the files are mapped shared, another process may rewrite them*/
+
+        out->host           = blobMap + r->blobOffset;
+        out->response       = (r->flags & LOG_HAS_RESPONSE) ?
+                                blobMap + r->blobOffset + r->hostLength + 1 :
+                                nullptr;
+        out->responseLength = r->responseLength;
+        out->timestamp      = r->timestamp;
+        out->ipv4           = r->ipv4;
+        out->port           = r->port;
+        out->error          = (pingError)r->error;
+        out->dnsError       = (DNS_ERROR)r->dnsError;
+        out->milliseconds   = r->milliseconds;
+        out->kernelRtt      = -1;
+        out->stampedPing    = -1;
+        /*the log format only keeps the application latency*/
+        out->fastOpen       = (r->flags & LOG_FAST_OPEN) != 0;
+
+        return true;
+}
+
+/***************************************************************************
+* void BinaryLogReader::close(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Releases the mappings
+*
+* Parameters:
+**************************************************************************/
+void BinaryLogReader::close(void)
+{
+        mc_unmapFile(recordMap, recordMapSize);
+        mc_unmapFile(blobMap, blobMapSize);
+
+        recordMap     = nullptr;
+        recordMapSize = 0;
+        blobMap       = nullptr;
+        blobMapSize   = 0;
+        count         = 0;
+}
@@ -0,0 +1,537 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  snapshot.cpp
+* Author:  agent
+* Procedures:
+* SnapshotWriter()      -Default constructor
+* ~SnapshotWriter()     -Destructor
+* add           -Adds the state of a target
+* addCheckpoint -Adds a scan checkpoint
+* compareStates -qsort comparison of two target states
+* write         -Writes the snapshot file
+* size          -Returns the number of targets added
+* clear         -Drops everything added so far
+* SnapshotReader()      -Default constructor
+* ~SnapshotReader()     -Destructor
+* open          -Memory-maps a snapshot
+* size          -Returns the number of targets in the snapshot
+* find          -Looks up the state of a target
+* getBackend    -Returns the SRV target a state's handshake names
+* restore       -Restores a target from the snapshot
+* getCheckpoint -Looks up a scan checkpoint
+* close         -Unmaps the snapshot
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif // _WIN32
+
+
+#define SNAPSHOT_TEMP_SUFFIX ".tmp"
+
+
+/***************************************************************************
+* SnapshotWriter::SnapshotWriter()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor
+*
+* Parameters:
+**************************************************************************/
+SnapshotWriter::SnapshotWriter()
+{
+        records            = nullptr;
+        count              = 0;
+        capacity           = 0;
+        names              = nullptr;
+        namesSize          = 0;
+        namesCapacity      = 0;
+        checkpoints        = nullptr;
+        checkpointCount    = 0;
+        checkpointCapacity = 0;
+}
+
+/***************************************************************************
+* SnapshotWriter::~SnapshotWriter()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+SnapshotWriter::~SnapshotWriter()
+{
+        free(records);
+        free(names);
+        free(checkpoints);
+}
+
+/***************************************************************************
+* bool SnapshotWriter::add(Ping* p, PollScheduler* scheduler, int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds the state of a target: its resolved address and last
+*       result, and its poll interval when a scheduler is given. The Ping
+*       must not be probing while it is added
+*
+* Parameters:
+*        p      I/P     Ping*   target to add
+*        scheduler      I/P     PollScheduler*  scheduler polling the target,
+*                                               or nullptr
+*        handle I/P     int     the target's handle in the scheduler
+*        add    O/P     bool    false if out of memory
+**************************************************************************/
+bool SnapshotWriter::add(Ping* p, PollScheduler* scheduler, int handle)
+{
+        if(count == capacity){
+                size_t grown = capacity ? capacity * 2 : 1024;
+                MC_TargetState* r = (MC_TargetState*)realloc(records,
+                                                grown * sizeof(MC_TargetState));
+                if(r == nullptr)
+                        return false;
+                records  = r;
+                capacity = grown;
+        }
+
+        MC_TargetState* state = &records[count];
+        const char* backend = p->exportState(state);
+        if(scheduler != nullptr)
+                scheduler->getState(handle, state);
+
+        if(backend != nullptr){
+                size_t length = strlen(backend);
+                if(namesSize + length > namesCapacity){
+                        size_t grown = namesCapacity ? namesCapacity : 4096;
+                        while(grown < namesSize + length)
+                                grown *= 2;
+                        char* n = (char*)realloc(names, grown);
+                        if(n == nullptr)
+                                return false;
+                        names         = n;
+                        namesCapacity = grown;
+                }
+
+                memcpy(names + namesSize, backend, length);
+                state->nameOffset = namesSize;
+                state->nameLength = length;
+                namesSize += length;
+        }
+        /*SRV targets are kept without terminators, the length is enough*/
+
+        count++;
+        return true;
+}
+
+/***************************************************************************
+* bool SnapshotWriter::addCheckpoint(uint64_t id, uint64_t position,
+*                                                       uint64_t total)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds a scan checkpoint
+*
+* Parameters:
+*        id     I/P     uint64_t        identifies the scan partition
+*        position       I/P     uint64_t        targets of the partition done
+*        total  I/P     uint64_t        size of the partition
+*        addCheckpoint  O/P     bool    false if out of memory
+**************************************************************************/
+bool SnapshotWriter::addCheckpoint(uint64_t id, uint64_t position,
+                                                                uint64_t total)
+{
+        if(checkpointCount == checkpointCapacity){
+                size_t grown = checkpointCapacity ? checkpointCapacity * 2 : 16;
+                MC_ScanCheckpoint* c = (MC_ScanCheckpoint*)realloc(checkpoints,
+                                        grown * sizeof(MC_ScanCheckpoint));
+                if(c == nullptr)
+                        return false;
+                checkpoints        = c;
+                checkpointCapacity = grown;
+        }
+
+        checkpoints[checkpointCount].id       = id;
+        checkpoints[checkpointCount].position = position;
+        checkpoints[checkpointCount].total    = total;
+        checkpointCount++;
+
+        return true;
+}
+
+/***************************************************************************
+* static int compareStates(const void* a, const void* b)
+* Author: agent
+* Date: 10/19/2026
+* Description: qsort comparison of two target states by key
+*
+* Parameters:
+*        a      I/P     const void*     first state
+*        b      I/P     const void*     second state
+*        compareStates  O/P     int     <0, 0 or >0
+**************************************************************************/
+static int compareStates(const void* a, const void* b)
+{
+        uint64_t x = ((const MC_TargetState*)a)->key;
+        uint64_t y = ((const MC_TargetState*)b)->key;
+
+        return (x > y) - (x < y);
+}
+
+/***************************************************************************
+* int SnapshotWriter::write(const char* path)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes everything added into a snapshot file. The snapshot is
+*       written next to the path first and renamed over it, so readers see
+*       either the old snapshot or the whole new one
+*
+* Parameters:
+*        path   I/P     const char*     snapshot to create or replace
+*        write  O/P     int     OK or INITIALIZATION_FAILURE
+**************************************************************************/
+int SnapshotWriter::write(const char* path)
+{
+        qsort(records, count, sizeof(MC_TargetState), compareStates);
+        /*the reader finds targets by binary search*/
+
+        size_t pathLength = strlen(path);
+        char* temp = (char*)malloc(pathLength + sizeof(SNAPSHOT_TEMP_SUFFIX));
+        if(temp == nullptr)
+                return INITIALIZATION_FAILURE;
+        memcpy(temp, path, pathLength);
+        memcpy(temp + pathLength, SNAPSHOT_TEMP_SUFFIX,
+                                                sizeof(SNAPSHOT_TEMP_SUFFIX));
+
+        FILE* f = fopen(temp, "wb");
+        if(f == nullptr){
+                free(temp);
+                return INITIALIZATION_FAILURE;
+        }
+
+        uint8_t header[SNAPSHOT_HEADER_SIZE];
+        memset(header, 0, sizeof(header));
+        memcpy(header, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        uint32_t recordSize      = sizeof(MC_TargetState);
+        uint32_t checkpointTotal = checkpointCount;
+        uint64_t recordTotal     = count;
+        uint64_t nameTotal       = namesSize;
+        memcpy(header + 8, &recordSize, sizeof(recordSize));
+        memcpy(header + 12, &checkpointTotal, sizeof(checkpointTotal));
+        memcpy(header + 16, &recordTotal, sizeof(recordTotal));
+        memcpy(header + 24, &nameTotal, sizeof(nameTotal));
+
+        bool written = fwrite(header, 1, sizeof(header), f) == sizeof(header)
+                && fwrite(checkpoints, sizeof(MC_ScanCheckpoint),
+                                checkpointCount, f) == checkpointCount
+                && fwrite(records, sizeof(MC_TargetState), count, f) == count
+                && fwrite(names, 1, namesSize, f) == namesSize
+                && fflush(f) == 0 && fsync(fileno(f)) == 0;
+        written = fclose(f) == 0 && written;
+        /*the data has to be on disk before the rename is, or a crash can
+        *leave an empty or partial file under the snapshot's name
+        */
+
+#ifdef _WIN32
+        if(written)
+                remove(path);
+        /*rename() does not replace an existing file on Windows*/
+#endif // _WIN32
+
+        if(!written || rename(temp, path) != 0){
+                remove(temp);
+                free(temp);
+                return INITIALIZATION_FAILURE;
+        }
+
+        free(temp);
+        return OK;
+}
+
+/***************************************************************************
+* size_t SnapshotWriter::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of targets added
+*
+* Parameters:
+*        size   O/P     size_t  number of targets
+**************************************************************************/
+size_t SnapshotWriter::size(void)
+{
+        return count;
+}
+
+/***************************************************************************
+* void SnapshotWriter::clear(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Drops everything added so far and keeps the memory, for the
+*       next periodic snapshot
+*
+* Parameters:
+**************************************************************************/
+void SnapshotWriter::clear(void)
+{
+        count           = 0;
+        namesSize       = 0;
+        checkpointCount = 0;
+}
+
+/***************************************************************************
+* SnapshotReader::SnapshotReader()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor
+*
+* Parameters:
+**************************************************************************/
+SnapshotReader::SnapshotReader()
+{
+        map             = nullptr;
+        mapSize         = 0;
+        checkpoints     = nullptr;
+        checkpointCount = 0;
+        records         = nullptr;
+        count           = 0;
+        names           = nullptr;
+        namesSize       = 0;
+}
+
+/***************************************************************************
+* SnapshotReader::~SnapshotReader()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+SnapshotReader::~SnapshotReader()
+{
+        close();
+}
+
+/***************************************************************************
+* int SnapshotReader::open(const char* path)
+* Author: agent
+* Date: 10/19/2026
+* Description: Memory-maps a snapshot and checks that its sections fit the
+*       file
+*
+* Parameters:
+*        path   I/P     const char*     snapshot to open
+*        open   O/P     int     OK, BAD_RESPONSE if it is not a snapshot, or
+*                               INITIALIZATION_FAILURE
+**************************************************************************/
+int SnapshotReader::open(const char* path)
+{
+        close();
+
+        map = (const uint8_t*)mc_mapFile(path, &mapSize);
+        if(map == nullptr)
+                return INITIALIZATION_FAILURE;
+
+        uint32_t recordSize      = 0;
+        uint32_t checkpointTotal = 0;
+        uint64_t recordTotal     = 0;
+        uint64_t nameTotal       = 0;
+        if(mapSize >= SNAPSHOT_HEADER_SIZE){
+                memcpy(&recordSize, map + 8, sizeof(recordSize));
+                memcpy(&checkpointTotal, map + 12, sizeof(checkpointTotal));
+                memcpy(&recordTotal, map + 16, sizeof(recordTotal));
+                memcpy(&nameTotal, map + 24, sizeof(nameTotal));
+        }
+
+        uint64_t records = SNAPSHOT_HEADER_SIZE
+                        + (uint64_t)checkpointTotal * sizeof(MC_ScanCheckpoint);
+        uint64_t pool    = records + recordTotal * sizeof(MC_TargetState);
+
+        if(recordSize != sizeof(MC_TargetState)
+                        || memcmp(map, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC))
+                        || recordTotal > mapSize / sizeof(MC_TargetState)
+                        || pool > mapSize || nameTotal != mapSize - pool){
+                close();
+                return BAD_RESPONSE;
+        }
+        /*a snapshot is renamed into place whole, anything that does not add
+        *up is not one of ours. The name pool size is checked against what is
+        *left, a huge one would wrap the sum around
+        */
+
+        checkpoints     = (const MC_ScanCheckpoint*)(map + SNAPSHOT_HEADER_SIZE);
+        checkpointCount = checkpointTotal;
+        this->records   = (const MC_TargetState*)(map + records);
+        count           = recordTotal;
+        names           = (const char*)(map + pool);
+        namesSize       = nameTotal;
+
+        return OK;
+}
+
+/***************************************************************************
+* size_t SnapshotReader::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of targets in the snapshot
+*
+* Parameters:
+*        size   O/P     size_t  number of targets
+**************************************************************************/
+size_t SnapshotReader::size(void)
+{
+        return count;
+}
+
+/***************************************************************************
+* const MC_TargetState* SnapshotReader::find(uint64_t key)
+* Author: agent
+* Date: 10/19/2026
+* Description: Looks up the state of a target by its key
+*
+* Parameters:
+*        key    I/P     uint64_t        the target's Ping::getStateKey()
+*        find   O/P     const MC_TargetState*   the state, nullptr if the
+*                                               target is not in the snapshot
+**************************************************************************/
+const MC_TargetState* SnapshotReader::find(uint64_t key)
+{
+        size_t low  = 0;
+        size_t high = count;
+
+        while(low < high){
+                size_t middle = low + (high - low) / 2;
+                if(records[middle].key < key)
+                        low = middle + 1;
+                else
+                        high = middle;
+        }
+
+        if(low < count && records[low].key == key)
+                return &records[low];
+
+        return nullptr;
+}
+
+/***************************************************************************
+* const char* SnapshotReader::getBackend(const MC_TargetState* state,
+*                                                       char* buffer)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the SRV target the handshake of a state names, copied
+*       into the caller's buffer since the name pool keeps no terminators
+*
+* Parameters:
+*        state  I/P     const MC_TargetState*   state from find()
+*        buffer O/P     char*   DOMAIN_MAX_SIZE + 1 bytes for the name
+*        getBackend     O/P     const char*     the buffer, nullptr if the
+*                                               handshake names the host
+**************************************************************************/
+const char* SnapshotReader::getBackend(const MC_TargetState* state,
+                                                                char* buffer)
+{
+        if(state->nameLength == 0 || state->nameLength > DOMAIN_MAX_SIZE
+                        || (uint64_t)state->nameOffset + state->nameLength
+                                                                > namesSize)
+                return nullptr;
+
+        memcpy(buffer, names + state->nameOffset, state->nameLength);
+        buffer[state->nameLength] = '\0';
+
+        return buffer;
+}
+
+/***************************************************************************
+* bool SnapshotReader::restore(Ping* p, PollScheduler* scheduler, int handle)
+* Author: agent
+* Date: 10/19/2026
+* Description: Restores a target's resolved address and last result, and
+*       its poll interval when a scheduler is given
+*
+* Parameters:
+*        p      I/O     Ping*   target to restore
+*        scheduler      I/O     PollScheduler*  scheduler polling the target,
+*                                               or nullptr
+*        handle I/P     int     the target's handle in the scheduler
+*        restore        O/P     bool    false if the target is not in the
+*                                       snapshot
+**************************************************************************/
+bool SnapshotReader::restore(Ping* p, PollScheduler* scheduler, int handle)
+{
+        const MC_TargetState* state = find(p->getStateKey());
+        if(state == nullptr)
+                return false;
+
+        char backend[DOMAIN_MAX_SIZE + 1];
+        p->importState(state, getBackend(state, backend));
+        if(scheduler != nullptr)
+                scheduler->restore(handle, state, PollScheduler::now());
+
+        return true;
+}
+
+/***************************************************************************
+* bool SnapshotReader::getCheckpoint(uint64_t id, MC_ScanCheckpoint* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Looks up a scan checkpoint
+*
+* Parameters:
+*        id     I/P     uint64_t        identifies the scan partition
+*        out    O/P     MC_ScanCheckpoint*      the checkpoint
+*        getCheckpoint  O/P     bool    false if there is none with the id
+**************************************************************************/
+bool SnapshotReader::getCheckpoint(uint64_t id, MC_ScanCheckpoint* out)
+{
+        for(size_t i = 0; i < checkpointCount; i++){
+                if(checkpoints[i].id == id){
+                        memcpy(out, &checkpoints[i], sizeof(MC_ScanCheckpoint));
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/***************************************************************************
+* void SnapshotReader::close(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Unmaps the snapshot, pointers into it become invalid
+*
+* Parameters:
+**************************************************************************/
+void SnapshotReader::close(void)
+{
+        mc_unmapFile(map, mapSize);
+
+        map             = nullptr;
+        mapSize         = 0;
+        checkpoints     = nullptr;
+        checkpointCount = 0;
+        records         = nullptr;
+        count           = 0;
+        names           = nullptr;
+        namesSize       = 0;
+}
@@ -0,0 +1,667 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+/***************************************************************************
+* File:  socket.cpp
+* Author:  agent
+* Procedures:
+* SocketHandle(X)       -Constructor, takes ownership of a descriptor
+* ~SocketHandle()       -Destructor, closes the descriptor
+* get           -Returns the descriptor
+* valid         -Checks if a descriptor is held
+* reset         -Closes the descriptor and takes ownership of another
+* release       -Gives up ownership of the descriptor without closing it
+* setAbortive   -Makes the close reset the connection
+* setTimeout    -Sets the send and receive timeouts of the socket
+* SourcePool()  -Default constructor
+* ~SourcePool() -Destructor
+* add           -Adds a local address to the pool
+* size          -Returns the number of local addresses
+* bindSocket    -Binds a socket to the next local address
+* waitWritable  -Waits a moment for room in the send buffer of a socket
+* sendDatagrams -Sends a batch of UDP datagrams
+* receiveDatagrams      -Receives a batch of waiting UDP datagrams
+* exchange      -Runs the send, resend and receive loop of a UDP client
+* mc_currentMillis      -Returns the wall clock time in milliseconds
+* mc_setBlocking        -Switches a socket between blocking and non-blocking
+* mc_readKernelRTT      -Returns the kernel's smoothed RTT of a connection
+* mc_decodeVarInt       -Decodes a protocol varint out of a buffer
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#define CLOSE(X)            closesocket(X)
+#define OPT_CAST (const char*)
+#define SEND_CAST (const char*)
+#define RECV_CAST (char*)
+#define RECV_FLAGS 0
+#define poll WSAPoll
+#define NO_ROOM() (WSAGetLastError() == WSAEWOULDBLOCK \
+                        || WSAGetLastError() == WSAENOBUFS)
+typedef int socklen_t;
+#else
+#include <unistd.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#define CLOSE(X)            close(X)
+#define OPT_CAST
+#define SEND_CAST
+#define RECV_CAST
+#define RECV_FLAGS MSG_DONTWAIT
+#define NO_ROOM() (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+#endif // _WIN32
+/*the send buffer or the interface queue is full for now*/
+
+#define DATAGRAM_RETRIES 3
+/*times a datagram that found no room is tried again before it is skipped*/
+#define DATAGRAM_WAIT 10
+/*longest wait for room in the send buffer, in milliseconds*/
+
+
+/***************************************************************************
+* SocketHandle::SocketHandle(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Constructor, takes ownership of a descriptor
+*
+* Parameters:
+*        fd     I/P     int     descriptor to own, negative for none
+**************************************************************************/
+SocketHandle::SocketHandle(int fd)
+{
+        this->fd       = fd;
+        this->abortive = false;
+}
+
+/***************************************************************************
+* SocketHandle::~SocketHandle()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor, closes the descriptor
+*
+* Parameters:
+**************************************************************************/
+SocketHandle::~SocketHandle()
+{
+        reset();
+}
+
+/***************************************************************************
+* int SocketHandle::get(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the descriptor, still owned by the handle
+*
+* Parameters:
+*        get    O/P     int     descriptor, negative if none is held
+**************************************************************************/
+int SocketHandle::get(void)
+{
+        return fd;
+}
+
+/***************************************************************************
+* bool SocketHandle::valid(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks if a descriptor is held
+*
+* Parameters:
+*        valid  O/P     bool    true if a descriptor is held
+**************************************************************************/
+bool SocketHandle::valid(void)
+{
+        return fd >= 0;
+}
+
+/***************************************************************************
+* void SocketHandle::reset(int newFd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Closes the held descriptor, if any, and takes ownership of
+*       another one. Abortive closes set SO_LINGER to 0 first, which sends a
+*       RST and skips TIME_WAIT
+*
+* Parameters:
+*        newFd  I/P     int     descriptor to own next, negative for none
+**************************************************************************/
+void SocketHandle::reset(int newFd)
+{
+        if(fd >= 0){
+                if(abortive){
+                        struct linger l;
+                        l.l_onoff  = 1;
+                        l.l_linger = 0;
+                        setsockopt(fd, SOL_SOCKET, SO_LINGER, OPT_CAST &l,
+                                                                sizeof(l));
+                }
+                CLOSE(fd);
+        }
+
+        fd = newFd;
+}
+
+/***************************************************************************
+* int SocketHandle::release(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Gives up ownership of the descriptor without closing it
+*
+* Parameters:
+*        release        O/P     int     the descriptor, now owned by the caller
+**************************************************************************/
+int SocketHandle::release(void)
+{
+        int old = fd;
+        fd = -1;
+
+        return old;
+}
+
+/***************************************************************************
+* void SocketHandle::setAbortive(bool enable)
+* Author: agent
+* Date: 10/19/2026
+* Description: Makes closing the socket reset the connection. Long-running
+*       pollers use it so thousands of finished probes do not sit in
+*       TIME_WAIT holding ephemeral ports
+*
+* Parameters:
+*        enable I/P     bool    true for an abortive close
+**************************************************************************/
+void SocketHandle::setAbortive(bool enable)
+{
+        abortive = enable;
+}
+
+/***************************************************************************
+* bool SocketHandle::setTimeout(const struct timeval* tv)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sets the send and receive timeouts of the socket
+*
+* Parameters:
+*        tv     I/P     const struct timeval*   timeout of a single call
+*        setTimeout     O/P     bool    false if the options could not be set
+**************************************************************************/
+bool SocketHandle::setTimeout(const struct timeval* tv)
+{
+#ifdef _WIN32
+        DWORD ms = tv->tv_sec * 1000 + tv->tv_usec / 1000;
+        return !setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, (const char*)&ms,
+                                                        sizeof(ms))
+                && !setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&ms,
+                                                        sizeof(ms));
+#else
+        return !setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, tv, sizeof(*tv))
+                && !setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, tv, sizeof(*tv));
+#endif // _WIN32
+}
+
+
+/***************************************************************************
+* SourcePool::SourcePool()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor, creates an empty pool
+*
+* Parameters:
+**************************************************************************/
+SourcePool::SourcePool() : nextAddress(0)
+{
+        addresses = nullptr;
+        count     = 0;
+        capacity  = 0;
+}
+
+/***************************************************************************
+* SourcePool::~SourcePool()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+SourcePool::~SourcePool()
+{
+        free(addresses);
+}
+
+/***************************************************************************
+* bool SourcePool::add(const char* address)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds a local IPv4 address to the pool. Must not be called
+*       while other threads bind through the pool
+*
+* Parameters:
+*        address        I/P     const char*     dotted quad local address
+*        add    O/P     bool    false if the address is not an IPv4 literal
+*                               or out of memory
+**************************************************************************/
+bool SourcePool::add(const char* address)
+{
+        uint32_t ip;
+        if(!Ping::parseIPv4(address, strlen(address), &ip))
+                return false;
+
+        if(count == capacity){
+                size_t newCapacity = capacity ? capacity * 2 : 8;
+                uint32_t* tmp = (uint32_t*)realloc(addresses,
+                                        newCapacity * sizeof(uint32_t));
+                if(tmp == nullptr)
+                        return false;
+
+                addresses = tmp;
+                capacity  = newCapacity;
+        }
+
+        addresses[count++] = ip;
+
+        return true;
+}
+
+/***************************************************************************
+* size_t SourcePool::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of local addresses in the pool
+*
+* Parameters:
+*        size   O/P     size_t  number of addresses
+**************************************************************************/
+size_t SourcePool::size(void)
+{
+        return count;
+}
+
+/***************************************************************************
+* bool SourcePool::bindSocket(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Binds an unconnected socket to the next local address of the
+*       pool. The port is left for connect() to pick where the system
+*       supports it, so the port is only reserved for the actual destination
+*
+* Parameters:
+*        fd     I/P     int     socket to bind
+*        bindSocket     O/P     bool    false if the bind failed, true if it
+*                                       worked or the pool is empty
+**************************************************************************/
+bool SourcePool::bindSocket(int fd)
+{
+        if(count == 0)
+                return true;
+
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family      = AF_INET;
+        local.sin_port        = 0;
+        local.sin_addr.s_addr = addresses[nextAddress++ % count];
+
+#ifdef IP_BIND_ADDRESS_NO_PORT
+        int one = 1;
+        setsockopt(fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+        /*without this bind() reserves a port for every destination at once,
+        *which runs the ephemeral range dry at high probe rates
+        */
+#endif // IP_BIND_ADDRESS_NO_PORT
+
+        return bind(fd, (struct sockaddr*)&local, sizeof(local)) == 0;
+}
+
+/***************************************************************************
+* static void waitWritable(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Waits up to DATAGRAM_WAIT milliseconds for room in the send
+*       buffer of a socket
+*
+* Parameters:
+*        fd     I/P     int     UDP socket
+**************************************************************************/
+static void waitWritable(int fd)
+{
+        struct pollfd pfd;
+        pfd.fd      = fd;
+        pfd.events  = POLLOUT;
+        pfd.revents = 0;
+
+        poll(&pfd, 1, DATAGRAM_WAIT);
+}
+
+/***************************************************************************
+* size_t sendDatagrams(int fd, const struct Datagram* datagrams, size_t count)
+* Author: agent
+* Date: 10/19/2026
+* Description: Sends UDP datagrams, DATAGRAM_BATCH per system call where the
+*       platform allows it. A datagram that finds the send buffer full is
+*       tried again once there is room, up to DATAGRAM_RETRIES times. One
+*       that still cannot be sent is skipped, UDP callers resend on their own
+*
+* Parameters:
+*        fd     I/P     int     UDP socket
+*        datagrams      I/P     const struct Datagram*  datagrams to send
+*        count  I/P     size_t  number of datagrams
+*        sendDatagrams  O/P     size_t  number of datagrams that failed
+**************************************************************************/
+size_t sendDatagrams(int fd, const struct Datagram* datagrams, size_t count)
+{
+        size_t failed = 0;
+
+        while(count > DATAGRAM_BATCH){
+                failed    += sendDatagrams(fd, datagrams, DATAGRAM_BATCH);
+                datagrams += DATAGRAM_BATCH;
+                count     -= DATAGRAM_BATCH;
+        }
+        /*the message arrays hold one batch, longer runs go out in chunks*/
+
+        size_t sent = 0;
+        int retries = 0;
+
+#ifdef __linux__
+        struct mmsghdr messages[DATAGRAM_BATCH];
+        struct iovec vectors[DATAGRAM_BATCH];
+        memset(messages, 0, count * sizeof(struct mmsghdr));
+        for(size_t i = 0; i < count; i++){
+                vectors[i].iov_base = datagrams[i].data;
+                vectors[i].iov_len  = datagrams[i].length;
+                messages[i].msg_hdr.msg_name    = (void*)&datagrams[i].address;
+                messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+                messages[i].msg_hdr.msg_iov     = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen  = 1;
+        }
+
+        while(sent < count){
+                int n = sendmmsg(fd, messages + sent, count - sent, 0);
+                if(n > 0){
+                        sent   += n;
+                        retries = 0;
+                        continue;
+                }
+                /*sendmmsg stops at the first datagram that fails*/
+
+                if(NO_ROOM() && retries < DATAGRAM_RETRIES){
+                        retries++;
+                        waitWritable(fd);
+                        continue;
+                }
+
+                failed++;
+                sent++;
+                retries = 0;
+        }
+#else
+        while(sent < count){
+                if(sendto(fd, SEND_CAST datagrams[sent].data,
+                                datagrams[sent].length, 0,
+                                (const struct sockaddr*)&datagrams[sent].address,
+                                sizeof(struct sockaddr_in)) >= 0){
+                        sent++;
+                        retries = 0;
+                        continue;
+                }
+
+                if(NO_ROOM() && retries < DATAGRAM_RETRIES){
+                        retries++;
+                        waitWritable(fd);
+                        continue;
+                }
+
+                failed++;
+                sent++;
+                retries = 0;
+        }
+#endif // __linux__
+
+        return failed;
+}
+
+/***************************************************************************
+* size_t receiveDatagrams(int fd, struct Datagram* datagrams, size_t count)
+* Author: agent
+* Date: 10/19/2026
+* Description: Receives the UDP datagrams already waiting on the socket
+*       without blocking, with as few system calls as the platform allows
+*
+* Parameters:
+*        fd     I/P     int     UDP socket poll() reported readable
+*        datagrams      I/O     struct Datagram*        buffers to fill
+*        count  I/P     size_t  number of buffers, only the first
+*                               DATAGRAM_BATCH are filled
+*        receiveDatagrams       O/P     size_t  number of datagrams received
+**************************************************************************/
+size_t receiveDatagrams(int fd, struct Datagram* datagrams, size_t count)
+{
+        if(count > DATAGRAM_BATCH)
+                count = DATAGRAM_BATCH;
+        /*the message arrays hold one batch*/
+
+#ifdef __linux__
+        struct mmsghdr messages[DATAGRAM_BATCH];
+        struct iovec vectors[DATAGRAM_BATCH];
+        memset(messages, 0, count * sizeof(struct mmsghdr));
+        for(size_t i = 0; i < count; i++){
+                vectors[i].iov_base = datagrams[i].data;
+                vectors[i].iov_len  = datagrams[i].length;
+                messages[i].msg_hdr.msg_name    = &datagrams[i].address;
+                messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+                messages[i].msg_hdr.msg_iov     = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen  = 1;
+        }
+
+        int received = recvmmsg(fd, messages, count, MSG_DONTWAIT, nullptr);
+        if(received <= 0)
+                return 0;
+
+        for(int i = 0; i < received; i++)
+                datagrams[i].length = messages[i].msg_len;
+
+        return received;
+#else
+        size_t received = 0;
+        for(; received < count; received++){
+                socklen_t length = sizeof(struct sockaddr_in);
+                int n = recvfrom(fd, RECV_CAST datagrams[received].data,
+                                datagrams[received].length, RECV_FLAGS,
+                                (struct sockaddr*)&datagrams[received].address,
+                                &length);
+                if(n < 0)
+                        break;
+                datagrams[received].length = n;
+#ifdef _WIN32
+                received++;
+                break;
+                /*without MSG_DONTWAIT only the datagram poll() announced is
+                *sure not to block
+                */
+#endif // _WIN32
+        }
+
+        return received;
+#endif // __linux__
+}
+
+/***************************************************************************
+* int DatagramClient::exchange(uint32_t timeoutMs, int receiveBuffer)
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs the loop of a UDP client through one socket until every
+*       pending target answered or the timeout ran out. Whatever is queued
+*       is sent, answers are drained as soon as the socket turns readable,
+*       and halfway through the timeout requeue() queues the silent targets
+*       once more
+*
+* Parameters:
+*        timeoutMs      I/P     uint32_t        time to wait for all answers
+*        receiveBuffer  I/P     int     receive buffer size to ask for
+*        exchange       O/P     int     OK, or SOCKET_OPEN_FAILURE
+**************************************************************************/
+int DatagramClient::exchange(uint32_t timeoutMs, int receiveBuffer)
+{
+        SocketHandle sock(socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP));
+        if(!sock.valid())
+                return SOCKET_OPEN_FAILURE;
+
+        setsockopt(sock.get(), SOL_SOCKET, SO_RCVBUF,
+                        (const char*)&receiveBuffer, sizeof(receiveBuffer));
+        /*a large sweep's answers arrive all at once*/
+
+        uint64_t start    = PollScheduler::now();
+        uint64_t deadline = start + timeoutMs;
+        uint64_t resendAt = start + timeoutMs / 2;
+        bool resent = false;
+
+        while(pending > 0){
+                uint64_t now = PollScheduler::now();
+                if(now >= deadline)
+                        break;
+
+                if(!resent && now >= resendAt){
+                        resent = true;
+                        requeue();
+                }
+                /*UDP drops packets, ask the silent targets once more*/
+
+                sendPending(sock.get());
+
+                struct pollfd fds;
+                fds.fd      = sock.get();
+                fds.events  = POLLIN;
+                fds.revents = 0;
+                now = PollScheduler::now();
+                uint64_t until = resent ? deadline : resendAt;
+                if(poll(&fds, 1, until > now ? until - now : 0) <= 0)
+                        continue;
+
+                drain(sock.get());
+        }
+
+        return OK;
+}
+
+/***************************************************************************
+* uint64_t mc_currentMillis(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the wall clock time in milliseconds, used for the
+*       latency measurements and result timestamps
+*
+* Parameters:
+*        mc_currentMillis       O/P     uint64_t        milliseconds since the
+*                                                       epoch
+**************************************************************************/
+uint64_t mc_currentMillis(void)
+{
+        struct timeval now;
+        gettimeofday(&now, NULL);
+
+        return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+/***************************************************************************
+* bool mc_setBlocking(int fd, bool blocking)
+* Author: agent
+* Date: 10/19/2026
+* Description: Switches a socket between blocking and non-blocking mode
+*
+* Parameters:
+*        fd     I/P     int     socket
+*        blocking       I/P     bool    true for blocking
+*        mc_setBlocking O/P     bool    false if the mode could not be set
+**************************************************************************/
+bool mc_setBlocking(int fd, bool blocking)
+{
+#ifdef _WIN32
+        unsigned long mode = blocking ? 0 : 1;
+        return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+        int flags = fcntl(fd, F_GETFL, 0);
+        if(flags < 0)
+                return false;
+
+        flags = blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+        return fcntl(fd, F_SETFL, flags) == 0;
+#endif // _WIN32
+}
+
+/***************************************************************************
+* long mc_readKernelRTT(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the smoothed round trip time the kernel keeps for a
+*       TCP connection. It is measured from the ACKs, so it does not include
+*       the time our own process waits to be scheduled
+*
+* Parameters:
+*        fd     I/P     int     connected socket
+*        mc_readKernelRTT       O/P     long    RTT in microseconds, -1 if the
+*                                               platform does not report it
+**************************************************************************/
+long mc_readKernelRTT(int fd)
+{
+#ifdef __linux__
+        struct tcp_info info;
+        socklen_t length = sizeof(info);
+
+        if(getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &length) < 0)
+                return -1;
+
+        return info.tcpi_rtt;
+#else
+        (void)fd;
+        return -1;
+#endif // __linux__
+}
+
+/***************************************************************************
+* int mc_decodeVarInt(const uint8_t* in, size_t length, int32_t* value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Decodes a protocol varint out of the bytes received so far
+*
+* Parameters:
+*        in     I/P     const uint8_t*  received bytes
+*        length I/P     size_t  number of bytes received
+*        value  O/P     int32_t*        the decoded value
+*        mc_decodeVarInt        O/P     int     bytes the varint takes, 0 if
+*                                               it is not complete yet, -1 if
+*                                               it runs past 5 bytes
+**************************************************************************/
+int mc_decodeVarInt(const uint8_t* in, size_t length, int32_t* value)
+{
+        uint32_t result = 0;
+
+        for(size_t i = 0; i < length; i++){
+                if(i == 5)
+                        return -1;
+                result |= (uint32_t)(in[i] & 0x7f) << (7 * i);
+                if(!(in[i] & 0x80)){
+                        *value = (int32_t)result;
+                        return i + 1;
+                }
+        }
+
+        return length >= 5 ? -1 : 0;
+}
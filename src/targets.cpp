@@ -0,0 +1,717 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+/***************************************************************************
+* File:  targets.cpp
+* Author:  agent
+* Procedures:
+* TargetList()  -Default constructor
+* ~TargetList() -Destructor
+* load          -Memory-maps a target file and parses every line of it
+* loadBuffer    -Parses an in-memory buffer of target lines
+* normalizeHost -Validates and lowercases a host
+* parseLine     -Parses a single host[:port] line into a pending target
+* insert        -Inserts a pending target, skipping duplicates
+* add           -Adds a single target to the list, skipping duplicates
+* reserve       -Grows the target array and string pool
+* rehash        -Grows the deduplication index
+* size          -Returns the number of unique targets
+* getDuplicates -Returns the number of duplicate lines skipped
+* getRejected   -Returns the number of malformed lines skipped
+* getTarget     -Returns the raw target entry
+* getHost       -Returns the host string of a target
+* getPort       -Returns the port of a target
+* createPing    -Creates a Ping object for a target
+* clear         -Frees all targets
+***************************************************************************/
+
+
+#include "MinecraftPing.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include <new>
+
+
+#define INITIAL_TARGETS 64
+#define AVERAGE_HOST_SIZE 24
+/*guess of the average host length, used to size the string pool*/
+#define LOAD_BATCH 16
+/*number of lines parsed ahead of their deduplication index inserts*/
+
+
+/***************************************************************************
+* static uint32_t hashEndpoint(const char* host, size_t length, uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Hashes a lowercase host and port into a 32 bit endpoint hash
+*
+* Parameters:
+*        host   I/P     const char*     lowercase host
+*        length I/P     size_t  length of the host
+*        port   I/P     uint16_t        port of the endpoint
+*        hashEndpoint   O/P     uint32_t        endpoint hash
+**************************************************************************/
+static uint32_t hashEndpoint(const char* host, size_t length, uint16_t port)
+{
+        uint64_t h = mc_hash64(host, length, 0);
+        h = mc_hash64(&port, sizeof(port), h);
+
+        return (uint32_t)(h ^ (h >> 32));
+        /*fold the 64 bit hash down to 32 bits*/
+}
+
+/***************************************************************************
+* TargetList::TargetList()
+* Author: agent
+* Date: 10/19/2026
+* Description: Default constructor
+*
+* Parameters:
+**************************************************************************/
+TargetList::TargetList()
+{
+        targets      = nullptr;
+        count        = 0;
+        capacity     = 0;
+        pool         = nullptr;
+        poolSize     = 0;
+        poolCapacity = 0;
+        table        = nullptr;
+        tableMask    = 0;
+        duplicates   = 0;
+        rejected     = 0;
+}
+
+/***************************************************************************
+* TargetList::~TargetList()
+* Author: agent
+* Date: 10/19/2026
+* Description: Destructor
+*
+* Parameters:
+**************************************************************************/
+TargetList::~TargetList()
+{
+        clear();
+}
+
+/***************************************************************************
+* void TargetList::clear(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Frees all targets and resets the statistics
+*
+* Parameters:
+**************************************************************************/
+void TargetList::clear(void)
+{
+        free(targets);
+        free(pool);
+        free(table);
+
+        targets      = nullptr;
+        count        = 0;
+        capacity     = 0;
+        pool         = nullptr;
+        poolSize     = 0;
+        poolCapacity = 0;
+        table        = nullptr;
+        tableMask    = 0;
+        duplicates   = 0;
+        rejected     = 0;
+}
+
+/***************************************************************************
+* bool TargetList::reserve(size_t targetCount, size_t poolBytes)
+* Author: agent
+* Date: 10/19/2026
+* Description: Makes sure there is room for the given number of targets and
+*       string pool bytes, growing the deduplication index along with them
+*
+* Parameters:
+*        targetCount    I/P     size_t  total number of targets needed
+*        poolBytes      I/P     size_t  total number of pool bytes needed
+*        reserve        O/P     bool    false if out of memory
+**************************************************************************/
+bool TargetList::reserve(size_t targetCount, size_t poolBytes)
+{
+        if(targetCount > 0xFFFFFFFEu || poolBytes > 0xFFFFFFFFu)
+                return false;
+        /*indices and pool offsets are stored as 32 bit values*/
+
+        if(targetCount > capacity){
+                size_t newCapacity = capacity ? capacity : INITIAL_TARGETS;
+                while(newCapacity < targetCount)
+                        newCapacity *= 2;
+
+                MC_Target* tmp = (MC_Target*)realloc(targets,
+                                        newCapacity * sizeof(MC_Target));
+                if(tmp == nullptr)
+                        return false;
+
+                targets  = tmp;
+                capacity = newCapacity;
+        }
+
+        if(poolBytes > poolCapacity){
+                size_t newCapacity = poolCapacity ? poolCapacity :
+                                        INITIAL_TARGETS * AVERAGE_HOST_SIZE;
+                while(newCapacity < poolBytes)
+                        newCapacity *= 2;
+                if(newCapacity > 0xFFFFFFFFu)
+                        newCapacity = 0xFFFFFFFFu;
+
+                char* tmp = (char*)realloc(pool, newCapacity);
+                if(tmp == nullptr)
+                        return false;
+
+                pool         = tmp;
+                poolCapacity = newCapacity;
+        }
+
+        if(targetCount * 2 > tableMask + 1 || table == nullptr){
+        /*keep the index at most half full so probe chains stay short*/
+                size_t slots = 16;
+                while(slots < targetCount * 2)
+                        slots *= 2;
+                if(!rehash(slots))
+                        return false;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* bool TargetList::rehash(size_t slots)
+* Author: agent
+* Date: 10/19/2026
+* Description: Rebuilds the deduplication index with the given number of
+*       slots (must be a power of 2)
+*
+* Parameters:
+*        slots  I/P     size_t  number of slots in the new index
+*        rehash O/P     bool    false if out of memory
+**************************************************************************/
+bool TargetList::rehash(size_t slots)
+{
+        uint64_t* tmp = (uint64_t*)calloc(slots, sizeof(uint64_t));
+        if(tmp == nullptr)
+                return false;
+
+        size_t mask = slots - 1;
+
+        for(size_t i = 0; i < count; i++){
+                size_t slot = targets[i].hash & mask;
+                while(tmp[slot] != 0)
+                        slot = (slot + 1) & mask;
+                tmp[slot] = ((uint64_t)targets[i].hash << 32) | (i + 1);
+        }
+        /*re-insert every existing target*/
+
+        free(table);
+        table     = tmp;
+        tableMask = mask;
+
+        return true;
+}
+
+/***************************************************************************
+* struct TargetList::Pending
+* Author: agent
+* Date: 10/19/2026
+* Description: A parsed, validated and lowercased target that has not been
+*       checked against the deduplication index yet
+*
+**************************************************************************/
+struct TargetList::Pending{
+        char host[DOMAIN_MAX_SIZE + 1];
+        uint16_t length;
+        uint16_t port;
+        uint32_t hash;
+};
+
+/***************************************************************************
+* static bool normalizeHost(const char* in, size_t length, char* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Validates the characters of a host and copies it out as
+*       lowercase in the same pass
+*
+* Parameters:
+*        in     I/P     const char*     host to validate
+*        length I/P     size_t  length of the host
+*        out    I/O     char*   lowercase copy, null terminated
+*        normalizeHost  O/P     bool    false if the host has bad characters
+**************************************************************************/
+static bool normalizeHost(const char* in, size_t length, char* out)
+{
+        for(size_t i = 0; i < length; i++){
+                char c = in[i];
+
+                if(c >= 'A' && c <= 'Z')
+                        c += 'a' - 'A';
+                else if(!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+                                || c == '.' || c == '-' || c == '_'))
+                        return false;
+                /*only characters that can appear in a domain or IPv4
+                *literal are allowed
+                */
+
+                out[i] = c;
+        }
+        out[length] = '\000';
+
+        return true;
+}
+
+/***************************************************************************
+* int TargetList::insert(const Pending* p)
+* Author: agent
+* Date: 10/19/2026
+* Description: Inserts a pending target unless an identical endpoint is
+*       already in the list. Room must have been reserved beforehand
+*
+* Parameters:
+*        p      I/P     const Pending*  target to insert
+*        insert O/P     int     1 if added, 0 if it was a duplicate
+**************************************************************************/
+int TargetList::insert(const Pending* p)
+{
+        size_t slot = p->hash & tableMask;
+
+        while(table[slot] != 0){
+                if((uint32_t)(table[slot] >> 32) == p->hash){
+                        const MC_Target* t = &targets[(uint32_t)table[slot] - 1];
+                        if(t->port == p->port && t->hostLength == p->length
+                                && !memcmp(pool + t->hostOffset, p->host, p->length)){
+                                duplicates++;
+                                return 0;
+                        }
+                }
+                slot = (slot + 1) & tableMask;
+        }
+        /*linear probe the index for an identical endpoint. The slot holds the
+        *hash next to the index, so only real matches touch the target array
+        */
+
+        uint32_t ipv4 = 0;
+        if(!Ping::parseIPv4(p->host, p->length, &ipv4))
+                ipv4 = 0;
+
+        MC_Target* t  = &targets[count];
+        t->hostOffset = poolSize;
+        t->hostLength = p->length;
+        t->port       = p->port;
+        t->ipv4       = ipv4;
+        t->hash       = p->hash;
+
+        memcpy(pool + poolSize, p->host, p->length + 1);
+        poolSize += p->length + 1;
+        table[slot] = ((uint64_t)p->hash << 32) | ++count;
+
+        return 1;
+}
+
+/***************************************************************************
+* int TargetList::add(const char* host, uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Adds a single target to the list. Hosts are compared case
+*       insensitively and identical endpoints are only stored once
+*
+* Parameters:
+*        host   I/P     const char*     domain or IPv4 literal of the server
+*        port   I/P     uint16_t        port of the server
+*        add    O/P     int     1 if added, 0 if it was a duplicate, negative
+*                                       if the host is invalid or out of memory
+**************************************************************************/
+int TargetList::add(const char* host, uint16_t port)
+{
+        Pending p;
+        size_t length = strnlen(host, DOMAIN_MAX_SIZE+1);
+
+        if(length == 0 || length > DOMAIN_MAX_SIZE || port == 0
+                                || !normalizeHost(host, length, p.host)){
+                rejected++;
+                return BAD_DOMAIN;
+        }
+
+        p.length = length;
+        p.port   = port;
+        p.hash   = hashEndpoint(p.host, length, port);
+
+        if(!reserve(count + 1, poolSize + length + 1))
+                return INITIALIZATION_FAILURE;
+
+        return insert(&p);
+}
+
+/***************************************************************************
+* int TargetList::parseLine(const char* line, size_t length,
+*                               uint16_t defaultPort, Pending* out)
+* Author: agent
+* Date: 10/19/2026
+* Description: Parses a single "host[:port]" line into a pending target.
+*       Blank lines and lines starting with '#' are ignored
+*
+* Parameters:
+*        line   I/P     const char*     start of the line, not null terminated
+*        length I/P     size_t  length of the line without the newline
+*        defaultPort    I/P     uint16_t        port used when none is given
+*        out    I/O     Pending*        parsed target
+*        parseLine      O/P     int     1 if out was filled, 0 for ignored
+*                                       lines, BAD_DOMAIN for malformed lines
+**************************************************************************/
+int TargetList::parseLine(const char* line, size_t length, uint16_t defaultPort,
+                                Pending* out)
+{
+        while(length > 0 && (line[length-1] == '\r' || line[length-1] == ' '
+                                || line[length-1] == '\t'))
+                length--;
+        while(length > 0 && (*line == ' ' || *line == '\t')){
+                line++;
+                length--;
+        }
+        /*trim whitespace and windows line endings*/
+
+        if(length == 0 || *line == '#')
+                return 0;
+
+        size_t hostLength = length;
+        uint16_t port     = defaultPort;
+
+        for(size_t i = length; i > 0 && length - i < 6; i--){
+                if(line[i-1] == ':'){
+                        hostLength = i - 1;
+                        break;
+                }
+        }
+        /*search backwards for the port separator, a port is at most 5
+        *digits so this only touches the last few characters
+        */
+
+        if(hostLength != length){
+                size_t digits = length - hostLength - 1;
+                uint32_t value = 0;
+
+                if(digits == 0)
+                        return BAD_DOMAIN;
+                for(size_t i = hostLength + 1; i < length; i++){
+                        unsigned c = (unsigned char)line[i] - '0';
+                        if(c > 9)
+                                return BAD_DOMAIN;
+                        value = value * 10 + c;
+                }
+                if(value == 0 || value > 0xFFFF)
+                        return BAD_DOMAIN;
+                port = value;
+        }
+
+        if(hostLength == 0 || hostLength > DOMAIN_MAX_SIZE || port == 0)
+                return BAD_DOMAIN;
+
+        if(!normalizeHost(line, hostLength, out->host))
+                return BAD_DOMAIN;
+
+        out->length = hostLength;
+        out->port   = port;
+        out->hash   = hashEndpoint(out->host, hostLength, port);
+
+        return 1;
+}
+
+/***************************************************************************
+* int TargetList::loadBuffer(const char* data, size_t length,
+*                                               uint16_t defaultPort)
+* Author: agent
+* Date: 10/19/2026
+* Description: Parses an in-memory buffer of newline separated target lines.
+*       The buffer is scanned once with memchr to size the list up front,
+*       then parsed in small batches. Each batch prefetches its index slots
+*       before inserting, so the cache misses of a batch overlap instead of
+*       being paid one line at a time
+*
+* Parameters:
+*        data   I/P     const char*     buffer of target lines
+*        length I/P     size_t  length of the buffer
+*        defaultPort    I/P     uint16_t        port used when a line has none
+*        loadBuffer     O/P     int     number of unique targets added, or a
+*                                       negative pingError on failure
+**************************************************************************/
+int TargetList::loadBuffer(const char* data, size_t length, uint16_t defaultPort)
+{
+        size_t lines = 1;
+        const char* p   = data;
+        const char* end = data + length;
+
+        while(p < end && (p = (const char*)memchr(p, '\n', end - p)) != nullptr){
+                lines++;
+                p++;
+        }
+        /*count the lines first, memchr is vectorized by the C library so this
+        *pass runs at memory bandwidth
+        */
+
+        if(!reserve(count + lines, poolSize + length + lines))
+                return INITIALIZATION_FAILURE;
+        /*reserve everything up front, the pool can never need more than the
+        *file itself plus a terminator per line
+        */
+
+        size_t before = count;
+        Pending batch[LOAD_BATCH];
+        p = data;
+
+        while(p < end){
+                int n = 0;
+
+                while(n < LOAD_BATCH && p < end){
+                        const char* nl = (const char*)memchr(p, '\n', end - p);
+                        if(nl == nullptr)
+                                nl = end;
+
+                        int r = parseLine(p, nl - p, defaultPort, &batch[n]);
+                        if(r == 1){
+                                __builtin_prefetch(&table[batch[n].hash & tableMask], 1);
+                                n++;
+                        }
+                        else if(r < 0){
+                                rejected++;
+                        }
+
+                        p = nl + 1;
+                }
+                /*parse a batch of lines, prefetching their index slots*/
+
+                for(int i = 0; i < n; i++)
+                        insert(&batch[i]);
+                /*the slots are now likely cached, insert the batch*/
+        }
+
+        return count - before;
+}
+
+/***************************************************************************
+* int TargetList::load(const char* path, uint16_t defaultPort)
+* Author: agent
+* Date: 10/19/2026
+* Description: Memory-maps a file of "host[:port]" lines and adds every
+*       unique target in it to the list
+*
+* Parameters:
+*        path   I/P     const char*     path of the target file
+*        defaultPort    I/P     uint16_t        port used when a line has none
+*        load   O/P     int     number of unique targets added, or a negative
+*                                       pingError on failure
+**************************************************************************/
+int TargetList::load(const char* path, uint16_t defaultPort)
+{
+        int ret;
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if(file == INVALID_HANDLE_VALUE)
+                return INITIALIZATION_FAILURE;
+
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize)){
+                CloseHandle(file);
+                return INITIALIZATION_FAILURE;
+        }
+        if(fileSize.QuadPart == 0){
+                CloseHandle(file);
+                return 0;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapping == NULL){
+                CloseHandle(file);
+                return INITIALIZATION_FAILURE;
+        }
+
+        const char* data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(data == NULL){
+                CloseHandle(mapping);
+                CloseHandle(file);
+                return INITIALIZATION_FAILURE;
+        }
+
+        ret = loadBuffer(data, fileSize.QuadPart, defaultPort);
+
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        int fd = open(path, O_RDONLY);
+        if(fd < 0)
+                return INITIALIZATION_FAILURE;
+
+        struct stat st;
+        if(fstat(fd, &st) < 0){
+                close(fd);
+                return INITIALIZATION_FAILURE;
+        }
+        if(st.st_size == 0){
+                close(fd);
+                return 0;
+        }
+
+        void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        /*the mapping stays valid after the descriptor is closed*/
+        if(data == MAP_FAILED)
+                return INITIALIZATION_FAILURE;
+
+        madvise(data, st.st_size, MADV_SEQUENTIAL);
+        /*let the kernel read ahead aggressively, the file is read once
+        *front to back
+        */
+
+        ret = loadBuffer((const char*)data, st.st_size, defaultPort);
+
+        munmap(data, st.st_size);
+#endif // _WIN32
+
+        return ret;
+}
+
+/***************************************************************************
+* size_t TargetList::size(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of unique targets in the list
+*
+* Parameters:
+*        size   O/P     size_t  number of targets
+**************************************************************************/
+size_t TargetList::size(void)
+{
+        return count;
+}
+
+/***************************************************************************
+* size_t TargetList::getDuplicates(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of duplicate targets that were skipped
+*
+* Parameters:
+*        getDuplicates  O/P     size_t  number of duplicates
+**************************************************************************/
+size_t TargetList::getDuplicates(void)
+{
+        return duplicates;
+}
+
+/***************************************************************************
+* size_t TargetList::getRejected(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the number of malformed targets that were skipped
+*
+* Parameters:
+*        getRejected    O/P     size_t  number of malformed targets
+**************************************************************************/
+size_t TargetList::getRejected(void)
+{
+        return rejected;
+}
+
+/***************************************************************************
+* const MC_Target* TargetList::getTarget(size_t index)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the raw target entry at the index
+*
+* Parameters:
+*        index  I/P     size_t  index of the target
+*        getTarget      O/P     const MC_Target*        target, or nullptr if
+*                                               out of range
+**************************************************************************/
+const MC_Target* TargetList::getTarget(size_t index)
+{
+        if(index >= count)
+                return nullptr;
+
+        return &targets[index];
+}
+
+/***************************************************************************
+* const char* TargetList::getHost(size_t index)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the null terminated host string of a target
+*
+* Parameters:
+*        index  I/P     size_t  index of the target
+*        getHost        O/P     const char*     host, or nullptr if out of range
+**************************************************************************/
+const char* TargetList::getHost(size_t index)
+{
+        if(index >= count)
+                return nullptr;
+
+        return pool + targets[index].hostOffset;
+}
+
+/***************************************************************************
+* uint16_t TargetList::getPort(size_t index)
+* Author: agent
+* Date: 10/19/2026
+* Description: Returns the port of a target
+*
+* Parameters:
+*        index  I/P     size_t  index of the target
+*        getPort        O/P     uint16_t        port, or 0 if out of range
+**************************************************************************/
+uint16_t TargetList::getPort(size_t index)
+{
+        if(index >= count)
+                return 0;
+
+        return targets[index].port;
+}
+
+/***************************************************************************
+* Ping* TargetList::createPing(size_t index)
+* Author: agent
+* Date: 10/19/2026
+* Description: Creates a new Ping object for a target. The caller owns the
+*       returned object
+*
+* Parameters:
+*        index  I/P     size_t  index of the target
+*        createPing     O/P     Ping*   new Ping object, or nullptr
+**************************************************************************/
+Ping* TargetList::createPing(size_t index)
+{
+        if(index >= count)
+                return nullptr;
+
+        return new(std::nothrow) Ping(pool + targets[index].hostOffset,
+                                        targets[index].port);
+}
@@ -0,0 +1,460 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+
+/***************************************************************************
+* File:  engine_loopback.cpp
+* Author:  agent
+* Procedures:
+* writeVarInt   -Encodes a protocol varint
+* readFrame     -Reads one length prefixed packet from a socket
+* serveClient   -Answers the status and ping requests of one connection
+* runServers    -Local stand-in Minecraft servers the engine probes
+* listenLoopback        -Opens a listening socket on a loopback port
+* write         -Counts a result by its outcome
+* flush         -Does nothing, the counts are kept in memory
+* scan          -Runs the engine over the list in one probe mode
+* testEventLoop -Checks that a reactor keeps many slow probes in flight
+* testModes     -Checks the status-only and connect-only probe modes
+* main          -Runs the loopback tests
+***************************************************************************/
+
+/**Loopback test of the probe engine. Stand-in servers listen on 127.0.0.1
+*and wait TEST_DELAY before they answer, so a reactor that probed one
+*target at a time would take TEST_SERVERS times as long. One extra server
+*rejects the status request and one target has nobody listening. Unix only
+**/
+
+
+#include <thread>
+#include <atomic>
+#include <poll.h>
+#include <unistd.h>
+#include "MinecraftPing.h"
+
+
+#define TEST_SERVERS 64
+#define TEST_DELAY 100
+#define TEST_REACTORS 2
+#define TEST_WINDOW 64
+
+static const char statusJSON[] = "{\"version\":{\"name\":\"1.20.4\","
+        "\"protocol\":765},\"players\":{\"max\":20,\"online\":1},"
+        "\"description\":{\"text\":\"loopback\"}}";
+static int listeners[TEST_SERVERS + 1];
+static uint16_t ports[TEST_SERVERS + 1];
+static std::atomic<bool> stopping(false);
+
+class CountingSink : public ResultSink{
+public:
+        std::atomic<int> answered;
+        std::atomic<int> refused;
+        std::atomic<int> rejected;
+        std::atomic<int> other;
+        std::atomic<int> mismatched;
+        probeMode mode;
+        int write(const PingResult* result);
+        int flush() { return OK; }
+};
+
+
+/***************************************************************************
+* static size_t writeVarInt(uint8_t* buffer, uint32_t value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes a protocol varint
+*
+* Parameters:
+*        buffer I/O     uint8_t*        buffer to write to, 5 bytes at most
+*        value  I/P     uint32_t        value to encode
+*        writeVarInt    O/P     size_t  number of bytes written
+**************************************************************************/
+static size_t writeVarInt(uint8_t* buffer, uint32_t value)
+{
+        size_t n = 0;
+
+        do{
+                uint8_t b = value & 0x7f;
+                value >>= 7;
+                buffer[n++] = b | (value ? 0x80 : 0);
+        }while(value);
+
+        return n;
+}
+
+/***************************************************************************
+* static bool readFrame(int fd, uint8_t* buffer, size_t size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads one length prefixed packet from a socket
+*
+* Parameters:
+*        fd     I/P     int     socket to read from
+*        buffer I/O     uint8_t*        buffer for the packet body
+*        size   I/P     size_t  size of the buffer
+*        readFrame      O/P     bool    false if the packet did not arrive
+**************************************************************************/
+static bool readFrame(int fd, uint8_t* buffer, size_t size)
+{
+        size_t length = 0;
+
+        for(int shift = 0; shift < 35; shift += 7){
+                uint8_t b;
+                if(recv(fd, &b, 1, 0) != 1)
+                        return false;
+                length |= (size_t)(b & 0x7f) << shift;
+                if(!(b & 0x80))
+                        break;
+        }
+        if(length > size)
+                return false;
+
+        size_t got = 0;
+        while(got < length){
+                ssize_t r = recv(fd, buffer + got, length - got, 0);
+                if(r <= 0)
+                        return false;
+                got += r;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static void serveClient(int fd, bool reject)
+* Author: agent
+* Date: 10/19/2026
+* Description: Answers the handshake, status request and ping of one
+*       connection like a vanilla server does, TEST_DELAY late. A rejecting
+*       server answers with a packet that is not a status response
+*
+* Parameters:
+*        fd     I/P     int     accepted connection, closed when done
+*        reject I/P     bool    true to reject the status request
+**************************************************************************/
+static void serveClient(int fd, bool reject)
+{
+        uint8_t packet[512];
+        uint8_t reply[sizeof(statusJSON) + 16];
+        size_t length = sizeof(statusJSON) - 1;
+
+        if(readFrame(fd, packet, sizeof(packet))
+                                && readFrame(fd, packet, sizeof(packet))){
+                usleep(TEST_DELAY * 1000);
+
+                if(reject){
+                        static const uint8_t disconnect[] = {3, 0x1b, 1, 'x'};
+                        send(fd, disconnect, sizeof(disconnect), 0);
+                        close(fd);
+                        return;
+                }
+
+                size_t n = writeVarInt(reply, length + 1
+                                + writeVarInt(packet, length));
+                reply[n++] = 0x00;
+                n += writeVarInt(reply + n, length);
+                memcpy(reply + n, statusJSON, length);
+                n += length;
+                send(fd, reply, n, 0);
+
+                if(readFrame(fd, packet, sizeof(packet))){
+                        uint8_t pong[10];
+                        pong[0] = 9;
+                        memcpy(pong + 1, packet, 9);
+                        send(fd, pong, sizeof(pong), 0);
+                }
+        }
+
+        close(fd);
+}
+
+/***************************************************************************
+* static void runServers(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Local stand-in Minecraft servers, one listener per target so
+*       every target of the list is a distinct host:port. The last one
+*       rejects every status request
+*
+* Parameters:
+**************************************************************************/
+static void runServers(void)
+{
+        struct pollfd fds[TEST_SERVERS + 1];
+
+        for(int i = 0; i <= TEST_SERVERS; i++){
+                fds[i].fd     = listeners[i];
+                fds[i].events = POLLIN;
+        }
+
+        while(!stopping){
+                if(poll(fds, TEST_SERVERS + 1, 100) <= 0)
+                        continue;
+
+                for(int i = 0; i <= TEST_SERVERS; i++){
+                        if(!(fds[i].revents & POLLIN))
+                                continue;
+                        int fd = accept(listeners[i], NULL, NULL);
+                        if(fd >= 0)
+                                std::thread(serveClient, fd,
+                                                i == TEST_SERVERS).detach();
+                }
+        }
+}
+
+/***************************************************************************
+* static int listenLoopback(uint16_t* port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Opens a listening socket on an unused loopback port
+*
+* Parameters:
+*        port   I/O     uint16_t*       port the socket listens on
+*        listenLoopback O/P     int     listening socket, -1 on failure
+**************************************************************************/
+static int listenLoopback(uint16_t* port)
+{
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+
+        if(fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0
+                        || listen(fd, 128) < 0
+                        || getsockname(fd, (struct sockaddr*)&address,
+                                                                &length) < 0){
+                if(fd >= 0)
+                        close(fd);
+                return -1;
+        }
+
+        *port = ntohs(address.sin_port);
+        return fd;
+}
+
+/***************************************************************************
+* int CountingSink::write(const PingResult* result)
+* Author: agent
+* Date: 10/19/2026
+* Description: Counts a result by its outcome. An answered result has to
+*       carry the server's response, unless the probe mode drops it, and a
+*       latency. No result may claim TCP Fast Open or a timestamped ping,
+*       the engine supports neither
+*
+* Parameters:
+*        result I/P     const PingResult*       completed probe
+*        write  O/P     int     OK
+**************************************************************************/
+int CountingSink::write(const PingResult* result)
+{
+        if(result->fastOpen != 0 || result->stampedPing != -1)
+                mismatched++;
+
+        if(result->error == OK){
+                answered++;
+                bool keeps = mode == PROBE_FULL || mode == PROBE_STATUS_ONLY;
+                if(result->milliseconds < 0 || (keeps && (result->response
+                                        == nullptr || strcmp(result->response,
+                                                        statusJSON)))
+                                || (!keeps && result->response != nullptr))
+                        mismatched++;
+        }
+        else if(result->error == CONNECT_FAILURE)
+                refused++;
+        else if(result->error == BAD_RESPONSE)
+                rejected++;
+        else
+                other++;
+
+        return OK;
+}
+
+/***************************************************************************
+* static bool scan(TargetList* list, probeMode mode, CountingSink* sink,
+*                                                       uint64_t* elapsed)
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs the engine over the list in one probe mode and checks
+*       the outcome of every target
+*
+* Parameters:
+*        list   I/P     TargetList*     targets, the last two fail
+*        mode   I/P     probeMode       probe mode
+*        sink   I/O     CountingSink*   receives the results
+*        elapsed        O/P     uint64_t*       time the run took in
+*                                               milliseconds
+*        scan   O/P     bool    true if every target had its outcome
+**************************************************************************/
+static bool scan(TargetList* list, probeMode mode, CountingSink* sink,
+                                                        uint64_t* elapsed)
+{
+        sink->answered = sink->refused = sink->rejected = 0;
+        sink->other = sink->mismatched = 0;
+        sink->mode = mode;
+
+        ProbeEngine engine(list, TEST_REACTORS);
+        engine.setAffinity(false);
+        engine.setWindow(TEST_WINDOW);
+        engine.setSink(sink);
+        engine.setProbeMode(mode);
+
+        uint64_t start = PollScheduler::now();
+        int probed = engine.run();
+        *elapsed = PollScheduler::now() - start;
+
+        EngineStats totals;
+        engine.getTotals(&totals);
+
+        bool connectOnly = mode == PROBE_CONNECT_ONLY;
+        int expected = TEST_SERVERS + connectOnly;
+        /*a connect-only probe never sees the rejecting server's answer*/
+
+        if(probed != TEST_SERVERS + 2 || sink->answered != expected
+                        || totals.answered != (uint64_t)expected
+                        || sink->refused != 1
+                        || sink->rejected != !connectOnly
+                        || sink->other != 0 || sink->mismatched != 0){
+                printf("engine_loopback: probed %d answered %d refused %d "
+                        "rejected %d other %d mismatched %d\n", probed,
+                        (int)sink->answered, (int)sink->refused,
+                        (int)sink->rejected, (int)sink->other,
+                        (int)sink->mismatched);
+                return false;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static bool testEventLoop(TargetList* list)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks that every target is probed once and that the slow
+*       servers are waited on at the same time, a run has to take a small
+*       part of what probing them one after another would
+*
+* Parameters:
+*        list   I/P     TargetList*     targets
+*        testEventLoop  O/P     bool    true if the test passed
+**************************************************************************/
+static bool testEventLoop(TargetList* list)
+{
+        CountingSink sink;
+        uint64_t elapsed;
+
+        if(!scan(list, PROBE_FULL, &sink, &elapsed))
+                return false;
+
+        uint64_t serial = (uint64_t)TEST_SERVERS * TEST_DELAY / TEST_REACTORS;
+        if(elapsed * 4 > serial){
+                printf("engine_loopback: run took %llu ms, one probe at a "
+                        "time per reactor takes %llu ms\n",
+                        (unsigned long long)elapsed,
+                        (unsigned long long)serial);
+                return false;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static bool testModes(TargetList* list)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks the status-only, latency-only and connect-only probe
+*       modes
+*
+* Parameters:
+*        list   I/P     TargetList*     targets
+*        testModes      O/P     bool    true if the test passed
+**************************************************************************/
+static bool testModes(TargetList* list)
+{
+        CountingSink sink;
+        uint64_t elapsed;
+
+        return scan(list, PROBE_STATUS_ONLY, &sink, &elapsed)
+                        && scan(list, PROBE_LATENCY_ONLY, &sink, &elapsed)
+                        && scan(list, PROBE_CONNECT_ONLY, &sink, &elapsed);
+}
+
+/***************************************************************************
+* int main(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs the loopback tests
+*
+* Parameters:
+*        main   O/P     int     0 if every test passed
+**************************************************************************/
+int main(void)
+{
+        char targets[(TEST_SERVERS + 2) * 24];
+        size_t length = 0;
+
+        for(int i = 0; i <= TEST_SERVERS; i++){
+                listeners[i] = listenLoopback(&ports[i]);
+                if(listeners[i] < 0){
+                        perror("engine_loopback: listen");
+                        return 1;
+                }
+                length += snprintf(targets + length, sizeof(targets) - length,
+                                                "127.0.0.1:%u\n", ports[i]);
+        }
+
+        uint16_t closed = 0;
+        int fd = listenLoopback(&closed);
+        if(fd >= 0)
+                close(fd);
+        length += snprintf(targets + length, sizeof(targets) - length,
+                                                "127.0.0.1:%u\n", closed);
+        /*a port nobody listens on any more*/
+
+        TargetList list;
+        if(list.loadBuffer(targets, length) != TEST_SERVERS + 2){
+                printf("engine_loopback: could not load the targets\n");
+                return 1;
+        }
+
+        std::thread servers(runServers);
+
+        struct{
+                const char* name;
+                bool (*run)(TargetList*);
+        }tests[] = {
+                {"event loop", testEventLoop},
+                {"probe modes", testModes}
+        };
+
+        int failed = 0;
+        for(size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++){
+                bool passed = tests[i].run(&list);
+                printf("%s: %s\n", passed ? "PASS" : "FAIL", tests[i].name);
+                failed += !passed;
+        }
+
+        stopping = true;
+        servers.join();
+        for(int i = 0; i <= TEST_SERVERS; i++)
+                close(listeners[i]);
+
+        return failed ? 1 : 0;
+}
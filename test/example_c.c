@@ -107,8 +107,10 @@ char* getAPIerror(enum pingError z){
     switch(z){
         case OK:                                return (char*)"OK";
         case REDIRECTED:                        return (char*)"REDIRECTED";
+        case UNCHANGED:                         return (char*)"UNCHANGED";
         case CONNECT_FAILURE:                   return (char*)"CONNECT_FAILURE";
 
+        case BUFFER_TRUNCATED:                  return (char*)"BUFFER_TRUNCATED";
         case SOCKET_INITIALIZATION_FAILURE:     return (char*)"SOCKET_INITIALIZATION_FAILURE";
         case SOCKET_OPEN_FAILURE:               return (char*)"SOCKET_OPEN_FAILURE";
         case RECEIVE_FAILURE:                   return (char*)"RECEIVE_FAILURE";
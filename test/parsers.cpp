@@ -0,0 +1,878 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+
+/***************************************************************************
+* File:  parsers.cpp
+* Author:  agent
+* Procedures:
+* joinPath      -Builds the path of a scratch file in the test directory
+* readFile      -Reads a whole file into a string
+* fillResult    -Fills a PingResult with a host and a response
+* testNDJSON    -Checks which responses the NDJSON sink embeds as objects
+* writeLog      -Writes a small binary result log
+* patchRecord   -Overwrites one field of a record in a log file
+* testBinaryLog -Checks that corrupt binary logs are refused
+* testHasher    -Checks that chunk boundaries do not change response hashes
+* splitFavicon  -Runs a response through a FaviconSplitter in chunks
+* testFavicon   -Checks that favicons are split out at any chunk boundary
+* addRecord     -Appends a DNS answer record to a test response
+* testSRV       -Checks SRV answers that are truncated, compressed or looping
+* writeFile     -Writes a string to a file
+* buildSnapshot -Builds a small state snapshot in memory
+* openSnapshot  -Writes a snapshot and opens it with a SnapshotReader
+* testSnapshot  -Checks that corrupt snapshots are refused
+* main          -Runs the parser tests
+***************************************************************************/
+
+/**Tests of the code that reads what a server or another process wrote:
+*responses embedded in NDJSON lines, binary result logs, the streaming
+*response parsers, DNS answers and state snapshots. Every input is built in
+*memory or in scratch files under the directory given on the command line,
+*no network is involved
+**/
+
+
+#include <string>
+#include <stddef.h>
+#include "MinecraftPing.h"
+
+
+#define LOG_RECORDS 4
+#define JSON_DEPTH_TEST 100
+/*deeper than the sink checks before it embeds a response*/
+#define FAVICON_TEST_CHUNK 256
+#define SRV_NAME_POINTER 28
+/*offset of "example" in the question, right after _minecraft._tcp*/
+
+
+/***************************************************************************
+* static std::string joinPath(const char* dir, const char* name)
+* Author: agent
+* Date: 10/19/2026
+* Description: Builds the path of a scratch file in the test directory
+*
+* Parameters:
+*        dir    I/P     const char*     test directory
+*        name   I/P     const char*     file name
+*        joinPath       O/P     std::string     path of the file
+**************************************************************************/
+static std::string joinPath(const char* dir, const char* name)
+{
+        return std::string(dir) + "/" + name;
+}
+
+/***************************************************************************
+* static std::string readFile(const std::string& path)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads a whole file into a string
+*
+* Parameters:
+*        path   I/P     const std::string&      file to read
+*        readFile       O/P     std::string     contents, empty on failure
+**************************************************************************/
+static std::string readFile(const std::string& path)
+{
+        std::string out;
+        FILE* f = fopen(path.c_str(), "rb");
+        if(f == nullptr)
+                return out;
+
+        char buffer[4096];
+        size_t n;
+        while((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+                out.append(buffer, n);
+
+        fclose(f);
+        return out;
+}
+
+/***************************************************************************
+* static void fillResult(PingResult* r, const char* host,
+*                                               const char* response)
+* Author: agent
+* Date: 10/19/2026
+* Description: Fills a PingResult with a host and a response
+*
+* Parameters:
+*        r      I/O     PingResult*     result to fill
+*        host   I/P     const char*     host of the result
+*        response       I/P     const char*     response, or nullptr
+**************************************************************************/
+static void fillResult(PingResult* r, const char* host, const char* response)
+{
+        memset(r, 0, sizeof(*r));
+        r->host           = host;
+        r->response       = response;
+        r->responseLength = response ? strlen(response) : 0;
+        r->port           = 25565;
+        r->error          = response ? OK : CONNECT_FAILURE;
+        r->dnsError       = NOERROR_STATUS;
+        r->milliseconds   = response ? 12 : -1;
+        r->kernelRtt      = -1;
+        r->stampedPing    = -1;
+}
+
+/***************************************************************************
+* static bool testNDJSON(const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes hostile and well formed responses through the NDJSON
+*       sink. Only well formed objects may be embedded, everything else has
+*       to come out as a JSON string, and every record has to stay on one
+*       line
+*
+* Parameters:
+*        dir    I/P     const char*     directory for scratch files
+*        testNDJSON     O/P     bool    true if the test passed
+**************************************************************************/
+static bool testNDJSON(const char* dir)
+{
+        struct{
+                const char* response;
+                bool embedded;
+        }cases[] = {
+                {"{\"players\":{\"max\":20,\"online\":1}}", true},
+                {"  {\"a\":[1,2.5e3,-0.5,true,null],\n\"b\":\"\\u00e9\"}\r\n", true},
+                {"{}", true},
+                {"{\"a\":1", false},
+                {"{\"a\":1}x", false},
+                {"{\"a\":1},\"error\":1,\"b\":{}", false},
+                {"{\"a\":\"line\nbreak\"}", false},
+                {"{\"a\":\"\\q\"}", false},
+                {"{\"a\":01}", false},
+                {"{\"a\":1,}", false},
+                {"{\"a\" 1}", false},
+                {"[1,2]", false},
+                {"\"}\n{\"error\":1", false},
+                {"", false}
+        };
+        const size_t caseCount = sizeof(cases) / sizeof(cases[0]);
+
+        std::string deep(JSON_DEPTH_TEST, '[');
+        deep = "{\"a\":" + deep + std::string(JSON_DEPTH_TEST, ']') + "}";
+        /*nested deeper than the sink is willing to check*/
+
+        std::string path = joinPath(dir, "parsers.ndjson");
+        NDJSONSink sink;
+        if(sink.open(path.c_str(), false) != OK)
+                return false;
+
+        PingResult r;
+        for(size_t i = 0; i < caseCount; i++){
+                fillResult(&r, "example.com", cases[i].response);
+                if(sink.write(&r) != OK)
+                        return false;
+        }
+        fillResult(&r, "deep.example.com", deep.c_str());
+        sink.write(&r);
+        fillResult(&r, "host\"with\nquotes", nullptr);
+        sink.write(&r);
+        sink.close();
+
+        std::string out = readFile(path);
+        size_t line = 0;
+        size_t start = 0;
+
+        while(start < out.size()){
+                size_t end = out.find('\n', start);
+                if(end == std::string::npos)
+                        return false;
+                std::string record = out.substr(start, end - start);
+                start = end + 1;
+
+                if(record.compare(record.size() - 1, 1, "}"))
+                        return false;
+                size_t at = record.find("\"response\":");
+                if(at == std::string::npos)
+                        return false;
+                char first = record[at + 11];
+
+                if(line < caseCount){
+                        if((first == '{') != cases[line].embedded)
+                                return false;
+                        if(!cases[line].embedded && first != '"')
+                                return false;
+                }
+                else if(line == caseCount && first != '"')
+                        return false;
+                else if(line == caseCount + 1 && first != 'n')
+                        return false;
+                /*the deep response is a string, the missing one is null*/
+
+                if(record.find("\"error\":1,\"b\"") != std::string::npos)
+                        return false;
+                /*no response may add fields to its record*/
+                line++;
+        }
+
+        remove(path.c_str());
+        return line == caseCount + 2;
+}
+
+/***************************************************************************
+* static bool writeLog(const std::string& path)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes a binary result log of LOG_RECORDS results, every
+*       other one with a response
+*
+* Parameters:
+*        path   I/P     const std::string&      path of the log
+*        writeLog       O/P     bool    true if the log was written
+**************************************************************************/
+static bool writeLog(const std::string& path)
+{
+        remove(path.c_str());
+        remove((path + ".blob").c_str());
+
+        BinaryLogSink sink;
+        if(sink.open(path.c_str(), false) != OK)
+                return false;
+
+        char hosts[LOG_RECORDS][32];
+        PingResult r;
+        for(int i = 0; i < LOG_RECORDS; i++){
+                snprintf(hosts[i], sizeof(hosts[i]), "server%d.example.com", i);
+                fillResult(&r, hosts[i], i % 2 ? nullptr : "{\"a\":1}");
+                if(sink.write(&r) != OK)
+                        return false;
+        }
+
+        sink.close();
+        return true;
+}
+
+/***************************************************************************
+* static bool patchRecord(const std::string& path, size_t index,
+*                       size_t offset, const void* value, size_t length)
+* Author: agent
+* Date: 10/19/2026
+* Description: Overwrites one field of a record in a log file
+*
+* Parameters:
+*        path   I/P     const std::string&      path of the log
+*        index  I/P     size_t  record to change
+*        offset I/P     size_t  offset of the field in MC_LogRecord
+*        value  I/P     const void*     new value of the field
+*        length I/P     size_t  size of the field
+*        patchRecord    O/P     bool    true if the field was written
+**************************************************************************/
+static bool patchRecord(const std::string& path, size_t index, size_t offset,
+                                        const void* value, size_t length)
+{
+        FILE* f = fopen(path.c_str(), "r+b");
+        if(f == nullptr)
+                return false;
+
+        bool ok = fseek(f, LOG_HEADER_SIZE + index * sizeof(MC_LogRecord)
+                                                        + offset, SEEK_SET) == 0
+                        && fwrite(value, 1, length, f) == length;
+
+        fclose(f);
+        return ok;
+}
+
+/***************************************************************************
+* static bool testBinaryLog(const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks that a well formed log reads back, that a blob cut
+*       short only loses its trailing record, and that records pointing
+*       outside the blob, hosts without their terminator and unknown error
+*       codes make the whole log corrupt
+*
+* Parameters:
+*        dir    I/P     const char*     directory for scratch files
+*        testBinaryLog  O/P     bool    true if the test passed
+**************************************************************************/
+static bool testBinaryLog(const char* dir)
+{
+        std::string path = joinPath(dir, "parsers.log");
+        BinaryLogReader reader;
+        PingResult r;
+
+        if(!writeLog(path) || reader.open(path.c_str()) != OK
+                                || reader.size() != LOG_RECORDS)
+                return false;
+        for(size_t i = 0; i < LOG_RECORDS; i++){
+                char host[32];
+                snprintf(host, sizeof(host), "server%d.example.com", (int)i);
+                if(!reader.get(i, &r) || strcmp(r.host, host)
+                                || (r.response != nullptr) != (i % 2 == 0))
+                        return false;
+        }
+        if(reader.get(LOG_RECORDS, &r))
+                return false;
+        reader.close();
+
+        std::string blob = readFile(path + ".blob");
+        FILE* f = fopen((path + ".blob").c_str(), "wb");
+        if(f == nullptr || fwrite(blob.data(), 1, blob.size() - 3, f)
+                                                        != blob.size() - 3){
+                if(f != nullptr)
+                        fclose(f);
+                return false;
+        }
+        fclose(f);
+        if(reader.open(path.c_str()) != OK
+                                || reader.size() != LOG_RECORDS - 1)
+                return false;
+        reader.close();
+        /*a crash while the blob was written only loses the last record*/
+
+        uint64_t hugeOffset = 0xFFFFFFFFFFFFFFF0ull;
+        uint8_t longHost    = 0xFF;
+        uint8_t shortHost   = 3;
+        uint32_t hugeLength = 0xFFFFFFFF;
+        int16_t badError    = 1000;
+        struct{
+                size_t offset;
+                const void* value;
+                size_t length;
+        }patches[] = {
+                {offsetof(MC_LogRecord, blobOffset), &hugeOffset, 8},
+                {offsetof(MC_LogRecord, hostLength), &longHost, 1},
+                {offsetof(MC_LogRecord, hostLength), &shortHost, 1},
+                {offsetof(MC_LogRecord, responseLength), &hugeLength, 4},
+                {offsetof(MC_LogRecord, error), &badError, 2}
+        };
+
+        for(size_t i = 0; i < sizeof(patches) / sizeof(patches[0]); i++){
+                if(!writeLog(path) || !patchRecord(path, 0, patches[i].offset,
+                                        patches[i].value, patches[i].length))
+                        return false;
+                if(reader.open(path.c_str()) != BAD_RESPONSE
+                                                || reader.size() != 0)
+                        return false;
+        }
+        /*the first record is followed by good ones, so it cannot pass for a
+        *record cut short by a crash
+        */
+
+        remove(path.c_str());
+        remove((path + ".blob").c_str());
+        return true;
+}
+
+/***************************************************************************
+* static bool testHasher(const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Feeds responses to the hasher split at every position and
+*       byte by byte, which has to give the hash of the whole response.
+*       Masked fields must not change the hash, other fields must
+*
+* Parameters:
+*        dir    I/P     const char*     unused, no files are needed
+*        testHasher     O/P     bool    true if the test passed
+**************************************************************************/
+static bool testHasher(const char* dir)
+{
+        (void)dir;
+        static const char* responses[] = {
+                "{\"description\":{\"text\":\"a \\\"quoted\\\" {motd}\"},"
+                        "\"players\":{\"max\":20,\"online\": 3,\"sample\":"
+                        "[{\"name\":\"x]\",\"id\":\"1\"}]},"
+                        "\"favicon\" : \"data:image/png;base64,AAAA\","
+                        "\"version\":{\"name\":\"1.20\",\"protocol\":765}}",
+                "{\"online\":true,\"description\":\"\\\\\",\"x\":[1,[2,{}]]}",
+                "{\"a\":\"unterminated"
+        };
+        static const unsigned masks[] = {HASH_MASK_NONE, HASH_MASK_SAMPLE
+                        | HASH_MASK_ONLINE, HASH_MASK_FAVICON
+                        | HASH_MASK_DESCRIPTION, HASH_MASK_SAMPLE
+                        | HASH_MASK_FAVICON | HASH_MASK_ONLINE
+                        | HASH_MASK_DESCRIPTION};
+
+        for(size_t r = 0; r < sizeof(responses) / sizeof(responses[0]); r++){
+                const char* text = responses[r];
+                size_t length = strlen(text);
+
+                for(size_t m = 0; m < sizeof(masks) / sizeof(masks[0]); m++){
+                        uint64_t whole = ResponseHasher::hashResponse(text,
+                                                        length, masks[m]);
+                        ResponseHasher h;
+
+                        for(size_t split = 0; split <= length; split++){
+                                h.reset(masks[m]);
+                                h.update(text, split);
+                                h.update(text + split, length - split);
+                                if(h.digest() != whole)
+                                        return false;
+                        }
+
+                        h.reset(masks[m]);
+                        for(size_t i = 0; i < length; i++)
+                                h.update(text + i, 1);
+                        if(h.digest() != whole)
+                                return false;
+                }
+        }
+
+        const char* before = "{\"players\":{\"online\":3,\"sample\":[]},"
+                                "\"favicon\":\"a\",\"description\":\"x\"}";
+        const char* after  = "{\"players\":{\"online\":47,\"sample\":[{}]},"
+                                "\"favicon\":\"b\",\"description\":{\"text\":\"}\"}}";
+        unsigned all = HASH_MASK_SAMPLE | HASH_MASK_FAVICON | HASH_MASK_ONLINE
+                                                | HASH_MASK_DESCRIPTION;
+
+        return ResponseHasher::hashResponse(before, strlen(before), all)
+                        == ResponseHasher::hashResponse(after, strlen(after), all)
+                && ResponseHasher::hashResponse(before, strlen(before),
+                                                        HASH_MASK_ONLINE)
+                        != ResponseHasher::hashResponse(after, strlen(after),
+                                                        HASH_MASK_ONLINE);
+}
+
+/***************************************************************************
+* static std::string splitFavicon(FaviconStore* store, const char* text,
+*                               size_t chunk, uint64_t* hash)
+* Author: agent
+* Date: 10/19/2026
+* Description: Feeds a response to a new FaviconSplitter in chunks of the
+*       given size and returns what the splitter kept of it
+*
+* Parameters:
+*        store  I/P     FaviconStore*   store the favicon is put in
+*        text   I/P     const char*     whole response
+*        chunk  I/P     size_t  length of every chunk but the last
+*        hash   I/O     uint64_t*       receives the favicon hash
+*        splitFavicon   O/P     std::string     response with the favicon
+*                                               replaced
+**************************************************************************/
+static std::string splitFavicon(FaviconStore* store, const char* text,
+                                size_t chunk, uint64_t* hash)
+{
+        FaviconSplitter splitter;
+        std::string kept;
+        size_t length = strlen(text);
+        char out[FAVICON_TEST_CHUNK + FAVICON_REFERENCE_SIZE];
+
+        splitter.reset(store);
+        for(size_t i = 0; i < length; i += chunk){
+                size_t n = length - i < chunk ? length - i : chunk;
+                kept.append(out, splitter.feed(text + i, n, out));
+        }
+        *hash = splitter.getHash();
+        return kept;
+}
+
+/***************************************************************************
+* static bool testFavicon(const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Splits the favicon out of a response fed in chunks of every
+*       size, which has to give the same result as feeding it whole. Only the
+*       top level favicon is replaced, and the stores give back the favicon
+*       text or its decoded PNG bytes whichever way it was escaped
+*
+* Parameters:
+*        dir    I/P     const char*     unused, no files are needed
+*        testFavicon    O/P     bool    true if the test passed
+**************************************************************************/
+static bool testFavicon(const char* dir)
+{
+        (void)dir;
+        const char* response = "{\"description\":\"favicon\","
+                        "\"extra\":{\"favicon\":\"inner\"},\"favicon\" : "
+                        "\"data:image\\/png;base64,iVBORw0KGgo=\"}";
+        const char* escaped = "{\"favicon\":"
+                        "\"data:image/png;base64,iVBORw0KGgo\\u003d\"}";
+        static const uint8_t png[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+                                                                        '\n'};
+        const char* uri = "data:image/png;base64,iVBORw0KGgo=";
+        FaviconStore text(false);
+        FaviconStore decoded(true);
+        uint64_t hash;
+        uint64_t other;
+        char expected[256];
+
+        std::string whole = splitFavicon(&text, response, FAVICON_TEST_CHUNK,
+                                                                        &hash);
+        snprintf(expected, sizeof(expected), "{\"description\":\"favicon\","
+                        "\"extra\":{\"favicon\":\"inner\"},\"favicon\" : \""
+                        FAVICON_REFERENCE "%016llx\"}",
+                        (unsigned long long)hash);
+        if(hash == 0 || whole != expected)
+                return false;
+        /*only the top level favicon is a reference, the nested one and the
+        *description that reads "favicon" are kept
+        */
+
+        for(size_t chunk = 1; chunk < strlen(response); chunk++){
+                if(splitFavicon(&text, response, chunk, &other) != whole
+                                || other != hash)
+                        return false;
+        }
+
+        const uint8_t* data;
+        size_t length;
+        if(!text.get(hash, &data, &length) || length != strlen(uri)
+                        || memcmp(data, uri, length) || text.size() != 1)
+                return false;
+        splitFavicon(&text, escaped, FAVICON_TEST_CHUNK, &other);
+        if(other != hash || text.size() != 1)
+                return false;
+        /*the escaped slash and \u003d spell the same favicon*/
+
+        splitFavicon(&decoded, response, 3, &hash);
+        if(!decoded.get(hash, &data, &length) || length != sizeof(png)
+                        || memcmp(data, png, length))
+                return false;
+
+        return !decoded.get(hash ^ 1, &data, &length);
+}
+
+/***************************************************************************
+* static int addRecord(uint8_t* packet, int pos, uint16_t type,
+*                               const char* rdata, uint16_t rdlength)
+* Author: agent
+* Date: 10/19/2026
+* Description: Appends an answer record named by a pointer to the question
+*       and counts it in the header
+*
+* Parameters:
+*        packet I/O     uint8_t*        response being built
+*        pos    I/P     int     offset the record is written at
+*        type   I/P     uint16_t        record type
+*        rdata  I/P     const char*     record data
+*        rdlength       I/P     uint16_t        length of the record data
+*        addRecord      O/P     int     offset after the record
+**************************************************************************/
+static int addRecord(uint8_t* packet, int pos, uint16_t type,
+                                const char* rdata, uint16_t rdlength)
+{
+        static const uint8_t fixed[] = {0xC0, 0x0C, 0, 0, 0x00, 0x01, 0, 0,
+                                                        0x01, 0x2C, 0, 0};
+        /*name pointer, type, class IN, TTL of 300 and the data length*/
+
+        memcpy(packet + pos, fixed, sizeof(fixed));
+        packet[pos + 2]  = type >> 8;
+        packet[pos + 3]  = type & 0xff;
+        packet[pos + 10] = rdlength >> 8;
+        packet[pos + 11] = rdlength & 0xff;
+        memcpy(packet + pos + sizeof(fixed), rdata, rdlength);
+
+        uint16_t answers = (packet[6] << 8 | packet[7]) + 1;
+        packet[6] = answers >> 8;
+        packet[7] = answers & 0xff;
+        return pos + sizeof(fixed) + rdlength;
+}
+
+/***************************************************************************
+* static bool testSRV(const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Parses an SRV response with compressed names, a CNAME, a
+*       root target and short record data, then every truncation of it and
+*       responses whose names loop or point out of the packet. Also checks
+*       the draw between records of weight 0
+*
+* Parameters:
+*        dir    I/P     const char*     unused, no files are needed
+*        testSRV        O/P     bool    true if the test passed
+**************************************************************************/
+static bool testSRV(const char* dir)
+{
+        (void)dir;
+        static const char* targets[] = {"a.example.com", "mc1.example.com",
+                                                        "b.example.com"};
+        static const uint16_t ports[] = {25565, 25566, 25567};
+        uint8_t packet[512];
+        SRV_Answer answer;
+
+        int length = (int)Ping::buildSRVQuestion("example.com", 0x1234,
+                                                                packet);
+        if(length == 0 || memcmp(packet + SRV_NAME_POINTER, "\7example", 8))
+                return false;
+        packet[2] = 0x81;
+        packet[3] = 0x80;
+        /*a response with recursion, NOERROR*/
+
+        length = addRecord(packet, length, 0x0021,
+                        "\0\x0a\0\0\x63\xdd\1a\xc0\x1c", 10);
+        length = addRecord(packet, length, 0x0005, "\xc0\x1c", 2);
+        length = addRecord(packet, length, 0x0021,
+                        "\0\x0a\0\0\x63\xde\3mc1\xc0\x1c", 12);
+        length = addRecord(packet, length, 0x0021, "\0\0\0\0\0\1", 7);
+        length = addRecord(packet, length, 0x0021, "\0\0\0", 3);
+        length = addRecord(packet, length, 0x0021,
+                        "\0\x14\0\5\x63\xdf\1b\xc0\x1c", 10);
+        /*the CNAME, the "." target and the 3 byte record are left out*/
+
+        Ping::parseSRVAnswer(packet, length, &answer);
+        if(answer.dns_error != NOERROR_STATUS || answer.count != 3)
+                return false;
+        for(int i = 0; i < 3; i++){
+                if(strcmp(answer.records[i].target, targets[i])
+                                || answer.records[i].port != ports[i]
+                                || answer.records[i].ttl != 300)
+                        return false;
+        }
+
+        if(Ping::selectSRV(&answer, 0) != 0 || Ping::selectSRV(&answer, 1) != 1
+                        || Ping::selectSRV(&answer, 2) != 0)
+                return false;
+        /*with every weight 0 the lowest priority records take turns*/
+        answer.records[1].weight = 3;
+        for(uint64_t r = 0; r < 8; r++){
+                if(Ping::selectSRV(&answer, r) != 1)
+                        return false;
+        }
+        /*and once one has a weight the ones without are never drawn*/
+
+        uint16_t read = 0;
+        for(int cut = 0; cut < length; cut++){
+                Ping::parseSRVAnswer(packet, cut, &answer);
+                if(answer.count < read || answer.count > 3)
+                        return false;
+                for(uint16_t i = 0; i < answer.count; i++){
+                        if(strcmp(answer.records[i].target, targets[i]))
+                                return false;
+                }
+                read = answer.count;
+                if(cut < 12 && answer.dns_error != RECV_REQUEST_FAILURE)
+                        return false;
+        }
+        if(read != 2)
+                return false;
+        /*every cut keeps the records in front of it and nothing else*/
+
+        packet[3] |= NXDOMAIN_STATUS;
+        Ping::parseSRVAnswer(packet, length, &answer);
+        if(answer.dns_error != NXDOMAIN_STATUS)
+                return false;
+
+        static const uint8_t loop[] = {0x12, 0x34, 0x81, 0x80, 0, 0, 0, 1,
+                        0, 0, 0, 0, 0xC0, 0x0C, 0, 0x21, 0, 1, 0, 0, 0, 0, 0,
+                        0};
+        Ping::parseSRVAnswer(loop, sizeof(loop), &answer);
+        if(answer.count != 0)
+                return false;
+        /*a name pointing at itself*/
+
+        static const uint8_t outside[] = {0x12, 0x34, 0x81, 0x80, 0, 0, 0, 1,
+                        0, 0, 0, 0, 0, 0, 0x21, 0, 1, 0, 0, 0, 0, 0, 9, 0, 0,
+                        0, 0, 0, 0, 0xC0, 0xFF, 0};
+        Ping::parseSRVAnswer(outside, sizeof(outside), &answer);
+        /*a target pointing past the end of the packet*/
+
+        return answer.count == 0;
+}
+
+/***************************************************************************
+* static bool writeFile(const std::string& path, const std::string& data)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes a string to a file, replacing what was there
+*
+* Parameters:
+*        path   I/P     const std::string&      path of the file
+*        data   I/P     const std::string&      contents
+*        writeFile      O/P     bool    true if the file was written
+**************************************************************************/
+static bool writeFile(const std::string& path, const std::string& data)
+{
+        FILE* f = fopen(path.c_str(), "wb");
+        if(f == nullptr)
+                return false;
+        bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+        return fclose(f) == 0 && written;
+}
+
+/***************************************************************************
+* static std::string buildSnapshot(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Lays out a snapshot the way SnapshotWriter does: a header,
+*       one checkpoint, three records sorted by key and a name pool. The
+*       first record names no backend, the second names one and the third
+*       points past the end of the pool
+*
+* Parameters:
+*        buildSnapshot  O/P     std::string     the snapshot file
+**************************************************************************/
+static std::string buildSnapshot(void)
+{
+        static const char pool[] = "mc1.example.com";
+        MC_ScanCheckpoint checkpoint = {7, 100, 250};
+        MC_TargetState records[3];
+        uint8_t header[SNAPSHOT_HEADER_SIZE] = {0};
+        uint32_t recordSize  = sizeof(MC_TargetState);
+        uint32_t checkpoints = 1;
+        uint64_t recordTotal = 3;
+        uint64_t nameTotal   = sizeof(pool) - 1;
+
+        memcpy(header, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        memcpy(header + 8, &recordSize, sizeof(recordSize));
+        memcpy(header + 12, &checkpoints, sizeof(checkpoints));
+        memcpy(header + 16, &recordTotal, sizeof(recordTotal));
+        memcpy(header + 24, &nameTotal, sizeof(nameTotal));
+
+        memset(records, 0, sizeof(records));
+        for(int i = 0; i < 3; i++){
+                records[i].key  = (i + 1) * 10;
+                records[i].port = 25565 + i;
+        }
+        records[1].nameLength = sizeof(pool) - 1;
+        records[2].nameOffset = 10;
+        records[2].nameLength = sizeof(pool) - 1;
+
+        std::string file((const char*)header, sizeof(header));
+        file.append((const char*)&checkpoint, sizeof(checkpoint));
+        file.append((const char*)records, sizeof(records));
+        file.append(pool, sizeof(pool) - 1);
+        return file;
+}
+
+/***************************************************************************
+* static int openSnapshot(SnapshotReader* reader, const std::string& path,
+*                                               const std::string& data)
+* Author: agent
+* Date: 10/19/2026
+* Description: Writes a snapshot file and opens it
+*
+* Parameters:
+*        reader I/O     SnapshotReader* reader to open the file with
+*        path   I/P     const std::string&      path of the file
+*        data   I/P     const std::string&      contents of the file
+*        openSnapshot   O/P     int     what SnapshotReader::open() returned
+**************************************************************************/
+static int openSnapshot(SnapshotReader* reader, const std::string& path,
+                                                const std::string& data)
+{
+        reader->close();
+        if(!writeFile(path, data))
+                return INITIALIZATION_FAILURE;
+        return reader->open(path.c_str());
+}
+
+/***************************************************************************
+* static bool testSnapshot(const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads back a snapshot, then every truncation of it and
+*       copies whose header counts do not add up, which have to be refused
+*       without reading past the mapping. Names outside the pool are not
+*       returned
+*
+* Parameters:
+*        dir    I/P     const char*     directory for the scratch snapshot
+*        testSnapshot   O/P     bool    true if the test passed
+**************************************************************************/
+static bool testSnapshot(const char* dir)
+{
+        std::string path = joinPath(dir, "parsers.snapshot");
+        std::string file = buildSnapshot();
+        SnapshotReader reader;
+        MC_ScanCheckpoint checkpoint;
+        char backend[DOMAIN_MAX_SIZE + 1];
+
+        if(openSnapshot(&reader, path, file) != OK || reader.size() != 3)
+                return false;
+        if(reader.find(5) != nullptr || reader.find(25) != nullptr
+                        || reader.find(40) != nullptr
+                        || reader.find(30) == nullptr
+                        || reader.find(20)->port != 25566)
+                return false;
+        if(reader.getBackend(reader.find(10), backend) != nullptr
+                        || reader.getBackend(reader.find(20), backend) == nullptr
+                        || strcmp(backend, "mc1.example.com")
+                        || reader.getBackend(reader.find(30), backend) != nullptr)
+                return false;
+        /*the third record's name would run past the pool*/
+        if(!reader.getCheckpoint(7, &checkpoint) || checkpoint.position != 100
+                        || reader.getCheckpoint(8, &checkpoint))
+                return false;
+
+        for(size_t cut = 0; cut < file.size(); cut++){
+                if(openSnapshot(&reader, path, file.substr(0, cut)) == OK)
+                        return false;
+        }
+
+        struct{
+                size_t offset;
+                uint64_t value;
+                size_t size;
+        }corrupt[] = {
+                {0, 'X', 1},
+                {8, sizeof(MC_TargetState) + 8, 4},
+                {12, 0xFFFFFFFF, 4},
+                {12, 2, 4},
+                {16, 4, 8},
+                {16, 1ULL << 61, 8},
+                {24, 16, 8},
+                {24, UINT64_MAX, 8}
+        };
+        /*bad magic and record size, counts that overrun the file or wrap
+        *the section offsets around, and name pools that do not fill the rest
+        */
+        for(size_t i = 0; i < sizeof(corrupt) / sizeof(corrupt[0]); i++){
+                std::string copy = file;
+                memcpy(&copy[corrupt[i].offset], &corrupt[i].value,
+                                                        corrupt[i].size);
+                if(openSnapshot(&reader, path, copy) != BAD_RESPONSE)
+                        return false;
+        }
+
+        reader.close();
+        remove(path.c_str());
+        /*and a missing one is no snapshot at all*/
+        return reader.open(path.c_str()) == INITIALIZATION_FAILURE;
+}
+
+/***************************************************************************
+* int main(int argc, char** argv)
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs the parser tests
+*
+* Parameters:
+*        argc   I/P     int     number of arguments
+*        argv   I/P     char**  arguments, the first one is the directory
+*                               for scratch files
+*        main   O/P     int     0 if every test passed
+**************************************************************************/
+int main(int argc, char** argv)
+{
+        const char* dir = argc > 1 ? argv[1] : ".";
+
+        struct{
+                const char* name;
+                bool (*run)(const char*);
+        }tests[] = {
+                {"NDJSON responses", testNDJSON},
+                {"binary log records", testBinaryLog},
+                {"response hasher chunks", testHasher},
+                {"favicon splitter chunks", testFavicon},
+                {"SRV answers", testSRV},
+                {"state snapshots", testSnapshot}
+        };
+
+        int failed = 0;
+        for(size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++){
+                bool passed = tests[i].run(dir);
+                printf("%s: %s\n", passed ? "PASS" : "FAIL", tests[i].name);
+                failed += !passed;
+        }
+
+        return failed ? 1 : 0;
+}
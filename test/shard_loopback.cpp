@@ -0,0 +1,658 @@
+/**
+    Minecraft Server List Protocol API.
+    Copyright (C) 2020  SkibbleBip
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+**/
+
+
+
+/***************************************************************************
+* File:  shard_loopback.cpp
+* Author:  agent
+* Procedures:
+* writeVarInt   -Encodes a protocol varint
+* readFrame     -Reads one length prefixed packet from a socket
+* serveClient   -Answers the status and ping requests of one connection
+* runServers    -Local stand-in Minecraft servers the shards probe
+* listenLoopback        -Opens a listening socket on a loopback port
+* freePort      -Finds a loopback port nobody listens on
+* connectCoordinator    -Connects to a coordinator that may not listen yet
+* returnShard   -Takes a shard and answers it with a forged result
+* checkLog      -Checks that a merged log holds one answer per target
+* testRemote    -Scans over serve() and two runWorker() connections
+* testDeadline  -Checks that serve() gives up on a stalled worker
+* testHostile   -Checks that serve() turns away bad workers and results
+* testLocal     -Scans with forked local shard processes
+* main          -Runs the loopback tests
+***************************************************************************/
+
+/**Loopback test of the sharded scan. Stand-in servers listen on 127.0.0.1,
+*a coordinator hands the shards out to two workers over the worker protocol
+*and the merged log has to hold exactly one answered record per target.
+*Unix only, as runLocal() forks
+**/
+
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <poll.h>
+#include <unistd.h>
+#include "MinecraftPing.h"
+
+
+#define TEST_SERVERS 24
+#define TEST_SHARDS 5
+#define TEST_WORKERS 2
+#define TEST_DEADLINE 60
+#define CONNECT_ATTEMPTS 100
+
+static const char statusJSON[] = "{\"version\":{\"name\":\"1.20.4\","
+        "\"protocol\":765},\"players\":{\"max\":20,\"online\":1},"
+        "\"description\":{\"text\":\"loopback\"}}";
+static int listeners[TEST_SERVERS];
+static uint16_t ports[TEST_SERVERS];
+static std::atomic<bool> stopping(false);
+
+
+/***************************************************************************
+* static size_t writeVarInt(uint8_t* buffer, uint32_t value)
+* Author: agent
+* Date: 10/19/2026
+* Description: Encodes a protocol varint
+*
+* Parameters:
+*        buffer I/O     uint8_t*        buffer to write to, 5 bytes at most
+*        value  I/P     uint32_t        value to encode
+*        writeVarInt    O/P     size_t  number of bytes written
+**************************************************************************/
+static size_t writeVarInt(uint8_t* buffer, uint32_t value)
+{
+        size_t n = 0;
+
+        do{
+                uint8_t b = value & 0x7f;
+                value >>= 7;
+                buffer[n++] = b | (value ? 0x80 : 0);
+        }while(value);
+
+        return n;
+}
+
+/***************************************************************************
+* static bool readFrame(int fd, uint8_t* buffer, size_t size)
+* Author: agent
+* Date: 10/19/2026
+* Description: Reads one length prefixed packet from a socket
+*
+* Parameters:
+*        fd     I/P     int     socket to read from
+*        buffer I/O     uint8_t*        buffer for the packet body
+*        size   I/P     size_t  size of the buffer
+*        readFrame      O/P     bool    false if the packet did not arrive
+**************************************************************************/
+static bool readFrame(int fd, uint8_t* buffer, size_t size)
+{
+        size_t length = 0;
+
+        for(int shift = 0; shift < 35; shift += 7){
+                uint8_t b;
+                if(recv(fd, &b, 1, 0) != 1)
+                        return false;
+                length |= (size_t)(b & 0x7f) << shift;
+                if(!(b & 0x80))
+                        break;
+        }
+        if(length > size)
+                return false;
+
+        size_t got = 0;
+        while(got < length){
+                ssize_t r = recv(fd, buffer + got, length - got, 0);
+                if(r <= 0)
+                        return false;
+                got += r;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static void serveClient(int fd)
+* Author: agent
+* Date: 10/19/2026
+* Description: Answers the handshake, status request and ping of one
+*       connection like a vanilla server does
+*
+* Parameters:
+*        fd     I/P     int     accepted connection, closed when done
+**************************************************************************/
+static void serveClient(int fd)
+{
+        uint8_t packet[512];
+        uint8_t reply[sizeof(statusJSON) + 16];
+        size_t length = sizeof(statusJSON) - 1;
+
+        if(readFrame(fd, packet, sizeof(packet))
+                                && readFrame(fd, packet, sizeof(packet))){
+                size_t n = writeVarInt(reply, length + 1
+                                + writeVarInt(packet, length));
+                reply[n++] = 0x00;
+                n += writeVarInt(reply + n, length);
+                memcpy(reply + n, statusJSON, length);
+                n += length;
+                send(fd, reply, n, 0);
+
+                if(readFrame(fd, packet, sizeof(packet))){
+                        uint8_t pong[10];
+                        pong[0] = 9;
+                        memcpy(pong + 1, packet, 9);
+                        send(fd, pong, sizeof(pong), 0);
+                }
+        }
+
+        close(fd);
+}
+
+/***************************************************************************
+* static void runServers(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Local stand-in Minecraft servers, one listener per target so
+*       every target of the list is a distinct host:port
+*
+* Parameters:
+**************************************************************************/
+static void runServers(void)
+{
+        struct pollfd fds[TEST_SERVERS];
+
+        for(int i = 0; i < TEST_SERVERS; i++){
+                fds[i].fd     = listeners[i];
+                fds[i].events = POLLIN;
+        }
+
+        while(!stopping){
+                if(poll(fds, TEST_SERVERS, 100) <= 0)
+                        continue;
+
+                for(int i = 0; i < TEST_SERVERS; i++){
+                        if(!(fds[i].revents & POLLIN))
+                                continue;
+                        int fd = accept(listeners[i], NULL, NULL);
+                        if(fd >= 0)
+                                std::thread(serveClient, fd).detach();
+                }
+        }
+}
+
+/***************************************************************************
+* static int listenLoopback(uint16_t* port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Opens a listening socket on an unused loopback port
+*
+* Parameters:
+*        port   I/O     uint16_t*       port the socket listens on
+*        listenLoopback O/P     int     listening socket, -1 on failure
+**************************************************************************/
+static int listenLoopback(uint16_t* port)
+{
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+
+        if(fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0
+                        || listen(fd, 64) < 0
+                        || getsockname(fd, (struct sockaddr*)&address,
+                                                                &length) < 0){
+                if(fd >= 0)
+                        close(fd);
+                return -1;
+        }
+
+        *port = ntohs(address.sin_port);
+        return fd;
+}
+
+/***************************************************************************
+* static uint16_t freePort(void)
+* Author: agent
+* Date: 10/19/2026
+* Description: Finds a loopback port nobody listens on, for the coordinator
+*
+* Parameters:
+*        freePort       O/P     uint16_t        free port, 0 on failure
+**************************************************************************/
+static uint16_t freePort(void)
+{
+        uint16_t port = 0;
+        int fd = listenLoopback(&port);
+        if(fd >= 0)
+                close(fd);
+
+        return port;
+}
+
+/***************************************************************************
+* static int connectCoordinator(uint16_t port)
+* Author: agent
+* Date: 10/19/2026
+* Description: Connects to a coordinator on a loopback port, retrying while
+*       it is not listening yet. Receives time out after a few seconds
+*
+* Parameters:
+*        port   I/P     uint16_t        port of the coordinator
+*        connectCoordinator     O/P     int     connected socket, -1 on
+*                                               failure
+**************************************************************************/
+static int connectCoordinator(uint16_t port)
+{
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family      = AF_INET;
+        address.sin_port        = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        for(int a = 0; a < CONNECT_ATTEMPTS; a++){
+                int fd = socket(AF_INET, SOCK_STREAM, 0);
+                if(fd >= 0 && connect(fd, (struct sockaddr*)&address,
+                                                        sizeof(address)) == 0){
+                        struct timeval timeout = {5, 0};
+                        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                                                        sizeof(timeout));
+                        return fd;
+                }
+                if(fd >= 0)
+                        close(fd);
+                usleep(20000);
+        }
+
+        return -1;
+}
+
+/***************************************************************************
+* static bool returnShard(uint16_t port, unsigned long long logBytes,
+*                                                       const char* log)
+* Author: agent
+* Date: 10/19/2026
+* Description: Connects with the right token, takes a shard and answers it
+*       with a forged result, then checks that the coordinator hangs up
+*
+* Parameters:
+*        port   I/P     uint16_t        port of the coordinator
+*        logBytes       I/P     unsigned long long      log size to announce
+*        log    I/P     const char*     log bytes to send, nullptr to send
+*                                       nothing after the announcement
+*        returnShard    O/P     bool    true if the result was refused
+**************************************************************************/
+static bool returnShard(uint16_t port, unsigned long long logBytes,
+                                                        const char* log)
+{
+        int fd = connectCoordinator(port);
+        if(fd < 0)
+                return false;
+
+        char line[128];
+        size_t n = 0;
+        unsigned shard;
+        int mode;
+        size_t length;
+        bool refused = send(fd, "HELLO s3cret\n", 13, 0) == 13;
+
+        while(refused && n < sizeof(line) - 1 && recv(fd, &line[n], 1, 0) == 1
+                                                        && line[n] != '\n')
+                n++;
+        line[n] = '\0';
+        refused = refused && sscanf(line, "SHARD %u %d %zu", &shard, &mode,
+                                                                &length) == 3;
+
+        for(size_t got = 0; refused && got < length; got++)
+                refused = recv(fd, line, 1, 0) == 1;
+        /*the shard's targets are not needed*/
+
+        if(refused){
+                n = snprintf(line, sizeof(line), "RESULT %u %llu 0\n", shard,
+                                                                logBytes);
+                refused = send(fd, line, n, 0) == (ssize_t)n
+                        && (log == nullptr
+                        || send(fd, log, logBytes, 0) == (ssize_t)logBytes)
+                        && recv(fd, line, 1, 0) == 0;
+        }
+
+        close(fd);
+        return refused;
+}
+
+/***************************************************************************
+* static bool checkLog(const char* path)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks that a merged log holds exactly one answered record
+*       for every target
+*
+* Parameters:
+*        path   I/P     const char*     merged log
+*        checkLog       O/P     bool    true if the log is complete
+**************************************************************************/
+static bool checkLog(const char* path)
+{
+        BinaryLogReader reader;
+        bool seen[TEST_SERVERS] = {false};
+
+        if(reader.open(path) != OK){
+                printf("  cannot open %s\n", path);
+                return false;
+        }
+        if(reader.size() != TEST_SERVERS){
+                printf("  %zu records, expected %d\n", reader.size(),
+                                                        TEST_SERVERS);
+                return false;
+        }
+
+        for(size_t i = 0; i < reader.size(); i++){
+                PingResult r;
+                if(!reader.get(i, &r) || r.error != OK
+                                || r.response == nullptr
+                                || strstr(r.response, "loopback") == nullptr){
+                        printf("  record %zu was not answered\n", i);
+                        return false;
+                }
+
+                int server = -1;
+                for(int k = 0; k < TEST_SERVERS; k++){
+                        if(ports[k] == r.port)
+                                server = k;
+                }
+                if(server < 0 || seen[server]){
+                        printf("  record %zu has an unknown or repeated "
+                                        "port %u\n", i, r.port);
+                        return false;
+                }
+                seen[server] = true;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static bool testRemote(TargetList* list, const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs serve() and two runWorker() connections over the
+*       loopback interface and checks the merged log
+*
+* Parameters:
+*        list   I/P     TargetList*     targets to scan
+*        dir    I/P     const char*     directory for the logs
+*        testRemote     O/P     bool    true if the test passed
+**************************************************************************/
+static bool testRemote(TargetList* list, const char* dir)
+{
+        char output[512];
+        char work[TEST_WORKERS][512];
+        int scanned[TEST_WORKERS];
+        int merged = 0;
+        uint16_t port = freePort();
+
+        snprintf(output, sizeof(output), "%s/remote.log", dir);
+
+        ScanCoordinator coordinator(list, TEST_SHARDS);
+        coordinator.setDeadline(TEST_DEADLINE);
+
+        std::thread server([&]{ merged = coordinator.serve(port, output); });
+
+        std::vector<std::thread> workers;
+        for(int i = 0; i < TEST_WORKERS; i++){
+                snprintf(work[i], sizeof(work[i]), "%s/work%d.log", dir, i);
+                workers.push_back(std::thread([&, i]{
+                        scanned[i] = CONNECT_FAILURE;
+                        for(int a = 0; a < CONNECT_ATTEMPTS
+                                        && scanned[i] == CONNECT_FAILURE; a++){
+                                scanned[i] = ScanCoordinator::runWorker(
+                                                "127.0.0.1", port, work[i]);
+                                if(scanned[i] == CONNECT_FAILURE)
+                                        usleep(20000);
+                        }
+                        /*the coordinator may not be listening yet*/
+                }));
+        }
+
+        for(size_t i = 0; i < workers.size(); i++)
+                workers[i].join();
+        server.join();
+
+        int total = 0;
+        for(int i = 0; i < TEST_WORKERS; i++){
+                if(scanned[i] < 0){
+                        printf("  worker %d failed with %d\n", i, scanned[i]);
+                        return false;
+                }
+                total += scanned[i];
+        }
+        if(total != TEST_SHARDS || merged != TEST_SERVERS){
+                printf("  workers scanned %d shards, %d records merged\n",
+                                                        total, merged);
+                return false;
+        }
+
+        return checkLog(output);
+}
+
+/***************************************************************************
+* static bool testDeadline(TargetList* list, const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Connects a worker that never answers its shard and checks
+*       that serve() gives up at the deadline instead of waiting forever
+*
+* Parameters:
+*        list   I/P     TargetList*     targets to scan
+*        dir    I/P     const char*     directory for the logs
+*        testDeadline   O/P     bool    true if the test passed
+**************************************************************************/
+static bool testDeadline(TargetList* list, const char* dir)
+{
+        char output[512];
+        int ret = OK;
+        uint16_t port = freePort();
+
+        snprintf(output, sizeof(output), "%s/deadline.log", dir);
+
+        ScanCoordinator coordinator(list, TEST_SHARDS);
+        coordinator.setDeadline(1);
+
+        uint64_t start = PollScheduler::now();
+        std::thread server([&]{ ret = coordinator.serve(port, output); });
+
+        int fd = connectCoordinator(port);
+        if(fd >= 0)
+                send(fd, "HELLO\n", 6, 0);
+        /*takes a shard and never sends its result back*/
+
+        server.join();
+        uint64_t took = PollScheduler::now() - start;
+        if(fd >= 0)
+                close(fd);
+
+        if(fd < 0 || ret != RECEIVE_FAILURE || took > 5000){
+                printf("  serve returned %d after %llu ms\n", ret,
+                                                (unsigned long long)took);
+                return false;
+        }
+
+        return true;
+}
+
+/***************************************************************************
+* static bool testHostile(TargetList* list, const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Checks that serve() refuses to listen on every interface
+*       without a token, turns away a worker with the wrong token, hands
+*       back the shards of an oversized and of a corrupt result, and still
+*       merges a complete log from the honest workers
+*
+* Parameters:
+*        list   I/P     TargetList*     targets to scan
+*        dir    I/P     const char*     directory for the logs
+*        testHostile    O/P     bool    true if the test passed
+**************************************************************************/
+static bool testHostile(TargetList* list, const char* dir)
+{
+        char output[512];
+        char work[512];
+        int merged  = 0;
+        int scanned = 0;
+        uint16_t port = freePort();
+
+        snprintf(output, sizeof(output), "%s/hostile.log", dir);
+        snprintf(work, sizeof(work), "%s/hostile_work.log", dir);
+
+        ScanCoordinator exposed(list, TEST_SHARDS);
+        if(exposed.setBindAddress("0.0.0.0") != OK
+                        || exposed.serve(port, output) != INITIALIZATION_FAILURE){
+                printf("  serve listened on every interface without a token\n");
+                return false;
+        }
+
+        ScanCoordinator coordinator(list, TEST_SHARDS);
+        coordinator.setDeadline(TEST_DEADLINE);
+        if(coordinator.setToken("s3cret") != OK
+                        || coordinator.setToken("two words") == OK){
+                printf("  setToken accepted a bad token\n");
+                return false;
+        }
+
+        std::thread server([&]{ merged = coordinator.serve(port, output); });
+
+        char c;
+        int fd = connectCoordinator(port);
+        bool turnedAway = fd >= 0 && send(fd, "HELLO guess\n", 12, 0) == 12
+                                        && recv(fd, &c, 1, 0) == 0;
+        if(fd >= 0)
+                close(fd);
+
+        bool oversized = returnShard(port, 1ULL << 40, nullptr);
+        bool corrupt   = returnShard(port, LOG_HEADER_SIZE, "not a log file!!");
+
+        for(int a = 0; a < CONNECT_ATTEMPTS && scanned >= 0
+                                        && scanned < TEST_SHARDS; a++){
+                int ret = ScanCoordinator::runWorker("127.0.0.1", port, work,
+                                                                "s3cret");
+                scanned = ret < 0 ? ret : scanned + ret;
+        }
+        server.join();
+
+        if(!turnedAway || !oversized || !corrupt || scanned != TEST_SHARDS
+                                                || merged != TEST_SERVERS){
+                printf("  turned away %d, oversized %d, corrupt %d, %d shards "
+                                "scanned, %d records merged\n", turnedAway,
+                                oversized, corrupt, scanned, merged);
+                return false;
+        }
+
+        return checkLog(output);
+}
+
+/***************************************************************************
+* static bool testLocal(TargetList* list, const char* dir)
+* Author: agent
+* Date: 10/19/2026
+* Description: Scans the shards with forked local processes and checks the
+*       merged log
+*
+* Parameters:
+*        list   I/P     TargetList*     targets to scan
+*        dir    I/P     const char*     directory for the logs
+*        testLocal      O/P     bool    true if the test passed
+**************************************************************************/
+static bool testLocal(TargetList* list, const char* dir)
+{
+        char output[512];
+        snprintf(output, sizeof(output), "%s/local.log", dir);
+
+        ScanCoordinator coordinator(list, TEST_SHARDS);
+        int merged = coordinator.runLocal(output);
+        if(merged != TEST_SERVERS){
+                printf("  runLocal returned %d\n", merged);
+                return false;
+        }
+
+        return checkLog(output);
+}
+
+/***************************************************************************
+* int main(int argc, char** argv)
+* Author: agent
+* Date: 10/19/2026
+* Description: Runs the loopback tests
+*
+* Parameters:
+*        argc   I/P     int     number of arguments
+*        argv   I/P     char**  directory for the logs, "." by default
+*        main   O/P     int     0 if every test passed
+**************************************************************************/
+int main(int argc, char** argv)
+{
+        const char* dir = argc > 1 ? argv[1] : ".";
+        char targets[TEST_SERVERS * 24];
+        size_t length = 0;
+
+        for(int i = 0; i < TEST_SERVERS; i++){
+                listeners[i] = listenLoopback(&ports[i]);
+                if(listeners[i] < 0){
+                        perror("shard_loopback: listen");
+                        return 1;
+                }
+                length += snprintf(targets + length, sizeof(targets) - length,
+                                                "127.0.0.1:%u\n", ports[i]);
+        }
+
+        TargetList list;
+        if(list.loadBuffer(targets, length) != TEST_SERVERS){
+                printf("shard_loopback: could not load the targets\n");
+                return 1;
+        }
+
+        std::thread servers(runServers);
+
+        struct{
+                const char* name;
+                bool (*run)(TargetList*, const char*);
+        }tests[] = {
+                {"remote workers", testRemote},
+                {"serve deadline", testDeadline},
+                {"hostile workers", testHostile},
+                {"local processes", testLocal}
+        };
+
+        int failed = 0;
+        for(size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++){
+                bool passed = tests[i].run(&list, dir);
+                printf("%s: %s\n", passed ? "PASS" : "FAIL", tests[i].name);
+                failed += !passed;
+        }
+
+        stopping = true;
+        servers.join();
+        for(int i = 0; i < TEST_SERVERS; i++)
+                close(listeners[i]);
+
+        return failed ? 1 : 0;
+}